@@ -0,0 +1,87 @@
+// base/kaldi-profile-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "base/kaldi-profile.h"
+
+namespace kaldi {
+
+static void ProfiledFunction(int32 n) {
+  KALDI_PROFILE_SCOPE("outer");
+  for (int32 i = 0; i < n; i++) {
+    KALDI_PROFILE_SCOPE("inner");
+    KALDI_PROFILE_COUNT("iterations", 1);
+  }
+  Sleep(0.01);
+}
+
+static void UnitTestProfileDisabled() {
+  ResetProfile();
+  ProfiledFunction(3);
+  std::ostringstream os;
+  WriteProfileFolded(os);
+  KALDI_ASSERT(os.str().empty());
+}
+
+static void UnitTestProfile() {
+  EnableProfiling("");
+  ResetProfile();
+  std::vector<std::thread> threads;
+  for (int32 t = 0; t < 3; t++)
+    threads.push_back(std::thread(ProfiledFunction, 10));
+  for (size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+  ProfiledFunction(10);
+
+  std::ostringstream folded;
+  WriteProfileFolded(folded);
+  // We slept 10ms in each "outer" scope.
+  std::istringstream is(folded.str());
+  std::string stack;
+  int64 microseconds;
+  KALDI_ASSERT(is >> stack >> microseconds && stack == "outer" &&
+               microseconds >= 4 * 10000);
+
+  std::ostringstream json;
+  WriteProfileJson(json);
+  KALDI_ASSERT(json.str().find("{\"name\": \"outer\", \"calls\": 4,") !=
+               std::string::npos);
+  KALDI_ASSERT(json.str().find("{\"name\": \"inner\", \"calls\": 40,") !=
+               std::string::npos);
+  KALDI_ASSERT(json.str().find("\"counters\": {\"iterations\": 40}") !=
+               std::string::npos);
+
+  ResetProfile();
+  std::ostringstream empty;
+  WriteProfileJson(empty);
+  KALDI_ASSERT(empty.str() == "{\"counters\": {},\n \"scopes\": []}\n");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestProfileDisabled();
+  UnitTestProfile();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,354 @@
+// base/kaldi-profile.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-profile.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "base/kaldi-error.h"
+
+namespace kaldi {
+
+bool g_kaldi_profiling_enabled = false;
+
+namespace internal {
+
+// A node in the tree of scopes that one thread has been in.
+struct ProfileNode {
+  const char *name;  // NULL for the root.
+  ProfileNode *parent;
+  std::vector<ProfileNode*> children;
+  int64 calls;
+  double seconds;
+  std::vector<std::pair<const char*, int64> > counters;
+
+  ProfileNode(const char *name, ProfileNode *parent):
+      name(name), parent(parent), calls(0), seconds(0.0) { }
+  ~ProfileNode() {
+    for (size_t i = 0; i < children.size(); i++)
+      delete children[i];
+  }
+};
+
+}  // namespace internal
+
+namespace {
+
+using internal::ProfileNode;
+
+// The profile of one thread.  Only that thread modifies it; the mutex is there
+// so that the profile can be written (or reset) while other threads are still
+// running, and it is never contended otherwise.
+struct ThreadProfile {
+  std::mutex mutex;
+  ProfileNode root;
+  ProfileNode *current;  // The innermost scope that the thread is in.
+  ThreadProfile(): root(NULL, NULL), current(&root) { }
+};
+
+// The profile merged over threads, which is what we write.  Nodes with the
+// same name under the same parent are merged.
+struct MergedNode {
+  int64 calls;
+  double seconds;
+  std::map<std::string, int64> counters;
+  std::map<std::string, MergedNode> children;
+  MergedNode(): calls(0), seconds(0.0) { }
+};
+
+void MergeNode(const ProfileNode &node, MergedNode *merged) {
+  merged->calls += node.calls;
+  merged->seconds += node.seconds;
+  for (size_t i = 0; i < node.counters.size(); i++)
+    merged->counters[node.counters[i].first] += node.counters[i].second;
+  for (size_t i = 0; i < node.children.size(); i++)
+    MergeNode(*(node.children[i]),
+              &(merged->children[node.children[i]->name]));
+}
+
+// The profiles of the running threads, and the merged profile of the threads
+// that have exited.
+struct ProfileRegistry {
+  std::mutex mutex;
+  std::vector<ThreadProfile*> threads;
+  MergedNode exited;
+  std::string filename;  // The file to write the profile to at exit, if any.
+};
+
+ProfileRegistry &GetProfileRegistry() {
+  // Allocated on first use and never freed, so that it is still there when
+  // the profile is written by the atexit() handler.
+  static ProfileRegistry *registry = new ProfileRegistry();
+  return *registry;
+}
+
+// Owns the profile of a thread.  When the thread exits, the destructor merges
+// the profile into the registry's profile of exited threads and frees it, so
+// programs that start a thread per task don't accumulate a profile per thread.
+struct ThreadProfileOwner {
+  ThreadProfile *profile;
+  ThreadProfileOwner(): profile(NULL) { }
+  ~ThreadProfileOwner();
+};
+
+thread_local ThreadProfileOwner thread_profile_owner;
+// Set when thread_profile_owner has been destroyed; from then on, this thread
+// records nothing.
+thread_local bool thread_profile_done = false;
+
+ThreadProfileOwner::~ThreadProfileOwner() {
+  thread_profile_done = true;
+  if (profile == NULL)
+    return;
+  ProfileRegistry &registry = GetProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  MergeNode(profile->root, &registry.exited);
+  for (size_t i = 0; i < registry.threads.size(); i++) {
+    if (registry.threads[i] == profile) {
+      registry.threads.erase(registry.threads.begin() + i);
+      break;
+    }
+  }
+  delete profile;
+  profile = NULL;
+}
+
+// Returns the profile of this thread, or NULL if the thread is exiting.
+ThreadProfile *GetThreadProfile() {
+  if (thread_profile_done)
+    return NULL;
+  ThreadProfileOwner &owner = thread_profile_owner;
+  if (owner.profile == NULL) {
+    owner.profile = new ThreadProfile();
+    ProfileRegistry &registry = GetProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(owner.profile);
+  }
+  return owner.profile;
+}
+
+void GetMergedProfile(MergedNode *merged) {
+  ProfileRegistry &registry = GetProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  *merged = registry.exited;
+  for (size_t i = 0; i < registry.threads.size(); i++) {
+    ThreadProfile *profile = registry.threads[i];
+    std::lock_guard<std::mutex> thread_lock(profile->mutex);
+    MergeNode(profile->root, merged);
+  }
+}
+
+// Returns the time spent in "node" but not in its children.  (Because of
+// rounding, or because a child scope is still open, this can be slightly
+// negative; we return zero then.)
+double SelfSeconds(const MergedNode &node) {
+  double ans = node.seconds;
+  std::map<std::string, MergedNode>::const_iterator iter;
+  for (iter = node.children.begin(); iter != node.children.end(); ++iter)
+    ans -= iter->second.seconds;
+  return (ans > 0.0 ? ans : 0.0);
+}
+
+void WriteJsonString(const std::string &str, std::ostream &os) {
+  os << '"';
+  for (size_t i = 0; i < str.size(); i++) {
+    char c = str[i];
+    if (c == '"' || c == '\\') os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20) os << ' ';
+    else os << c;
+  }
+  os << '"';
+}
+
+void WriteJsonCounters(const std::map<std::string, int64> &counters,
+                       std::ostream &os) {
+  os << "{";
+  std::map<std::string, int64>::const_iterator iter;
+  for (iter = counters.begin(); iter != counters.end(); ++iter) {
+    if (iter != counters.begin()) os << ", ";
+    WriteJsonString(iter->first, os);
+    os << ": " << iter->second;
+  }
+  os << "}";
+}
+
+void WriteJsonChildren(const MergedNode &node, int32 indent,
+                       std::ostream &os) {
+  std::string spaces(indent, ' ');
+  os << "[";
+  std::map<std::string, MergedNode>::const_iterator iter;
+  for (iter = node.children.begin(); iter != node.children.end(); ++iter) {
+    const MergedNode &child = iter->second;
+    os << (iter == node.children.begin() ? "\n" : ",\n")
+       << spaces << "  {\"name\": ";
+    WriteJsonString(iter->first, os);
+    os << ", \"calls\": " << child.calls
+       << ", \"seconds\": " << child.seconds
+       << ", \"self_seconds\": " << SelfSeconds(child);
+    if (!child.counters.empty()) {
+      os << ", \"counters\": ";
+      WriteJsonCounters(child.counters, os);
+    }
+    if (!child.children.empty()) {
+      os << ",\n" << spaces << "   \"children\": ";
+      WriteJsonChildren(child, indent + 3, os);
+    }
+    os << "}";
+  }
+  if (!node.children.empty())
+    os << "\n" << spaces;
+  os << "]";
+}
+
+void WriteFoldedNode(const MergedNode &node, const std::string &stack,
+                     std::ostream &os) {
+  int64 self_microseconds = static_cast<int64>(SelfSeconds(node) * 1.0e+06 +
+                                               0.5);
+  if (self_microseconds > 0)
+    os << stack << ' ' << self_microseconds << '\n';
+  std::map<std::string, MergedNode>::const_iterator iter;
+  for (iter = node.children.begin(); iter != node.children.end(); ++iter)
+    WriteFoldedNode(iter->second, stack + ';' + iter->first, os);
+}
+
+void WriteProfileAtExit() {
+  const std::string &filename = GetProfileRegistry().filename;
+  std::ofstream os(filename.c_str());
+  size_t len = filename.size();
+  if (len >= 5 && filename.compare(len - 5, 5, ".json") == 0)
+    WriteProfileJson(os);
+  else
+    WriteProfileFolded(os);
+  os.close();
+  if (!os)
+    KALDI_WARN << "Failed to write profile to " << filename;
+}
+
+}  // namespace
+
+
+namespace internal {
+
+ProfileNode *ProfileEnter(const char *name) {
+  ThreadProfile *thread_profile = GetThreadProfile();
+  if (thread_profile == NULL)
+    return NULL;
+  ThreadProfile &profile = *thread_profile;
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  ProfileNode *parent = profile.current;
+  std::vector<ProfileNode*> &children = parent->children;
+  // The same literal normally has the same address, so we compare pointers
+  // first; there are usually only a few children.
+  for (size_t i = 0; i < children.size(); i++) {
+    if (children[i]->name == name ||
+        std::strcmp(children[i]->name, name) == 0) {
+      profile.current = children[i];
+      return children[i];
+    }
+  }
+  ProfileNode *node = new ProfileNode(name, parent);
+  children.push_back(node);
+  profile.current = node;
+  return node;
+}
+
+void ProfileExit(ProfileNode *node, double seconds) {
+  ThreadProfile *thread_profile = GetThreadProfile();
+  if (thread_profile == NULL)
+    return;
+  ThreadProfile &profile = *thread_profile;
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  node->calls++;
+  node->seconds += seconds;
+  profile.current = node->parent;
+}
+
+void ProfileCount(const char *name, int64 count) {
+  ThreadProfile *thread_profile = GetThreadProfile();
+  if (thread_profile == NULL)
+    return;
+  ThreadProfile &profile = *thread_profile;
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  std::vector<std::pair<const char*, int64> > &counters =
+      profile.current->counters;
+  for (size_t i = 0; i < counters.size(); i++) {
+    if (counters[i].first == name ||
+        std::strcmp(counters[i].first, name) == 0) {
+      counters[i].second += count;
+      return;
+    }
+  }
+  counters.push_back(std::make_pair(name, count));
+}
+
+}  // namespace internal
+
+
+void EnableProfiling(const std::string &filename) {
+  ProfileRegistry &registry = GetProfileRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!filename.empty()) {
+      if (registry.filename.empty())
+        std::atexit(WriteProfileAtExit);
+      registry.filename = filename;
+    }
+  }
+  g_kaldi_profiling_enabled = true;
+}
+
+void WriteProfileJson(std::ostream &os) {
+  MergedNode merged;
+  GetMergedProfile(&merged);
+  os << std::setprecision(6) << "{\"counters\": ";
+  WriteJsonCounters(merged.counters, os);
+  os << ",\n \"scopes\": ";
+  WriteJsonChildren(merged, 1, os);
+  os << "}\n";
+}
+
+void WriteProfileFolded(std::ostream &os) {
+  MergedNode merged;
+  GetMergedProfile(&merged);
+  std::map<std::string, MergedNode>::const_iterator iter;
+  for (iter = merged.children.begin(); iter != merged.children.end(); ++iter)
+    WriteFoldedNode(iter->second, iter->first, os);
+}
+
+void ResetProfile() {
+  ProfileRegistry &registry = GetProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.exited = MergedNode();
+  for (size_t i = 0; i < registry.threads.size(); i++) {
+    ThreadProfile *profile = registry.threads[i];
+    std::lock_guard<std::mutex> thread_lock(profile->mutex);
+    for (size_t j = 0; j < profile->root.children.size(); j++)
+      delete profile->root.children[j];
+    profile->root.children.clear();
+    profile->root.counters.clear();
+    profile->current = &(profile->root);
+  }
+}
+
+}  // namespace kaldi
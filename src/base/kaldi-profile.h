@@ -0,0 +1,128 @@
+// base/kaldi-profile.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_BASE_KALDI_PROFILE_H_
+#define KALDI_BASE_KALDI_PROFILE_H_
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include "base/kaldi-types.h"
+#include "base/kaldi-utils.h"
+
+namespace kaldi {
+
+/// This file provides lightweight, built-in profiling.  Code that we want to
+/// be able to time is annotated with scopes, like
+/// \code
+///   void LatticeFasterDecoder::AdvanceDecoding(...) {
+///     KALDI_PROFILE_SCOPE("LatticeFasterDecoder::AdvanceDecoding");
+///     ...
+/// \endcode
+/// and, optionally, with counters:
+/// \code
+///     KALDI_PROFILE_COUNT("frames", num_frames);
+/// \endcode
+/// Scopes nest: the time spent in a scope is recorded separately for each
+/// chain of enclosing scopes (its "stack"), like a call graph, and counters
+/// are recorded for the innermost enclosing scope.  Each thread records into
+/// its own tree, so recording needs no locking between threads; when a thread
+/// exits its tree is merged into the profile of the exited threads and freed,
+/// and the trees of the running threads are merged with that when the profile
+/// is written.
+///
+/// Profiling is off by default, in which case a scope or counter costs one
+/// test of a global bool.  All programs that use ParseOptions accept the
+/// option --profile=<filename>, which turns it on and writes the profile to
+/// that file when the program exits: as JSON if the filename ends in ".json",
+/// and otherwise in the "folded stacks" format that flame-graph tools (e.g.
+/// flamegraph.pl) read, with the self-time of each stack in microseconds.
+
+/// True if profiling is enabled; don't set this directly, use
+/// EnableProfiling().
+extern bool g_kaldi_profiling_enabled;
+
+/// Turns on profiling.  If "filename" is nonempty, the profile will be
+/// written to it when the program exits (see the comment at the top of this
+/// file for the format).
+void EnableProfiling(const std::string &filename);
+
+/// Writes the profile collected so far, merged over threads, as JSON.
+void WriteProfileJson(std::ostream &os);
+
+/// Writes the profile collected so far, merged over threads, as folded stacks:
+/// one line per stack, like "Compute;Propagate 1234", where the number is the
+/// time in microseconds spent in that stack but not in any scope nested
+/// inside it.
+void WriteProfileFolded(std::ostream &os);
+
+/// Clears the profile collected so far.  Must not be called while any thread
+/// is inside a scope.  This is mainly for testing.
+void ResetProfile();
+
+namespace internal {
+struct ProfileNode;
+// These are called by ProfileScope and KALDI_PROFILE_COUNT when profiling is
+// enabled.  "name" must be a string literal, or at least a string that
+// outlives the program's profiling.
+ProfileNode *ProfileEnter(const char *name);
+void ProfileExit(ProfileNode *node, double seconds);
+void ProfileCount(const char *name, int64 count);
+}  // namespace internal
+
+/// ProfileScope records the time between its construction and its destruction
+/// under the scope "name", which must be a string literal.  Use it via
+/// KALDI_PROFILE_SCOPE.
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char *name): node_(NULL) {
+    if (g_kaldi_profiling_enabled) {
+      node_ = internal::ProfileEnter(name);
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+  ~ProfileScope() {
+    if (node_ != NULL) {
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start_;
+      internal::ProfileExit(node_, elapsed.count());
+    }
+  }
+ private:
+  internal::ProfileNode *node_;
+  std::chrono::steady_clock::time_point start_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ProfileScope);
+};
+
+}  // namespace kaldi
+
+#define KALDI_PROFILE_CONCAT_(a, b) a ## b
+#define KALDI_PROFILE_CONCAT(a, b) KALDI_PROFILE_CONCAT_(a, b)
+
+/// Times the rest of the enclosing block under the scope "name".
+#define KALDI_PROFILE_SCOPE(name) \
+  ::kaldi::ProfileScope KALDI_PROFILE_CONCAT(kaldi_profile_scope_, \
+                                             __LINE__)(name)
+
+/// Adds "count" to the counter "name" of the innermost enclosing scope.
+#define KALDI_PROFILE_COUNT(name, count) \
+  do { if (::kaldi::g_kaldi_profiling_enabled) \
+      ::kaldi::internal::ProfileCount(name, count); } while (0)
+
+#endif  // KALDI_BASE_KALDI_PROFILE_H_
@@ -0,0 +1,207 @@
+// bench/bench-decoder.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "bench/bench-utils.h"
+#include "decoder/decodable-matrix.h"
+#include "decoder/lattice-faster-decoder.h"
+#include "fstext/rand-fst.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "lat/kaldi-lattice.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+
+// Returns a random decoding graph, generated by RandFst(), with input labels
+// (pdf indexes plus one, as for DecodableMatrixScaled) in 1 ... num_pdfs and
+// output labels (words) in 1 ... num_words, except that a proportion of about
+// "epsilon_proportion" of the arcs have epsilon input labels.  We only put
+// epsilons on arcs to higher-numbered states, so there are no epsilon cycles;
+// real decoding graphs don't have them either.
+fst::VectorFst<fst::StdArc> *RandDecodingGraph(int32 num_states,
+                                               int32 num_arcs,
+                                               int32 num_pdfs,
+                                               int32 num_words,
+                                               BaseFloat epsilon_proportion) {
+  using namespace fst;
+  RandFstOptions opts;
+  opts.n_syms = 1;  // We'll set the labels below.
+  opts.n_states = num_states;
+  opts.n_arcs = num_arcs;
+  opts.n_final = std::max(1, num_states / 100);
+  opts.allow_empty = false;
+  opts.acyclic = false;
+  opts.weight_multiplier = 0.5;
+  VectorFst<StdArc> *fst = RandFst<StdArc>(opts);
+  for (StateIterator<VectorFst<StdArc> > siter(*fst); !siter.Done();
+       siter.Next()) {
+    StdArc::StateId s = siter.Value();
+    for (MutableArcIterator<VectorFst<StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      StdArc arc = aiter.Value();
+      if (arc.nextstate > s && RandUniform() < epsilon_proportion)
+        arc.ilabel = 0;
+      else
+        arc.ilabel = RandInt(1, num_pdfs);
+      // Most arcs have no word on them, as in a real graph.
+      arc.olabel = (RandInt(0, 9) == 0 ? RandInt(1, num_words) : 0);
+      aiter.SetValue(arc);
+    }
+  }
+  return fst;
+}
+
+// Outputs random log-likelihoods that look a bit like the log-posteriors of a
+// neural net: each row is the log-softmax of Gaussian noise.
+void RandLogLikes(int32 num_frames, int32 num_pdfs,
+                  Matrix<BaseFloat> *loglikes) {
+  loglikes->Resize(num_frames, num_pdfs);
+  loglikes->SetRandn();
+  loglikes->Scale(3.0);
+  for (int32 t = 0; t < num_frames; t++) {
+    SubVector<BaseFloat> row(*loglikes, t);
+    row.Add(-row.LogSumExp());
+  }
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Benchmark LatticeFasterDecoder and lattice determinization on a\n"
+        "random decoding graph (generated by RandFst()) with random\n"
+        "log-likelihoods.  Writes the real-time factor, latency percentiles\n"
+        "(per utterance) and peak memory as one line of JSON for decoding\n"
+        "and one for determinization.\n"
+        "\n"
+        "Usage:  bench-decoder [options]\n"
+        "e.g.: bench-decoder --num-states=100000 --output=results.jsonl\n";
+
+    ParseOptions po(usage);
+    BenchmarkOptions bench_opts;
+    LatticeFasterDecoderConfig decoder_opts;
+    int32 num_states = 20000, num_arcs = 100000, num_pdfs = 2000,
+        num_words = 5000, utt_frames = 300;
+    BaseFloat epsilon_proportion = 0.1, acoustic_scale = 0.1,
+        frame_shift = 0.03;
+
+    bench_opts.num_iters = 20;
+    decoder_opts.max_active = 7000;
+    bench_opts.Register(&po);
+    decoder_opts.Register(&po);
+    po.Register("num-states", &num_states, "Number of states in the random "
+                "decoding graph.");
+    po.Register("num-arcs", &num_arcs, "Number of arcs in the random "
+                "decoding graph.");
+    po.Register("num-pdfs", &num_pdfs, "Number of pdfs (distinct input "
+                "labels) in the decoding graph.");
+    po.Register("num-words", &num_words, "Number of distinct words (output "
+                "labels) in the decoding graph.");
+    po.Register("epsilon-proportion", &epsilon_proportion, "Approximate "
+                "proportion of arcs in the decoding graph with epsilon input "
+                "labels.");
+    po.Register("utt-frames", &utt_frames, "Number of frames per utterance.");
+    po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
+                "acoustic likelihoods.");
+    po.Register("frame-shift", &frame_shift, "Frame shift in seconds, used "
+                "to compute the real-time factor (e.g. 0.03 for chain models).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 0 || num_states <= 0 || num_pdfs <= 0 ||
+        num_words <= 0 || utt_frames <= 0) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    srand(bench_opts.seed);
+    fst::VectorFst<fst::StdArc> *graph = RandDecodingGraph(
+        num_states, num_arcs, num_pdfs, num_words, epsilon_proportion);
+    const int32 num_utts = 4;
+    std::vector<Matrix<BaseFloat> > loglikes(num_utts);
+    for (int32 i = 0; i < num_utts; i++)
+      RandLogLikes(utt_frames, num_pdfs, &(loglikes[i]));
+
+    LatticeFasterDecoder decoder(*graph, decoder_opts);
+    fst::DeterminizeLatticePrunedOptions det_opts;
+    det_opts.max_mem = decoder_opts.det_opts.max_mem;
+
+    BenchmarkResult decode_result("lattice-faster-decoder"),
+        determinize_result("lattice-determinize-pruned");
+    double raw_lattice_arcs = 0, lattice_arcs = 0;
+    int32 num_failed = 0;
+    for (int32 i = -bench_opts.num_warmup_iters; i < bench_opts.num_iters;
+         i++) {
+      DecodableMatrixScaled decodable(
+          loglikes[(i + bench_opts.num_warmup_iters) % num_utts],
+          acoustic_scale);
+      Timer decode_timer;
+      bool ok = decoder.Decode(&decodable);
+      double decode_seconds = decode_timer.Elapsed();
+
+      Lattice lat;
+      CompactLattice clat;
+      if (ok)
+        ok = decoder.GetRawLattice(&lat);
+      Timer determinize_timer;
+      if (ok) {
+        // This is what LatticeFasterDecoder::GetLattice() does.
+        Invert(&lat);
+        fst::ILabelCompare<LatticeArc> ilabel_comp;
+        ArcSort(&lat, ilabel_comp);
+        ok = DeterminizeLatticePruned(lat, decoder_opts.lattice_beam, &clat,
+                                      det_opts);
+      }
+      double determinize_seconds = determinize_timer.Elapsed();
+      if (i < 0)
+        continue;
+      if (!ok) {
+        num_failed++;
+        continue;
+      }
+      double data_seconds = utt_frames * frame_shift;
+      decode_result.AddIteration(decode_seconds, data_seconds);
+      determinize_result.AddIteration(determinize_seconds, data_seconds);
+      for (int32 s = 0; s < lat.NumStates(); s++)
+        raw_lattice_arcs += lat.NumArcs(s);
+      for (int32 s = 0; s < clat.NumStates(); s++)
+        lattice_arcs += clat.NumArcs(s);
+    }
+    if (num_failed != 0)
+      KALDI_WARN << "Decoding or determinization failed for " << num_failed
+                 << " utterances.";
+    int32 n = std::max(decode_result.NumIterations(), 1);
+    decode_result.AddInfo("graph_states", graph->NumStates());
+    decode_result.AddInfo("utt_frames", utt_frames);
+    decode_result.AddInfo("failed", num_failed);
+    decode_result.AddInfo("mean_raw_lattice_arcs", raw_lattice_arcs / n);
+    decode_result.Write(bench_opts.output);
+    determinize_result.AddInfo("mean_raw_lattice_arcs", raw_lattice_arcs / n);
+    determinize_result.AddInfo("mean_lattice_arcs", lattice_arcs / n);
+    determinize_result.Write(bench_opts.output);
+    delete graph;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,124 @@
+// bench/bench-features.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "bench/bench-utils.h"
+#include "feat/feature-fbank.h"
+#include "feat/feature-mfcc.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+
+// Times feature extraction with "computer" on "waves", which are used
+// cyclically.
+template<class F>
+void BenchmarkFeatures(const std::string &name,
+                       const BenchmarkOptions &bench_opts,
+                       const std::vector<Vector<BaseFloat> > &waves,
+                       BaseFloat samp_freq, OfflineFeatureTpl<F> *computer) {
+  BenchmarkResult result(name);
+  Matrix<BaseFloat> features;
+  int64 num_frames = 0;
+  for (int32 i = -bench_opts.num_warmup_iters; i < bench_opts.num_iters; i++) {
+    const Vector<BaseFloat> &wave =
+        waves[(i + bench_opts.num_warmup_iters) % waves.size()];
+    Timer timer;
+    computer->Compute(wave, 1.0, &features);
+    double elapsed = timer.Elapsed();
+    if (i >= 0) {
+      result.AddIteration(elapsed, wave.Dim() / samp_freq);
+      num_frames += features.NumRows();
+    }
+  }
+  result.AddInfo("frames", num_frames);
+  result.AddInfo("dim", features.NumCols());
+  result.Write(bench_opts.output);
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Benchmark MFCC and filterbank feature extraction on synthetic audio.\n"
+        "Writes the real-time factor, latency percentiles (per utterance) and\n"
+        "peak memory, one line of JSON per feature type.\n"
+        "\n"
+        "Usage:  bench-features [options]\n"
+        "e.g.: bench-features --num-iters=200 --output=results.jsonl\n"
+        "Options with the prefix --fbank. apply to the filterbank features.\n";
+
+    ParseOptions po(usage);
+    BenchmarkOptions bench_opts;
+    MfccOptions mfcc_opts;
+    FbankOptions fbank_opts;
+    BaseFloat utt_length = 5.0;
+    int32 num_utts = 10;
+    std::string feature_types = "mfcc,fbank";
+
+    bench_opts.Register(&po);
+    mfcc_opts.Register(&po);
+    ParseOptions po_fbank("fbank", &po);
+    fbank_opts.Register(&po_fbank);
+    po.Register("utt-length", &utt_length, "Length of each synthetic "
+                "utterance, in seconds.");
+    po.Register("num-utts", &num_utts, "Number of distinct synthetic "
+                "utterances; the iterations cycle through them.");
+    po.Register("feature-types", &feature_types, "Comma-separated list of "
+                "feature types to benchmark, from: mfcc, fbank.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 0 || num_utts <= 0 || utt_length <= 0.0) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    srand(bench_opts.seed);
+    BaseFloat samp_freq = mfcc_opts.frame_opts.samp_freq;
+    if (fbank_opts.frame_opts.samp_freq != samp_freq)
+      KALDI_ERR << "--sample-frequency and --fbank.sample-frequency differ.";
+    std::vector<Vector<BaseFloat> > waves(num_utts);
+    for (int32 i = 0; i < num_utts; i++)
+      GenerateSyntheticWave(static_cast<int32>(utt_length * samp_freq),
+                            samp_freq, &(waves[i]));
+
+    std::vector<std::string> types;
+    SplitStringToVector(feature_types, ",", true, &types);
+    for (size_t i = 0; i < types.size(); i++) {
+      if (types[i] == "mfcc") {
+        Mfcc mfcc(mfcc_opts);
+        BenchmarkFeatures("features-mfcc", bench_opts, waves, samp_freq,
+                          &mfcc);
+      } else if (types[i] == "fbank") {
+        Fbank fbank(fbank_opts);
+        BenchmarkFeatures("features-fbank", bench_opts, waves, samp_freq,
+                          &fbank);
+      } else {
+        KALDI_ERR << "Unknown feature type " << types[i];
+      }
+    }
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
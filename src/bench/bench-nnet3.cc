@@ -0,0 +1,168 @@
+// bench/bench-nnet3.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "bench/bench-utils.h"
+#include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-optimize.h"
+#include "nnet3/nnet-utils.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Returns the config of a TDNN with "num_layers" hidden layers of dimension
+// "hidden_dim" with ReLUs, each of which splices its input at offsets -1, 0, 1
+// (for the first layer) or -3, 0, 3 (for the others), followed by an output
+// layer with a log-softmax.
+std::string TdnnConfig(int32 input_dim, int32 hidden_dim, int32 num_layers,
+                       int32 output_dim) {
+  std::ostringstream os;
+  os << "input-node name=input dim=" << input_dim << "\n";
+  std::string prev = "input";
+  int32 prev_dim = input_dim;
+  for (int32 l = 1; l <= num_layers; l++) {
+    int32 offset = (l == 1 ? 1 : 3);
+    os << "component name=affine" << l << " type=AffineComponent input-dim="
+       << (3 * prev_dim) << " output-dim=" << hidden_dim << "\n"
+       << "component-node name=affine" << l << " component=affine" << l
+       << " input=Append(Offset(" << prev << "," << -offset << ")," << prev
+       << ",Offset(" << prev << "," << offset << "))\n"
+       << "component name=relu" << l << " type=RectifiedLinearComponent dim="
+       << hidden_dim << "\n"
+       << "component-node name=relu" << l << " component=relu" << l
+       << " input=affine" << l << "\n";
+    std::ostringstream name;
+    name << "relu" << l;
+    prev = name.str();
+    prev_dim = hidden_dim;
+  }
+  os << "component name=final-affine type=AffineComponent input-dim="
+     << prev_dim << " output-dim=" << output_dim << "\n"
+     << "component-node name=final-affine component=final-affine input="
+     << prev << "\n"
+     << "component name=final-log-softmax type=LogSoftmaxComponent dim="
+     << output_dim << "\n"
+     << "component-node name=final-log-softmax component=final-log-softmax "
+     << "input=final-affine\n"
+     << "output-node name=output input=final-log-softmax\n";
+  return os.str();
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    const char *usage =
+        "Benchmark nnet3 inference on the CPU (NnetComputer) for a randomly\n"
+        "initialized TDNN, computing the output for one chunk of frames per\n"
+        "iteration, as in decoding.  Writes the real-time factor, latency\n"
+        "percentiles (per chunk) and peak memory as one line of JSON.\n"
+        "\n"
+        "Usage:  bench-nnet3 [options]\n"
+        "e.g.: bench-nnet3 --hidden-dim=1024 --output=results.jsonl\n";
+
+    ParseOptions po(usage);
+    BenchmarkOptions bench_opts;
+    NnetOptimizeOptions optimize_opts;
+    NnetComputeOptions compute_opts;
+    int32 input_dim = 40, hidden_dim = 512, num_layers = 6,
+        output_dim = 3000, chunk_size = 50;
+    BaseFloat frame_shift = 0.01;
+
+    bench_opts.Register(&po);
+    // register the optimization options with the prefix "optimization".
+    ParseOptions optimization_po("optimization", &po);
+    optimize_opts.Register(&optimization_po);
+    po.Register("input-dim", &input_dim, "Dimension of the input features.");
+    po.Register("hidden-dim", &hidden_dim, "Dimension of the hidden layers.");
+    po.Register("num-layers", &num_layers, "Number of hidden layers.");
+    po.Register("output-dim", &output_dim, "Dimension of the output (e.g. "
+                "the number of pdfs).");
+    po.Register("chunk-size", &chunk_size, "Number of output frames "
+                "computed per iteration.");
+    po.Register("frame-shift", &frame_shift, "Frame shift in seconds, used "
+                "to compute the real-time factor.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 0 || num_layers <= 0 || chunk_size <= 0) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    srand(bench_opts.seed);
+    Nnet nnet;
+    {
+      std::istringstream is(TdnnConfig(input_dim, hidden_dim, num_layers,
+                                       output_dim));
+      nnet.ReadConfig(is);
+    }
+    int32 left_context, right_context;
+    ComputeSimpleNnetContext(nnet, &left_context, &right_context);
+
+    ComputationRequest request;
+    request.inputs.push_back(IoSpecification("input", -left_context,
+                                             chunk_size + right_context));
+    request.outputs.push_back(IoSpecification("output", 0, chunk_size));
+    CachingOptimizingCompiler compiler(nnet, optimize_opts);
+    Timer compile_timer;
+    std::shared_ptr<const NnetComputation> computation =
+        compiler.Compile(request);
+    double compile_seconds = compile_timer.Elapsed();
+
+    int32 num_input_frames = chunk_size + left_context + right_context;
+    std::vector<Matrix<BaseFloat> > inputs(4);
+    for (size_t i = 0; i < inputs.size(); i++) {
+      inputs[i].Resize(num_input_frames, input_dim);
+      inputs[i].SetRandn();
+    }
+
+    BenchmarkResult result("nnet3-compute");
+    CuMatrix<BaseFloat> input, output;
+    for (int32 i = -bench_opts.num_warmup_iters; i < bench_opts.num_iters;
+         i++) {
+      input = inputs[(i + bench_opts.num_warmup_iters) % inputs.size()];
+      Timer timer;
+      NnetComputer computer(compute_opts, *computation, nnet, NULL);
+      computer.AcceptInput("input", &input);
+      computer.Run();
+      computer.GetOutputDestructive("output", &output);
+      double elapsed = timer.Elapsed();
+      if (i >= 0)
+        result.AddIteration(elapsed, chunk_size * frame_shift);
+    }
+    result.AddInfo("num_parameters", NumParameters(nnet));
+    result.AddInfo("chunk_size", chunk_size);
+    result.AddInfo("left_context", left_context);
+    result.AddInfo("right_context", right_context);
+    result.AddInfo("compile_ms", 1000.0 * compile_seconds);
+    result.Write(bench_opts.output);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
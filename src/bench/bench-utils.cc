@@ -0,0 +1,136 @@
+// bench/bench-utils.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "bench/bench-utils.h"
+#include "util/kaldi-io.h"
+
+#if !defined(_MSC_VER)
+#include <sys/resource.h>
+#endif
+
+namespace kaldi {
+
+void BenchmarkResult::AddIteration(double seconds, double data_seconds) {
+  times_.push_back(seconds);
+  data_seconds_ += data_seconds;
+}
+
+void BenchmarkResult::AddInfo(const std::string &key, double value) {
+  info_.push_back(std::make_pair(key, value));
+}
+
+double BenchmarkResult::Percentile(double percent) const {
+  if (times_.empty())
+    return 0.0;
+  std::vector<double> sorted(times_);
+  std::sort(sorted.begin(), sorted.end());
+  // We use the nearest-rank method.
+  size_t rank = static_cast<size_t>(percent / 100.0 * sorted.size() + 0.999);
+  rank = std::max<size_t>(rank, 1);
+  return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+void BenchmarkResult::Write(std::ostream &os) const {
+  double total_seconds = 0.0;
+  for (size_t i = 0; i < times_.size(); i++)
+    total_seconds += times_[i];
+  int32 num_iters = times_.size();
+  os << std::setprecision(6)
+     << "{\"benchmark\": \"" << name_ << "\""
+     << ", \"iterations\": " << num_iters
+     << ", \"total_seconds\": " << total_seconds
+     << ", \"mean_ms\": "
+     << (num_iters > 0 ? 1000.0 * total_seconds / num_iters : 0.0)
+     << ", \"p50_ms\": " << 1000.0 * Percentile(50.0)
+     << ", \"p90_ms\": " << 1000.0 * Percentile(90.0)
+     << ", \"p99_ms\": " << 1000.0 * Percentile(99.0)
+     << ", \"max_ms\": " << 1000.0 * Percentile(100.0);
+  if (data_seconds_ > 0.0)
+    os << ", \"real_time_factor\": " << total_seconds / data_seconds_;
+  os << ", \"peak_memory_mb\": " << PeakMemoryMegabytes();
+  for (size_t i = 0; i < info_.size(); i++)
+    os << ", \"" << info_[i].first << "\": " << info_[i].second;
+  os << "}\n";
+}
+
+void BenchmarkResult::Write(const std::string &wxfilename) const {
+  std::ostringstream os;
+  Write(os);
+  KALDI_LOG << os.str();
+  if (ClassifyWxfilename(wxfilename) == kFileOutput) {
+    // Append, so that the results of several benchmarks can be collected in
+    // one file.
+    std::ofstream file(wxfilename.c_str(), std::ios_base::app);
+    file << os.str();
+    file.close();
+    if (!file)
+      KALDI_ERR << "Error writing benchmark results to " << wxfilename;
+  } else {
+    Output output(wxfilename, false, false);
+    output.Stream() << os.str();
+    if (!output.Close())
+      KALDI_ERR << "Error writing benchmark results to "
+                << PrintableWxfilename(wxfilename);
+  }
+}
+
+double PeakMemoryMegabytes() {
+#if defined(_MSC_VER)
+  return 0.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);  // in bytes on Mac.
+#else
+  return usage.ru_maxrss / 1024.0;  // in kilobytes on Linux.
+#endif
+#endif
+}
+
+void GenerateSyntheticWave(int32 num_samples, BaseFloat samp_freq,
+                           Vector<BaseFloat> *wave) {
+  wave->Resize(num_samples);
+  double pitch = 100.0 + 100.0 * RandUniform(),  // in Hz.
+      phase = 0.0,
+      syllable_rate = 3.0 + 2.0 * RandUniform();
+  const int32 num_harmonics = 8;
+  Vector<double> harmonic_amplitudes(num_harmonics);
+  for (int32 h = 0; h < num_harmonics; h++)
+    harmonic_amplitudes(h) = RandUniform() / (h + 1);
+  for (int32 i = 0; i < num_samples; i++) {
+    // The pitch does a random walk within [80, 250] Hz.
+    pitch = std::min(250.0, std::max(80.0, pitch + 0.01 * RandGauss()));
+    phase += 2.0 * M_PI * pitch / samp_freq;
+    if (phase > 2.0 * M_PI) phase -= 2.0 * M_PI;
+    double t = i / samp_freq,
+        envelope = 0.5 * (1.0 - cos(2.0 * M_PI * syllable_rate * t)),
+        sample = 0.0;
+    for (int32 h = 0; h < num_harmonics; h++)
+      sample += harmonic_amplitudes(h) * sin((h + 1) * phase);
+    (*wave)(i) = 8000.0 * envelope * sample + 100.0 * RandGauss();
+  }
+}
+
+}  // namespace kaldi
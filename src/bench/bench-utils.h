@@ -0,0 +1,110 @@
+// bench/bench-utils.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_BENCH_BENCH_UTILS_H_
+#define KALDI_BENCH_BENCH_UTILS_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "matrix/kaldi-vector.h"
+
+namespace kaldi {
+
+/// This directory contains end-to-end benchmarks of the main parts of a
+/// recognizer: bench-features (MFCC and filterbank extraction), bench-nnet3
+/// (nnet3 inference on the CPU) and bench-decoder (LatticeFasterDecoder and
+/// lattice determinization).  They are not built by default; do "make bench"
+/// in src/, and "make -C bench run" to run them all with their default
+/// settings.  Each benchmark generates its inputs from a random seed, so that
+/// runs with the same options are comparable, and writes its results as one
+/// line of JSON so that they can be collected for regression tracking.
+
+struct BenchmarkOptions {
+  int32 seed;
+  int32 num_iters;
+  int32 num_warmup_iters;
+  std::string output;
+
+  BenchmarkOptions(): seed(0), num_iters(100), num_warmup_iters(5),
+                      output("-") { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("seed", &seed, "Random seed used to generate the inputs.");
+    opts->Register("num-iters", &num_iters, "Number of timed iterations "
+                   "(e.g. utterances or chunks).");
+    opts->Register("num-warmup-iters", &num_warmup_iters, "Number of "
+                   "iterations to run before we start timing.");
+    opts->Register("output", &output, "Wxfilename to which to append the "
+                   "results, one line of JSON per benchmark.");
+  }
+};
+
+/// BenchmarkResult collects the times of the iterations of one benchmark and
+/// writes a summary of them: the mean, the latency percentiles, the real-time
+/// factor if the iterations processed audio, and the peak memory use of the
+/// process.
+class BenchmarkResult {
+ public:
+  explicit BenchmarkResult(const std::string &name): name_(name),
+                                                     data_seconds_(0.0) { }
+
+  /// Records one iteration that took "seconds", and that processed
+  /// "data_seconds" of audio (zero if this is not meaningful).
+  void AddIteration(double seconds, double data_seconds = 0.0);
+
+  /// Adds a field to the output, e.g. a property of the inputs.
+  void AddInfo(const std::string &key, double value);
+
+  int32 NumIterations() const { return times_.size(); }
+
+  /// Writes the result as one line of JSON to "os".
+  void Write(std::ostream &os) const;
+
+  /// Writes the result to "wxfilename" (appending, if it is a file), and
+  /// prints a summary to the log.
+  void Write(const std::string &wxfilename) const;
+
+ private:
+  // Returns the "percent"'th percentile of times_, in seconds.
+  double Percentile(double percent) const;
+
+  std::string name_;
+  std::vector<double> times_;
+  double data_seconds_;
+  std::vector<std::pair<std::string, double> > info_;
+};
+
+/// Returns the peak resident memory of this process so far, in megabytes, or
+/// zero if it is not known on this platform.
+double PeakMemoryMegabytes();
+
+/// Outputs a synthetic waveform of "num_samples" samples at "samp_freq" Hz,
+/// with the range of a 16-bit wav file, which sounds vaguely like speech: a
+/// few harmonics of a pitch that drifts, with a syllable-rate envelope and
+/// some noise.  It is generated from Kaldi's random number generator, so it is
+/// deterministic given the seed.
+void GenerateSyntheticWave(int32 num_samples, BaseFloat samp_freq,
+                           Vector<BaseFloat> *wave);
+
+}  // namespace kaldi
+
+#endif  // KALDI_BENCH_BENCH_UTILS_H_
@@ -31,6 +31,7 @@
 #endif
 
 #include "base/timer.h"
+#include "matrix/cpu-allocator.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
@@ -101,7 +102,7 @@ void CuMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) CpuFree(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
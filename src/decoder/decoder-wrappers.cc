@@ -421,33 +421,22 @@ void ModifyGraphForCarefulAlignment(
 }
 
 
-void AlignUtteranceWrapper(
+// This function does the part of AlignUtteranceWrapper() and
+// AlignUtteranceClass that is not to do with output.  It returns true on
+// success; on failure it prints a warning and returns false.  It sets
+// *retried to true if it had to retry with config.retry_beam.  On success it
+// outputs the best path to "best_path".
+static bool AlignUtteranceInternal(
     const AlignConfig &config,
     const std::string &utt,
-    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
-                               // present
-    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
-                                       // true.
-    DecodableInterface *decodable,  // not const but is really an input.
-    Int32VectorWriter *alignment_writer,
-    BaseFloatWriter *scores_writer,
-    int32 *num_done,
-    int32 *num_error,
-    int32 *num_retried,
-    double *tot_like,
-    int64 *frame_count,
-    BaseFloatVectorWriter *per_frame_acwt_writer) {
-
-  if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
-      config.beam <= 0.0) {
-    KALDI_ERR << "Beams do not make sense: beam " << config.beam
-              << ", retry-beam " << config.retry_beam;
-  }
-
+    fst::VectorFst<fst::StdArc> *fst,
+    DecodableInterface *decodable,
+    bool *retried,
+    fst::VectorFst<LatticeArc> *best_path) {
+  *retried = false;
   if (fst->Start() == fst::kNoStateId) {
     KALDI_WARN << "Empty decoding graph for " << utt;
-    if (num_error != NULL) (*num_error)++;
-    return;
+    return false;
   }
 
   if (config.careful)
@@ -462,7 +451,7 @@ void AlignUtteranceWrapper(
   bool ans = decoder.ReachedFinal();  // consider only final states.
 
   if (!ans && config.retry_beam != 0.0) {
-    if (num_retried != NULL) (*num_retried)++;
+    *retried = true;
     KALDI_WARN << "Retrying utterance " << utt << " with beam "
                << config.retry_beam;
     decode_opts.beam = config.retry_beam;
@@ -474,14 +463,49 @@ void AlignUtteranceWrapper(
   if (!ans) {  // Still did not reach final state.
     KALDI_WARN << "Did not successfully decode file " << utt << ", len = "
                << decodable->NumFramesReady();
-    if (num_error != NULL) (*num_error)++;
-    return;
+    return false;
   }
 
-  fst::VectorFst<LatticeArc> decoded;  // linear FST.
-  decoder.GetBestPath(&decoded);
-  if (decoded.NumStates() == 0) {
+  decoder.GetBestPath(best_path);
+  if (best_path->NumStates() == 0) {
     KALDI_WARN << "Error getting best path from decoder (likely a bug)";
+    return false;
+  }
+  return true;
+}
+
+static void CheckAlignConfig(const AlignConfig &config) {
+  if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
+      config.beam <= 0.0) {
+    KALDI_ERR << "Beams do not make sense: beam " << config.beam
+              << ", retry-beam " << config.retry_beam;
+  }
+}
+
+void AlignUtteranceWrapper(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
+                               // present
+    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
+                                       // true.
+    DecodableInterface *decodable,  // not const but is really an input.
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer) {
+  CheckAlignConfig(config);
+
+  fst::VectorFst<LatticeArc> decoded;  // linear FST.
+  bool retried;
+  bool ans = AlignUtteranceInternal(config, utt, fst, decodable,
+                                    &retried, &decoded);
+  if (retried && num_retried != NULL) (*num_retried)++;
+  if (!ans) {
     if (num_error != NULL) (*num_error)++;
     return;
   }
@@ -511,4 +535,79 @@ void AlignUtteranceWrapper(
   }
 }
 
+
+AlignUtteranceClass::AlignUtteranceClass(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,
+    fst::VectorFst<fst::StdArc> *fst,
+    DecodableInterface *decodable,
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer):
+    config_(config), utt_(utt), acoustic_scale_(acoustic_scale),
+    fst_(fst), decodable_(decodable),
+    alignment_writer_(alignment_writer), scores_writer_(scores_writer),
+    num_done_(num_done), num_error_(num_error), num_retried_(num_retried),
+    tot_like_(tot_like), frame_count_(frame_count),
+    per_frame_acwt_writer_(per_frame_acwt_writer),
+    computed_(false), success_(false), retried_(false), num_frames_(0) {
+  // Check this here rather than in operator (), as we don't want to throw
+  // from a thread other than the main one.
+  CheckAlignConfig(config);
+}
+
+void AlignUtteranceClass::operator () () {
+  computed_ = true;  // Just means this function was called-- a check on the
+  // calling code.
+  fst::VectorFst<LatticeArc> decoded;  // linear FST.
+  success_ = AlignUtteranceInternal(config_, utt_, fst_, decodable_,
+                                    &retried_, &decoded);
+  num_frames_ = decodable_->NumFramesReady();
+  // We won't need these any more; free the memory now rather than waiting for
+  // the output, which may be delayed by other threads.
+  delete fst_;
+  fst_ = NULL;
+  delete decodable_;
+  decodable_ = NULL;
+  if (!success_)
+    return;
+  std::vector<int32> words;
+  GetLinearSymbolSequence(decoded, &alignment_, &words, &weight_);
+  if (per_frame_acwt_writer_ != NULL && per_frame_acwt_writer_->IsOpen()) {
+    GetPerFrameAcousticCosts(decoded, &per_frame_loglikes_);
+    per_frame_loglikes_.Scale(-1 / acoustic_scale_);
+  }
+}
+
+AlignUtteranceClass::~AlignUtteranceClass() {
+  if (!computed_)
+    KALDI_ERR << "Destructor called without operator (), error in calling code.";
+  delete fst_;  // These will normally have been deleted already.
+  delete decodable_;
+  if (retried_ && num_retried_ != NULL) (*num_retried_)++;
+  if (!success_) {
+    if (num_error_ != NULL) (*num_error_)++;
+    return;
+  }
+  BaseFloat like = -(weight_.Value1() + weight_.Value2()) / acoustic_scale_;
+  if (num_done_ != NULL) (*num_done_)++;
+  if (tot_like_ != NULL) (*tot_like_) += like;
+  if (frame_count_ != NULL) (*frame_count_) += num_frames_;
+
+  if (alignment_writer_ != NULL && alignment_writer_->IsOpen())
+    alignment_writer_->Write(utt_, alignment_);
+
+  if (scores_writer_ != NULL && scores_writer_->IsOpen())
+    scores_writer_->Write(utt_, -(weight_.Value1() + weight_.Value2()));
+
+  if (per_frame_acwt_writer_ != NULL && per_frame_acwt_writer_->IsOpen())
+    per_frame_acwt_writer_->Write(utt_, per_frame_loglikes_);
+}
+
 } // end namespace kaldi.
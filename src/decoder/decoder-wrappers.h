@@ -73,6 +73,60 @@ void AlignUtteranceWrapper(
     BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
 
 
+/// This class does the same job as the function AlignUtteranceWrapper(), but in
+/// a way that allows us to build a multi-threaded command line program more
+/// easily, using class TaskSequencer.  The alignment takes place in operator
+/// (), and the output happens in the destructor, so the model used by the
+/// decodable object can be shared between threads as long as it is only read.
+class AlignUtteranceClass {
+ public:
+  // NOTE: we "take ownership" of "fst" and "decodable".  These are deleted by
+  // the destructor.  The other arguments are as for AlignUtteranceWrapper();
+  // the writers and statistics are only accessed in the destructor.
+  AlignUtteranceClass(
+      const AlignConfig &config,
+      const std::string &utt,
+      BaseFloat acoustic_scale,
+      fst::VectorFst<fst::StdArc> *fst,
+      DecodableInterface *decodable,
+      Int32VectorWriter *alignment_writer,
+      BaseFloatWriter *scores_writer,
+      int32 *num_done,
+      int32 *num_error,
+      int32 *num_retried,
+      double *tot_like,
+      int64 *frame_count,
+      BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
+  void operator () ();  // The alignment happens here.
+  ~AlignUtteranceClass();  // Output happens here.
+ private:
+  // The following variables correspond to inputs:
+  const AlignConfig &config_;
+  std::string utt_;
+  BaseFloat acoustic_scale_;
+  fst::VectorFst<fst::StdArc> *fst_;
+  DecodableInterface *decodable_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloatWriter *scores_writer_;
+  int32 *num_done_;
+  int32 *num_error_;
+  int32 *num_retried_;
+  double *tot_like_;
+  int64 *frame_count_;
+  BaseFloatVectorWriter *per_frame_acwt_writer_;
+
+  // The following variables are stored by the computation.
+  bool computed_;  // operator () was called.
+  bool success_;  // alignment succeeded.
+  bool retried_;  // we had to use the retry beam.
+  int32 num_frames_;
+  std::vector<int32> alignment_;
+  LatticeWeight weight_;
+  Vector<BaseFloat> per_frame_loglikes_;  // only set if per_frame_acwt_writer_
+                                          // is open.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AlignUtteranceClass);
+};
+
 
 /// This function modifies the decoding graph for what we call "careful
 /// alignment".  The problem we are trying to solve is that if the decoding eats
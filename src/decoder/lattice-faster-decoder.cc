@@ -27,6 +27,7 @@
 
 #include "decoder/lattice-faster-decoder.h"
 #include "lat/lattice-functions.h"
+#include "base/kaldi-profile.h"
 
 namespace kaldi {
 
@@ -76,6 +77,7 @@ void LatticeFasterDecoder::InitDecoding() {
 // a final state).  It should only very rarely return false; this indicates
 // an unusual search error.
 bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::Decode");
   InitDecoding();
 
   // We use 1-based indexing for frames in this decoder (if you view it in
@@ -501,6 +503,7 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame_plus_one) {
 // where the delta-costs are not changing (and the delta controls when we consider
 // a cost to have "not changed").
 void LatticeFasterDecoder::PruneActiveTokens(BaseFloat delta) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::PruneActiveTokens");
   int32 cur_frame_plus_one = NumFramesDecoded();
   int32 num_toks_begin = num_toks_;
   // The index "f" below represents a "frame plus one", i.e. you'd have to subtract
@@ -573,6 +576,7 @@ void LatticeFasterDecoder::ComputeFinalCosts(
 
 void LatticeFasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
                                              int32 max_num_frames) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::AdvanceDecoding");
   KALDI_ASSERT(!active_toks_.empty() && !decoding_finalized_ &&
                "You must call InitDecoding() before AdvanceDecoding");
   int32 num_frames_ready = decodable->NumFramesReady();
@@ -598,6 +602,7 @@ void LatticeFasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
 // (optionally) on the final frame.  Takes into account the final-prob of
 // tokens.  This function used to be called PruneActiveTokensFinal().
 void LatticeFasterDecoder::FinalizeDecoding() {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::FinalizeDecoding");
   int32 final_frame_plus_one = NumFramesDecoded();
   int32 num_toks_begin = num_toks_;
   // PruneForwardLinksFinal() prunes final frame (with final-probs), and
@@ -784,6 +789,7 @@ template BaseFloat LatticeFasterDecoder::ProcessEmitting<fst::Fst<fst::StdArc>>(
         DecodableInterface *decodable);
 
 BaseFloat LatticeFasterDecoder::ProcessEmittingWrapper(DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessEmitting");
   if (fst_.Type() == "const") {
     return LatticeFasterDecoder::ProcessEmitting<fst::ConstFst<Arc>>(decodable);
   } else if (fst_.Type() == "vector") {
@@ -865,6 +871,7 @@ template void LatticeFasterDecoder::ProcessNonemitting<fst::Fst<fst::StdArc>>(
         BaseFloat cutoff);
 
 void LatticeFasterDecoder::ProcessNonemittingWrapper(BaseFloat cost_cutoff) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessNonemitting");
   if (fst_.Type() == "const") {
     return LatticeFasterDecoder::ProcessNonemitting<fst::ConstFst<Arc>>(cost_cutoff);
   } else if (fst_.Type() == "vector") {
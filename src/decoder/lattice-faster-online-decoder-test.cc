@@ -0,0 +1,280 @@
+// decoder/lattice-faster-online-decoder-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-faster-online-decoder.h"
+#include "decoder/decodable-matrix.h"
+
+namespace kaldi {
+
+// Creates a word-loop decoding graph, as a small stand-in for HCLG: each word
+// is a sequence of "pdfs" (the input labels, 1..num_pdfs), each with a
+// self-loop, and the word label is on the first arc of the word.  State 0 is
+// the start and final state, and words return to it via epsilon arcs.  The
+// pdf sequences of the words are output to "prons" (indexed by word - 1).
+static void CreateWordLoopGraph(int32 num_words, int32 num_pdfs,
+                                fst::VectorFst<fst::StdArc> *fst,
+                                std::vector<std::vector<int32> > *prons) {
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+  fst->DeleteStates();
+  prons->clear();
+  StateId loop_state = fst->AddState();
+  fst->SetStart(loop_state);
+  fst->SetFinal(loop_state, Weight::One());
+  for (int32 word = 1; word <= num_words; word++) {
+    std::vector<int32> pron(RandInt(2, 4));
+    for (size_t i = 0; i < pron.size(); i++)
+      pron[i] = RandInt(1, num_pdfs);
+    prons->push_back(pron);
+    StateId prev_state = loop_state;
+    for (size_t i = 0; i < pron.size(); i++) {
+      StateId state = fst->AddState();
+      BaseFloat cost = (i == 0 ? -Log(1.0 / num_words) : -Log(0.5));
+      fst->AddArc(prev_state, Arc(pron[i], (i == 0 ? word : 0),
+                                  Weight(cost), state));
+      fst->AddArc(state, Arc(pron[i], 0, Weight(-Log(0.5)), state));
+      prev_state = state;
+    }
+    fst->AddArc(prev_state, Arc(0, 0, Weight::One(), loop_state));
+  }
+}
+
+// Creates a decoding graph like CreateWordLoopGraph(), but with a bigram
+// language model: there is a state for each word history (state 0 for the
+// start, and state w for a history ending in word w), and each word goes from
+// each history state to its own, with a random bigram cost.  This is more like
+// a real HCLG, in which competing hypotheses with different word histories are
+// in different states.
+static void CreateBigramGraph(int32 num_words, int32 num_pdfs,
+                              fst::VectorFst<fst::StdArc> *fst,
+                              std::vector<std::vector<int32> > *prons) {
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+  fst->DeleteStates();
+  prons->clear();
+  for (int32 word = 1; word <= num_words; word++) {
+    std::vector<int32> pron(RandInt(2, 4));
+    for (size_t i = 0; i < pron.size(); i++)
+      pron[i] = RandInt(1, num_pdfs);
+    prons->push_back(pron);
+  }
+  for (int32 h = 0; h <= num_words; h++) {
+    StateId history_state = fst->AddState();
+    KALDI_ASSERT(history_state == h);
+    fst->SetFinal(history_state, Weight::One());
+  }
+  fst->SetStart(0);
+  for (int32 h = 0; h <= num_words; h++) {
+    for (int32 word = 1; word <= num_words; word++) {
+      const std::vector<int32> &pron = (*prons)[word - 1];
+      StateId prev_state = h;
+      for (size_t i = 0; i < pron.size(); i++) {
+        StateId state = fst->AddState();
+        BaseFloat cost = (i == 0 ? -Log(RandUniform() / num_words) :
+                          -Log(0.5));
+        fst->AddArc(prev_state, Arc(pron[i], (i == 0 ? word : 0),
+                                    Weight(cost), state));
+        fst->AddArc(state, Arc(pron[i], 0, Weight(-Log(0.5)), state));
+        prev_state = state;
+      }
+      fst->AddArc(prev_state, Arc(0, 0, Weight::One(), word));
+    }
+  }
+}
+
+// Creates log-likelihoods for a random word sequence through the graph
+// created by CreateWordLoopGraph(), with noise so that the search has
+// competing hypotheses.
+static void CreateLoglikes(const std::vector<std::vector<int32> > &prons,
+                           int32 num_pdfs, int32 num_frames,
+                           Matrix<BaseFloat> *loglikes) {
+  std::vector<int32> alignment;
+  while (static_cast<int32>(alignment.size()) < num_frames) {
+    const std::vector<int32> &pron = prons[RandInt(0, prons.size() - 1)];
+    for (size_t i = 0; i < pron.size(); i++)
+      alignment.insert(alignment.end(), RandInt(1, 5), pron[i]);
+  }
+  loglikes->Resize(num_frames, num_pdfs);
+  for (int32 t = 0; t < num_frames; t++) {
+    for (int32 p = 0; p < num_pdfs; p++)
+      (*loglikes)(t, p) = -2.0 + RandGauss();
+    (*loglikes)(t, alignment[t] - 1) += 2.0;
+  }
+}
+
+// Appends the non-epsilon labels on the linear lattice "lat" to "ilabels"
+// and "olabels", and returns its total cost.
+static double AppendLinearLattice(const Lattice &lat,
+                                  std::vector<int32> *ilabels,
+                                  std::vector<int32> *olabels) {
+  double cost = 0.0;
+  LatticeArc::StateId s = lat.Start();
+  KALDI_ASSERT(s != fst::kNoStateId);
+  while (true) {
+    KALDI_ASSERT(lat.NumArcs(s) <= 1);
+    if (lat.NumArcs(s) == 0) {
+      LatticeWeight final_weight = lat.Final(s);
+      KALDI_ASSERT(final_weight != LatticeWeight::Zero());
+      return cost + final_weight.Value1() + final_weight.Value2();
+    }
+    fst::ArcIterator<Lattice> aiter(lat, s);
+    const LatticeArc &arc = aiter.Value();
+    if (arc.ilabel != 0) ilabels->push_back(arc.ilabel);
+    if (arc.olabel != 0) olabels->push_back(arc.olabel);
+    cost += arc.weight.Value1() + arc.weight.Value2();
+    s = arc.nextstate;
+  }
+}
+
+// Returns the cost of the best path through "lat", which must be acyclic;
+// final-probs are included.
+static double LatticeBestCost(const Lattice &lat) {
+  std::vector<double> cost(lat.NumStates(),
+                           std::numeric_limits<double>::infinity());
+  cost[lat.Start()] = 0.0;
+  // Relax until nothing changes, so we don't rely on the state order.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (LatticeArc::StateId s = 0; s < lat.NumStates(); s++) {
+      if (cost[s] == std::numeric_limits<double>::infinity())
+        continue;
+      for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+           aiter.Next()) {
+        const LatticeArc &arc = aiter.Value();
+        double next_cost = cost[s] + arc.weight.Value1() + arc.weight.Value2();
+        if (next_cost < cost[arc.nextstate] - 1.0e-04) {
+          cost[arc.nextstate] = next_cost;
+          changed = true;
+        }
+      }
+    }
+  }
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (LatticeArc::StateId s = 0; s < lat.NumStates(); s++) {
+    LatticeWeight final_weight = lat.Final(s);
+    if (final_weight != LatticeWeight::Zero())
+      best_cost = std::min(best_cost, cost[s] + final_weight.Value1() +
+                           final_weight.Value2());
+  }
+  return best_cost;
+}
+
+// Checks that decoding with calls to CommitStablePrefix() gives the same best
+// path as decoding without it: the committed prefixes, followed by the
+// output of GetBestPath() at the end, should equal the best path.  If
+// "bigram" is true we use the graph from CreateBigramGraph(), else the one
+// from CreateWordLoopGraph().
+void UnitTestCommitStablePrefix(bool bigram) {
+  int32 num_words = RandInt(3, 8), num_pdfs = RandInt(10, 20),
+      num_frames = RandInt(200, 600);
+  fst::VectorFst<fst::StdArc> fst;
+  std::vector<std::vector<int32> > prons;
+  if (bigram)
+    CreateBigramGraph(num_words, num_pdfs, &fst, &prons);
+  else
+    CreateWordLoopGraph(num_words, num_pdfs, &fst, &prons);
+  Matrix<BaseFloat> loglikes;
+  CreateLoglikes(prons, num_pdfs, num_frames, &loglikes);
+
+  LatticeFasterDecoderConfig config;
+  config.beam = 12.0;
+  config.lattice_beam = 4.0;
+  config.prune_interval = RandInt(5, 25);
+  // These graphs are small, and with the default min_active, which is more
+  // than their number of states, nothing would be pruned by the beam.
+  config.min_active = 20;
+
+  // The reference: decode without committing anything.
+  std::vector<int32> ref_ilabels, ref_olabels;
+  double ref_cost;
+  {
+    LatticeFasterOnlineDecoder decoder(fst, config);
+    DecodableMatrixScaled decodable(loglikes, 1.0);
+    decoder.InitDecoding();
+    decoder.AdvanceDecoding(&decodable);
+    Lattice best_path;
+    KALDI_ASSERT(decoder.GetBestPath(&best_path, true));
+    ref_cost = AppendLinearLattice(best_path, &ref_ilabels, &ref_olabels);
+  }
+  KALDI_ASSERT(static_cast<int32>(ref_ilabels.size()) == num_frames);
+
+  // Decode in chunks, committing the stable prefix after each one.
+  std::vector<int32> ilabels, olabels;
+  double cost = 0.0;
+  LatticeFasterOnlineDecoder decoder(fst, config);
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  decoder.InitDecoding();
+  int32 num_commits = 0;
+  while (decoder.NumFramesDecoded() < num_frames) {
+    decoder.AdvanceDecoding(&decodable, RandInt(1, 40));
+    Lattice prefix;
+    if (decoder.CommitStablePrefix(&prefix)) {
+      num_commits++;
+      cost += AppendLinearLattice(prefix, &ilabels, &olabels);
+      KALDI_ASSERT(static_cast<int32>(ilabels.size()) ==
+                   decoder.NumFramesCommitted());
+    } else {
+      KALDI_ASSERT(prefix.NumStates() == 0);
+    }
+    // The traceback from the best token now stops at the first uncommitted
+    // frame.
+    LatticeFasterOnlineDecoder::BestPathIterator iter =
+        decoder.BestPathEnd(false, NULL);
+    int32 num_emitting = 0;
+    while (!iter.Done()) {
+      LatticeArc arc;
+      iter = decoder.TraceBackBestPath(iter, &arc);
+      if (arc.ilabel != 0) num_emitting++;
+    }
+    KALDI_ASSERT(num_emitting == decoder.NumFramesDecoded() -
+                 decoder.NumFramesCommitted());
+    // The lattice of the uncommitted frames, which starts at the commit
+    // point, contains the current best path.
+    Lattice raw_lat, best_path;
+    KALDI_ASSERT(decoder.GetRawLattice(&raw_lat, false));
+    KALDI_ASSERT(decoder.GetBestPath(&best_path, false));
+    std::vector<int32> unused_ilabels, unused_olabels;
+    KALDI_ASSERT(ApproxEqual(LatticeBestCost(raw_lat),
+                             AppendLinearLattice(best_path, &unused_ilabels,
+                                                 &unused_olabels), 1.0e-04));
+  }
+  KALDI_ASSERT(decoder.NumFramesDecoded() == num_frames);
+  KALDI_ASSERT(num_commits > 0);
+  Lattice best_path;
+  KALDI_ASSERT(decoder.GetBestPath(&best_path, true));
+  cost += AppendLinearLattice(best_path, &ilabels, &olabels);
+
+  KALDI_ASSERT(ilabels == ref_ilabels);
+  KALDI_ASSERT(olabels == ref_olabels);
+  KALDI_ASSERT(ApproxEqual(cost, ref_cost, 1.0e-04));
+}
+
+}  // namespace kaldi
+
+int main() {
+  for (int32 i = 0; i < 20; i++) {
+    kaldi::UnitTestCommitStablePrefix(false);
+    kaldi::UnitTestCommitStablePrefix(true);
+  }
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -26,6 +26,7 @@
 
 #include "decoder/lattice-faster-online-decoder.h"
 #include "lat/lattice-functions.h"
+#include "base/kaldi-profile.h"
 
 namespace kaldi {
 
@@ -33,7 +34,8 @@ namespace kaldi {
 LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(
     const fst::Fst<fst::StdArc> &fst,
     const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+    num_frames_committed_(0), fst_(fst), delete_fst_(false), config_(config),
+    num_toks_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -41,7 +43,8 @@ LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(
 
 LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(const LatticeFasterDecoderConfig &config,
                                                        fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+    num_frames_committed_(0), fst_(*fst), delete_fst_(true), config_(config),
+    num_toks_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -58,6 +61,7 @@ void LatticeFasterOnlineDecoder::InitDecoding() {
   DeleteElems(toks_.Clear());
   cost_offsets_.clear();
   ClearActiveTokens();
+  num_frames_committed_ = 0;
   warned_ = false;
   num_toks_ = 0;
   decoding_finalized_ = false;
@@ -76,6 +80,7 @@ void LatticeFasterOnlineDecoder::InitDecoding() {
 // a final state).  It should only very rarely return false; this indicates
 // an unusual search error.
 bool LatticeFasterOnlineDecoder::Decode(DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::Decode");
   InitDecoding();
 
   // We use 1-based indexing for frames in this decoder (if you view it in
@@ -587,7 +592,8 @@ void LatticeFasterOnlineDecoder::PruneTokensForFrame(int32 frame_plus_one) {
 // where the delta-costs are not changing (and the delta controls when we consider
 // a cost to have "not changed").
 void LatticeFasterOnlineDecoder::PruneActiveTokens(BaseFloat delta) {
-  int32 cur_frame_plus_one = NumFramesDecoded();
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::PruneActiveTokens");
+  int32 cur_frame_plus_one = active_toks_.size() - 1;
   int32 num_toks_begin = num_toks_;
   // The index "f" below represents a "frame plus one", i.e. you'd have to subtract
   // one to get the corresponding index for the decodable object.
@@ -724,8 +730,9 @@ LatticeFasterOnlineDecoder::BestPathIterator LatticeFasterOnlineDecoder::TraceBa
         BaseFloat graph_cost = link->graph_cost,
             acoustic_cost = link->acoustic_cost;
         if (link->ilabel != 0) {
-          KALDI_ASSERT(static_cast<size_t>(cur_t) < cost_offsets_.size());
-          acoustic_cost -= cost_offsets_[cur_t];
+          int32 t = cur_t - num_frames_committed_;
+          KALDI_ASSERT(t >= 0 && static_cast<size_t>(t) < cost_offsets_.size());
+          acoustic_cost -= cost_offsets_[t];
           ret_t--;
         }
         oarc->weight = LatticeWeight(graph_cost, acoustic_cost);
@@ -747,6 +754,7 @@ LatticeFasterOnlineDecoder::BestPathIterator LatticeFasterOnlineDecoder::TraceBa
 
 void LatticeFasterOnlineDecoder::AdvanceDecoding(DecodableInterface *decodable,
                                                    int32 max_num_frames) {
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::AdvanceDecoding");
   KALDI_ASSERT(!active_toks_.empty() && !decoding_finalized_ &&
                "You must call InitDecoding() before AdvanceDecoding");
   int32 num_frames_ready = decodable->NumFramesReady();
@@ -774,7 +782,8 @@ void LatticeFasterOnlineDecoder::AdvanceDecoding(DecodableInterface *decodable,
 // (optionally) on the final frame.  Takes into account the final-prob of
 // tokens.  This function used to be called PruneActiveTokensFinal().
 void LatticeFasterOnlineDecoder::FinalizeDecoding() {
-  int32 final_frame_plus_one = NumFramesDecoded();
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::FinalizeDecoding");
+  int32 final_frame_plus_one = active_toks_.size() - 1;
   int32 num_toks_begin = num_toks_;
   // PruneForwardLinksFinal() prunes final frame (with final-probs), and
   // sets decoding_finalized_.
@@ -790,6 +799,160 @@ void LatticeFasterOnlineDecoder::FinalizeDecoding() {
                 << " to " << num_toks_;
 }
 
+bool LatticeFasterOnlineDecoder::CommitStablePrefix(Lattice *prefix) {
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::CommitStablePrefix");
+  KALDI_ASSERT(!active_toks_.empty() && !decoding_finalized_ &&
+               "You must call InitDecoding() before CommitStablePrefix(), "
+               "and you cannot call it after FinalizeDecoding()");
+  prefix->DeleteStates();
+  // Pruning first reduces the number of tokens whose tracebacks we follow.
+  PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
+  int32 frame_plus_one;
+  unordered_set<Token*> on_traceback;
+  Token *root = FindStableToken(&frame_plus_one, &on_traceback);
+  if (root == NULL)
+    return false;
+  // Output the best path up to "root", as in GetBestPath().
+  StateId state = prefix->AddState();
+  prefix->SetFinal(state, LatticeWeight::One());
+  BestPathIterator iter(root, num_frames_committed_ + frame_plus_one - 1);
+  while (!iter.Done()) {
+    LatticeArc arc;
+    iter = TraceBackBestPath(iter, &arc);
+    arc.nextstate = state;
+    StateId new_state = prefix->AddState();
+    prefix->AddArc(new_state, arc);
+    state = new_state;
+  }
+  prefix->SetStart(state);
+  CommitPrefix(frame_plus_one, root, on_traceback);
+  return true;
+}
+
+LatticeFasterOnlineDecoder::Token *LatticeFasterOnlineDecoder::FindStableToken(
+    int32 *frame_plus_one, unordered_set<Token*> *on_traceback) const {
+  int32 last_frame_plus_one = active_toks_.size() - 1;
+  on_traceback->clear();
+  // "entries" are the tokens on frame f through which the tracebacks from
+  // the most recent frame enter frame f, i.e. the last token on frame f of
+  // each traceback.  On the most recent frame, that is all of its tokens.
+  std::vector<Token*> entries;
+  for (Token *tok = active_toks_[last_frame_plus_one].toks; tok != NULL;
+       tok = tok->next)
+    entries.push_back(tok);
+  unordered_set<Token*> this_frame, prev_entries_set;
+  std::vector<Token*> queue, prev_entries;
+  for (int32 f = last_frame_plus_one; f > 1; f--) {
+    this_frame.clear();
+    for (Token *tok = active_toks_[f].toks; tok != NULL; tok = tok->next)
+      this_frame.insert(tok);
+    // Follow the tracebacks through frame f (they may go through several
+    // tokens on it, via epsilon links), and find where they enter it from
+    // frame f - 1.
+    prev_entries.clear();
+    prev_entries_set.clear();
+    queue = entries;
+    for (size_t i = 0; i < entries.size(); i++)
+      on_traceback->insert(entries[i]);
+    while (!queue.empty()) {
+      Token *tok = queue.back();
+      queue.pop_back();
+      Token *backpointer = tok->backpointer;
+      if (backpointer == NULL)  // Should not happen: only the start token has
+        return NULL;            // no backpointer.
+      if (this_frame.count(backpointer) != 0) {
+        if (on_traceback->insert(backpointer).second)
+          queue.push_back(backpointer);
+      } else if (prev_entries_set.insert(backpointer).second) {
+        prev_entries.push_back(backpointer);
+      }
+    }
+    if (prev_entries.size() == 1) {
+      // All the tracebacks go through this token on frame f - 1.
+      *frame_plus_one = f - 1;
+      return prev_entries[0];
+    }
+    entries.swap(prev_entries);
+  }
+  return NULL;
+}
+
+void LatticeFasterOnlineDecoder::CommitPrefix(
+    int32 frame_plus_one, Token *root,
+    const unordered_set<Token*> &on_traceback) {
+  // We keep the tokens that are reachable from "root", or from the tokens on
+  // the tracebacks from the most recent frame (which include all its tokens,
+  // and are normally reachable from "root" anyway), via forward links.
+  unordered_set<Token*> keep;
+  std::vector<Token*> queue(1, root);
+  keep.insert(root);
+  for (unordered_set<Token*>::const_iterator iter = on_traceback.begin();
+       iter != on_traceback.end(); ++iter)
+    if (keep.insert(*iter).second)
+      queue.push_back(*iter);
+  while (!queue.empty()) {
+    Token *tok = queue.back();
+    queue.pop_back();
+    for (ForwardLink *l = tok->links; l != NULL; l = l->next)
+      if (keep.insert(l->next_tok).second)
+        queue.push_back(l->next_tok);
+  }
+
+  for (int32 f = 0; f < frame_plus_one; f++) {
+    for (Token *tok = active_toks_[f].toks; tok != NULL; ) {
+      tok->DeleteForwardLinks();
+      Token *next_tok = tok->next;
+      delete tok;
+      num_toks_--;
+      tok = next_tok;
+    }
+  }
+  // Delete the tokens on frame_plus_one and later that we don't keep (none
+  // of the kept tokens has links to them), and clear the backpointers that
+  // pointed to deleted tokens; the tokens that have them are on no traceback
+  // from the most recent frame, so their backpointers won't be used.  On
+  // frame_plus_one, we move "root" to the end of the list, which is where
+  // InitDecoding() puts the start token (GetRawLatticePruned() relies on this).
+  int32 last_frame_plus_one = active_toks_.size() - 1;
+  for (int32 f = frame_plus_one; f <= last_frame_plus_one; f++) {
+    Token *head = NULL, *tail = NULL;
+    for (Token *tok = active_toks_[f].toks, *next_tok; tok != NULL;
+         tok = next_tok) {
+      next_tok = tok->next;
+      if (tok == root) {
+        continue;
+      } else if (keep.count(tok) == 0) {
+        // Tokens on the most recent frame are all on tracebacks.
+        KALDI_ASSERT(f < last_frame_plus_one);
+        tok->DeleteForwardLinks();
+        delete tok;
+        num_toks_--;
+      } else {
+        if (tok->backpointer != NULL && keep.count(tok->backpointer) == 0)
+          tok->backpointer = NULL;
+        tok->next = NULL;
+        if (tail == NULL) head = tok;
+        else tail->next = tok;
+        tail = tok;
+      }
+    }
+    if (f == frame_plus_one) {
+      root->next = NULL;
+      root->backpointer = NULL;
+      if (tail == NULL) head = root;
+      else tail->next = root;
+    }
+    active_toks_[f].toks = head;
+  }
+
+  active_toks_.erase(active_toks_.begin(),
+                     active_toks_.begin() + frame_plus_one);
+  KALDI_ASSERT(cost_offsets_.size() >= static_cast<size_t>(frame_plus_one));
+  cost_offsets_.erase(cost_offsets_.begin(),
+                      cost_offsets_.begin() + frame_plus_one);
+  num_frames_committed_ += frame_plus_one;
+}
+
 /// Gets the weight cutoff.  Also counts the active tokens.
 BaseFloat LatticeFasterOnlineDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                                 BaseFloat *adaptive_beam, Elem **best_elem) {
@@ -868,7 +1031,8 @@ BaseFloat LatticeFasterOnlineDecoder::ProcessEmitting(
   KALDI_ASSERT(active_toks_.size() > 0);
   int32 frame = active_toks_.size() - 1; // frame is the frame-index
   // (zero-based) used to get likelihoods
-  // from the decodable object.
+  // from the decodable object, minus num_frames_committed_.
+  int32 decodable_frame = num_frames_committed_ + frame;
   active_toks_.resize(active_toks_.size() + 1);
 
   Elem *final_toks = toks_.Clear(); // analogous to swapping prev_toks_ / cur_toks_
@@ -899,8 +1063,9 @@ BaseFloat LatticeFasterOnlineDecoder::ProcessEmitting(
          aiter.Next()) {
       const Arc &arc = aiter.Value();
       if (arc.ilabel != 0) {  // propagate..
-        BaseFloat new_weight = arc.weight.Value() + cost_offset - 
-            decodable->LogLikelihood(frame, arc.ilabel) + tok->tot_cost;
+        BaseFloat new_weight = arc.weight.Value() + cost_offset -
+            decodable->LogLikelihood(decodable_frame, arc.ilabel) +
+            tok->tot_cost;
         if (new_weight + adaptive_beam < next_cutoff)
           next_cutoff = new_weight + adaptive_beam;
       }
@@ -927,7 +1092,7 @@ BaseFloat LatticeFasterOnlineDecoder::ProcessEmitting(
         const Arc &arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
           BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame, arc.ilabel),
+              decodable->LogLikelihood(decodable_frame, arc.ilabel),
               graph_cost = arc.weight.Value(),
               cur_cost = tok->tot_cost,
               tot_cost = cur_cost + ac_cost + graph_cost;
@@ -961,6 +1126,7 @@ template BaseFloat LatticeFasterOnlineDecoder::
 
 BaseFloat LatticeFasterOnlineDecoder::ProcessEmittingWrapper(
         DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::ProcessEmitting");
   if (fst_.Type() == "const") {
     return LatticeFasterOnlineDecoder::
         ProcessEmitting<fst::ConstFst<Arc>>(decodable);
@@ -1046,6 +1212,7 @@ template void LatticeFasterOnlineDecoder::
 
 void LatticeFasterOnlineDecoder::ProcessNonemittingWrapper(
         BaseFloat cost_cutoff) {
+  KALDI_PROFILE_SCOPE("LatticeFasterOnlineDecoder::ProcessNonemitting");
   if (fst_.Type() == "const") {
     return LatticeFasterOnlineDecoder::
         ProcessNonemitting<fst::ConstFst<Arc>>(cost_cutoff);
@@ -44,6 +44,13 @@ namespace kaldi {
 /** LatticeFasterOnlineDecoder is as LatticeFasterDecoder but also supports an
     efficient way to get the best path (see the function BestPathEnd()), which
     is useful in endpointing.
+
+    It can also decode endless streams (e.g. continuous monitoring, where we
+    never endpoint) with bounded memory: call CommitStablePrefix()
+    periodically, e.g. after each call to AdvanceDecoding().  It finds the most
+    recent token where the best-path tracebacks of all the currently active
+    tokens coalesce, outputs the best path up to there, and frees the tokens
+    and links before it.
  */
 class LatticeFasterOnlineDecoder {
  public:
@@ -59,7 +66,8 @@ class LatticeFasterOnlineDecoder {
     // transition-id for next time, if you call TraceBackBestPath on this
     // iterator (assuming it's not an epsilon transition).  Note that this
     // is one less than you might reasonably expect, e.g. it's -1 for
-    // the nonemitting transitions before the first frame.
+    // the nonemitting transitions before the first frame (or
+    // NumFramesCommitted() - 1, if you have called CommitStablePrefix()).
     BestPathIterator(void *t, int32 f): tok(t), frame(f) { }
     bool Done() { return tok == NULL; }
   };
@@ -154,6 +162,34 @@ class LatticeFasterOnlineDecoder {
                            BaseFloat beam) const;
 
 
+  /// This is for decoding endless streams with bounded memory.  It follows
+  /// the best-path tracebacks (backpointers) of all the tokens on the most
+  /// recent frame, and looks for the most recent frame where they coalesce,
+  /// i.e. all of them leave that frame through a single token.  Any future
+  /// best path extends one of those tokens, so its part up to that token is
+  /// settled.  If it finds one, it outputs to "prefix" the best path from the
+  /// previous such point (or the start) up to that token, as a linear lattice
+  /// in the same format as GetBestPath() (without final-probs), frees the
+  /// tokens and links before it, and returns true.  Otherwise it returns false
+  /// and "prefix" will be empty.  Concatenating the prefixes with the output
+  /// of GetBestPath() at the end gives the best path of the whole stream.
+  ///
+  /// Note: this truncates the lattice.  The tokens on the committed frame
+  /// other than that token (and those reachable from it), and the lattice
+  /// links from them, are deleted, so lattice paths that were within the
+  /// lattice beam but did not pass through the commit point are lost; after
+  /// this is called, GetRawLattice() and related functions give a lattice of
+  /// the frames from NumFramesCommitted() onward that starts from that token.
+  /// The output of GetBestPath() and tracebacks from BestPathEnd() also only
+  /// cover the frames from NumFramesCommitted() onward.  Must be called after
+  /// InitDecoding() and before FinalizeDecoding(); it is most useful to call
+  /// it every few hundred frames or so.
+  bool CommitStablePrefix(Lattice *prefix);
+
+  /// Returns the number of frames that have been committed (and freed) by
+  /// CommitStablePrefix() since InitDecoding().
+  int32 NumFramesCommitted() const { return num_frames_committed_; }
+
   /// InitDecoding initializes the decoding, and should only be used if you
   /// intend to call AdvanceDecoding().  If you call Decode(), you don't need to
   /// call this.  You can also call InitDecoding if you have already decoded an
@@ -190,9 +226,12 @@ class LatticeFasterOnlineDecoder {
   /// reasonable likelihood.
   BaseFloat FinalRelativeCost() const;
 
-  // Returns the number of frames decoded so far.  The value returned changes
-  // whenever we call ProcessEmitting().
-  inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
+  // Returns the number of frames decoded so far (including any frames committed
+  // by CommitStablePrefix()).  The value returned changes whenever we call
+  // ProcessEmitting().
+  inline int32 NumFramesDecoded() const {
+    return num_frames_committed_ + active_toks_.size() - 1;
+  }
 
  private:
   // ForwardLinks are the links from a token to a token on the next frame.
@@ -362,7 +401,10 @@ class LatticeFasterOnlineDecoder {
 
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
-  // must_prune_tokens).
+  // must_prune_tokens).  Note: active_toks_[0] is for frame
+  // num_frames_committed_, which is only nonzero if the user called
+  // CommitStablePrefix(); the same offset applies to cost_offsets_.
+  int32 num_frames_committed_;
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
@@ -414,6 +456,24 @@ class LatticeFasterOnlineDecoder {
 
   void ClearActiveTokens();
 
+  // This is called from CommitStablePrefix().  It follows the backpointers
+  // of the tokens on the most recent frame back until the most recent frame
+  // (before it) where they all leave through the same token, and returns that
+  // token, setting "frame_plus_one" to its frame (always > 0).  It outputs to
+  // "on_traceback" the tokens on the tracebacks after that frame.  Returns
+  // NULL if there is no such frame.
+  Token *FindStableToken(int32 *frame_plus_one,
+                         unordered_set<Token*> *on_traceback) const;
+
+  // This is called from CommitStablePrefix().  It deletes all tokens before
+  // frame_plus_one, and the tokens on frame_plus_one and later that are not
+  // reachable via forward links from "root" or from the tokens in
+  // "on_traceback"; "root" becomes the start token (with no backpointer), and
+  // the frame indexes of active_toks_ and cost_offsets_ are shifted so that
+  // frame_plus_one becomes zero.
+  void CommitPrefix(int32 frame_plus_one, Token *root,
+                    const unordered_set<Token*> &on_traceback);
+
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeFasterOnlineDecoder);
 };
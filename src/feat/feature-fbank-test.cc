@@ -443,7 +443,45 @@ static void UnitTestHTKCompare4() {
 
 
 
+// Checks that MelBanks::ComputeFromFft() gives the same results as
+// ComputePowerSpectrum() followed by MelBanks::Compute().
+static void UnitTestMelBanksComputeFromFft() {
+  FrameExtractionOptions frame_opts;
+  MelBanksOptions mel_opts(23 + Rand() % 20);
+  frame_opts.round_to_power_of_two = (Rand() % 2 == 0);
+  if (Rand() % 2 == 0)
+    mel_opts.low_freq = 0.0;
+  BaseFloat vtln_warp = (Rand() % 2 == 0 ? 1.0 : 0.9);
+  MelBanks mel_banks(mel_opts, frame_opts, vtln_warp);
+
+  int32 padded_window_size = frame_opts.PaddedWindowSize(),
+      num_frames = 50;
+  Matrix<BaseFloat> frames(num_frames, padded_window_size);
+  frames.SetRandn();
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> frame(frames, i);
+    RealFft(&frame, true);
+  }
+  Matrix<BaseFloat> mel_energies1(num_frames, mel_opts.num_bins),
+      mel_energies2(num_frames, mel_opts.num_bins);
+
+  for (int32 i = 0; i < num_frames; i++) {
+    Vector<BaseFloat> power_spectrum(frames.Row(i));
+    ComputePowerSpectrum(&power_spectrum);
+    SubVector<BaseFloat> mel_energies(mel_energies1, i);
+    mel_banks.Compute(power_spectrum.Range(0, padded_window_size / 2 + 1),
+                      &mel_energies);
+  }
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> mel_energies(mel_energies2, i);
+    mel_banks.ComputeFromFft(frames.Row(i), &mel_energies);
+  }
+  AssertEqual(mel_energies1, mel_energies2, 1.0e-04);
+}
+
+
 static void UnitTestFeat() {
+  UnitTestMelBanksComputeFromFft();
   UnitTestReadWave();
   UnitTestSimple();
   UnitTestHTKCompare1();
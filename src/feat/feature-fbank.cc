@@ -90,22 +90,25 @@ void FbankComputer::Compute(BaseFloat signal_log_energy,
   else  // An alternative algorithm that works for non-powers-of-two.
     RealFft(signal_frame, true);
 
-  // Convert the FFT into a power spectrum.
-  ComputePowerSpectrum(signal_frame);
-  SubVector<BaseFloat> power_spectrum(*signal_frame, 0,
-                                      signal_frame->Dim() / 2 + 1);
-
-  // Use magnitude instead of power if requested.
-  if (!opts_.use_power)
-    power_spectrum.ApplyPow(0.5);
-
   int32 mel_offset = ((opts_.use_energy && !opts_.htk_compat) ? 1 : 0);
   SubVector<BaseFloat> mel_energies(*feature,
                                     mel_offset,
                                     opts_.mel_opts.num_bins);
 
-  // Sum with mel fiterbanks over the power spectrum
-  mel_banks.Compute(power_spectrum, &mel_energies);
+  if (opts_.use_power) {
+    // Sum with mel filterbanks over the power spectrum, computing the power
+    // spectrum on the fly from the FFT output.
+    mel_banks.ComputeFromFft(*signal_frame, &mel_energies);
+  } else {
+    // Convert the FFT into a power spectrum.
+    ComputePowerSpectrum(signal_frame);
+    SubVector<BaseFloat> power_spectrum(*signal_frame, 0,
+                                        signal_frame->Dim() / 2 + 1);
+    // Use magnitude instead of power.
+    power_spectrum.ApplyPow(0.5);
+    // Sum with mel fiterbanks over the magnitude spectrum
+    mel_banks.Compute(power_spectrum, &mel_energies);
+  }
   if (opts_.use_log_fbank) {
     // Avoid log of zero (which should be prevented anyway by dithering).
     mel_energies.ApplyFloor(std::numeric_limits<BaseFloat>::epsilon());
@@ -92,15 +92,52 @@ void UnitTestOnlineCmvn() {
   }
 }
 
+// Checks that ExtractWindows() gives the same results as calling
+// ExtractWindow() for each frame.
+void UnitTestExtractWindows() {
+  for (int32 i = 0; i < 10; i++) {
+    FrameExtractionOptions opts;
+    opts.dither = 0.0;  // so the results are deterministic.
+    opts.snip_edges = (Rand() % 2 == 0);
+    opts.remove_dc_offset = (Rand() % 2 == 0);
+    opts.round_to_power_of_two = (Rand() % 2 == 0);
+    if (Rand() % 2 == 0)
+      opts.preemph_coeff = 0.0;
+    FeatureWindowFunction window_function(opts);
+
+    Vector<BaseFloat> wave(1000 + Rand() % 5000);
+    wave.SetRandn();
+    int32 num_frames = NumFrames(wave.Dim(), opts),
+        first_frame = Rand() % (num_frames / 2 + 1),
+        block_size = std::min(num_frames - first_frame, 1 + Rand() % 20);
+
+    Matrix<BaseFloat> windows(block_size, opts.PaddedWindowSize());
+    Vector<BaseFloat> log_energies(block_size);
+    ExtractWindows(0, wave, first_frame, opts, window_function,
+                   &windows, &log_energies);
+    for (int32 r = 0; r < block_size; r++) {
+      Vector<BaseFloat> window;
+      BaseFloat log_energy;
+      ExtractWindow(0, wave, first_frame + r, opts, window_function,
+                    &window, &log_energy);
+      SubVector<BaseFloat> window2(windows, r);
+      AssertEqual(window, window2);
+      AssertEqual(log_energy, log_energies(r));
+    }
+  }
+}
+
 
 }
 
 
 
+
 int main() {
   using namespace kaldi;
   try {
     UnitTestOnlineCmvn();
+    UnitTestExtractWindows();
     std::cout << "Tests succeeded.\n";
     return 0;
   } catch (const std::exception &e) {
@@ -43,12 +43,9 @@ void MfccComputer::Compute(BaseFloat signal_log_energy,
   else  // An alternative algorithm that works for non-powers-of-two.
     RealFft(signal_frame, true);
 
-  // Convert the FFT into a power spectrum.
-  ComputePowerSpectrum(signal_frame);
-  SubVector<BaseFloat> power_spectrum(*signal_frame, 0,
-                                      signal_frame->Dim() / 2 + 1);
-
-  mel_banks.Compute(power_spectrum, &mel_energies_);
+  // Sum with mel filterbanks over the power spectrum, which is computed on
+  // the fly from the FFT output.
+  mel_banks.ComputeFromFft(*signal_frame, &mel_energies_);
 
   // avoid log of zero (which should be prevented anyway by dithering).
   mel_energies_.ApplyFloor(std::numeric_limits<BaseFloat>::epsilon());
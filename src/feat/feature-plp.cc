@@ -132,17 +132,13 @@ void PlpComputer::Compute(BaseFloat signal_log_energy,
   else  // An alternative algorithm that works for non-powers-of-two.
     RealFft(signal_frame, true);
 
-  // Convert the FFT into a power spectrum.
-  ComputePowerSpectrum(signal_frame);  // elements 0 ... signal_frame->Dim()/2
-
-  SubVector<BaseFloat> power_spectrum(*signal_frame,
-                                      0, signal_frame->Dim() / 2 + 1);
-
   int32 num_mel_bins = opts_.mel_opts.num_bins;
 
   SubVector<BaseFloat> mel_energies(mel_energies_duplicated_, 1, num_mel_bins);
 
-  mel_banks.Compute(power_spectrum, &mel_energies);
+  // Sum with mel filterbanks over the power spectrum, which is computed on
+  // the fly from the FFT output.
+  mel_banks.ComputeFromFft(*signal_frame, &mel_energies);
 
   mel_energies.MulElements(equal_loudness);
 
@@ -44,6 +44,7 @@ struct FrameExtractionOptions {
   BaseFloat blackman_coeff;
   bool snip_edges;
   bool allow_downsample;
+  int32 max_feature_vectors;
   // May be "hamming", "rectangular", "povey", "hanning", "blackman"
   // "povey" is a window I made to be similar to Hamming but to go to zero at the
   // edges, it's pow((0.5 - 0.5*cos(n/N*2*pi)), 0.85)
@@ -59,7 +60,8 @@ struct FrameExtractionOptions {
       round_to_power_of_two(true),
       blackman_coeff(0.42),
       snip_edges(true),
-      allow_downsample(false) { }
+      allow_downsample(false),
+      max_feature_vectors(-1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("sample-frequency", &samp_freq,
@@ -88,6 +90,12 @@ struct FrameExtractionOptions {
     opts->Register("allow-downsample", &allow_downsample,
                    "If true, allow the input waveform to have a higher frequency than "
                    "the specified --sample-frequency (and we'll downsample).");
+    opts->Register("max-feature-vectors", &max_feature_vectors,
+                   "Memory optimization for online feature extraction.  If "
+                   "larger than 0, only this number of the latest feature "
+                   "vectors is retained; older ones are discarded.  Must "
+                   "cover whatever the consumers of the features look back "
+                   "at (e.g. CMVN window, splicing, decoder).");
   }
   int32 WindowShift() const {
     return static_cast<int32>(samp_freq * 0.001 * frame_shift_ms);
@@ -201,6 +209,56 @@ void ExtractWindow(int64 sample_offset,
                    Vector<BaseFloat> *window,
                    BaseFloat *log_energy_pre_window = NULL);
 
+/**
+  This is a batched version of ProcessWindow(), which processes the windows
+  of many frames at once; it gives the same results (up to roundoff, and
+  except for the random numbers used in dithering).
+   @param [in] opts  The options class to be used
+   @param [in] window_function  The windowing function-- should have
+                    been initialized using 'opts'.
+   @param [in,out] windows  A matrix with opts.WindowSize() columns, one row
+      per frame.  It will typically be a sub-matrix of a matrix with
+      opts.PaddedWindowSize() columns, with the remaining columns zero.
+   @param [out]   log_energy_pre_window If non-NULL, a vector of dimension
+      windows->NumRows(), to which we write the log-energy of each frame
+      after dithering and DC offset removal.
+ */
+void ProcessWindows(const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window = NULL);
+
+/*
+  ExtractWindows() is a batched version of ExtractWindow(): it extracts the
+  windowed, possibly-padded frames first_frame, first_frame + 1, ...,
+  first_frame + windows->NumRows() - 1 into the rows of 'windows', doing all
+  the processing with ProcessWindows().  Processing a block of frames at once
+  avoids the per-frame overhead of ExtractWindow().
+
+  @param [in] sample_offset  As for ExtractWindow().
+  @param [in] wave  The waveform
+  @param [in] first_frame  The index of the frame to be extracted to the
+                    first row of 'windows'; we require
+                    first_frame + windows->NumRows() <=
+                    NumFrames(sample_offset + wave.Dim(), opts, true).
+  @param [in] opts  The options class to be used
+  @param [in] window_function  The windowing function, as derived from the
+                    options class.
+  @param [out] windows  The windowed, possibly-padded frames.  Must have
+                    opts.PaddedWindowSize() columns.
+  @param [out] log_energy_pre_window  If non-NULL, a vector of dimension
+                   windows->NumRows() to which the log-energy of each frame
+                   prior to pre-emphasis and multiplying by the windowing
+                   function will be written.
+*/
+void ExtractWindows(int64 sample_offset,
+                    const VectorBase<BaseFloat> &wave,
+                    int32 first_frame,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window = NULL);
+
 
 // ExtractWaveformRemainder is useful if the waveform is coming in segments.
 // It extracts the bit of the waveform at the end of this block that you
@@ -0,0 +1,82 @@
+// feat/mel-computations-speed-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/mel-computations.h"
+#include "feat/feature-functions.h"
+#include "feat/feature-window.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// Computes mel energies of 'num_frames' random FFT outputs, once with
+// ComputePowerSpectrum() followed by MelBanks::Compute() and once with
+// MelBanks::ComputeFromFft(), and prints the time taken by each.
+static void TestMelBanksComputeSpeed(int32 frame_length_ms, int32 num_bins) {
+  FrameExtractionOptions frame_opts;
+  frame_opts.frame_length_ms = frame_length_ms;
+  MelBanksOptions mel_opts(num_bins);
+  MelBanks mel_banks(mel_opts, frame_opts, 1.0);
+
+  int32 padded_window_size = frame_opts.PaddedWindowSize(),
+      num_frames = 100000;
+  Matrix<BaseFloat> frames(num_frames, padded_window_size);
+  frames.SetRandn();
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> frame(frames, i);
+    RealFft(&frame, true);
+  }
+  Matrix<BaseFloat> mel_energies1(num_frames, num_bins),
+      mel_energies2(num_frames, num_bins);
+
+  Timer timer1;
+  Vector<BaseFloat> power_spectrum(padded_window_size);
+  for (int32 i = 0; i < num_frames; i++) {
+    power_spectrum.CopyFromVec(frames.Row(i));
+    ComputePowerSpectrum(&power_spectrum);
+    SubVector<BaseFloat> mel_energies(mel_energies1, i);
+    mel_banks.Compute(power_spectrum.Range(0, padded_window_size / 2 + 1),
+                      &mel_energies);
+  }
+  double time1 = timer1.Elapsed();
+
+  Timer timer2;
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> mel_energies(mel_energies2, i);
+    mel_banks.ComputeFromFft(frames.Row(i), &mel_energies);
+  }
+  double time2 = timer2.Elapsed();
+
+  KALDI_ASSERT(mel_energies1.ApproxEqual(mel_energies2, 1.0e-04));
+  KALDI_LOG << "For window size " << padded_window_size << " and "
+            << num_bins << " mel bins, ComputePowerSpectrum() + Compute() "
+            << "took " << time1 << "s and ComputeFromFft() took " << time2
+            << "s for " << num_frames << " frames.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestMelBanksComputeSpeed(25, 23);
+  TestMelBanksComputeSpeed(25, 40);
+  TestMelBanksComputeSpeed(25, 80);
+  TestMelBanksComputeSpeed(50, 80);
+  std::cout << "Test OK.\n";
+  return 0;
+}
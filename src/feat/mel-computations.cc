@@ -83,8 +83,13 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
               << "low-freq " << low_freq << " and high-freq "
               << high_freq;
 
-  bins_.resize(num_bins);
+  bin_offsets_.resize(num_bins);
+  weight_offsets_.resize(num_bins + 1);
+  weight_offsets_[0] = 0;
   center_freqs_.Resize(num_bins);
+  // "all_weights" will contain the weights for all the bins, concatenated;
+  // it's copied to weights_ at the end.
+  std::vector<BaseFloat> all_weights;
 
   for (int32 bin = 0; bin < num_bins; bin++) {
     BaseFloat left_mel = mel_low_freq + bin * mel_freq_delta,
@@ -123,27 +128,36 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
     KALDI_ASSERT(first_index != -1 && last_index >= first_index
                  && "You may have set --num-mel-bins too large.");
 
-    bins_[bin].first = first_index;
+    bin_offsets_[bin] = first_index;
     int32 size = last_index + 1 - first_index;
-    bins_[bin].second.Resize(size);
-    bins_[bin].second.CopyFromVec(this_bin.Range(first_index, size));
+    weight_offsets_[bin + 1] = weight_offsets_[bin] + size;
+    all_weights.insert(all_weights.end(), this_bin.Data() + first_index,
+                       this_bin.Data() + first_index + size);
 
     // Replicate a bug in HTK, for testing purposes.
     if (opts.htk_mode && bin == 0 && mel_low_freq != 0.0)
-      bins_[bin].second(0) = 0.0;
+      all_weights[weight_offsets_[bin]] = 0.0;
 
   }
+  weights_.Resize(all_weights.size(), kUndefined);
+  std::copy(all_weights.begin(), all_weights.end(), weights_.Data());
+
   if (debug_) {
-    for (size_t i = 0; i < bins_.size(); i++) {
-      KALDI_LOG << "bin " << i << ", offset = " << bins_[i].first
-                << ", vec = " << bins_[i].second;
+    for (int32 i = 0; i < num_bins; i++) {
+      SubVector<BaseFloat> this_bin(weights_, weight_offsets_[i],
+                                    weight_offsets_[i + 1] -
+                                    weight_offsets_[i]);
+      KALDI_LOG << "bin " << i << ", offset = " << bin_offsets_[i]
+                << ", vec = " << this_bin;
     }
   }
 }
 
 MelBanks::MelBanks(const MelBanks &other):
     center_freqs_(other.center_freqs_),
-    bins_(other.bins_),
+    bin_offsets_(other.bin_offsets_),
+    weight_offsets_(other.weight_offsets_),
+    weights_(other.weights_),
     debug_(other.debug_),
     htk_mode_(other.htk_mode_) { }
 
@@ -225,16 +239,63 @@ BaseFloat MelBanks::VtlnWarpMelFreq(BaseFloat vtln_low_cutoff,  // upper+lower f
 // "power_spectrum" contains fft energies.
 void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
                        VectorBase<BaseFloat> *mel_energies_out) const {
-  int32 num_bins = bins_.size();
+  int32 num_bins = bin_offsets_.size();
+  KALDI_ASSERT(mel_energies_out->Dim() == num_bins);
+  const BaseFloat *weights = weights_.Data();
+  BaseFloat *mel_energies = mel_energies_out->Data();
+
+  for (int32 i = 0; i < num_bins; i++) {
+    int32 begin = weight_offsets_[i], size = weight_offsets_[i + 1] - begin;
+    KALDI_ASSERT(bin_offsets_[i] + size <= power_spectrum.Dim());
+    const BaseFloat *w = weights + begin,
+        *p = power_spectrum.Data() + bin_offsets_[i];
+    // This loop is short, so it's faster to do it directly than to call
+    // VecVec(), which goes to BLAS.
+    BaseFloat energy = 0.0;
+    for (int32 j = 0; j < size; j++)
+      energy += w[j] * p[j];
+    mel_energies[i] = energy;
+  }
+  FinishCompute(mel_energies_out);
+}
+
+void MelBanks::ComputeFromFft(const VectorBase<BaseFloat> &fft_output,
+                              VectorBase<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = bin_offsets_.size();
   KALDI_ASSERT(mel_energies_out->Dim() == num_bins);
+  const BaseFloat *weights = weights_.Data(), *fft = fft_output.Data();
+  BaseFloat *mel_energies = mel_energies_out->Data();
+
+  for (int32 i = 0; i < num_bins; i++) {
+    int32 begin = weight_offsets_[i], size = weight_offsets_[i + 1] - begin,
+        offset = bin_offsets_[i];
+    // The mel bins never include the fft-bin for the Nyquist frequency, which
+    // in the FFT output is stored in place of the imaginary part of the zeroth
+    // bin.
+    KALDI_ASSERT(2 * (offset + size) <= fft_output.Dim());
+    const BaseFloat *w = weights + begin;
+    BaseFloat energy = 0.0;
+    int32 j = 0;
+    if (offset == 0) {  // the zeroth fft-bin has no imaginary part.
+      energy = w[0] * fft[0] * fft[0];
+      j = 1;
+    }
+    const BaseFloat *f = fft + 2 * offset;
+    for (; j < size; j++) {
+      BaseFloat re = f[2 * j], im = f[2 * j + 1];
+      energy += w[j] * (re * re + im * im);
+    }
+    mel_energies[i] = energy;
+  }
+  FinishCompute(mel_energies_out);
+}
 
+void MelBanks::FinishCompute(VectorBase<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = mel_energies_out->Dim();
   for (int32 i = 0; i < num_bins; i++) {
-    int32 offset = bins_[i].first;
-    const Vector<BaseFloat> &v(bins_[i].second);
-    BaseFloat energy = VecVec(v, power_spectrum.Range(offset, v.Dim()));
     // HTK-like flooring- for testing purposes (we prefer dither)
-    if (htk_mode_ && energy < 1.0) energy = 1.0;
-    (*mel_energies_out)(i) = energy;
+    if (htk_mode_ && (*mel_energies_out)(i) < 1.0)
+      (*mel_energies_out)(i) = 1.0;
 
     // The following assert was added due to a problem with OpenBlas that
     // we had at one point (it was a bug in that library).  Just to detect
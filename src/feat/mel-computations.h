@@ -111,7 +111,16 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                VectorBase<BaseFloat> *mel_energies_out) const;
 
-  int32 NumBins() const { return bins_.size(); }
+  /// This does the same as calling ComputePowerSpectrum() on "fft_output" and
+  /// then calling Compute(), but it works directly from the output of the real
+  /// FFT, which is in the format produced by RealFft() and SplitRadixRealFft,
+  /// i.e. [real0, real_{N/2}, real1, im1, real2, im2, ...], and only computes
+  /// the power spectrum for the FFT bins that the mel bins cover, without a
+  /// separate pass over the data.  "fft_output" is not modified.
+  void ComputeFromFft(const VectorBase<BaseFloat> &fft_output,
+                      VectorBase<BaseFloat> *mel_energies_out) const;
+
+  int32 NumBins() const { return bin_offsets_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
   const Vector<BaseFloat> &GetCenterFreqs() const { return center_freqs_; }
@@ -126,9 +135,19 @@ class MelBanks {
   // Needed by GetCenterFreqs().
   Vector<BaseFloat> center_freqs_;
 
-  // the "bins_" vector is a vector, one for each bin, of a pair:
-  // (the first nonzero fft-bin), (the vector of weights).
-  std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
+  // Applies the HTK-style flooring (if htk_mode_) and prints debugging
+  // output (if debug_); called at the end of Compute() and ComputeFromFft().
+  void FinishCompute(VectorBase<BaseFloat> *mel_energies_out) const;
+
+  // bin_offsets_[i] is the index of the first nonzero fft-bin of mel bin i.
+  std::vector<int32> bin_offsets_;
+  // The weights of mel bin i are weights_(weight_offsets_[i]) through
+  // weights_(weight_offsets_[i+1] - 1), applied to fft-bins starting from
+  // bin_offsets_[i].  We store them contiguously rather than as one vector
+  // per bin, for memory locality.  weight_offsets_ has dimension
+  // NumBins() + 1.
+  std::vector<int32> weight_offsets_;
+  Vector<BaseFloat> weights_;
 
   bool debug_;
   bool htk_mode_;
@@ -195,6 +195,51 @@ void TestOnlineMfcc() {
   }
 }
 
+void TestOnlineMfccDownsample() {
+  std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
+  WaveData wave;
+  wave.Read(is);
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  MfccOptions op;
+  op.frame_opts.dither = 0.0;
+  op.frame_opts.samp_freq = wave.SampFreq() / 2;
+  op.frame_opts.allow_downsample = true;
+  if (RandInt(0, 1) == 0)
+    op.frame_opts.snip_edges = false;
+  Mfcc mfcc(op);
+
+  // downsample and compute mfcc offline
+  Vector<BaseFloat> downsampled_wave;
+  DownsampleWaveForm(wave.SampFreq(), waveform, op.frame_opts.samp_freq,
+                     &downsampled_wave);
+  Matrix<BaseFloat> mfcc_feats;
+  mfcc.Compute(downsampled_wave, 1.0, &mfcc_feats);
+
+  for (int32 num_piece = 5; num_piece < 10; num_piece++) {
+    OnlineMfcc online_mfcc(op);
+    std::vector<int32> piece_length(num_piece, 0);
+
+    bool ret = RandomSplit(waveform.Dim(), &piece_length, num_piece);
+    KALDI_ASSERT(ret);
+
+    int32 offset_start = 0;
+    for (int32 i = 0; i < num_piece; i++) {
+      Vector<BaseFloat> wave_piece(
+        waveform.Range(offset_start, piece_length[i]));
+      online_mfcc.AcceptWaveform(wave.SampFreq(), wave_piece);
+      offset_start += piece_length[i];
+    }
+    online_mfcc.InputFinished();
+
+    Matrix<BaseFloat> online_mfcc_feats;
+    GetOutput(&online_mfcc, &online_mfcc_feats);
+
+    AssertEqual(mfcc_feats, online_mfcc_feats);
+  }
+}
+
 void TestOnlinePlp() {
   std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
   WaveData wave;
@@ -375,6 +420,103 @@ void TestOnlineAppendFeature() {
   }
 }
 
+// Tests that with --max-feature-vectors and --max-cached-frames set, so that
+// OnlineMfcc and OnlineCmvn only retain their latest frames, we get the same
+// features as without, as long as we only look at recent frames.
+void TestOnlineFeatureRetention() {
+  std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
+  WaveData wave;
+  wave.Read(is);
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  MfccOptions op;
+  op.frame_opts.dither = 0.0;
+  op.frame_opts.samp_freq = wave.SampFreq();
+  if (RandInt(0, 1) == 0)
+    op.frame_opts.snip_edges = false;
+  Mfcc mfcc(op);
+  Matrix<BaseFloat> mfcc_feats;
+  mfcc.Compute(waveform, 1.0, &mfcc_feats);
+  int32 num_frames = mfcc_feats.NumRows(), dim = mfcc_feats.NumCols();
+
+  OnlineCmvnOptions cmvn_opts;
+  cmvn_opts.cmn_window = 30;
+  cmvn_opts.speaker_frames = 30;
+  cmvn_opts.global_frames = 20;
+  Matrix<double> global_stats(2, dim + 1);
+  for (int32 t = 0; t < num_frames; t++) {
+    Vector<double> feat(mfcc_feats.Row(t));
+    global_stats.Row(0).Range(0, dim).AddVec(1.0, feat);
+    global_stats.Row(1).Range(0, dim).AddVec2(1.0, feat);
+    global_stats(0, dim) += 1.0;
+  }
+  OnlineCmvnState cmvn_state(global_stats);
+
+  MfccOptions bounded_op(op);
+  int32 lookback = RandInt(0, 10);
+  OnlineCmvnOptions bounded_cmvn_opts(cmvn_opts);
+  bounded_cmvn_opts.max_cached_frames = lookback + RandInt(0, 5);
+  // We'll give the waveform in pieces of up to max_piece_frames frames; the
+  // frames retained have to cover the ones computed from a piece too.
+  int32 max_piece_frames = 10,
+      frame_shift = bounded_op.frame_opts.WindowShift();
+  bounded_op.frame_opts.max_feature_vectors = cmvn_opts.cmn_window +
+      bounded_cmvn_opts.max_cached_frames + cmvn_opts.modulus +
+      max_piece_frames;
+
+  OnlineMfcc online_mfcc(op), bounded_mfcc(bounded_op);
+  OnlineCmvn online_cmvn(cmvn_opts, cmvn_state, &online_mfcc),
+      bounded_cmvn(bounded_cmvn_opts, cmvn_state, &bounded_mfcc);
+
+  Vector<BaseFloat> feat1(dim), feat2(dim);
+  int32 offset_start = 0, frames_done = 0;
+  while (offset_start < waveform.Dim()) {
+    int32 piece_length = std::min(waveform.Dim() - offset_start,
+                                  RandInt(1, max_piece_frames * frame_shift));
+    SubVector<BaseFloat> wave_piece(waveform, offset_start, piece_length);
+    online_mfcc.AcceptWaveform(wave.SampFreq(), wave_piece);
+    bounded_mfcc.AcceptWaveform(wave.SampFreq(), wave_piece);
+    offset_start += piece_length;
+    if (offset_start == waveform.Dim()) {
+      online_mfcc.InputFinished();
+      bounded_mfcc.InputFinished();
+    }
+    int32 num_frames_ready = bounded_mfcc.NumFramesReady();
+    KALDI_ASSERT(num_frames_ready == online_mfcc.NumFramesReady());
+    for (; frames_done < num_frames_ready; frames_done++) {
+      bounded_mfcc.GetFrame(frames_done, &feat2);
+      SubVector<BaseFloat> offline_feat(mfcc_feats, frames_done);
+      AssertEqual(feat2, offline_feat);
+      // Look back a little, as a decoder might.
+      int32 t = std::max(0, frames_done - lookback);
+      online_cmvn.GetFrame(t, &feat1);
+      bounded_cmvn.GetFrame(t, &feat2);
+      AssertEqual(feat1, feat2);
+      online_cmvn.GetFrame(frames_done, &feat1);
+      bounded_cmvn.GetFrame(frames_done, &feat2);
+      AssertEqual(feat1, feat2);
+    }
+  }
+  KALDI_ASSERT(frames_done == num_frames);
+
+  // The oldest frames should have been discarded.
+  if (num_frames > bounded_op.frame_opts.max_feature_vectors) {
+    bool threw = false;
+    try {
+      bounded_mfcc.GetFrame(0, &feat2);
+    } catch (const std::exception &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+  }
+
+  OnlineCmvnState state1, state2;
+  online_cmvn.GetState(num_frames - 1, &state1);
+  bounded_cmvn.GetState(num_frames - 1, &state2);
+  AssertEqual(state1.speaker_cmvn_stats, state2.speaker_cmvn_stats);
+}
+
 }  // end namespace kaldi
 
 int main() {
@@ -384,9 +526,11 @@ int main() {
     TestOnlineDeltaFeature();
     TestOnlineSpliceFrames();
     TestOnlineMfcc();
+    TestOnlineMfccDownsample();
     TestOnlinePlp();
     TestOnlineTransform();
     TestOnlineAppendFeature();
+    TestOnlineFeatureRetention();
   }
   std::cout << "Test OK.\n";
 }
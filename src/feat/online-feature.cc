@@ -19,69 +19,144 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
+
 #include "feat/online-feature.h"
 #include "transform/cmvn.h"
 
 namespace kaldi {
 
+const SubVector<BaseFloat> FrameRingBuffer::Frame(int32 frame) const {
+  if (frame < FirstFrame() || frame >= num_frames_) {
+    if (frame >= 0 && frame < num_frames_)
+      KALDI_ERR << "Frame " << frame << " has been discarded: only the latest "
+                << max_frames_ << " frames are retained.";
+    else
+      KALDI_ERR << "Frame " << frame << " out of range, there are "
+                << num_frames_ << " frames.";
+  }
+  return frames_.Row(frame % frames_.NumRows());
+}
+
+SubVector<BaseFloat> FrameRingBuffer::AppendFrame() {
+  int32 num_rows = frames_.NumRows();
+  if (num_frames_ == num_rows && (max_frames_ <= 0 || num_rows < max_frames_)) {
+    // No frame has been discarded yet, so frame t is in row t and we can
+    // grow the matrix while keeping the frames in place.
+    int32 new_num_rows = std::max<int32>(2 * num_rows, 16);
+    if (max_frames_ > 0)
+      new_num_rows = std::min(new_num_rows, max_frames_);
+    frames_.Resize(new_num_rows, dim_, kCopyData);
+  }
+  int32 row = num_frames_ % frames_.NumRows();
+  num_frames_++;
+  return frames_.Row(row);
+}
+
 template<class C>
 void OnlineGenericBaseFeature<C>::GetFrame(int32 frame,
                                            VectorBase<BaseFloat> *feat) {
-  // 'at' does size checking.
-  feat->CopyFromVec(*(features_.at(frame)));
+  // Frame() does range checking.
+  feat->CopyFromVec(features_.Frame(frame));
 };
 
 template<class C>
 OnlineGenericBaseFeature<C>::OnlineGenericBaseFeature(
     const typename C::Options &opts):
     computer_(opts), window_function_(computer_.GetFrameOptions()),
-    input_finished_(false), waveform_offset_(0) { }
+    features_(computer_.Dim(), computer_.GetFrameOptions().max_feature_vectors),
+    input_finished_(false), waveform_offset_(0), waveform_remainder_dim_(0),
+    resampler_(NULL), resampler_rate_(0.0) { }
 
 template<class C>
 void OnlineGenericBaseFeature<C>::AcceptWaveform(BaseFloat sampling_rate,
                                                  const VectorBase<BaseFloat> &waveform) {
-  BaseFloat expected_sampling_rate = computer_.GetFrameOptions().samp_freq;
-  if (sampling_rate != expected_sampling_rate)
-    KALDI_ERR << "Sampling frequency mismatch, expected "
-              << expected_sampling_rate << ", got " << sampling_rate;
+  const FrameExtractionOptions &frame_opts = computer_.GetFrameOptions();
+  BaseFloat expected_sampling_rate = frame_opts.samp_freq;
+  if (sampling_rate != expected_sampling_rate) {
+    if (!frame_opts.allow_downsample ||
+        sampling_rate < expected_sampling_rate)
+      KALDI_ERR << "Sampling frequency mismatch, expected "
+                << expected_sampling_rate << ", got " << sampling_rate
+                << (sampling_rate > expected_sampling_rate ?
+                    " (use --allow-downsample=true to allow downsampling "
+                    "the waveform)" : "");
+    if (resampler_ != NULL && resampler_rate_ != sampling_rate)
+      KALDI_ERR << "Sampling frequency changed within an utterance, from "
+                << resampler_rate_ << " to " << sampling_rate;
+  }
   if (waveform.Dim() == 0)
     return;  // Nothing to do.
   if (input_finished_)
     KALDI_ERR << "AcceptWaveform called after InputFinished() was called.";
-  // append 'waveform' to 'waveform_remainder_.'
-  Vector<BaseFloat> appended_wave(waveform_remainder_.Dim() + waveform.Dim());
-  if (waveform_remainder_.Dim() != 0)
-    appended_wave.Range(0, waveform_remainder_.Dim()).CopyFromVec(
-        waveform_remainder_);
-  appended_wave.Range(waveform_remainder_.Dim(), waveform.Dim()).CopyFromVec(
+  if (sampling_rate != expected_sampling_rate) {
+    if (resampler_ == NULL) {
+      // Use the same filter as DownsampleWaveForm().
+      BaseFloat lowpass_cutoff = 0.99 * 0.5 * expected_sampling_rate;
+      int32 lowpass_filter_width = 6;
+      resampler_ = new LinearResample(sampling_rate, expected_sampling_rate,
+                                      lowpass_cutoff, lowpass_filter_width);
+      resampler_rate_ = sampling_rate;
+    }
+    Vector<BaseFloat> downsampled_wave;
+    resampler_->Resample(waveform, false, &downsampled_wave);
+    AppendWaveform(downsampled_wave);
+  } else {
+    AppendWaveform(waveform);
+  }
+  ComputeFeatures();
+}
+
+template<class C>
+void OnlineGenericBaseFeature<C>::AppendWaveform(
+    const VectorBase<BaseFloat> &waveform) {
+  if (waveform.Dim() == 0)
+    return;
+  // append 'waveform' to the waveform remainder, growing the buffer
+  // geometrically so that we rarely need to reallocate it.
+  int32 new_dim = waveform_remainder_dim_ + waveform.Dim();
+  if (new_dim > waveform_buffer_.Dim())
+    waveform_buffer_.Resize(std::max(new_dim, 2 * waveform_buffer_.Dim()),
+                            kCopyData);
+  waveform_buffer_.Range(waveform_remainder_dim_, waveform.Dim()).CopyFromVec(
       waveform);
-  waveform_remainder_.Swap(&appended_wave);
+  waveform_remainder_dim_ = new_dim;
+}
+
+template<class C>
+void OnlineGenericBaseFeature<C>::InputFinished() {
+  if (resampler_ != NULL && !input_finished_) {
+    // Flush out the last few samples held back by the resampler.
+    Vector<BaseFloat> empty, downsampled_wave;
+    resampler_->Resample(empty, true, &downsampled_wave);
+    AppendWaveform(downsampled_wave);
+  }
+  input_finished_ = true;
   ComputeFeatures();
 }
 
 template<class C>
 void OnlineGenericBaseFeature<C>::ComputeFeatures() {
   const FrameExtractionOptions &frame_opts = computer_.GetFrameOptions();
-  int64 num_samples_total = waveform_offset_ + waveform_remainder_.Dim();
-  int32 num_frames_old = features_.size(),
+  SubVector<BaseFloat> waveform_remainder(waveform_buffer_, 0,
+                                          waveform_remainder_dim_);
+  int64 num_samples_total = waveform_offset_ + waveform_remainder_dim_;
+  int32 num_frames_old = features_.NumFrames(),
       num_frames_new = NumFrames(num_samples_total, frame_opts,
                                  input_finished_);
   KALDI_ASSERT(num_frames_new >= num_frames_old);
-  features_.resize(num_frames_new, NULL);
 
-  Vector<BaseFloat> window;
   bool need_raw_log_energy = computer_.NeedRawLogEnergy();
   for (int32 frame = num_frames_old; frame < num_frames_new; frame++) {
     BaseFloat raw_log_energy = 0.0;
-    ExtractWindow(waveform_offset_, waveform_remainder_, frame,
-                  frame_opts, window_function_, &window,
+    ExtractWindow(waveform_offset_, waveform_remainder, frame,
+                  frame_opts, window_function_, &window_,
                   need_raw_log_energy ? &raw_log_energy : NULL);
-    Vector<BaseFloat> *this_feature = new Vector<BaseFloat>(computer_.Dim(),
-                                                            kUndefined);
+    // The features are computed directly into their place in features_.
+    SubVector<BaseFloat> this_feature(features_.AppendFrame());
     // note: this online feature-extraction code does not support VTLN.
     BaseFloat vtln_warp = 1.0;
-    computer_.Compute(raw_log_energy, vtln_warp, &window, this_feature);
-    features_[frame] = this_feature;
+    computer_.Compute(raw_log_energy, vtln_warp, &window_, &this_feature);
   }
   // OK, we will now discard any portion of the signal that will not be
   // necessary to compute frames in the future.
@@ -90,17 +165,19 @@ void OnlineGenericBaseFeature<C>::ComputeFeatures() {
   int32 samples_to_discard = first_sample_of_next_frame - waveform_offset_;
   if (samples_to_discard > 0) {
     // discard the leftmost part of the waveform that we no longer need.
-    int32 new_num_samples = waveform_remainder_.Dim() - samples_to_discard;
+    int32 new_num_samples = waveform_remainder_dim_ - samples_to_discard;
     if (new_num_samples <= 0) {
       // odd, but we'll try to handle it.
-      waveform_offset_ += waveform_remainder_.Dim();
-      waveform_remainder_.Resize(0);
+      waveform_offset_ += waveform_remainder_dim_;
+      waveform_remainder_dim_ = 0;
     } else {
-      Vector<BaseFloat> new_remainder(new_num_samples);
-      new_remainder.CopyFromVec(waveform_remainder_.Range(samples_to_discard,
-                                                          new_num_samples));
+      // shift the remaining samples to the start of the buffer; the ranges
+      // may overlap, so we use memmove.
+      BaseFloat *data = waveform_buffer_.Data();
+      std::memmove(data, data + samples_to_discard,
+                   sizeof(BaseFloat) * new_num_samples);
       waveform_offset_ += samples_to_discard;
-      waveform_remainder_.Swap(&new_remainder);
+      waveform_remainder_dim_ = new_num_samples;
     }
   }
 }
@@ -143,7 +220,8 @@ void OnlineCmvnState::Read(std::istream &is, bool binary) {
 OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
                        const OnlineCmvnState &cmvn_state,
                        OnlineFeatureInterface *src):
-    opts_(opts), src_(src) {
+    opts_(opts), cached_stats_modulo_offset_(0), speaker_stats_frames_(0),
+    src_(src) {
   SetState(cmvn_state);
   if (!SplitStringToIntegers(opts.skip_dims, ":", false, &skip_dims_))
     KALDI_ERR << "Bad --skip-dims option (should be colon-separated list of "
@@ -151,7 +229,9 @@ OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
 }
 
 OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
-                       OnlineFeatureInterface *src): opts_(opts), src_(src) {
+                       OnlineFeatureInterface *src):
+    opts_(opts), cached_stats_modulo_offset_(0), speaker_stats_frames_(0),
+    src_(src) {
   if (!SplitStringToIntegers(opts.skip_dims, ":", false, &skip_dims_))
     KALDI_ERR << "Bad --skip-dims option (should be colon-separated list of "
               <<  "integers)";
@@ -160,7 +240,7 @@ OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
 
 void OnlineCmvn::GetMostRecentCachedFrame(int32 frame,
                                           int32 *cached_frame,
-                                          Matrix<double> *stats) {
+                                          MatrixBase<double> *stats) {
   KALDI_ASSERT(frame >= 0);
   InitRingBufferIfNeeded();
   // look for a cached frame on a previous frame as close as possible in time
@@ -174,23 +254,27 @@ void OnlineCmvn::GetMostRecentCachedFrame(int32 frame,
     int32 index = t % opts_.ring_buffer_size;
     if (cached_stats_ring_[index].first == t) {
       *cached_frame = t;
-      *stats = cached_stats_ring_[index].second;
+      stats->CopyFromMat(cached_stats_ring_[index].second);
       return;
     }
   }
-  int32 n = frame / opts_.modulus;
+  int32 n = frame / opts_.modulus - cached_stats_modulo_offset_;
+  if (n < 0)
+    KALDI_ERR << "CMVN stats for frame " << frame << " are no longer "
+              << "available; you may need to increase --max-cached-frames "
+              << "(currently " << opts_.max_cached_frames << ")";
   if (n >= cached_stats_modulo_.size()) {
     if (cached_stats_modulo_.size() == 0) {
       *cached_frame = -1;
-      stats->Resize(2, this->Dim() + 1);
+      stats->SetZero();
       return;
     } else {
       n = static_cast<int32>(cached_stats_modulo_.size() - 1);
     }
   }
-  *cached_frame = n * opts_.modulus;
+  *cached_frame = (n + cached_stats_modulo_offset_) * opts_.modulus;
   KALDI_ASSERT(cached_stats_modulo_[n] != NULL);
-  *stats = *(cached_stats_modulo_[n]);
+  stats->CopyFromMat(*(cached_stats_modulo_[n]));
 }
 
 // Initialize ring buffer for caching stats.
@@ -202,17 +286,31 @@ void OnlineCmvn::InitRingBufferIfNeeded() {
   }
 }
 
-void OnlineCmvn::CacheFrame(int32 frame, const Matrix<double> &stats) {
+void OnlineCmvn::CacheFrame(int32 frame, const MatrixBase<double> &stats) {
   KALDI_ASSERT(frame >= 0);
   if (frame % opts_.modulus == 0) {  // store in cached_stats_modulo_.
-    int32 n = frame / opts_.modulus;
+    int32 n = frame / opts_.modulus - cached_stats_modulo_offset_;
+    KALDI_ASSERT(n >= 0);
     if (n >= cached_stats_modulo_.size()) {
       // The following assert is a limitation on in what order you can call
       // CacheFrame.  Fortunately the calling code always calls it in sequence,
       // which it has to because you need a previous frame to compute the
       // current one.
       KALDI_ASSERT(n == cached_stats_modulo_.size());
-      cached_stats_modulo_.push_back(new Matrix<double>(stats));
+      if (opts_.max_cached_frames > 0 && !cached_stats_modulo_.empty() &&
+          (cached_stats_modulo_offset_ + 1) * opts_.modulus <=
+          frame - opts_.max_cached_frames) {
+        // Recycle the oldest cached stats, which are no longer needed: frames
+        // from frame - opts_.max_cached_frames onward can be computed from
+        // the next ones.
+        Matrix<double> *oldest = cached_stats_modulo_.front();
+        cached_stats_modulo_.pop_front();
+        cached_stats_modulo_offset_++;
+        oldest->CopyFromMat(stats);
+        cached_stats_modulo_.push_back(oldest);
+      } else {
+        cached_stats_modulo_.push_back(new Matrix<double>(stats));
+      }
     } else {
       KALDI_WARN << "Did not expect to reach this part of code.";
       // do what seems right, but we shouldn't get here.
@@ -234,37 +332,48 @@ OnlineCmvn::~OnlineCmvn() {
   cached_stats_modulo_.clear();
 }
 
+// static
+void OnlineCmvn::AddFrameToStats(const VectorBase<double> &feat,
+                                 double weight,
+                                 MatrixBase<double> *stats) {
+  int32 dim = feat.Dim();
+  stats->Row(0).Range(0, dim).AddVec(weight, feat);
+  stats->Row(1).Range(0, dim).AddVec2(weight, feat);
+  (*stats)(0, dim) += weight;
+}
+
 void OnlineCmvn::ComputeStatsForFrame(int32 frame,
-                                      MatrixBase<double> *stats_out) {
+                                      MatrixBase<double> *stats) {
   KALDI_ASSERT(frame >= 0 && frame < src_->NumFramesReady());
-
   int32 dim = this->Dim(), cur_frame;
-  Matrix<double> stats(2, dim + 1);
-  GetMostRecentCachedFrame(frame, &cur_frame, &stats);
+  KALDI_ASSERT(stats->NumRows() == 2 && stats->NumCols() == dim + 1);
+  GetMostRecentCachedFrame(frame, &cur_frame, stats);
 
-  Vector<BaseFloat> feats(dim);
-  Vector<double> feats_dbl(dim);
+  temp_feat_.Resize(dim, kUndefined);
+  temp_feat_dbl_.Resize(dim, kUndefined);
   while (cur_frame < frame) {
     cur_frame++;
-    src_->GetFrame(cur_frame, &feats);
-    feats_dbl.CopyFromVec(feats);
-    stats.Row(0).Range(0, dim).AddVec(1.0, feats_dbl);
-    stats.Row(1).Range(0, dim).AddVec2(1.0, feats_dbl);
-    stats(0, dim) += 1.0;
+    src_->GetFrame(cur_frame, &temp_feat_);
+    temp_feat_dbl_.CopyFromVec(temp_feat_);
+    AddFrameToStats(temp_feat_dbl_, 1.0, stats);
+    if (cur_frame == speaker_stats_frames_) {
+      // This is the first time we have seen this frame, so add it to the
+      // speaker stats while we have it.
+      InitSpeakerStatsIfNeeded();
+      AddFrameToStats(temp_feat_dbl_, 1.0, &speaker_stats_);
+      speaker_stats_frames_++;
+    }
     // it's a sliding buffer; a frame at the back may be
     // leaving the buffer so we have to subtract that.
     int32 prev_frame = cur_frame - opts_.cmn_window;
     if (prev_frame >= 0) {
       // we need to subtract frame prev_f from the stats.
-      src_->GetFrame(prev_frame, &feats);
-      feats_dbl.CopyFromVec(feats);
-      stats.Row(0).Range(0, dim).AddVec(-1.0, feats_dbl);
-      stats.Row(1).Range(0, dim).AddVec2(-1.0, feats_dbl);
-      stats(0, dim) -= 1.0;
+      src_->GetFrame(prev_frame, &temp_feat_);
+      temp_feat_dbl_.CopyFromVec(temp_feat_);
+      AddFrameToStats(temp_feat_dbl_, -1.0, stats);
     }
-    CacheFrame(cur_frame, stats);
+    CacheFrame(cur_frame, *stats);
   }
-  stats_out->CopyFromMat(stats);
 }
 
 
@@ -311,7 +420,8 @@ void OnlineCmvn::GetFrame(int32 frame,
   src_->GetFrame(frame, feat);
   KALDI_ASSERT(feat->Dim() == this->Dim());
   int32 dim = feat->Dim();
-  Matrix<double> stats(2, dim + 1);
+  Matrix<double> &stats = temp_stats_;
+  stats.Resize(2, dim + 1, kUndefined);  // Does nothing if the size is right.
   if (frozen_state_.NumRows() != 0) {  // the CMVN state has been frozen.
     stats.CopyFromMat(frozen_state_);
   } else {
@@ -328,15 +438,12 @@ void OnlineCmvn::GetFrame(int32 frame,
     FakeStatsForSomeDims(skip_dims_, &stats);
 
   // call the function ApplyCmvn declared in ../transform/cmvn.h, which
-  // requires a matrix.
-  Matrix<BaseFloat> feat_mat(1, dim);
-  feat_mat.Row(0).CopyFromVec(*feat);
-  // the function ApplyCmvn takes a matrix, so form a one-row matrix to give it.
+  // requires a matrix; we give it a one-row matrix that shares feat's data.
+  SubMatrix<BaseFloat> feat_mat(feat->Data(), 1, dim, dim);
   if (opts_.normalize_mean)
     ApplyCmvn(stats, opts_.normalize_variance, &feat_mat);
   else
     KALDI_ASSERT(!opts_.normalize_variance);
-  feat->CopyFromVec(feat_mat.Row(0));
 }
 
 void OnlineCmvn::Freeze(int32 cur_frame) {
@@ -352,21 +459,49 @@ void OnlineCmvn::Freeze(int32 cur_frame) {
   this->frozen_state_ = stats;
 }
 
+void OnlineCmvn::InitSpeakerStatsIfNeeded() {
+  if (speaker_stats_.NumRows() == 0) {
+    if (orig_state_.speaker_cmvn_stats.NumRows() != 0)
+      speaker_stats_ = orig_state_.speaker_cmvn_stats;
+    else
+      speaker_stats_.Resize(2, this->Dim() + 1);
+  }
+}
+
+void OnlineCmvn::AccumulateSpeakerStats(int32 cur_frame) {
+  int32 dim = this->Dim();
+  InitSpeakerStatsIfNeeded();
+  temp_feat_.Resize(dim, kUndefined);
+  temp_feat_dbl_.Resize(dim, kUndefined);
+  for (; speaker_stats_frames_ <= cur_frame; speaker_stats_frames_++) {
+    src_->GetFrame(speaker_stats_frames_, &temp_feat_);
+    temp_feat_dbl_.CopyFromVec(temp_feat_);
+    AddFrameToStats(temp_feat_dbl_, 1.0, &speaker_stats_);
+  }
+}
+
 void OnlineCmvn::GetState(int32 cur_frame,
                           OnlineCmvnState *state_out) {
   *state_out = this->orig_state_;
   { // This block updates state_out->speaker_cmvn_stats
     int32 dim = this->Dim();
-    if (state_out->speaker_cmvn_stats.NumRows() == 0)
-      state_out->speaker_cmvn_stats.Resize(2, dim + 1);
-    Vector<BaseFloat> feat(dim);
-    Vector<double> feat_dbl(dim);
-    for (int32 t = 0; t <= cur_frame; t++) {
-      src_->GetFrame(t, &feat);
-      feat_dbl.CopyFromVec(feat);
-      state_out->speaker_cmvn_stats(0, dim) += 1.0;
-      state_out->speaker_cmvn_stats.Row(0).Range(0, dim).AddVec(1.0, feat_dbl);
-      state_out->speaker_cmvn_stats.Row(1).Range(0, dim).AddVec2(1.0, feat_dbl);
+    if (cur_frame + 1 >= speaker_stats_frames_) {
+      // The normal case: speaker_stats_ has the stats up to some frame not
+      // after cur_frame, so we just need to add the rest.
+      AccumulateSpeakerStats(cur_frame);
+      state_out->speaker_cmvn_stats = speaker_stats_;
+    } else {
+      // The user is asking for the state at an earlier frame than we have
+      // accumulated, so recompute it (this needs the old frames).
+      if (state_out->speaker_cmvn_stats.NumRows() == 0)
+        state_out->speaker_cmvn_stats.Resize(2, dim + 1);
+      Vector<BaseFloat> feat(dim);
+      Vector<double> feat_dbl(dim);
+      for (int32 t = 0; t <= cur_frame; t++) {
+        src_->GetFrame(t, &feat);
+        feat_dbl.CopyFromVec(feat);
+        AddFrameToStats(feat_dbl, 1.0, &(state_out->speaker_cmvn_stats));
+      }
     }
   }
   // Store any frozen state (the effect of the user possibly
@@ -375,10 +510,11 @@ void OnlineCmvn::GetState(int32 cur_frame,
 }
 
 void OnlineCmvn::SetState(const OnlineCmvnState &cmvn_state) {
-  KALDI_ASSERT(cached_stats_modulo_.empty() &&
+  KALDI_ASSERT(cached_stats_modulo_.empty() && speaker_stats_frames_ == 0 &&
                "You cannot call SetState() after processing data.");
   orig_state_ = cmvn_state;
   frozen_state_ = cmvn_state.frozen_state;
+  speaker_stats_.Resize(0, 0);  // speaker_stats_ depends on orig_state_.
 }
 
 int32 OnlineSpliceFrames::NumFramesReady() const {
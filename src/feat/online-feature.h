@@ -34,6 +34,7 @@
 #include "feat/feature-mfcc.h"
 #include "feat/feature-plp.h"
 #include "feat/feature-fbank.h"
+#include "feat/resample.h"
 #include "itf/online-feature-itf.h"
 
 namespace kaldi {
@@ -41,6 +42,48 @@ namespace kaldi {
 /// @{
 
 
+/// FrameRingBuffer stores the feature frames computed by an online feature
+/// class.  The frames are stored in the rows of a matrix which is used as a
+/// ring buffer, indexed by the frame index within the utterance.  If
+/// max_frames > 0, only the latest max_frames frames are retained (older ones
+/// are overwritten), so the memory used is bounded however long the stream
+/// is; otherwise all frames are retained and the matrix grows (doubling its
+/// size) as needed.  Either way there is no memory allocation per frame.
+class FrameRingBuffer {
+ public:
+  explicit FrameRingBuffer(int32 dim, int32 max_frames = -1):
+      dim_(dim), max_frames_(max_frames), num_frames_(0) { }
+
+  /// Returns the number of frames appended so far, including any that have
+  /// been discarded.
+  int32 NumFrames() const { return num_frames_; }
+
+  /// Returns the first frame that has not been discarded.
+  int32 FirstFrame() const {
+    return (max_frames_ > 0 && num_frames_ > max_frames_ ?
+            num_frames_ - max_frames_ : 0);
+  }
+
+  /// Returns frame "frame", which must satisfy
+  /// FirstFrame() <= frame < NumFrames(); it is an error otherwise.
+  const SubVector<BaseFloat> Frame(int32 frame) const;
+
+  /// Appends a frame (with index NumFrames() before the call) and returns
+  /// the storage for it, which the caller should set.  If max_frames > 0,
+  /// this may discard the oldest frame.
+  SubVector<BaseFloat> AppendFrame();
+
+ private:
+  int32 dim_;
+  int32 max_frames_;
+  int32 num_frames_;
+  // Frame t is stored in row t % frames_.NumRows().  The number of rows only
+  // increases while no frame has been discarded, so before that point frame t
+  // is in row t.
+  Matrix<BaseFloat> frames_;
+};
+
+
 /// This is a templated class for online feature extraction;
 /// it's templated on a class like MfccComputer or PlpComputer
 /// that does the basic feature extraction.
@@ -61,8 +104,11 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
     return computer_.GetFrameOptions().frame_shift_ms / 1000.0f;
   }
 
-  virtual int32 NumFramesReady() const { return features_.size(); }
+  virtual int32 NumFramesReady() const { return features_.NumFrames(); }
 
+  // Note: if --max-feature-vectors is set, only that many of the latest frames
+  // computed can be requested (it is an error to request a frame that has been
+  // discarded), so the caller needs to keep up with AcceptWaveform().
   virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
 
   // Next, functions that are not in the interface.
@@ -74,7 +120,9 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   // This would be called from the application, when you get
   // more wave data.  Note: the sampling_rate is only provided so
   // the code can assert that it matches the sampling rate
-  // expected in the options.
+  // expected in the options.  If --allow-downsample=true and the
+  // sampling_rate is higher than expected, the waveform is downsampled
+  // as it arrives, using a streaming LinearResample object.
   virtual void AcceptWaveform(BaseFloat sampling_rate,
                               const VectorBase<BaseFloat> &waveform);
 
@@ -83,31 +131,34 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   // more waveform.  This will help flush out the last frame or two
   // of features, in the case where snip-edges == false; it also
   // affects the return value of IsLastFrame().
-  virtual void InputFinished() {
-    input_finished_ = true;
-    ComputeFeatures();
-  }
+  virtual void InputFinished();
 
-  ~OnlineGenericBaseFeature() {
-    DeletePointers(&features_);
-  }
+  ~OnlineGenericBaseFeature() { delete resampler_; }
 
  private:
   // This function computes any additional feature frames that it is possible to
-  // compute from 'waveform_remainder_', which at this point may contain more
+  // compute from the waveform remainder, which at this point may contain more
   // than just a remainder-sized quantity (because AcceptWaveform() appends to
-  // waveform_remainder_ before calling this function).  It adds these feature
-  // frames to features_, and shifts off any now-unneeded samples of input from
-  // waveform_remainder_ while incrementing waveform_offset_ by the same amount.
+  // it before calling this function).  It adds these feature frames to
+  // features_, and shifts off any now-unneeded samples of input from the
+  // waveform remainder while incrementing waveform_offset_ by the same amount.
   void ComputeFeatures();
 
+  // Appends 'waveform' (which is at the configured sampling rate) to the
+  // waveform remainder, growing waveform_buffer_ if necessary.
+  void AppendWaveform(const VectorBase<BaseFloat> &waveform);
+
   C computer_;  // class that does the MFCC or PLP or filterbank computation
 
   FeatureWindowFunction window_function_;
 
-  // features_ is the Mfcc or Plp or Fbank features that we have already computed.
+  // features_ is the Mfcc or Plp or Fbank features that we have already
+  // computed (or the latest --max-feature-vectors of them).
+  FrameRingBuffer features_;
 
-  std::vector<Vector<BaseFloat>*> features_;
+  // window_ is a temporary used in ComputeFeatures(), stored here to avoid
+  // allocating it each time.
+  Vector<BaseFloat> window_;
 
   // True if the user has called "InputFinished()"
   bool input_finished_;
@@ -117,13 +168,24 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   BaseFloat sampling_frequency_;
 
   // waveform_offset_ is the number of samples of waveform that we have
-  // already discarded, i.e. thatn were prior to 'waveform_remainder_'.
+  // already discarded, i.e. thatn were prior to the waveform remainder.
   int64 waveform_offset_;
 
-  // waveform_remainder_ is a short piece of waveform that we may need to keep
-  // after extracting all the whole frames we can (whatever length of feature
-  // will be required for the next phase of computation).
-  Vector<BaseFloat> waveform_remainder_;
+  // The first waveform_remainder_dim_ samples of waveform_buffer_ (which we
+  // call the waveform remainder) are a short piece of waveform that we may need
+  // to keep after extracting all the whole frames we can (whatever length of
+  // feature will be required for the next phase of computation).  The rest of
+  // waveform_buffer_ is unused space, so that appending waveform does not
+  // normally need to allocate memory.
+  Vector<BaseFloat> waveform_buffer_;
+  int32 waveform_remainder_dim_;
+
+  // resampler_ is only used if the input waveform has a higher sampling
+  // rate than the configured one (and --allow-downsample=true); it is
+  // created on the first such call to AcceptWaveform().  resampler_rate_ is
+  // the input sampling rate it was created for.
+  LinearResample *resampler_;
+  BaseFloat resampler_rate_;
 };
 
 typedef OnlineGenericBaseFeature<MfccComputer> OnlineMfcc;
@@ -185,6 +247,10 @@ struct OnlineCmvnOptions {
                            // buffer used for caching CMVN stats.
   std::string skip_dims; // Colon-separated list of dimensions to skip normalization
                          // of, e.g. 13:14:15.
+  int32 max_cached_frames;  // If > 0, the stats cached every "modulus" frames
+                            // are discarded once they are more than this many
+                            // frames old, which bounds the memory used for
+                            // long streams.
 
   OnlineCmvnOptions():
       cmn_window(600),
@@ -194,7 +260,8 @@ struct OnlineCmvnOptions {
       normalize_variance(false),
       modulus(20),
       ring_buffer_size(20),
-      skip_dims("") { }
+      skip_dims(""),
+      max_cached_frames(-1) { }
 
   void Check() {
     KALDI_ASSERT(speaker_frames <= cmn_window && global_frames <= speaker_frames
@@ -218,7 +285,13 @@ struct OnlineCmvnOptions {
     po->Register("norm-means", &normalize_mean, "If true, do mean normalization "
                  "(note: you cannot normalize the variance but not the mean)");
     po->Register("skip-dims", &skip_dims, "Dimensions to skip normalization of "
-                 "(colon-separated list of integers)");}
+                 "(colon-separated list of integers)");
+    po->Register("max-cached-frames", &max_cached_frames, "Memory "
+                 "optimization for long streams.  If larger than 0, only "
+                 "frames up to this many frames before the latest frame can "
+                 "be normalized.  The features this reads from need to retain "
+                 "at least cmn-window + max-cached-frames + 20 frames (see "
+                 "--max-feature-vectors).");}
 };
 
 
@@ -287,6 +360,11 @@ struct OnlineCmvnState {
    stats.  The global stats are CMVN stats accumulated from training or testing
    data, that give us a reasonable source of mean and variance for "typical"
    data.
+
+   For endless streams, set "max_cached_frames" (and --max-feature-vectors for
+   the input features, see OnlineCmvnOptions) so that the memory used stays
+   bounded; the speaker stats needed for GetState() are accumulated as the
+   frames are processed, so they do not need the old frames.
  */
 class OnlineCmvn: public OnlineFeatureInterface {
  public:
@@ -371,10 +449,10 @@ class OnlineCmvn: public OnlineFeatureInterface {
   /// were cached, sets up empty stats for frame zero and returns that].
   void GetMostRecentCachedFrame(int32 frame,
                                 int32 *cached_frame,
-                                Matrix<double> *stats);
+                                MatrixBase<double> *stats);
 
   /// Cache this frame of stats.
-  void CacheFrame(int32 frame, const Matrix<double> &stats);
+  void CacheFrame(int32 frame, const MatrixBase<double> &stats);
 
   /// Initialize ring buffer for caching stats.
   inline void InitRingBufferIfNeeded();
@@ -385,6 +463,18 @@ class OnlineCmvn: public OnlineFeatureInterface {
   void ComputeStatsForFrame(int32 frame,
                             MatrixBase<double> *stats);
 
+  /// Initialize speaker_stats_ from orig_state_ if it is empty.
+  void InitSpeakerStatsIfNeeded();
+
+  /// Adds the stats of frames speaker_stats_frames_ through cur_frame
+  /// of the input to speaker_stats_.
+  void AccumulateSpeakerStats(int32 cur_frame);
+
+  /// Adds the (x, x^2, count) stats of "feat", times "weight", to "stats".
+  static inline void AddFrameToStats(const VectorBase<double> &feat,
+                                     double weight,
+                                     MatrixBase<double> *stats);
+
 
   OnlineCmvnOptions opts_;
   std::vector<int32> skip_dims_; // Skip CMVN for these dimensions.  Derived from opts_.
@@ -395,14 +485,29 @@ class OnlineCmvn: public OnlineFeatureInterface {
                                  // at.
 
   // The variable below reflects the raw (count, x, x^2) statistics of the
-  // input, computed every opts_.modulus frames.  raw_stats_[n / opts_.modulus]
+  // input, computed every opts_.modulus frames.
+  // cached_stats_modulo_[n / opts_.modulus - cached_stats_modulo_offset_]
   // contains the (count, x, x^2) statistics for the frames from
-  // std::max(0, n - opts_.cmn_window) through n.
-  std::vector<Matrix<double>*> cached_stats_modulo_;
+  // std::max(0, n - opts_.cmn_window) through n.  cached_stats_modulo_offset_
+  // is only nonzero if opts_.max_cached_frames > 0, in which case we discard
+  // the oldest ones.
+  std::deque<Matrix<double>*> cached_stats_modulo_;
+  int32 cached_stats_modulo_offset_;
   // the variable below is a ring-buffer of cached stats.  the int32 is the
   // frame index.
   std::vector<std::pair<int32, Matrix<double> > > cached_stats_ring_;
 
+  // speaker_stats_ is orig_state_.speaker_cmvn_stats plus the stats of frames
+  // 0 through speaker_stats_frames_ - 1 of the input; it is used in
+  // GetState().  It is empty until the first frame is accumulated.
+  Matrix<double> speaker_stats_;
+  int32 speaker_stats_frames_;
+
+  // Temporaries, stored here to avoid allocating them for each frame.
+  Matrix<double> temp_stats_;
+  Vector<BaseFloat> temp_feat_;
+  Vector<double> temp_feat_dbl_;
+
   OnlineFeatureInterface *src_;  // Not owned here
 };
 
@@ -442,6 +547,10 @@ class OnlineSpliceFrames: public OnlineFeatureInterface {
   //
   // Next, functions that are not in the interface.
   //
+  // Note: this class does not store any frames; GetFrame(t) reads frames
+  // t - left_context through t + right_context of "src", so if "src" retains
+  // only its latest frames (e.g. --max-feature-vectors), that has to cover
+  // left_context frames more than the lookback of whatever reads from here.
   OnlineSpliceFrames(const OnlineSpliceOptions &opts,
                      OnlineFeatureInterface *src):
       left_context_(opts.left_context), right_context_(opts.right_context),
@@ -324,6 +324,81 @@ static void UnitTestSearch() {
   KALDI_LOG << "Test passed :)\n";
 }
 
+extern bool pitch_use_naive_nccf;  // was declared in pitch-functions.cc
+extern bool pitch_keep_all_states;  // was declared in pitch-functions.cc
+
+// Computes the pitch of "wave", offline if chunk_size == 0 and otherwise
+// online, giving the waveform to OnlinePitchFeature in pieces of chunk_size
+// samples.
+static void ComputePitchInChunks(const PitchExtractionOptions &opts,
+                                 const VectorBase<BaseFloat> &wave,
+                                 int32 chunk_size,
+                                 Matrix<BaseFloat> *output) {
+  if (chunk_size == 0) {
+    ComputeKaldiPitch(opts, wave, output);
+    return;
+  }
+  OnlinePitchFeature pitch_extractor(opts);
+  for (int32 start_samp = 0; start_samp < wave.Dim();
+       start_samp += chunk_size) {
+    int32 num_samp = std::min(chunk_size, wave.Dim() - start_samp);
+    pitch_extractor.AcceptWaveform(opts.samp_freq,
+                                   wave.Range(start_samp, num_samp));
+  }
+  pitch_extractor.InputFinished();
+  output->Resize(pitch_extractor.NumFramesReady(), 2);
+  for (int32 frame = 0; frame < output->NumRows(); frame++) {
+    SubVector<BaseFloat> row(*output, frame);
+    pitch_extractor.GetFrame(frame, &row);
+  }
+}
+
+// Make sure that the NCCF computation that does all lags in one pass, and the
+// traceback that discards unreachable Viterbi states, give the same NCCF and
+// pitch on test.wav as the naive versions (a pair of dot-products per lag,
+// and keeping the states of all frames).  recompute_frame is set below the
+// number of frames so that the states are discarded after the backtraces
+// have been recomputed, and with nccf_ballast_online they are discarded from
+// the first chunk.
+static void UnitTestCompareNaive() {
+  KALDI_LOG << "=== UnitTestCompareNaive() ===\n";
+  WaveData wave;
+  {
+    std::ifstream is("test_data/test.wav");
+    wave.Read(is);
+  }
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  int32 chunk_sizes[] = { 0, 160, 1000, 4000 };
+  for (int32 n = 0; n < 3; n++) {
+    PitchExtractionOptions op;
+    if (n == 1)
+      op.recompute_frame = 50;
+    if (n == 2)
+      op.nccf_ballast_online = true;
+    for (int32 c = 0; c < 4; c++) {
+      Matrix<BaseFloat> m1, m2;
+      ComputePitchInChunks(op, waveform, chunk_sizes[c], &m1);
+
+      pitch_use_naive_nccf = true;
+      pitch_keep_all_states = true;
+      ComputePitchInChunks(op, waveform, chunk_sizes[c], &m2);
+      pitch_use_naive_nccf = false;
+      pitch_keep_all_states = false;
+
+      KALDI_ASSERT(m1.NumRows() == m2.NumRows());
+      // The NCCF differs by float roundoff only, and the pitch should be
+      // identical.
+      for (int32 frame = 0; frame < m1.NumRows(); frame++) {
+        KALDI_ASSERT(std::abs(m1(frame, 0) - m2(frame, 0)) < 1.0e-04);
+        KALDI_ASSERT(m1(frame, 1) == m2(frame, 1));
+      }
+    }
+  }
+  KALDI_LOG << "Test passed :)\n";
+}
+
 static void UnitTestComputeGPE() {
   KALDI_LOG << "=== UnitTestComputeGPE ===\n";
   int32 wrong_pitch = 0, tot_voiced = 0, tot_unvoiced = 0, num_frames = 0;
@@ -599,6 +674,7 @@ static void UnitTestFeatNoKeele() {
   UnitTestSnipEdges();
   UnitTestDelay();
   UnitTestSearch();
+  UnitTestCompareNaive();
 }
 
 static void UnitTestFeatWithKeele() {
@@ -87,6 +87,8 @@ BaseFloat NccfToPov(BaseFloat n) {
   return p;
 }
 
+bool pitch_use_naive_nccf = false;  // This is used in unit-tests.
+
 /**
    This function computes some dot products that are required
    while computing the NCCF.
@@ -109,16 +111,42 @@ void ComputeCorrelation(const VectorBase<BaseFloat> &wave,
   SubVector<BaseFloat> wave_part(wave, 0, nccf_window_size);
   // subtract mean-frame from wave
   zero_mean_wave.Add(-wave_part.Sum() / nccf_window_size);
-  BaseFloat e1, e2, sum;
   SubVector<BaseFloat> sub_vec1(zero_mean_wave, 0, nccf_window_size);
-  e1 = VecVec(sub_vec1, sub_vec1);
-  for (int32 lag = first_lag; lag <= last_lag; lag++) {
-    SubVector<BaseFloat> sub_vec2(zero_mean_wave, lag, nccf_window_size);
-    e2 = VecVec(sub_vec2, sub_vec2);
-    sum = VecVec(sub_vec1, sub_vec2);
-    (*inner_prod)(lag - first_lag) = sum;
-    (*norm_prod)(lag - first_lag) = e1 * e2;
+  BaseFloat e1 = VecVec(sub_vec1, sub_vec1);
+
+  if (pitch_use_naive_nccf) {
+    // This branch is only taken in unit-testing code.
+    for (int32 lag = first_lag; lag <= last_lag; lag++) {
+      SubVector<BaseFloat> sub_vec2(zero_mean_wave, lag, nccf_window_size);
+      (*inner_prod)(lag - first_lag) = VecVec(sub_vec1, sub_vec2);
+      (*norm_prod)(lag - first_lag) = e1 * VecVec(sub_vec2, sub_vec2);
+    }
+    return;
+  }
+
+  // Rather than doing two dot-products per lag, we accumulate the
+  // dot-products for all lags at once, with the innermost loop over the lag.
+  // That loop accesses contiguous memory and has no dependencies between
+  // iterations, so the compiler can vectorize it; the lags are typically too
+  // few, and the window too short, for BLAS calls to be efficient here.
+  int32 num_lags = last_lag - first_lag + 1;
+  KALDI_ASSERT(inner_prod->Dim() == num_lags && norm_prod->Dim() == num_lags &&
+               wave.Dim() >= last_lag + nccf_window_size);
+  Vector<BaseFloat> e2(num_lags);
+  inner_prod->SetZero();
+  const BaseFloat *wave_data = zero_mean_wave.Data();
+  BaseFloat *inner_prod_data = inner_prod->Data(), *e2_data = e2.Data();
+  for (int32 i = 0; i < nccf_window_size; i++) {
+    BaseFloat x = wave_data[i];
+    const BaseFloat *shifted_wave_data = wave_data + i + first_lag;
+    for (int32 j = 0; j < num_lags; j++) {
+      BaseFloat y = shifted_wave_data[j];
+      inner_prod_data[j] += x * y;
+      e2_data[j] += y * y;
+    }
   }
+  norm_prod->CopyFromVec(e2);
+  norm_prod->Scale(e1);
 }
 
 /**
@@ -136,7 +164,7 @@ void ComputeNccf(const VectorBase<BaseFloat> &inner_prod,
                inner_prod.Dim() == nccf_vec->Dim());
   for (int32 lag = 0; lag < inner_prod.Dim(); lag++) {
     BaseFloat numerator = inner_prod(lag),
-        denominator = pow(norm_prod(lag) + nccf_ballast, 0.5),
+        denominator = std::sqrt(norm_prod(lag) + nccf_ballast),
         nccf;
     if (denominator != 0.0) {
       nccf = numerator / denominator;
@@ -197,12 +225,19 @@ void ComputeLocalCost(const VectorBase<BaseFloat> &nccf_pitch,
 // of the pitch computation.
 class PitchFrameInfo {
  public:
-  /// This function resizes the arrays for this object and updates the reference
-  /// counts for the previous object (by decrementing those reference counts
-  /// when we destroy a StateInfo object).  A StateInfo object is considered to
-  /// be destroyed when we delete it, not when its reference counts goes to
-  /// zero.
-  void Cleanup(PitchFrameInfo *prev_frame);
+  /// This function may be called on the last (most recent) PitchFrameInfo
+  /// object.  Going backwards from this frame, it discards the StateInfo of
+  /// states that can no longer be on the best path, i.e. that are not
+  /// reachable by following backpointers from the states of the following
+  /// frame, and sets state_offset_ accordingly.  Once the traceback has
+  /// converged, earlier frames keep just a single state.  It stops at the
+  /// first frame where there is nothing to discard, since earlier frames
+  /// will have been dealt with by previous calls.  This bounds the memory
+  /// used for long utterances, and keeps SetBestState() and
+  /// ComputeLatency() working on a small, recently used part of the data.
+  /// It must not be called while the backtraces for these frames may still be
+  /// recomputed (see OnlinePitchFeatureImpl::RecomputeBacktraces()).
+  void PruneStates();
 
   /// This function may be called for the last (most recent) PitchFrameInfo
   /// object with the best state (obtained from the externally held
@@ -290,6 +325,7 @@ PitchFrameInfo::PitchFrameInfo(int32 num_states)
 
 
 bool pitch_use_naive_search = false;  // This is used in unit-tests.
+bool pitch_keep_all_states = false;  // This is used in unit-tests.
 
 
 PitchFrameInfo::PitchFrameInfo(PitchFrameInfo *prev_info):
@@ -543,8 +579,38 @@ int32 PitchFrameInfo::ComputeLatency(int32 max_latency) {
   return latency;
 }
 
-void PitchFrameInfo::Cleanup(PitchFrameInfo *prev_frame) {
-  KALDI_ERR << "Cleanup not implemented.";
+void PitchFrameInfo::PruneStates() {
+  // Like SetBestState() and ComputeLatency(), this is coded without recursion.
+  PitchFrameInfo *next_info = this;
+  for (PitchFrameInfo *this_info = prev_info_; this_info != NULL;
+       this_info = this_info->prev_info_) {
+    // Work out the range of states on this frame that are reachable from the
+    // following frame.  The backpointers should be monotonic in the state
+    // index, but we don't rely on that here.
+    const std::vector<StateInfo> &next_state_info = next_info->state_info_;
+    int32 min_living_state = next_state_info[0].backpointer,
+        max_living_state = min_living_state;
+    for (size_t i = 1; i < next_state_info.size(); i++) {
+      int32 backpointer = next_state_info[i].backpointer;
+      min_living_state = std::min(min_living_state, backpointer);
+      max_living_state = std::max(max_living_state, backpointer);
+    }
+    int32 offset = this_info->state_offset_,
+        num_states = this_info->state_info_.size();
+    KALDI_ASSERT(min_living_state >= offset &&
+                 max_living_state < offset + num_states);
+    if (min_living_state == offset &&
+        max_living_state == offset + num_states - 1)
+      break;  // Nothing to prune here, or on previous frames.
+    // Copy to a new vector rather than calling erase() and resize(), so that
+    // the memory is actually freed.
+    std::vector<StateInfo>(
+        this_info->state_info_.begin() + (min_living_state - offset),
+        this_info->state_info_.begin() + (max_living_state - offset + 1)).swap(
+            this_info->state_info_);
+    this_info->state_offset_ = min_living_state;
+    next_info = this_info;
+  }
 }
 
 
@@ -1195,6 +1261,13 @@ void OnlinePitchFeatureImpl::AcceptWaveform(
   frames_latency_ =
       frame_info_.back()->ComputeLatency(opts_.max_frames_latency);
   KALDI_VLOG(4) << "Latency is " << frames_latency_;
+  // Discard the Viterbi states that can no longer be on the best path.  We
+  // can't do this while RecomputeBacktraces() may still need to be called,
+  // which is the case while nccf_info_ is nonempty (unless
+  // opts_.nccf_ballast_online == true, in which case we never call it).
+  if ((opts_.nccf_ballast_online || nccf_info_.empty()) &&
+      !pitch_keep_all_states)
+    frame_info_.back()->PruneStates();
 }
 
 
@@ -0,0 +1,69 @@
+// feat/resample-speed-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/resample.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// Resamples 'num_seconds' of random signal from samp_rate_in to
+// samp_rate_out, in pieces of 'chunk_size' samples, and prints the speed as a
+// multiple of real time.
+static void TestLinearResampleSpeed(int32 samp_rate_in, int32 samp_rate_out,
+                                    int32 num_zeros, int32 chunk_size) {
+  BaseFloat num_seconds = 100.0,
+      filter_cutoff = 0.99 * 0.5 * std::min(samp_rate_in, samp_rate_out);
+  int32 num_samples = static_cast<int32>(num_seconds * samp_rate_in);
+  Vector<BaseFloat> signal(num_samples);
+  signal.SetRandn();
+
+  LinearResample resampler(samp_rate_in, samp_rate_out,
+                           filter_cutoff, num_zeros);
+  Timer timer;
+  int64 num_samples_out = 0;
+  Vector<BaseFloat> output;
+  for (int32 offset = 0; offset < num_samples; offset += chunk_size) {
+    int32 this_chunk_size = std::min(chunk_size, num_samples - offset);
+    bool flush = (offset + this_chunk_size == num_samples);
+    resampler.Resample(signal.Range(offset, this_chunk_size), flush, &output);
+    num_samples_out += output.Dim();
+  }
+  double elapsed = timer.Elapsed();
+  KALDI_ASSERT(std::abs(num_samples_out -
+                        num_seconds * samp_rate_out) <= 1.0);
+  KALDI_LOG << "Resampling " << samp_rate_in << " -> " << samp_rate_out
+            << " Hz with num-zeros=" << num_zeros << ", chunk-size="
+            << chunk_size << ": " << (num_seconds / elapsed)
+            << " times faster than real time.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  int32 chunk_sizes[] = { 160, 1600, 1000000 };
+  for (int32 i = 0; i < 3; i++) {
+    TestLinearResampleSpeed(16000, 8000, 6, chunk_sizes[i]);
+    TestLinearResampleSpeed(44100, 16000, 6, chunk_sizes[i]);
+    TestLinearResampleSpeed(8000, 16000, 6, chunk_sizes[i]);
+    TestLinearResampleSpeed(16000, 8000, 20, chunk_sizes[i]);
+  }
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -103,10 +103,11 @@ int64 LinearResample::GetNumOutputSamples(int64 input_num_samp,
 
 void LinearResample::SetIndexesAndWeights() {
   first_index_.resize(output_samples_in_unit_);
-  weights_.resize(output_samples_in_unit_);
+  std::vector<Vector<BaseFloat> > weights(output_samples_in_unit_);
 
   double window_width = num_zeros_ / (2.0 * filter_cutoff_);
 
+  num_taps_ = 0;
   for (int32 i = 0; i < output_samples_in_unit_; i++) {
     double output_t = i / static_cast<double>(samp_rate_out_);
     double min_t = output_t - window_width, max_t = output_t + window_width;
@@ -121,15 +122,38 @@ void LinearResample::SetIndexesAndWeights() {
         max_input_index = floor(max_t * samp_rate_in_),
         num_indices = max_input_index - min_input_index + 1;
     first_index_[i] = min_input_index;
-    weights_[i].Resize(num_indices);
+    weights[i].Resize(num_indices);
     for (int32 j = 0; j < num_indices; j++) {
       int32 input_index = min_input_index + j;
       double input_t = input_index / static_cast<double>(samp_rate_in_),
           delta_t = input_t - output_t;
       // sign of delta_t doesn't matter.
-      weights_[i](j) = FilterFunc(delta_t) / samp_rate_in_;
+      weights[i](j) = FilterFunc(delta_t) / samp_rate_in_;
     }
+    num_taps_ = std::max(num_taps_, num_indices);
   }
+  // Round num_taps_ up to a multiple of 4, for the benefit of the unrolled
+  // loop in DotProduct().
+  num_taps_ = 4 * ((num_taps_ + 3) / 4);
+  weights_.Resize(output_samples_in_unit_, num_taps_);  // zeroes it.
+  for (int32 i = 0; i < output_samples_in_unit_; i++)
+    weights_.Row(i).Range(0, weights[i].Dim()).CopyFromVec(weights[i]);
+}
+
+// Returns the dot product of a[0 ... dim-1] and b[0 ... dim-1]; 'dim' must be
+// a multiple of 4.  Using four separate accumulators breaks the dependency
+// between successive additions, so the compiler can keep them in one SIMD
+// register.
+static inline BaseFloat DotProduct(const BaseFloat *a, const BaseFloat *b,
+                                   int32 dim) {
+  BaseFloat sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  for (int32 i = 0; i < dim; i += 4) {
+    sum0 += a[i] * b[i];
+    sum1 += a[i + 1] * b[i + 1];
+    sum2 += a[i + 2] * b[i + 2];
+    sum3 += a[i + 3] * b[i + 3];
+  }
+  return (sum0 + sum1) + (sum2 + sum3);
 }
 
 
@@ -158,46 +182,62 @@ void LinearResample::Resample(const VectorBase<BaseFloat> &input,
 
   KALDI_ASSERT(tot_output_samp >= output_sample_offset_);
 
-  output->Resize(tot_output_samp - output_sample_offset_);
+  output->Resize(tot_output_samp - output_sample_offset_, kUndefined);
+
+  const BaseFloat *input_data = input.Data();
+  BaseFloat *output_data = output->Data();
+  const int32 num_taps = num_taps_;
+
+  // We call GetIndexes() only for the first output sample and then advance
+  // the phase (samp_out_wrapped) and the start of the current unit
+  // (unit_first_samp_in) incrementally, which avoids a division per sample.
+  int64 first_samp_in = 0;
+  int32 samp_out_wrapped = 0;
+  if (tot_output_samp > output_sample_offset_)
+    GetIndexes(output_sample_offset_, &first_samp_in, &samp_out_wrapped);
+  int64 unit_first_samp_in = first_samp_in - first_index_[samp_out_wrapped];
 
   // samp_out is the index into the total output signal, not just the part
   // of it we are producing here.
   for (int64 samp_out = output_sample_offset_;
        samp_out < tot_output_samp;
        samp_out++) {
-    int64 first_samp_in;
-    int32 samp_out_wrapped;
-    GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const Vector<BaseFloat> &weights = weights_[samp_out_wrapped];
+    first_samp_in = unit_first_samp_in + first_index_[samp_out_wrapped];
+    const BaseFloat *weights = weights_.RowData(samp_out_wrapped);
     // first_input_index is the first index into "input" that we have a weight
     // for.
     int32 first_input_index = static_cast<int32>(first_samp_in -
                                                  input_sample_offset_);
     BaseFloat this_output;
     if (first_input_index >= 0 &&
-        first_input_index + weights.Dim() <= input_dim) {
-      SubVector<BaseFloat> input_part(input, first_input_index, weights.Dim());
-      this_output = VecVec(input_part, weights);
+        first_input_index + num_taps <= input_dim) {
+      this_output = DotProduct(input_data + first_input_index, weights,
+                               num_taps);
     } else {  // Handle edge cases.
       this_output = 0.0;
-      for (int32 i = 0; i < weights.Dim(); i++) {
-        BaseFloat weight = weights(i);
+      for (int32 i = 0; i < num_taps; i++) {
+        BaseFloat weight = weights[i];
         int32 input_index = first_input_index + i;
         if (input_index < 0 && input_remainder_.Dim() + input_index >= 0) {
           this_output += weight *
               input_remainder_(input_remainder_.Dim() + input_index);
         } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input(input_index);
+          this_output += weight * input_data[input_index];
         } else if (input_index >= input_dim) {
           // We're past the end of the input and are adding zero; should only
           // happen if the user specified flush == true, or else we would not
-          // be trying to output this sample.
-          KALDI_ASSERT(flush);
+          // be trying to output this sample.  The zero-padded taps at the
+          // end of a row are the exception.
+          KALDI_ASSERT(flush || weight == 0.0);
         }
       }
     }
-    int32 output_index = static_cast<int32>(samp_out - output_sample_offset_);
-    (*output)(output_index) = this_output;
+    output_data[samp_out - output_sample_offset_] = this_output;
+
+    if (++samp_out_wrapped == output_samples_in_unit_) {
+      samp_out_wrapped = 0;
+      unit_first_samp_in += input_samples_in_unit_;
+    }
   }
 
   if (flush) {
@@ -286,15 +326,22 @@ void ArbitraryResample::Resample(const MatrixBase<BaseFloat> &input,
                input.NumCols() == num_samples_in_ &&
                output->NumCols() == weights_.size());
 
-  Vector<BaseFloat> output_col(output->NumRows());
-  for (int32 i = 0; i < NumSamplesOut(); i++) {
-    SubMatrix<BaseFloat> input_part(input, 0, input.NumRows(),
-                                    first_index_[i],
-                                    weights_[i].Dim());
-    const Vector<BaseFloat> &weight_vec(weights_[i]);
-    output_col.AddMatVec(1.0, input_part,
-                         kNoTrans, weight_vec, 0.0);
-    output->CopyColFromVec(output_col, i);
+  // We go row by row, since the rows are contiguous in memory; the number of
+  // rows is often small (e.g. in online pitch extraction), which would make
+  // a matrix-vector product per output sample inefficient.
+  int32 num_rows = input.NumRows(), num_samples_out = NumSamplesOut();
+  for (int32 r = 0; r < num_rows; r++) {
+    const BaseFloat *input_data = input.RowData(r);
+    BaseFloat *output_data = output->RowData(r);
+    for (int32 i = 0; i < num_samples_out; i++) {
+      const BaseFloat *this_input = input_data + first_index_[i],
+          *weights = weights_[i].Data();
+      int32 num_weights = weights_[i].Dim();
+      BaseFloat sum = 0.0;
+      for (int32 j = 0; j < num_weights; j++)
+        sum += this_input[j] * weights[j];
+      output_data[i] = sum;
+    }
   }
 }
 
@@ -233,8 +233,17 @@ class LinearResample {
   /// extrapolate the correct input-sample index for arbitrary output samples.
   std::vector<int32> first_index_;
 
-  /// Weights on the input samples, for this output-sample index.
-  std::vector<Vector<BaseFloat> > weights_;
+  /// Weights on the input samples: row i contains the weights for
+  /// output-sample index i (i.e. the i'th phase of the polyphase filter).  All
+  /// rows have num_taps_ columns; rows that need fewer weights are padded with
+  /// zeros at the end.  Storing the weights contiguously with a fixed number
+  /// of taps keeps the inner loop of Resample() simple enough for the compiler
+  /// to vectorize.
+  Matrix<BaseFloat> weights_;
+
+  /// The number of columns of weights_: the largest number of input samples
+  /// that any output sample depends on, rounded up to a multiple of 4.
+  int32 num_taps_;
 
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
@@ -23,6 +23,7 @@
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/kaldi-vector.h"
+#include "util/matrix-view-reader.h"
 
 
 int main(int argc, char *argv[]) {
@@ -60,7 +61,9 @@ int main(int argc, char *argv[]) {
     double overall_similarity = 0;
 
     SequentialBaseFloatMatrixReader feat_reader1(rspecifier1);
-    RandomAccessBaseFloatMatrixReader feat_reader2(rspecifier2);
+    // For scp files pointing into uncompressed archives, this gives views of
+    // the memory-mapped archives, so we don't copy the second features.
+    RandomAccessMatrixViewReader feat_reader2(rspecifier2);
 
     for (; !feat_reader1.Done(); feat_reader1.Next()) {
       std::string utt = feat_reader1.Key();
@@ -73,7 +76,7 @@ int main(int argc, char *argv[]) {
         num_err++;
         continue;
       }
-      Matrix<BaseFloat> feat2 (feat_reader2.Value(utt));
+      const MatrixBase<BaseFloat> &feat2 = feat_reader2.Value(utt);
       if (feat1.NumCols() != feat2.NumCols()) {
         KALDI_WARN << "Feature dimensions differ for utterance "
                    << utt << ", " << feat1.NumCols() << " vs. "
@@ -77,7 +77,11 @@ int main(int argc, char *argv[]) {
     int32 logdet_type = Unknown;
     double tot_t = 0.0, tot_logdet = 0.0;  // to compute average logdet weighted by time...
     int32 num_done = 0, num_error = 0;
+    // cached_logdet is the logdet of cached_logdet_transform; this saves
+    // recomputing it for a global transform, or for consecutive utterances of
+    // the same speaker.
     BaseFloat cached_logdet = -1;
+    Matrix<BaseFloat> cached_logdet_transform;
     
     for (;!feat_reader.Done(); feat_reader.Next()) {
       std::string utt = feat_reader.Key();
@@ -95,17 +99,21 @@ int main(int argc, char *argv[]) {
           transform_cols = trans.NumCols(),
           feat_dim = feat.NumCols();
 
-      Matrix<BaseFloat> feat_out(feat.NumRows(), transform_rows);
+      Matrix<BaseFloat> feat_out;
 
       if (transform_cols == feat_dim) {
+        feat_out.Resize(feat.NumRows(), transform_rows);
         feat_out.AddMatMat(1.0, feat, kNoTrans, trans, kTrans, 0.0);
       } else if (transform_cols == feat_dim + 1) {
-        // append the implicit 1.0 to the input features.
+        // append the implicit 1.0 to the input features: we initialize each
+        // row of the output to the offset, and add the linear part on top of
+        // it, which saves a pass over the output.
+        feat_out.Resize(feat.NumRows(), transform_rows, kUndefined);
         SubMatrix<BaseFloat> linear_part(trans, 0, transform_rows, 0, feat_dim);
-        feat_out.AddMatMat(1.0, feat, kNoTrans, linear_part, kTrans, 0.0);
         Vector<BaseFloat> offset(transform_rows);
         offset.CopyColFromMat(trans, feat_dim);
-        feat_out.AddVecToRows(1.0, offset);
+        feat_out.CopyRowsFromVec(offset);
+        feat_out.AddMatMat(1.0, feat, kNoTrans, linear_part, kTrans, 1.0);
       } else {
         KALDI_WARN << "Transform matrix for utterance " << utt << " has bad dimension "
                    << transform_rows << "x" << transform_cols << " versus feat dim "
@@ -131,20 +139,23 @@ int main(int argc, char *argv[]) {
       }
 
       if (logdet_type != DimIncrease) { // Accumulate log-determinant stats.
-        SubMatrix<BaseFloat> linear_transform(trans, 0, trans.NumRows(), 0, feat_dim);
-        // "linear_transform" is just the linear part of any transform, ignoring
-        // any affine (offset) component.
-        SpMatrix<BaseFloat> TT(trans.NumRows());
-        // TT = linear_transform * linear_transform^T
-        TT.AddMat2(1.0, linear_transform, kNoTrans, 0.0);
-        BaseFloat logdet;
-        if (use_global_transform) {
-          if (cached_logdet == -1)
-            cached_logdet = 0.5 * TT.LogDet(NULL);
-          logdet = cached_logdet;
-        } else {
-          logdet = 0.5 * TT.LogDet(NULL);
+        if (cached_logdet == -1 ||
+            !(use_global_transform ||
+              (cached_logdet_transform.NumRows() == trans.NumRows() &&
+               cached_logdet_transform.NumCols() == trans.NumCols() &&
+               cached_logdet_transform.Equal(trans)))) {
+          SubMatrix<BaseFloat> linear_transform(trans, 0, trans.NumRows(),
+                                                0, feat_dim);
+          // "linear_transform" is just the linear part of any transform,
+          // ignoring any affine (offset) component.
+          SpMatrix<BaseFloat> TT(trans.NumRows());
+          // TT = linear_transform * linear_transform^T
+          TT.AddMat2(1.0, linear_transform, kNoTrans, 0.0);
+          cached_logdet = 0.5 * TT.LogDet(NULL);
+          if (!use_global_transform)
+            cached_logdet_transform = trans;
         }
+        BaseFloat logdet = cached_logdet;
         if (logdet != logdet || logdet-logdet != 0.0) // NaN or info.
           KALDI_WARN << "Matrix has bad logdet " << logdet;
         else {
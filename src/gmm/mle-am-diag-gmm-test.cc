@@ -91,6 +91,39 @@ void TestAmDiagGmmAccsIO(const AmDiagGmm &am_gmm,
   unlink("tmpfb");
 }
 
+// Tests that AccumulateForGmms() gives the same stats as calling
+// AccumulateForGmm() for each frame, including when the frames are split
+// between two accumulators which are then summed.
+void TestAmDiagGmmAccsBlock(const AmDiagGmm &am_gmm,
+                            const Matrix<BaseFloat> &feats) {
+  int32 num_frames = feats.NumRows();
+  std::vector<int32> pdfs(num_frames);
+  AccumAmDiagGmm accs, block_accs, block_accs2;
+  accs.Init(am_gmm, kaldi::kGmmAll);
+  block_accs.Init(am_gmm, kaldi::kGmmAll);
+  block_accs2.Init(am_gmm, kaldi::kGmmAll);
+  BaseFloat loglike = 0.0;
+  for (int32 i = 0; i < num_frames; i++) {
+    pdfs[i] = RandInt(0, am_gmm.NumPdfs() - 1);
+    loglike += accs.AccumulateForGmm(am_gmm, feats.Row(i), pdfs[i], 1.0);
+  }
+  int32 split = RandInt(0, num_frames);
+  std::vector<int32> pdfs1(pdfs.begin(), pdfs.begin() + split),
+      pdfs2(pdfs.begin() + split, pdfs.end());
+  BaseFloat block_loglike =
+      block_accs.AccumulateForGmms(am_gmm, feats.RowRange(0, split), pdfs1) +
+      block_accs2.AccumulateForGmms(am_gmm,
+                                    feats.RowRange(split, num_frames - split),
+                                    pdfs2);
+  block_accs.Add(1.0, block_accs2);
+
+  AssertEqual(loglike, block_loglike, 1e-4);
+  AssertEqual(accs.TotLogLike(), block_accs.TotLogLike(), 1e-4);
+  AssertEqual(accs.TotCount(), block_accs.TotCount(), 1e-5);
+  for (int32 pdf = 0; pdf < am_gmm.NumPdfs(); pdf++)
+    accs.GetAcc(pdf).AssertEqual(block_accs.GetAcc(pdf));
+}
+
 void UnitTestMleAmDiagGmm() {
   int32 dim = 1 + kaldi::RandInt(0, 9),  // random dimension of the gmm
       num_pdfs = 5 + kaldi::RandInt(0, 9);  // random number of states
@@ -126,6 +159,7 @@ void UnitTestMleAmDiagGmm() {
     }
   }
   TestAmDiagGmmAccsIO(am_gmm, feats);
+  TestAmDiagGmmAccsBlock(am_gmm, feats);
 }
 
 
@@ -78,6 +78,43 @@ BaseFloat AccumAmDiagGmm::AccumulateForGmm(
   return log_like;
 }
 
+BaseFloat AccumAmDiagGmm::AccumulateForGmms(
+    const AmDiagGmm &model, const MatrixBase<BaseFloat> &data,
+    const std::vector<int32> &gmm_index) {
+  int32 num_frames = data.NumRows();
+  KALDI_ASSERT(static_cast<int32>(gmm_index.size()) == num_frames);
+  // Sort the frames by GMM index, so that the frames for each GMM are
+  // contiguous; the sort is stable in the frame index.
+  std::vector<std::pair<int32, int32> > pairs(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    KALDI_ASSERT(static_cast<size_t>(gmm_index[t]) <
+                 gmm_accumulators_.size());
+    pairs[t] = std::pair<int32, int32>(gmm_index[t], t);
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  double tot_like = 0.0;
+  std::vector<MatrixIndexT> frames;
+  for (int32 start = 0; start < num_frames; ) {
+    int32 pdf = pairs[start].first, end = start + 1;
+    while (end < num_frames && pairs[end].first == pdf)
+      end++;
+    frames.clear();
+    for (int32 i = start; i < end; i++)
+      frames.push_back(pairs[i].second);
+    Matrix<BaseFloat> pdf_data(end - start, data.NumCols(), kUndefined);
+    pdf_data.CopyRows(data, &(frames[0]));
+    Vector<BaseFloat> weights(end - start);
+    weights.Set(1.0);
+    tot_like += gmm_accumulators_[pdf]->AccumulateFromDiag(
+        model.GetPdf(pdf), pdf_data, weights);
+    start = end;
+  }
+  total_log_like_ += tot_like;
+  total_frames_ += num_frames;
+  return tot_like;
+}
+
 BaseFloat AccumAmDiagGmm::AccumulateForGmmTwofeats(
     const AmDiagGmm &model,
     const VectorBase<BaseFloat> &data1,
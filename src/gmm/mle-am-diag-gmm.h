@@ -52,6 +52,16 @@ class AccumAmDiagGmm {
                              const VectorBase<BaseFloat> &data,
                              int32 gmm_index, BaseFloat weight);
 
+  /// Accumulate stats for a sequence of frames, e.g. an utterance, where
+  /// frame t (row t of "data") is aligned to the GMM with index gmm_index[t],
+  /// with weight 1.0.  Gives the same result as calling AccumulateForGmm()
+  /// for each frame, but it groups the frames by GMM and processes each group
+  /// with matrix operations, which is faster.  Returns the total
+  /// log-likelihood.
+  BaseFloat AccumulateForGmms(const AmDiagGmm &model,
+                              const MatrixBase<BaseFloat> &data,
+                              const std::vector<int32> &gmm_index);
+
   /// Accumulate stats for a single GMM in the model; uses data1 for
   /// getting posteriors and data2 for stats. Returns log likelihood.
   BaseFloat AccumulateForGmmTwofeats(const AmDiagGmm &model,
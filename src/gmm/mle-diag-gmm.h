@@ -136,12 +136,28 @@ class AccumDiagGmm {
   void AccumulateFromPosteriors(const VectorBase<BaseFloat> &data,
                                 const VectorBase<BaseFloat> &gauss_posteriors);
 
+  /// Accumulate for all components, given the posteriors, for a block of
+  /// frames (one per row of "data" and of "gauss_posteriors").  Equivalent to
+  /// calling the one-frame version for each row, but faster as it uses
+  /// matrix-matrix products.
+  void AccumulateFromPosteriors(const MatrixBase<BaseFloat> &data,
+                                const MatrixBase<BaseFloat> &gauss_posteriors);
+
   /// Accumulate for all components given a diagonal-covariance GMM.
   /// Computes posteriors and returns log-likelihood
   BaseFloat AccumulateFromDiag(const DiagGmm &gmm,
                                const VectorBase<BaseFloat> &data,
                                BaseFloat frame_posterior);
 
+  /// This does the same job as the one-frame version of AccumulateFromDiag
+  /// for each row of "data", with the weights "frame_weights", but it computes
+  /// the posteriors and the stats for all the frames at once using matrix
+  /// operations.  Returns sum of (log-likelihood times frame weight) over all
+  /// frames.
+  BaseFloat AccumulateFromDiag(const DiagGmm &gmm,
+                               const MatrixBase<BaseFloat> &data,
+                               const VectorBase<BaseFloat> &frame_weights);
+
   /// This does the same job as AccumulateFromDiag, but using
   /// multiple threads.  Returns sum of (log-likelihood times
   /// frame weight) over all frames.
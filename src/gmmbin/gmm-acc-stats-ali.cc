@@ -23,23 +23,161 @@
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "util/kaldi-thread.h"
 
+namespace kaldi {
+
+// A set of accumulators, one per thread that may be running at once; each
+// running task takes one from the free list while it accumulates, so no
+// locking is needed while accumulating.  At the end they are summed in a tree.
+class AccumulatorPool {
+ public:
+  AccumulatorPool(const AmDiagGmm &am_gmm, const TransitionModel &trans_model,
+                  int32 num_accs): gmm_accs_(num_accs),
+                                   transition_accs_(num_accs) {
+    KALDI_ASSERT(num_accs > 0);
+    for (int32 i = 0; i < num_accs; i++) {
+      gmm_accs_[i] = new AccumAmDiagGmm();
+      gmm_accs_[i]->Init(am_gmm, kGmmAll);
+      trans_model.InitStats(&(transition_accs_[i]));
+      free_list_.push_back(i);
+    }
+  }
+  // Returns the index of a free accumulator; the caller must call Release()
+  // when done with it.
+  int32 Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // TaskSequencer never runs more tasks at once than there are accumulators.
+    KALDI_ASSERT(!free_list_.empty());
+    int32 ans = free_list_.back();
+    free_list_.pop_back();
+    return ans;
+  }
+  void Release(int32 i) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_list_.push_back(i);
+  }
+  AccumAmDiagGmm *GmmAccs(int32 i) { return gmm_accs_[i]; }
+  Vector<double> *TransitionAccs(int32 i) { return &(transition_accs_[i]); }
+
+  // Sums all the accumulators into accumulator 0, pairwise in a tree, with
+  // the sums at each level of the tree done in parallel.
+  void Reduce(int32 num_threads);
+
+  ~AccumulatorPool() { DeletePointers(&gmm_accs_); }
+ private:
+  class ReduceClass: public MultiThreadable {
+   public:
+    ReduceClass(AccumulatorPool *pool, int32 stride):
+        pool_(pool), stride_(stride) { }
+    void operator () () {
+      int32 num_accs = pool_->gmm_accs_.size(), pair_index = 0;
+      for (int32 i = 0; i + stride_ < num_accs; i += 2 * stride_, pair_index++) {
+        if (pair_index % num_threads_ != thread_id_)
+          continue;
+        pool_->gmm_accs_[i]->Add(1.0, *(pool_->gmm_accs_[i + stride_]));
+        pool_->transition_accs_[i].AddVec(1.0,
+                                          pool_->transition_accs_[i + stride_]);
+      }
+    }
+   private:
+    AccumulatorPool *pool_;
+    int32 stride_;
+  };
+
+  std::vector<AccumAmDiagGmm*> gmm_accs_;
+  std::vector<Vector<double> > transition_accs_;
+  std::vector<int32> free_list_;
+  std::mutex mutex_;
+};
+
+void AccumulatorPool::Reduce(int32 num_threads) {
+  int32 num_accs = gmm_accs_.size();
+  for (int32 stride = 1; stride < num_accs; stride *= 2) {
+    int32 num_pairs = (num_accs + 2 * stride - 1) / (2 * stride);
+    ReduceClass c(this, stride);
+    // MultiThreader waits for all the threads in its destructor.
+    MultiThreader<ReduceClass> m(std::max(1, std::min(num_threads, num_pairs)),
+                                 c);
+  }
+}
 
 
+// Accumulates the stats for one utterance in operator (), which is run in
+// its own thread; the destructor (called in order) does the logging.
+class AccStatsAliClass {
+ public:
+  AccStatsAliClass(const AmDiagGmm &am_gmm,
+                   const TransitionModel &trans_model,
+                   const std::string &utt,
+                   const Matrix<BaseFloat> &features,
+                   const std::vector<int32> &alignment,
+                   AccumulatorPool *pool,
+                   int32 num_done,
+                   double *tot_like,
+                   int64 *tot_t):
+      am_gmm_(am_gmm), trans_model_(trans_model), utt_(utt),
+      features_(features), alignment_(alignment), pool_(pool),
+      num_done_(num_done), tot_like_this_file_(0.0), tot_like_(tot_like),
+      tot_t_(tot_t) { }
+
+  void operator () () {
+    int32 i = pool_->Acquire();
+    Vector<double> *transition_accs = pool_->TransitionAccs(i);
+    std::vector<int32> pdfs(alignment_.size());
+    for (size_t t = 0; t < alignment_.size(); t++) {
+      int32 tid = alignment_[t];  // transition identifier.
+      pdfs[t] = trans_model_.TransitionIdToPdf(tid);
+      trans_model_.Accumulate(1.0, tid, transition_accs);
+    }
+    tot_like_this_file_ = pool_->GmmAccs(i)->AccumulateForGmms(
+        am_gmm_, features_, pdfs);
+    pool_->Release(i);
+  }
+
+  ~AccStatsAliClass() {
+    *tot_like_ += tot_like_this_file_;
+    *tot_t_ += alignment_.size();
+    if (num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << num_done_ << " utterances; for utterance "
+                << utt_ << " avg. like is "
+                << (tot_like_this_file_/alignment_.size())
+                << " over " << alignment_.size() <<" frames.";
+    }
+  }
+ private:
+  const AmDiagGmm &am_gmm_;
+  const TransitionModel &trans_model_;
+  std::string utt_;
+  Matrix<BaseFloat> features_;
+  std::vector<int32> alignment_;
+  AccumulatorPool *pool_;
+  int32 num_done_;
+  double tot_like_this_file_;
+  double *tot_like_;
+  int64 *tot_t_;
+};
+
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   typedef kaldi::int32 int32;
   try {
     const char *usage =
-        "Accumulate stats for GMM training.\n"
+        "Accumulate stats for GMM training.  With --num-threads > 1, the\n"
+        "utterances are processed in parallel, each thread with its own\n"
+        "accumulators, which are summed at the end.\n"
         "Usage:  gmm-acc-stats-ali [options] <model-in> <feature-rspecifier> "
         "<alignments-rspecifier> <stats-out>\n"
         "e.g.:\n gmm-acc-stats-ali 1.mdl scp:train.scp ark:1.ali 1.acc\n";
 
     ParseOptions po(usage);
     bool binary = true;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -61,10 +199,9 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    Vector<double> transition_accs;
-    trans_model.InitStats(&transition_accs);
-    AccumAmDiagGmm gmm_accs;
-    gmm_accs.Init(am_gmm, kGmmAll);
+    // One set of accumulators per task that may be running at once.
+    int32 num_accs = std::max<int32>(1, sequencer_config.num_threads);
+    AccumulatorPool pool(am_gmm, trans_model, num_accs);
 
     double tot_like = 0.0;
     kaldi::int64 tot_t = 0;
@@ -73,42 +210,35 @@ int main(int argc, char *argv[]) {
     RandomAccessInt32VectorReader alignments_reader(alignments_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignments_reader.HasKey(key)) {
-        KALDI_WARN << "No alignment for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const std::vector<int32> &alignment = alignments_reader.Value(key);
-
-        if (alignment.size() != mat.NumRows()) {
-          KALDI_WARN << "Alignments has wrong size " << (alignment.size())
-                     << " vs. " << (mat.NumRows());
+    {
+      TaskSequencer<AccStatsAliClass> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignments_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
           num_err++;
-          continue;
-        }
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const std::vector<int32> &alignment = alignments_reader.Value(key);
 
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0;
+          if (alignment.size() != mat.NumRows()) {
+            KALDI_WARN << "Alignments has wrong size " << (alignment.size())
+                       << " vs. " << (mat.NumRows());
+            num_err++;
+            continue;
+          }
 
-        for (size_t i = 0; i < alignment.size(); i++) {
-          int32 tid = alignment[i],  // transition identifier.
-              pdf_id = trans_model.TransitionIdToPdf(tid);
-          trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
-        }
-        tot_like += tot_like_this_file;
-        tot_t += alignment.size();
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is "
-                    << (tot_like_this_file/alignment.size())
-                    << " over " << alignment.size() <<" frames.";
+          num_done++;
+          sequencer.Run(new AccStatsAliClass(am_gmm, trans_model, key, mat,
+                                             alignment, &pool, num_done,
+                                             &tot_like, &tot_t));
         }
       }
-    }
+    }  // the destructor of "sequencer" waits for the remaining tasks.
+    pool.Reduce(sequencer_config.num_threads);
+    const Vector<double> &transition_accs = *(pool.TransitionAccs(0));
+    const AccumAmDiagGmm &gmm_accs = *(pool.GmmAccs(0));
+
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
 
@@ -30,8 +30,50 @@ using std::vector;
 #include "hmm/transition-model.h"
 #include "transform/fmllr-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
+
+// Holds the fMLLR stats for one speaker (or utterance); Finish() estimates
+// the transform, writes it and does the logging.
+class FmllrSpeakerStats {
+ public:
+  FmllrSpeakerStats(const AmDiagGmm &am_gmm,
+                    const FmllrOptions &fmllr_opts,
+                    const std::string &key,
+                    const std::string &key_type,  // "speaker" or "utterance"
+                    BaseFloatMatrixWriter *transform_writer,
+                    double *tot_impr,
+                    double *tot_t):
+      am_gmm_(am_gmm), fmllr_opts_(fmllr_opts), key_(key), key_type_(key_type),
+      transform_writer_(transform_writer), tot_impr_(tot_impr), tot_t_(tot_t),
+      stats_(am_gmm.Dim(), fmllr_opts) { }
+
+  FmllrDiagGmmAccs *Stats() { return &stats_; }
+
+  void Finish() {
+    Matrix<BaseFloat> transform(am_gmm_.Dim(), am_gmm_.Dim() + 1);
+    transform.SetUnit();
+    BaseFloat impr, count;
+    stats_.Update(fmllr_opts_, &transform, &impr, &count);
+    transform_writer_->Write(key_, transform);
+    KALDI_LOG << "For " << key_type_ << ' ' << key_
+              << ", auxf-impr from fMLLR is " << (impr / count) << ", over "
+              << count << " frames.";
+    *tot_impr_ += impr;
+    *tot_t_ += count;
+  }
+ private:
+  const AmDiagGmm &am_gmm_;
+  const FmllrOptions &fmllr_opts_;
+  std::string key_;
+  std::string key_type_;
+  BaseFloatMatrixWriter *transform_writer_;
+  double *tot_impr_;
+  double *tot_t_;
+  FmllrDiagGmmAccs stats_;
+};
+
 void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
                             const Posterior &post,
                             const TransitionModel &trans_model,
@@ -39,18 +81,59 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
                             FmllrDiagGmmAccs *spk_stats) {
   Posterior pdf_post;
   ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-  for (size_t i = 0; i < post.size(); i++) {
-    for (size_t j = 0; j < pdf_post[i].size(); j++) {
-      int32 pdf_id = pdf_post[i][j].first;
-      spk_stats->AccumulateForGmm(am_gmm.GetPdf(pdf_id),
-                                  feats.Row(i),
-                                  pdf_post[i][j].second);
-    }
-  }
+  spk_stats->AccumulateForGmms(am_gmm, feats, pdf_post);
 }
 
+// Used with --num-threads > 1.  A task constructed with an utterance
+// accumulates the stats for it into its own FmllrDiagGmmAccs in operator (),
+// which is run in its own thread, and the destructor adds them to the
+// speaker's stats.  A task constructed without one does nothing in
+// operator (), and its destructor estimates and writes the speaker's
+// transform and deletes "spk_stats"; since the destructors are called in
+// order, all of the speaker's stats have been added by then.
+class EstimateFmllrClass {
+ public:
+  EstimateFmllrClass(const TransitionModel &trans_model,
+                     const AmDiagGmm &am_gmm,
+                     const Matrix<BaseFloat> &feats,
+                     const Posterior &post,
+                     FmllrSpeakerStats *spk_stats):
+      trans_model_(trans_model), am_gmm_(am_gmm), feats_(feats), post_(post),
+      spk_stats_(spk_stats), finish_(false) { }
 
-}
+  EstimateFmllrClass(const TransitionModel &trans_model,
+                     const AmDiagGmm &am_gmm,
+                     FmllrSpeakerStats *spk_stats):
+      trans_model_(trans_model), am_gmm_(am_gmm), spk_stats_(spk_stats),
+      finish_(true) { }
+
+  void operator () () {
+    if (finish_) return;
+    stats_.Init(am_gmm_.Dim());
+    AccumulateForUtterance(feats_, post_, trans_model_, am_gmm_, &stats_);
+    feats_.Resize(0, 0);
+    post_.clear();
+  }
+
+  ~EstimateFmllrClass() {
+    if (finish_) {
+      spk_stats_->Finish();
+      delete spk_stats_;
+    } else {
+      spk_stats_->Stats()->Add(stats_);
+    }
+  }
+ private:
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  Matrix<BaseFloat> feats_;
+  Posterior post_;
+  FmllrSpeakerStats *spk_stats_;
+  bool finish_;
+  FmllrDiagGmmAccs stats_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -59,16 +142,19 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Estimate global fMLLR transforms, either per utterance or for the supplied\n"
         "set of speakers (spk2utt option).  Reads posteriors (on transition-ids).  Writes\n"
-        "to a table of matrices.\n"
+        "to a table of matrices.  With --num-threads > 1, the stats for several\n"
+        "utterances are accumulated in parallel.\n"
         "Usage: gmm-est-fmllr [options] <model-in> "
         "<feature-rspecifier> <post-rspecifier> <transform-wspecifier>\n";
 
     ParseOptions po(usage);
     FmllrOptions fmllr_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     string spk2utt_rspecifier;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to "
                 "utterance-list map");
     fmllr_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -99,91 +185,99 @@ int main(int argc, char *argv[]) {
     BaseFloatMatrixWriter transform_writer(trans_wspecifier);
 
     int32 num_done = 0, num_no_post = 0, num_other_error = 0;
-    if (spk2utt_rspecifier != "") {  // per-speaker adaptation
-      SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
-      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
-
-      for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
-        string spk = spk2utt_reader.Key();
-        const vector<string> &uttlist = spk2utt_reader.Value();
-        for (size_t i = 0; i < uttlist.size(); i++) {
-          std::string utt = uttlist[i];
-          if (!feature_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find features for utterance " << utt;
-            num_other_error++;
-            continue;
+    {
+      // With one thread we accumulate in this thread, to avoid copying the
+      // features; otherwise each utterance's stats are accumulated by a
+      // separate task (see EstimateFmllrClass).
+      bool threaded = (sequencer_config.num_threads > 1);
+      TaskSequencer<EstimateFmllrClass> sequencer(sequencer_config);
+      if (spk2utt_rspecifier != "") {  // per-speaker adaptation
+        SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+        RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+
+        for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+          string spk = spk2utt_reader.Key();
+          FmllrSpeakerStats *spk_stats = new FmllrSpeakerStats(
+              am_gmm, fmllr_opts, spk, "speaker", &transform_writer,
+              &tot_impr, &tot_t);
+          const vector<string> &uttlist = spk2utt_reader.Value();
+          for (size_t i = 0; i < uttlist.size(); i++) {
+            std::string utt = uttlist[i];
+            if (!feature_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find features for utterance " << utt;
+              num_other_error++;
+              continue;
+            }
+            if (!post_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find posteriors for utterance " << utt;
+              num_no_post++;
+              continue;
+            }
+            const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+            const Posterior &post = post_reader.Value(utt);
+            if (static_cast<int32>(post.size()) != feats.NumRows()) {
+              KALDI_WARN << "Posterior vector has wrong size " << (post.size())
+                         << " vs. " << (feats.NumRows());
+              num_other_error++;
+              continue;
+            }
+
+            if (threaded)
+              sequencer.Run(new EstimateFmllrClass(trans_model, am_gmm, feats,
+                                                   post, spk_stats));
+            else
+              AccumulateForUtterance(feats, post, trans_model, am_gmm,
+                                     spk_stats->Stats());
+
+            num_done++;
+          }  // end looping over all utterances of the current speaker
+          if (threaded) {
+            // takes ownership of "spk_stats".
+            sequencer.Run(new EstimateFmllrClass(trans_model, am_gmm,
+                                                 spk_stats));
+          } else {
+            spk_stats->Finish();
+            delete spk_stats;
           }
+        }  // end looping over speakers
+      } else {  // per-utterance adaptation
+        SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+        for (; !feature_reader.Done(); feature_reader.Next()) {
+          string utt = feature_reader.Key();
           if (!post_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find posteriors for utterance " << utt;
+            KALDI_WARN << "Did not find posts for utterance "
+                       << utt;
             num_no_post++;
             continue;
           }
-          const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+          const Matrix<BaseFloat> &feats = feature_reader.Value();
           const Posterior &post = post_reader.Value(utt);
+
           if (static_cast<int32>(post.size()) != feats.NumRows()) {
-            KALDI_WARN << "Posterior vector has wrong size " << (post.size())
-                       << " vs. " << (feats.NumRows());
+            KALDI_WARN << "Posterior has wrong size " << (post.size())
+                << " vs. " << (feats.NumRows());
             num_other_error++;
             continue;
           }
-
-          AccumulateForUtterance(feats, post, trans_model, am_gmm, &spk_stats);
-
           num_done++;
-        }  // end looping over all utterances of the current speaker
-
-        BaseFloat impr, spk_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &spk_tot_t);
-          transform_writer.Write(spk, transform);
-        }
-        KALDI_LOG << "For speaker " << spk << ", auxf-impr from fMLLR is "
-                  << (impr/spk_tot_t) << ", over " << spk_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += spk_tot_t;
-      }  // end looping over speakers
-    } else {  // per-utterance adaptation
-      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-      for (; !feature_reader.Done(); feature_reader.Next()) {
-        string utt = feature_reader.Key();
-        if (!post_reader.HasKey(utt)) {
-          KALDI_WARN << "Did not find posts for utterance "
-                     << utt;
-          num_no_post++;
-          continue;
-        }
-        const Matrix<BaseFloat> &feats = feature_reader.Value();
-        const Posterior &post = post_reader.Value(utt);
-
-        if (static_cast<int32>(post.size()) != feats.NumRows()) {
-          KALDI_WARN << "Posterior has wrong size " << (post.size())
-              << " vs. " << (feats.NumRows());
-          num_other_error++;
-          continue;
-        }
-        num_done++;
-
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
 
-        AccumulateForUtterance(feats, post, trans_model, am_gmm,
-                               &spk_stats);
-
-        BaseFloat impr, utt_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &utt_tot_t);
-          transform_writer.Write(utt, transform);
+          FmllrSpeakerStats *spk_stats = new FmllrSpeakerStats(
+              am_gmm, fmllr_opts, utt, "utterance", &transform_writer,
+              &tot_impr, &tot_t);
+          if (threaded) {
+            sequencer.Run(new EstimateFmllrClass(trans_model, am_gmm, feats,
+                                                 post, spk_stats));
+            sequencer.Run(new EstimateFmllrClass(trans_model, am_gmm,
+                                                 spk_stats));
+          } else {
+            AccumulateForUtterance(feats, post, trans_model, am_gmm,
+                                   spk_stats->Stats());
+            spk_stats->Finish();
+            delete spk_stats;
+          }
         }
-        KALDI_LOG << "For utterance " << utt << ", auxf-impr from fMLLR is "
-                  << (impr/utt_tot_t) << ", over " << utt_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += utt_tot_t;
       }
-    }
+    }  // the destructor of "sequencer" waits for the remaining tasks.
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_post
               << " with no posts, " << num_other_error << " with other errors.";
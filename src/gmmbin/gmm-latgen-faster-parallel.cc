@@ -67,6 +67,7 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    g_lattice_write_options.Register(&po);
 
     po.Read(argc, argv);
 
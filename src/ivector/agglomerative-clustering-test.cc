@@ -0,0 +1,118 @@
+// ivector/agglomerative-clustering-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ivector/agglomerative-clustering.h"
+
+
+namespace kaldi {
+
+// A simple and slow version of average-linkage clustering, which at each step
+// searches over all pairs of clusters.  The output labels are numbered in the
+// order the clusters were created, as for AgglomerativeCluster().
+void NaiveAgglomerativeCluster(const Matrix<BaseFloat> &costs,
+                               BaseFloat thresh, int32 min_clust,
+                               std::vector<int32> *assignments) {
+  int32 n = costs.NumRows();
+  std::vector<std::vector<int32> > clusters(n);
+  std::vector<int32> ids(n);
+  for (int32 i = 0; i < n; i++) {
+    clusters[i].push_back(i);
+    ids[i] = i;
+  }
+  int32 count = n;
+  while (static_cast<int32>(clusters.size()) > min_clust) {
+    double best_cost = std::numeric_limits<double>::infinity();
+    int32 best_a = -1, best_b = -1;
+    for (size_t a = 0; a < clusters.size(); a++) {
+      for (size_t b = a + 1; b < clusters.size(); b++) {
+        double sum = 0.0;
+        for (size_t p = 0; p < clusters[a].size(); p++)
+          for (size_t q = 0; q < clusters[b].size(); q++)
+            sum += costs(clusters[a][p], clusters[b][q]);
+        double cost = sum / (clusters[a].size() * clusters[b].size());
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_a = a;
+          best_b = b;
+        }
+      }
+    }
+    if (best_a < 0 || best_cost > thresh)
+      break;
+    clusters[best_a].insert(clusters[best_a].end(), clusters[best_b].begin(),
+                            clusters[best_b].end());
+    ids[best_a] = count++;
+    clusters.erase(clusters.begin() + best_b);
+    ids.erase(ids.begin() + best_b);
+  }
+  std::vector<std::pair<int32, int32> > sorted_ids;
+  for (size_t a = 0; a < clusters.size(); a++)
+    sorted_ids.push_back(std::make_pair(ids[a], a));
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  assignments->resize(n);
+  for (size_t k = 0; k < sorted_ids.size(); k++) {
+    const std::vector<int32> &cluster = clusters[sorted_ids[k].second];
+    for (size_t p = 0; p < cluster.size(); p++)
+      (*assignments)[cluster[p]] = k + 1;
+  }
+}
+
+void UnitTestAgglomerativeCluster() {
+  for (int32 iter = 0; iter < 20; iter++) {
+    int32 num_points = 1 + Rand() % 40,
+        num_threads = 1 + Rand() % 3,
+        min_clust = Rand() % 4;
+    // Make the points come from a few groups, so the clusters are not
+    // arbitrary.
+    int32 num_groups = 1 + Rand() % 5;
+    std::vector<int32> groups(num_points);
+    for (int32 i = 0; i < num_points; i++)
+      groups[i] = Rand() % num_groups;
+    Matrix<BaseFloat> costs(num_points, num_points);
+    for (int32 i = 0; i < num_points; i++) {
+      for (int32 j = i + 1; j < num_points; j++) {
+        BaseFloat cost = RandUniform() + (groups[i] == groups[j] ? 0.0 : 1.0);
+        costs(i, j) = cost;
+        costs(j, i) = cost;
+      }
+    }
+    BaseFloat thresh = 2.0 * RandUniform();
+    std::vector<int32> assignments, ref_assignments;
+    AgglomerativeCluster(costs, thresh, min_clust, &assignments, num_threads);
+    NaiveAgglomerativeCluster(costs, thresh, min_clust, &ref_assignments);
+    KALDI_ASSERT(assignments == ref_assignments);
+    // With a low threshold for using multiple threads, so that the threaded
+    // nearest-neighbor search is used even for these small problems.
+    std::vector<int32> threaded_assignments;
+    AgglomerativeClusterer clusterer(costs, thresh, min_clust, 1 + Rand() % 3,
+                                     &threaded_assignments);
+    clusterer.SetMinWorkPerThread(1 + Rand() % 10);
+    clusterer.Cluster();
+    KALDI_ASSERT(threaded_assignments == ref_assignments);
+  }
+}
+
+}
+
+int main() {
+  using namespace kaldi;
+  UnitTestAgglomerativeCluster();
+  std::cout << "Test OK.\n";
+  return 0;
+}
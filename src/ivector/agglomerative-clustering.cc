@@ -19,113 +19,214 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
 #include "ivector/agglomerative-clustering.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 
+// This class is used to find the nearest neighbors of a list of slots in
+// parallel; thread i handles the slots with indexes i, i + num_threads_, ...
+// The slots are interleaved because the searches for lower-numbered slots take
+// longer.
+class AgglomerativeNeighborTask: public MultiThreadable {
+ public:
+  AgglomerativeNeighborTask(AgglomerativeClusterer *clusterer,
+                            const std::vector<int32> &slots):
+      clusterer_(clusterer), slots_(&slots) { }
+  void operator() () {
+    for (size_t i = thread_id_; i < slots_->size(); i += num_threads_)
+      clusterer_->FindNearestNeighbor((*slots_)[i]);
+  }
+ private:
+  AgglomerativeClusterer *clusterer_;
+  const std::vector<int32> *slots_;
+};
+
 void AgglomerativeClusterer::Cluster() {
   KALDI_VLOG(2) << "Initializing cluster assignments.";
   Initialize();
 
   KALDI_VLOG(2) << "Clustering...";
   // This is the main algorithm loop. It moves through the queue merging
-  // clusters until a stopping criterion has been reached.
+  // clusters until a stopping criterion has been reached.  Average linkage
+  // never decreases the cost between clusters below the cost of the pair
+  // being merged, so the merges happen in order of increasing cost and we can
+  // stop as soon as the lowest cost exceeds the threshold.
   while (num_clusters_ > min_clust_ && !queue_.empty()) {
-    std::pair<BaseFloat, std::pair<uint16, uint16> > pr = queue_.top();
-    int32 i = (int32) pr.second.first, j = (int32) pr.second.second;
+    QueueElement pr = queue_.top();
+    int32 i = pr.second;
+    // check to make sure the entry is not out of date.
+    if (sizes_[i] == 0 || nearest_neighbor_[i] < 0 ||
+        pr.first != nearest_cost_[i]) {
+      queue_.pop();
+      continue;
+    }
+    if (pr.first > thresh_)
+      break;
     queue_.pop();
-    // check to make sure clusters have not already been merged
-    if ((active_clusters_.find(i) != active_clusters_.end()) &&
-        (active_clusters_.find(j) != active_clusters_.end()))
-      MergeClusters(i, j);
+    MergeClusters(i, nearest_neighbor_[i]);
   }
 
+  // Assign all utterances within each cluster an ID label unique to the
+  // cluster, with the labels in the order the clusters were created.  This is
+  // the final output.
+  std::vector<std::pair<int32, int32> > active_ids;  // (cluster id, slot)
+  for (int32 i = 0; i < num_points_; i++)
+    if (sizes_[i] > 0)
+      active_ids.push_back(std::make_pair(ids_[i], i));
+  std::sort(active_ids.begin(), active_ids.end());
+  std::vector<int32> slot_labels(num_points_, 0);
+  for (size_t k = 0; k < active_ids.size(); k++)
+    slot_labels[active_ids[k].second] = k + 1;
+
   std::vector<int32> new_assignments(num_points_);
-  int32 label_id = 0;
-  std::set<int32>::iterator it;
-  // Iterate through the clusters and assign all utterances within the cluster
-  // an ID label unique to the cluster. This is the final output and frees up
-  // the cluster memory accordingly.
-  for (it = active_clusters_.begin(); it != active_clusters_.end(); ++it) {
-    ++label_id;
-    AhcCluster *cluster = clusters_map_[*it];
-    std::vector<int32>::iterator utt_it;
-    for (utt_it = cluster->utt_ids.begin();
-         utt_it != cluster->utt_ids.end(); ++utt_it)
-      new_assignments[*utt_it] = label_id;
-    delete cluster;
+  for (int32 p = 0; p < num_points_; p++) {
+    int32 root = p;
+    while (merged_into_[root] != root)
+      root = merged_into_[root];
+    // path compression.
+    for (int32 q = p; merged_into_[q] != root; ) {
+      int32 next = merged_into_[q];
+      merged_into_[q] = root;
+      q = next;
+    }
+    new_assignments[p] = slot_labels[root];
   }
   assignments_->swap(new_assignments);
 }
 
-BaseFloat AgglomerativeClusterer::GetCost(int32 i, int32 j) {
-  if (i < j)
-    return cluster_cost_map_[std::make_pair(i, j)];
-  else
-    return cluster_cost_map_[std::make_pair(j, i)];
+void AgglomerativeClusterer::FindNearestNeighbor(int32 i) {
+  int32 best_j = -1;
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+  if (i + 1 == num_points_) {
+    nearest_neighbor_[i] = best_j;
+    nearest_cost_[i] = best_cost;
+    return;
+  }
+  // The costs between slot i and slots j > i, starting at j = i + 1.
+  const BaseFloat *sum_costs = &(sum_costs_[CostIndex(i, i + 1)]);
+  BaseFloat size_i = sizes_[i];
+  for (int32 j = i + 1; j < num_points_; j++) {
+    int32 size_j = sizes_[j];
+    if (size_j == 0)
+      continue;
+    BaseFloat cost = sum_costs[j - i - 1] / (size_i * size_j);
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_j = j;
+    }
+  }
+  nearest_neighbor_[i] = best_j;
+  nearest_cost_[i] = best_cost;
+}
+
+void AgglomerativeClusterer::FindNearestNeighbors(
+    const std::vector<int32> &slots) {
+  // We only use multiple threads if the total number of costs to examine is
+  // large enough to make it worthwhile.
+  int64 work = 0;
+  for (size_t k = 0; k < slots.size(); k++)
+    work += num_points_ - slots[k];
+  int32 num_threads = std::min<int64>(num_threads_,
+                                      work / min_work_per_thread_);
+  if (num_threads > 1 && slots.size() > 1) {
+    AgglomerativeNeighborTask task(this, slots);
+    MultiThreader<AgglomerativeNeighborTask> threader(num_threads, task);
+  } else {
+    for (size_t k = 0; k < slots.size(); k++)
+      FindNearestNeighbor(slots[k]);
+  }
+  for (size_t k = 0; k < slots.size(); k++) {
+    int32 i = slots[k];
+    if (nearest_neighbor_[i] >= 0)
+      queue_.push(std::make_pair(nearest_cost_[i], i));
+  }
 }
 
 void AgglomerativeClusterer::Initialize() {
   KALDI_ASSERT(num_clusters_ != 0);
-  for (int32 i = 0; i < num_points_; i++) {
+  KALDI_ASSERT(costs_.NumCols() == num_points_);
+  int32 n = num_points_;
+  sum_costs_.resize(static_cast<size_t>(n) * (n - 1) / 2);
+  sizes_.assign(n, 1);
+  ids_.resize(n);
+  merged_into_.resize(n);
+  nearest_neighbor_.assign(n, -1);
+  nearest_cost_.resize(n);
+  std::vector<int32> slots(n);
+  for (int32 i = 0; i < n; i++) {
     // create an initial cluster of size 1 for each point
-    std::vector<int32> ids;
-    ids.push_back(i);
-    AhcCluster *c = new AhcCluster(++count_, -1, -1, ids);
-    clusters_map_[count_] = c;
-    active_clusters_.insert(count_);
-
-    // propagate the queue with all pairs from the cost matrix
-    for (int32 j = i+1; j < num_clusters_; j++) {
-      BaseFloat cost = costs_(i,j);
-      cluster_cost_map_[std::make_pair(i+1, j+1)] = cost;
-      if (cost <= thresh_)
-        queue_.push(std::make_pair(cost,
-            std::make_pair(static_cast<uint16>(i+1),
-                           static_cast<uint16>(j+1))));
-    }
+    ids_[i] = ++count_;
+    merged_into_[i] = i;
+    slots[i] = i;
+    // copy the upper triangle of the cost matrix.
+    const BaseFloat *costs_row = costs_.RowData(i);
+    std::copy(costs_row + i + 1, costs_row + n,
+              sum_costs_.begin() + (i + 1 < n ? CostIndex(i, i + 1) : 0));
   }
+  FindNearestNeighbors(slots);
 }
 
 void AgglomerativeClusterer::MergeClusters(int32 i, int32 j) {
-  AhcCluster *clust1 = clusters_map_[i];
-  AhcCluster *clust2 = clusters_map_[j];
-  // For memory efficiency, the first cluster is updated to contain the new
-  // merged cluster information, and the second cluster is later deleted.
-  clust1->id = ++count_;
-  clust1->parent1 = i;
-  clust1->parent2 = j;
-  clust1->size += clust2->size;
-  clust1->utt_ids.insert(clust1->utt_ids.end(), clust2->utt_ids.begin(),
-                         clust2->utt_ids.end());
-  // Remove the merged clusters from the list of active clusters.
-  active_clusters_.erase(i);
-  active_clusters_.erase(j);
-  // Update the queue with all the new costs involving the new cluster
-  std::set<int32>::iterator it;
-  for (it = active_clusters_.begin(); it != active_clusters_.end(); ++it) {
-    // The new cost is the sum of the costs of the new cluster's parents
-    BaseFloat new_cost = GetCost(*it, i) + GetCost(*it, j);
-    cluster_cost_map_[std::make_pair(*it, count_)] = new_cost;
-    BaseFloat norm = clust1->size * (clusters_map_[*it])->size;
-    if (new_cost / norm <= thresh_)
-      queue_.push(std::make_pair(new_cost / norm,
-          std::make_pair(static_cast<uint16>(*it),
-                         static_cast<uint16>(count_))));
+  KALDI_ASSERT(i < j && sizes_[i] > 0 && sizes_[j] > 0);
+  // The new cluster takes the place of the second cluster.  The new sum of
+  // costs between it and each other cluster is the sum of the costs of the
+  // new cluster's parents.
+  for (int32 k = 0; k < i; k++) {
+    if (sizes_[k] > 0)
+      sum_costs_[CostIndex(k, j)] += sum_costs_[CostIndex(k, i)];
+  }
+  for (int32 k = i + 1; k < j; k++) {
+    if (sizes_[k] > 0)
+      sum_costs_[CostIndex(k, j)] += sum_costs_[CostIndex(i, k)];
   }
-  active_clusters_.insert(count_);
-  clusters_map_[count_] = clust1;
-  delete clust2;
+  if (j + 1 < num_points_) {
+    BaseFloat *j_row = &(sum_costs_[CostIndex(j, j + 1)]);
+    const BaseFloat *i_row = &(sum_costs_[CostIndex(i, j + 1)]);
+    for (int32 k = j + 1; k < num_points_; k++)
+      j_row[k - j - 1] += i_row[k - j - 1];
+  }
+  sizes_[j] += sizes_[i];
+  sizes_[i] = 0;
+  ids_[j] = ++count_;
+  merged_into_[i] = j;
   num_clusters_--;
+
+  // Update the nearest neighbors.  Only the slots lower than j can have
+  // either of the merged clusters as a neighbor.  Those whose nearest
+  // neighbor was one of the merged clusters need a full search; for the
+  // others, the new cluster only becomes the nearest neighbor if it is
+  // closer than the current one.
+  std::vector<int32> to_search;
+  to_search.push_back(j);
+  for (int32 k = 0; k < j; k++) {
+    if (sizes_[k] == 0)
+      continue;
+    int32 nn = nearest_neighbor_[k];
+    if (nn == i || nn == j) {
+      to_search.push_back(k);
+    } else {
+      BaseFloat cost = GetCost(k, j);
+      if (cost < nearest_cost_[k]) {
+        nearest_neighbor_[k] = j;
+        nearest_cost_[k] = cost;
+        queue_.push(std::make_pair(cost, k));
+      }
+    }
+  }
+  FindNearestNeighbors(to_search);
 }
 
 void AgglomerativeCluster(
     const Matrix<BaseFloat> &costs,
     BaseFloat thresh,
     int32 min_clust,
-    std::vector<int32> *assignments_out) {
-  KALDI_ASSERT(min_clust >= 0);
-  AgglomerativeClusterer ac(costs, thresh, min_clust, assignments_out);
+    std::vector<int32> *assignments_out,
+    int32 num_threads) {
+  KALDI_ASSERT(min_clust >= 0 && num_threads >= 1);
+  AgglomerativeClusterer ac(costs, thresh, min_clust, num_threads,
+                            assignments_out);
   ac.Cluster();
 }
 
@@ -23,8 +23,6 @@
 
 #include <vector>
 #include <queue>
-#include <set>
-#include <unordered_map>
 #include <functional>
 #include "base/kaldi-common.h"
 #include "matrix/matrix-lib.h"
@@ -32,46 +30,64 @@
 
 namespace kaldi {
 
-/// AhcCluster is the cluster object for the agglomerative clustering. It
-/// contains three integer IDs: its own ID and the IDs of its "parents", i.e.
-/// the clusters that were merged to form it. It also contains the size (the
-/// number of points in the cluster) and a vector of the IDs of the utterances
-/// contained in the cluster.
-struct AhcCluster {
-  int32 id,
-    parent1,
-    parent2,
-    size;
-  std::vector<int32> utt_ids;
-  AhcCluster(int32 id, int32 p1, int32 p2, std::vector<int32> utts)
-      : id(id), parent1(p1), parent2(p2), utt_ids(utts) {
-    size = utts.size();
-  }
-};
-
 /// The AgglomerativeClusterer class contains the necessary mechanisms for the
-/// actual clustering algorithm.
+/// actual clustering algorithm.  Each cluster occupies a "slot", which is the
+/// index of one of its points; when two clusters are merged, the merged
+/// cluster takes the higher-numbered of the two slots.  For each active slot
+/// we keep the nearest neighbor among the higher-numbered active slots, and a
+/// priority queue of slots keyed by the cost to that neighbor, whose top gives
+/// the next pair to merge.  After a merge, only the neighbors that involved
+/// the merged clusters need to be recomputed.  The sums of pairwise costs
+/// between clusters are stored in a condensed upper-triangular array.
 class AgglomerativeClusterer {
  public:
   AgglomerativeClusterer(
       const Matrix<BaseFloat> &costs,
       BaseFloat thresh,
       int32 min_clust,
+      int32 num_threads,
       std::vector<int32> *assignments_out)
       : count_(0), costs_(costs), thresh_(thresh), min_clust_(min_clust),
+        num_threads_(num_threads), min_work_per_thread_(100000),
         assignments_(assignments_out) {
     num_clusters_ = costs.NumRows();
     num_points_ = costs.NumRows();
   }
 
+  // Sets the number of costs that each thread must have to examine, in a
+  // nearest-neighbor search, for us to use multiple threads (default 100000).
+  // This is mainly for testing.
+  void SetMinWorkPerThread(int64 min_work_per_thread) {
+    KALDI_ASSERT(min_work_per_thread > 0);
+    min_work_per_thread_ = min_work_per_thread;
+  }
+
   // Performs the clustering
   void Cluster();
  private:
-  // Returns the cost between clusters with IDs i and j
-  BaseFloat GetCost(int32 i, int32 j);
-  // Initializes the clustering queue with singleton clusters
+  friend class AgglomerativeNeighborTask;
+
+  // Returns the index into sum_costs_ for slots i and j; requires i < j.
+  inline size_t CostIndex(int32 i, int32 j) const {
+    return static_cast<size_t>(i) * (2 * num_points_ - i - 1) / 2 +
+        (j - i - 1);
+  }
+  // Returns the average cost between the clusters in slots i and j; requires
+  // i < j.
+  inline BaseFloat GetCost(int32 i, int32 j) const {
+    BaseFloat norm = sizes_[i] * sizes_[j];
+    return sum_costs_[CostIndex(i, j)] / norm;
+  }
+  // Sets nearest_neighbor_[i] and nearest_cost_[i] by searching over the
+  // active slots greater than i.
+  void FindNearestNeighbor(int32 i);
+  // Calls FindNearestNeighbor() for each slot in "slots", using multiple
+  // threads if there is enough work, and adds them to the queue.
+  void FindNearestNeighbors(const std::vector<int32> &slots);
+  // Initializes the costs, the nearest neighbors and the queue.
   void Initialize();
-  // Merges clusters with IDs i and j and updates cost map and queue
+  // Merges the clusters in slots i < j into slot j and updates the costs,
+  // the nearest neighbors and the queue.
   void MergeClusters(int32 i, int32 j);
 
 
@@ -80,22 +96,35 @@ class AgglomerativeClusterer {
   const Matrix<BaseFloat> &costs_;  // cost matrix
   BaseFloat thresh_;  // stopping criterion threshold
   int32 min_clust_;  // minimum number of clusters
+  int32 num_threads_;  // number of threads for nearest-neighbor searches
+  int64 min_work_per_thread_;  // see SetMinWorkPerThread().
   std::vector<int32> *assignments_;  // assignments out
 
+  // Sum of the pairwise costs between the points of the clusters in slots i
+  // and j, for i < j, at index CostIndex(i, j).
+  std::vector<BaseFloat> sum_costs_;
+  // Number of points in the cluster in each slot; zero if the slot is no
+  // longer active.
+  std::vector<int32> sizes_;
+  // Cluster ID of the cluster in each slot; these IDs increase in the order
+  // the clusters were created, and determine the order of the output labels.
+  std::vector<int32> ids_;
+  // For inactive slots, the slot that its cluster was merged into; for active
+  // slots, the slot itself.
+  std::vector<int32> merged_into_;
+  // For each active slot i, the active slot j > i with the lowest average cost
+  // to it (or -1 if there is none), and that cost.
+  std::vector<int32> nearest_neighbor_;
+  std::vector<BaseFloat> nearest_cost_;
+
   // Priority queue using greater (lowest costs are highest priority).
-  // Elements contain pairs of cluster IDs and their cost.
-  typedef std::pair<BaseFloat, std::pair<uint16,
-    uint16> > QueueElement;
+  // Elements contain the cost to the nearest neighbor and the slot; they may
+  // be out of date, which we detect by comparing with nearest_cost_.
+  typedef std::pair<BaseFloat, int32> QueueElement;
   typedef std::priority_queue<QueueElement, std::vector<QueueElement>,
     std::greater<QueueElement>  > QueueType;
   QueueType queue_;
 
-  // Map from cluster IDs to cost between them
-  std::unordered_map<std::pair<int32, int32>, BaseFloat,
-                     PairHasher<int32, int32>> cluster_cost_map_;
-  // Map from cluster ID to cluster object address
-  std::unordered_map<int32, AhcCluster*> clusters_map_;
-  std::set<int32> active_clusters_;  // IDs of unmerged clusters
   int32 num_clusters_;  // number of active clusters
   int32 num_points_;  // total number of points to cluster
 };
@@ -126,12 +155,17 @@ class AgglomerativeClusterer {
  *  costs between clusters I and M and clusters I and N, where
  *  cluster J was formed by merging clusters M and N.
  *
+ *  The time taken is typically O(N^2 log N) for N points, and the memory
+ *  is about 2 N^2 bytes in addition to the cost matrix.  "num_threads"
+ *  controls the number of threads used for the nearest-neighbor searches.
+ *
  */
 void AgglomerativeCluster(
     const Matrix<BaseFloat> &costs,
     BaseFloat thresh,
     int32 min_clust,
-    std::vector<int32> *assignments_out);
+    std::vector<int32> *assignments_out,
+    int32 num_threads = 1);
 
 }  // end namespace kaldi.
 
@@ -141,6 +141,99 @@ void TestIvectorExtraction(const IvectorExtractor &extractor,
   KALDI_ASSERT(ivector1.ApproxEqual(ivector2));
 }
 
+// Checks that accumulating the online stats in blocks gives the same result as
+// accumulating them one frame at a time, and that GetIvector() with a
+// tolerance, warm-started from an earlier estimate, gets close to the exact
+// iVector.
+void TestOnlineIvectorBlockStats(const IvectorExtractor &extractor,
+                                 const MatrixBase<BaseFloat> &feats,
+                                 const FullGmm &fgmm) {
+  if (extractor.IvectorDependentWeights())
+    return;
+  int32 num_frames = feats.NumRows(),
+      ivector_dim = extractor.IvectorDim();
+  Posterior post(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    Vector<BaseFloat> posterior(fgmm.NumGauss(), kUndefined);
+    fgmm.ComponentPosteriors(feats.Row(t), &posterior);
+    // Use a posterior scale, and occasionally negative weights as in the
+    // silence-weighted online estimation.
+    BaseFloat scale = (Rand() % 10 == 0 ? -0.05 : 0.1);
+    for (int32 i = 0; i < posterior.Dim(); i++)
+      if (RandUniform() < 0.7)
+        post[t].push_back(std::make_pair(i, scale * posterior(i)));
+  }
+  BaseFloat max_count = (Rand() % 2 == 0 ? 0.0 : 5.0);
+  OnlineIvectorEstimationStats stats1(ivector_dim, extractor.PriorOffset(),
+                                      max_count),
+      stats2(stats1);
+
+  int32 ivector_period = 1 + Rand() % 20, num_cg_iters = -1;
+  BaseFloat cg_tolerance = 1.0e-04;
+  Vector<double> ivector1(ivector_dim), ivector2(ivector_dim);
+  for (int32 start = 0; start < num_frames; start += ivector_period) {
+    int32 end = std::min(start + ivector_period, num_frames);
+    for (int32 t = start; t < end; t++)
+      stats1.AccStats(extractor, feats.Row(t), post[t]);
+    Posterior block_post(post.begin() + start, post.begin() + end);
+    stats2.AccStats(extractor, feats.RowRange(start, end - start),
+                    block_post);
+    KALDI_ASSERT(ApproxEqual(stats1.Count(), stats2.Count()));
+
+    stats1.GetIvector(num_cg_iters, &ivector1);
+    int32 num_iters = stats2.GetIvector(num_cg_iters, &ivector2,
+                                        cg_tolerance);
+    KALDI_ASSERT(num_iters <= ivector_dim + 5);
+    KALDI_ASSERT(ivector1.ApproxEqual(ivector2, 1.0e-02));
+  }
+  stats2.GetIvector(num_cg_iters, &ivector2);
+  KALDI_ASSERT(ivector1.ApproxEqual(ivector2, 1.0e-05));
+}
+
+// Checks that GetIvectorMeans() agrees with GetIvectorDistribution() and
+// GetAuxf() computed one utterance at a time.
+void TestIvectorMeans(const IvectorExtractor &extractor,
+                      const std::vector<Matrix<BaseFloat> > &all_feats,
+                      const FullGmm &fgmm) {
+  int32 num_utts = all_feats.size(),
+      ivector_dim = extractor.IvectorDim();
+  std::vector<IvectorExtractorUtteranceStats*> utt_stats(num_utts);
+  std::vector<const IvectorExtractorUtteranceStats*> const_utt_stats(num_utts);
+  for (int32 n = 0; n < num_utts; n++) {
+    const Matrix<BaseFloat> &feats = all_feats[n];
+    Posterior post(feats.NumRows());
+    for (int32 t = 0; t < feats.NumRows(); t++) {
+      Vector<BaseFloat> posterior(fgmm.NumGauss(), kUndefined);
+      fgmm.ComponentPosteriors(feats.Row(t), &posterior);
+      for (int32 i = 0; i < posterior.Dim(); i++)
+        if (i == 0 || RandUniform() < 0.8)  // leave some gaps.
+          post[t].push_back(std::make_pair(i, posterior(i)));
+    }
+    utt_stats[n] = new IvectorExtractorUtteranceStats(extractor.NumGauss(),
+                                                      feats.NumCols(), false);
+    utt_stats[n]->AccStats(feats, post);
+    const_utt_stats[n] = utt_stats[n];
+  }
+
+  Matrix<double> means(num_utts, ivector_dim);
+  Vector<double> auxf_changes;
+  extractor.GetIvectorMeans(const_utt_stats, &means, &auxf_changes);
+
+  Vector<double> ivector_baseline(ivector_dim);
+  ivector_baseline(0) = extractor.PriorOffset();
+  for (int32 n = 0; n < num_utts; n++) {
+    Vector<double> ivector(ivector_dim);
+    extractor.GetIvectorDistribution(*(utt_stats[n]), &ivector, NULL);
+    double auxf_change = extractor.GetAuxf(*(utt_stats[n]), ivector) -
+        extractor.GetAuxf(*(utt_stats[n]), ivector_baseline);
+    KALDI_LOG << "Auxf change is " << auxf_change << " vs. "
+              << auxf_changes(n);
+    KALDI_ASSERT(ivector.ApproxEqual(Vector<double>(means.Row(n)), 1.0e-05));
+    KALDI_ASSERT(ApproxEqual(auxf_change, auxf_changes(n), 1.0e-04));
+  }
+  DeletePointers(&utt_stats);
+}
+
 
 void UnitTestIvectorExtractor() {
   FullGmm fgmm;
@@ -183,7 +276,9 @@ void UnitTestIvectorExtractor() {
       Matrix<BaseFloat> &feats = all_feats[utt];
       stats.AccStatsForUtterance(extractor, feats, fgmm);
       TestIvectorExtraction(extractor, feats, fgmm);
+      TestOnlineIvectorBlockStats(extractor, feats, fgmm);
     }
+    TestIvectorMeans(extractor, all_feats, fgmm);
     TestIvectorExtractorStatsIO(stats);
     
     IvectorExtractorEstimationOptions estimation_opts;
@@ -64,26 +64,104 @@ void IvectorExtractor::GetIvectorDistribution(
     const IvectorExtractorUtteranceStats &utt_stats,
     VectorBase<double> *mean,
     SpMatrix<double> *var) const {
+  Vector<double> linear(IvectorDim());
+  SpMatrix<double> quadratic(IvectorDim());
+  GetIvectorDistMean(utt_stats, &linear, &quadratic);
+  GetIvectorDistPrior(utt_stats, &linear, &quadratic);
+  SolveIvectorDistribution(utt_stats, linear, &quadratic, mean, var);
+}
+
+
+void IvectorExtractor::GetIvectorMeans(
+    const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+    MatrixBase<double> *means,
+    Vector<double> *auxf_changes) const {
+  int32 num_utts = utt_stats.size(), I = NumGauss(), D = FeatDim(),
+      S = IvectorDim(), packed_dim = S * (S + 1) / 2;
+  KALDI_ASSERT(means->NumRows() == num_utts && means->NumCols() == S);
+  if (num_utts == 0)
+    return;
+
+  // "gammas" has the zeroth-order stats of each utterance in its rows.
+  Matrix<double> gammas(num_utts, I);
+  for (int32 n = 0; n < num_utts; n++)
+    gammas.Row(n).CopyFromVec(utt_stats[n]->gamma_);
+
+  // The linear terms from the means; row n is \sum_i \M_i^T \Sigma_i^{-1}
+  // times the first-order stats of utterance n for Gaussian i.
+  Matrix<double> linear(num_utts, S);
+  Matrix<double> X_i(num_utts, D);
+  for (int32 i = 0; i < I; i++) {
+    bool any_nonzero = false;
+    for (int32 n = 0; n < num_utts; n++) {
+      X_i.Row(n).CopyFromVec(utt_stats[n]->X_.Row(i));
+      any_nonzero = any_nonzero || (gammas(n, i) != 0.0);
+    }
+    if (any_nonzero)
+      linear.AddMatMat(1.0, X_i, kNoTrans, Sigma_inv_M_[i], kNoTrans, 1.0);
+  }
+  // The quadratic terms from the means, in packed form: row n is
+  // \sum_i \gamma_i \U_i for utterance n.
+  Matrix<double> quadratic(num_utts, packed_dim);
+  quadratic.AddMatMat(1.0, gammas, kNoTrans, U_, kNoTrans, 0.0);
+
+  if (auxf_changes != NULL)
+    auxf_changes->Resize(num_utts);
+  Vector<double> prior_mean(S);
+  prior_mean(0) = prior_offset_;
+  for (int32 n = 0; n < num_utts; n++) {
+    const IvectorExtractorUtteranceStats &this_stats = *(utt_stats[n]);
+    Vector<double> this_linear(linear.Row(n));
+    SpMatrix<double> this_quadratic(S);
+    SubVector<double> q_vec(this_quadratic.Data(), packed_dim);
+    q_vec.CopyFromVec(quadratic.Row(n));
+    SpMatrix<double> mean_quadratic;
+    if (auxf_changes != NULL)  // this_quadratic gets overwritten.
+      mean_quadratic = this_quadratic;
+
+    GetIvectorDistPrior(this_stats, &this_linear, &this_quadratic);
+    SubVector<double> mean(*means, n);
+    SolveIvectorDistribution(this_stats, this_linear, &this_quadratic,
+                             &mean, NULL);
+
+    if (auxf_changes != NULL) {
+      // The part of the auxf that depends on the means is
+      // K + x^T a - 0.5 x^T B x (see GetAcousticAuxfMean()), where a and B are
+      // the linear and quadratic terms from the means; K cancels when we
+      // take the difference.
+      SubVector<double> mean_linear(linear, n);
+      double mean_auxf_change =
+          VecVec(mean, mean_linear) -
+          0.5 * VecSpVec(mean, mean_quadratic, mean) -
+          VecVec(prior_mean, mean_linear) +
+          0.5 * VecSpVec(prior_mean, mean_quadratic, prior_mean);
+      (*auxf_changes)(n) = mean_auxf_change +
+          GetAcousticAuxfWeight(this_stats, mean) -
+          GetAcousticAuxfWeight(this_stats, prior_mean) +
+          GetPriorAuxf(mean) - GetPriorAuxf(prior_mean);
+    }
+  }
+}
+
+
+void IvectorExtractor::SolveIvectorDistribution(
+    const IvectorExtractorUtteranceStats &utt_stats,
+    const VectorBase<double> &linear,
+    SpMatrix<double> *quadratic,
+    VectorBase<double> *mean,
+    SpMatrix<double> *var) const {
   if (!IvectorDependentWeights()) {
-    Vector<double> linear(IvectorDim());
-    SpMatrix<double> quadratic(IvectorDim());
-    GetIvectorDistMean(utt_stats, &linear, &quadratic);
-    GetIvectorDistPrior(utt_stats, &linear, &quadratic);
     if (var != NULL) {
-      var->CopyFromSp(quadratic);
+      var->CopyFromSp(*quadratic);
       var->Invert(); // now it's a variance.
 
       // mean of distribution = quadratic^{-1} * linear...
       mean->AddSpVec(1.0, *var, linear, 0.0);
     } else {
-      quadratic.Invert();
-      mean->AddSpVec(1.0, quadratic, linear, 0.0);
+      quadratic->Invert();
+      mean->AddSpVec(1.0, *quadratic, linear, 0.0);
     }
   } else {
-    Vector<double> linear(IvectorDim());
-    SpMatrix<double> quadratic(IvectorDim());
-    GetIvectorDistMean(utt_stats, &linear, &quadratic);
-    GetIvectorDistPrior(utt_stats, &linear, &quadratic);
     // At this point, "linear" and "quadratic" contain
     // the mean and prior-related terms, and we avoid
     // recomputing those.
@@ -91,11 +169,11 @@ void IvectorExtractor::GetIvectorDistribution(
     Vector<double> cur_mean(IvectorDim());
 
     SpMatrix<double> quadratic_inv(IvectorDim());
-    InvertWithFlooring(quadratic, &quadratic_inv);
+    InvertWithFlooring(*quadratic, &quadratic_inv);
     cur_mean.AddSpVec(1.0, quadratic_inv, linear, 0.0);
 
-    KALDI_VLOG(3) << "Trace of quadratic is " << quadratic.Trace()
-                  << ", condition is " << quadratic.Cond();
+    KALDI_VLOG(3) << "Trace of quadratic is " << quadratic->Trace()
+                  << ", condition is " << quadratic->Cond();
     KALDI_VLOG(3) << "Trace of quadratic_inv is " << quadratic_inv.Trace()
                   << ", condition is " << quadratic_inv.Cond();
 
@@ -115,7 +193,7 @@ void IvectorExtractor::GetIvectorDistribution(
                       << ", var trace is " << quadratic_inv.Trace();
       }
       Vector<double> this_linear(linear);
-      SpMatrix<double> this_quadratic(quadratic);
+      SpMatrix<double> this_quadratic(*quadratic);
       GetIvectorDistWeight(utt_stats, cur_mean,
                            &this_linear, &this_quadratic);
       InvertWithFlooring(this_quadratic, &quadratic_inv);
@@ -562,6 +640,74 @@ void OnlineIvectorEstimationStats::AccStats(
     quadratic_term_vec.AddVec(weight, U_g);
     tot_weight += weight;
   }
+  AddToCount(tot_weight);
+}
+
+void OnlineIvectorEstimationStats::AccStats(
+    const IvectorExtractor &extractor,
+    const MatrixBase<BaseFloat> &features,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &gauss_post) {
+  KALDI_ASSERT(extractor.IvectorDim() == this->IvectorDim());
+  KALDI_ASSERT(!extractor.IvectorDependentWeights());
+  KALDI_ASSERT(static_cast<int32>(gauss_post.size()) == features.NumRows() &&
+               features.NumCols() == extractor.FeatDim());
+
+  int32 num_frames = features.NumRows(),
+      num_gauss = extractor.NumGauss();
+  if (num_frames == 1) {
+    AccStats(extractor, features.Row(0), gauss_post[0]);
+    return;
+  }
+  // First work out the list of Gaussians that have nonzero posteriors in this
+  // block; gauss_to_index maps from Gaussian index to position in that list.
+  std::vector<int32> gauss_to_index(num_gauss, -1), gauss_list;
+  for (int32 t = 0; t < num_frames; t++) {
+    for (size_t idx = 0; idx < gauss_post[t].size(); idx++) {
+      int32 g = gauss_post[t][idx].first;
+      if (gauss_post[t][idx].second != 0.0 && gauss_to_index[g] == -1) {
+        gauss_to_index[g] = gauss_list.size();
+        gauss_list.push_back(g);
+      }
+    }
+  }
+  int32 num_active = gauss_list.size();
+  if (num_active == 0)
+    return;
+
+  // Accumulate the zeroth and first-order stats per Gaussian.  Negative weights
+  // are allowed, as in the one-frame version of AccStats().
+  Vector<double> gamma(num_active);
+  Matrix<double> X(num_active, extractor.FeatDim());
+  Vector<double> feature_dbl(extractor.FeatDim());
+  for (int32 t = 0; t < num_frames; t++) {
+    if (gauss_post[t].empty())
+      continue;
+    feature_dbl.CopyFromVec(features.Row(t));
+    for (size_t idx = 0; idx < gauss_post[t].size(); idx++) {
+      double weight = gauss_post[t][idx].second;
+      if (weight == 0.0)
+        continue;
+      int32 i = gauss_to_index[gauss_post[t][idx].first];
+      gamma(i) += weight;
+      X.Row(i).AddVec(weight, feature_dbl);
+    }
+  }
+
+  int32 ivector_dim = this->IvectorDim(),
+      quadratic_term_dim = (ivector_dim * (ivector_dim + 1)) / 2;
+  SubVector<double> quadratic_term_vec(quadratic_term_.Data(),
+                                       quadratic_term_dim);
+  for (int32 i = 0; i < num_active; i++) {
+    int32 g = gauss_list[i];
+    linear_term_.AddMatVec(1.0, extractor.Sigma_inv_M_[g], kTrans,
+                           X.Row(i), 1.0);
+    SubVector<double> U_g(extractor.U_, g);
+    quadratic_term_vec.AddVec(gamma(i), U_g);
+  }
+  AddToCount(gamma.Sum());
+}
+
+void OnlineIvectorEstimationStats::AddToCount(double tot_weight) {
   if (max_count_ > 0.0) {
     // see comments in header RE max_count for explanation.  It relates to
     // prior scaling when the count exceeds max_count_
@@ -643,12 +789,14 @@ void OnlineIvectorEstimationStats::Read(std::istream &is, bool binary) {
   ExpectToken(is, binary, "</OnlineIvectorEstimationStats>");
 }
 
-void OnlineIvectorEstimationStats::GetIvector(
+int32 OnlineIvectorEstimationStats::GetIvector(
     int32 num_cg_iters,
-    VectorBase<double> *ivector) const {
+    VectorBase<double> *ivector,
+    BaseFloat cg_tolerance) const {
   KALDI_ASSERT(ivector != NULL && ivector->Dim() ==
-               this->IvectorDim());
+               this->IvectorDim() && cg_tolerance >= 0.0);
 
+  int32 num_iters = 0;
   if (num_frames_ > 0.0) {
     // could be done exactly as follows:
     // SpMatrix<double> quadratic_inv(quadratic_term_);
@@ -658,7 +806,16 @@ void OnlineIvectorEstimationStats::GetIvector(
       (*ivector)(0) = prior_offset_;  // better initial guess.
     LinearCgdOptions opts;
     opts.max_iters = num_cg_iters;
-    LinearCgd(opts, quadratic_term_, linear_term_, ivector);
+    if (cg_tolerance > 0.0) {
+      // Make the tolerance relative to the residual at the default iVector
+      // [ prior_offset_, 0, 0, ... ], rather than to linear_term_ itself which
+      // is dominated by the prior term.
+      Vector<double> default_residual(linear_term_);
+      for (int32 i = 0; i < default_residual.Dim(); i++)
+        default_residual(i) -= prior_offset_ * quadratic_term_(i, 0);
+      opts.max_error = cg_tolerance * default_residual.Norm(2.0);
+    }
+    num_iters = LinearCgd(opts, quadratic_term_, linear_term_, ivector);
   } else {
     // Use 'default' value.
     ivector->SetZero();
@@ -667,6 +824,7 @@ void OnlineIvectorEstimationStats::GetIvector(
   KALDI_VLOG(4) << "Objective function improvement from estimating the "
                 << "iVector (vs. default value) is "
                 << ObjfChange(*ivector);
+  return num_iters;
 }
 
 double OnlineIvectorEstimationStats::ObjfChange(
@@ -1696,7 +1854,8 @@ double EstimateIvectorsOnline(
     int32 ivector_period,
     int32 num_cg_iters,
     BaseFloat max_count,
-    Matrix<BaseFloat> *ivectors) {
+    Matrix<BaseFloat> *ivectors,
+    BaseFloat cg_tolerance) {
 
   KALDI_ASSERT(ivector_period > 0);
   KALDI_ASSERT(static_cast<int32>(post.size()) == feats.NumRows());
@@ -1713,18 +1872,23 @@ double EstimateIvectorsOnline(
 
   Vector<double> cur_ivector(extractor.IvectorDim());
   cur_ivector(0) = extractor.PriorOffset();
-  for (int32 frame = 0; frame < num_frames; frame++) {
+  // The iVector for index i is estimated from frames 0 through
+  // i * ivector_period; we accumulate the frames since the previous estimate
+  // as one block.
+  int32 block_start = 0;
+  for (int32 ivector_index = 0; ivector_index < num_ivectors;
+       ivector_index++) {
+    int32 block_end = ivector_index * ivector_period + 1;
+    Posterior block_post(post.begin() + block_start,
+                         post.begin() + block_end);
     online_stats.AccStats(extractor,
-                          feats.Row(frame),
-                          post[frame]);
-    if (frame % ivector_period == 0) {
-      online_stats.GetIvector(num_cg_iters, &cur_ivector);
-      int32 ivector_index = frame / ivector_period;
-      ivectors->Row(ivector_index).CopyFromVec(cur_ivector);
-      if (ivector_index == num_ivectors - 1)  // last iVector
-        ans = online_stats.ObjfChange(cur_ivector);
-    }
+                          feats.RowRange(block_start, block_end - block_start),
+                          block_post);
+    block_start = block_end;
+    online_stats.GetIvector(num_cg_iters, &cur_ivector, cg_tolerance);
+    ivectors->Row(ivector_index).CopyFromVec(cur_ivector);
   }
+  ans = online_stats.ObjfChange(cur_ivector);
   return ans;
 }
 
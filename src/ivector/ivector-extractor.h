@@ -153,6 +153,21 @@ class IvectorExtractor {
       VectorBase<double> *mean,
       SpMatrix<double> *var) const;
 
+  /// This is a batched version of GetIvectorDistribution(), which gets the
+  /// point estimates of the iVectors for several utterances (one per row of
+  /// "means", which must have utt_stats.size() rows and IvectorDim() columns).
+  /// It is much faster than calling GetIvectorDistribution() for each
+  /// utterance, because the terms that depend on the stats are computed with
+  /// matrix-matrix products, so the large matrix U_ is read once per batch
+  /// instead of once per utterance.  If "auxf_changes" is non-NULL, it is set
+  /// to the change in GetAuxf() (with var == NULL) from the mean of the prior
+  /// to the estimated iVector, for each utterance; computing it this way
+  /// avoids further passes over U_.
+  void GetIvectorMeans(
+      const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+      MatrixBase<double> *means,
+      Vector<double> *auxf_changes = NULL) const;
+
   /// The distribution over iVectors, in our formulation, is not centered at
   /// zero; its first dimension has a nonzero offset.  This function returns
   /// that offset.
@@ -253,6 +268,17 @@ class IvectorExtractor {
   void ComputeDerivedVars(int32 i);
   friend class IvectorExtractorComputeDerivedVarsClass;
 
+  // Used in GetIvectorDistribution() and GetIvectorMeans(): given the linear
+  // and quadratic terms from the means and the prior, works out the
+  // distribution over the iVector, iterating to handle the weights if
+  // applicable.  "quadratic" is used as temporary storage.
+  void SolveIvectorDistribution(
+      const IvectorExtractorUtteranceStats &utt_stats,
+      const VectorBase<double> &linear,
+      SpMatrix<double> *quadratic,
+      VectorBase<double> *mean,
+      SpMatrix<double> *var) const;
+
   // Imagine we'll project the iVectors with transformation T, so apply T^{-1}
   // where necessary to keep the model equivalent.  Used to keep unit variance
   // (like prior re-estimation).
@@ -327,6 +353,20 @@ class OnlineIvectorEstimationStats {
                 const VectorBase<BaseFloat> &feature,
                 const std::vector<std::pair<int32, BaseFloat> > &gauss_post);
 
+  /// This version of AccStats() accumulates a block of frames (one per row of
+  /// "features", with gauss_post.size() == features.NumRows()).  It gives the
+  /// same result as calling the one-frame version for each frame, but it
+  /// first sums the posteriors and the posterior-weighted features for each
+  /// Gaussian, so the update of the linear and quadratic terms is done once
+  /// per distinct Gaussian in the block rather than once per (frame,
+  /// Gaussian) pair.  Since consecutive frames tend to select the same
+  /// Gaussians, this is considerably faster when called with the frames
+  /// between two successive iVector estimates.
+  void AccStats(const IvectorExtractor &extractor,
+                const MatrixBase<BaseFloat> &features,
+                const std::vector<std::vector<std::pair<int32, BaseFloat> > >
+                    &gauss_post);
+
   int32 IvectorDim() const { return linear_term_.Dim(); }
 
   /// This function gets the current estimate of the iVector.  Internally it
@@ -342,8 +382,15 @@ class OnlineIvectorEstimationStats {
   /// set to a positive number, the number of conjugate gradient iterations will
   /// be limited to that number.  Note: the iVectors output still have a nonzero
   /// mean (first dim offset by PriorOffset()).
-  void GetIvector(int32 num_cg_iters,
-                  VectorBase<double> *ivector) const;
+  /// If cg_tolerance > 0, the conjugate gradient also stops once the 2-norm of
+  /// the residual is no more than cg_tolerance times its 2-norm at the default
+  /// iVector [ PriorOffset(), 0, 0, ... ]; when *ivector is the estimate from a
+  /// few frames ago this typically happens after only a few iterations, since
+  /// the stats will have changed very little.  Returns the number of CG
+  /// iterations done (zero if there were no stats).
+  int32 GetIvector(int32 num_cg_iters,
+                   VectorBase<double> *ivector,
+                   BaseFloat cg_tolerance = 0.0) const;
 
   double NumFrames() const { return num_frames_; }
 
@@ -383,6 +430,10 @@ class OnlineIvectorEstimationStats {
   /// [ prior_offset_, 0, 0, 0, ... ]... this is used in diagnostics.
   double DefaultObjf() const;
 
+  /// Adds "tot_weight" to num_frames_, and if max_count_ is set, updates the
+  /// prior term to reflect the new count.
+  void AddToCount(double tot_weight);
+
   friend class IvectorExtractor;
   double prior_offset_;
   double max_count_;
@@ -403,7 +454,9 @@ class OnlineIvectorEstimationStats {
 // from the first element of each row of the output before writing it out.
 // For num_cg_iters, we suggest 15.  It can be a positive number (more -> more
 // exact, less -> faster), or if it's negative it will do the optimization
-// exactly each time which is slower.
+// exactly each time which is slower.  If cg_tolerance > 0, the conjugate
+// gradient for each iVector may stop sooner than that; see
+// OnlineIvectorEstimationStats::GetIvector().
 // It returns the objective function improvement per frame from the "default" iVector to
 // the last iVector estimated.
 double EstimateIvectorsOnline(
@@ -413,7 +466,8 @@ double EstimateIvectorsOnline(
     int32 ivector_period,
     int32 num_cg_iters,
     BaseFloat max_count,
-    Matrix<BaseFloat> *ivectors);
+    Matrix<BaseFloat> *ivectors,
+    BaseFloat cg_tolerance = 0.0);
 
 
 /// Options for IvectorExtractorStats, which is used to update the parameters of
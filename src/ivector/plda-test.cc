@@ -89,6 +89,84 @@ void UnitTestPldaEstimation(int32 dim) {
 
 }
 
+template<class Real>
+void UnitTestPldaBatchScorer(const Plda &plda) {
+  int32 dim = plda.Dim(), num_train = 1 + Rand() % 50,
+      num_test = 1 + Rand() % 50;
+  Matrix<Real> train_ivectors(num_train, dim),
+      test_ivectors(num_test, dim);
+  std::vector<int32> num_train_utts(num_train);
+  PldaConfig config;
+  for (int32 i = 0; i < num_train; i++) {
+    Vector<Real> ivector(dim);
+    ivector.SetRandn();
+    num_train_utts[i] = 1 + Rand() % 3;
+    SubVector<Real> transformed_ivector(train_ivectors, i);
+    plda.TransformIvector(config, ivector, num_train_utts[i],
+                          &transformed_ivector);
+  }
+  for (int32 i = 0; i < num_test; i++) {
+    Vector<Real> ivector(dim);
+    ivector.SetRandn();
+    SubVector<Real> transformed_ivector(test_ivectors, i);
+    plda.TransformIvector(config, ivector, 1, &transformed_ivector);
+  }
+
+  PldaBatchScorer<Real> scorer(plda, train_ivectors, num_train_utts);
+  Matrix<Real> scores(num_test, num_train);
+  scorer.Score(test_ivectors, &scores);
+  for (int32 i = 0; i < num_test; i++) {
+    for (int32 j = 0; j < num_train; j++) {
+      double score = plda.LogLikelihoodRatio(
+          Vector<double>(train_ivectors.Row(j)), num_train_utts[j],
+          Vector<double>(test_ivectors.Row(i)));
+      KALDI_ASSERT(ApproxEqual(score, scores(i, j), 1.0e-04) ||
+                   std::abs(score - scores(i, j)) < 1.0e-04);
+    }
+  }
+
+  int32 k = 1 + Rand() % 10, block_size = 1 + Rand() % 20;
+  std::vector<std::vector<std::pair<Real, int32> > > top_scores;
+  scorer.ScoreTopK(test_ivectors, k, block_size, &top_scores);
+  KALDI_ASSERT(top_scores.size() == static_cast<size_t>(num_test));
+  for (int32 i = 0; i < num_test; i++) {
+    std::vector<std::pair<Real, int32> > all_scores;
+    for (int32 j = 0; j < num_train; j++)
+      all_scores.push_back(std::pair<Real, int32>(scores(i, j), j));
+    std::sort(all_scores.begin(), all_scores.end(),
+              std::greater<std::pair<Real, int32> >());
+    KALDI_ASSERT(top_scores[i].size() == std::min<size_t>(k, num_train));
+    for (size_t n = 0; n < top_scores[i].size(); n++) {
+      // The scores may differ very slightly, as they were computed in
+      // different-sized blocks.
+      AssertEqual(top_scores[i][n].first, all_scores[n].first, 1.0e-04);
+      AssertEqual(top_scores[i][n].first,
+                  scores(i, top_scores[i][n].second), 1.0e-04);
+    }
+  }
+}
+
+void UnitTestPldaBatchScorer(int32 dim) {
+  PldaStats stats;
+  for (int32 n = 0; n < 100; n++) {
+    int32 num_egs = 1 + Rand() % 10;
+    Vector<double> class_mean(dim);
+    class_mean.SetRandn();
+    class_mean.Scale(2.0);
+    Matrix<double> egs(num_egs, dim);
+    egs.SetRandn();
+    egs.AddVecToRows(1.0, class_mean);
+    stats.AddSamples(1.0, egs);
+  }
+  stats.Sort();
+  PldaEstimator estimator(stats);
+  Plda plda;
+  PldaEstimationConfig config;
+  estimator.Estimate(config, &plda);
+  UnitTestPldaBatchScorer<float>(plda);
+  UnitTestPldaBatchScorer<double>(plda);
+}
+
 }
 
 
@@ -110,6 +188,8 @@ int main() {
 
   // UnitTestPldaEstimation(400);
   UnitTestPldaEstimation(40);
+  for (int i = 0; i < 5; i++)
+    UnitTestPldaBatchScorer(i + 1);
   std::cout << "Test OK.\n";
   return 0;
 }
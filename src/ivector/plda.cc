@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
 #include <vector>
 #include "ivector/plda.h"
 
@@ -192,6 +193,186 @@ double Plda::LogLikelihoodRatio(
 }
 
 
+template<class Real>
+PldaBatchScorer<Real>::PldaBatchScorer(
+    const Plda &plda,
+    const MatrixBase<Real> &transformed_train_ivectors,
+    const std::vector<int32> &num_train_utts):
+    train_ivectors_(transformed_train_ivectors),
+    train_offsets_(transformed_train_ivectors.NumRows()),
+    train_num_utts_index_(transformed_train_ivectors.NumRows()) {
+  int32 dim = plda.Dim(), num_train = transformed_train_ivectors.NumRows();
+  KALDI_ASSERT(transformed_train_ivectors.NumCols() == dim &&
+               num_train_utts.size() == static_cast<size_t>(num_train));
+  const Vector<double> &psi = plda.psi_;
+
+  // See the comment above Plda::LogLikelihoodRatio() for the derivation.  For
+  // each distinct n we work out, for each dimension i, the scale
+  // a_i = n psi_i / (n psi_i + 1) on the train iVector in the mean, the
+  // variance s_i = 1 + psi_i / (n psi_i + 1), and
+  // the term  -0.5 log(s_i) + 0.5 log(1 + psi_i)  of the log-likelihood ratio
+  // that doesn't depend on the iVectors.
+  std::vector<Vector<double> > scales, inv_variances;
+  std::vector<double> logdet_terms;
+  for (int32 t = 0; t < num_train; t++) {
+    int32 n = num_train_utts[t];
+    KALDI_ASSERT(n > 0);
+    std::vector<int32>::iterator iter = std::find(distinct_num_utts_.begin(),
+                                                  distinct_num_utts_.end(), n);
+    if (iter != distinct_num_utts_.end()) {
+      train_num_utts_index_[t] = iter - distinct_num_utts_.begin();
+      continue;
+    }
+    train_num_utts_index_[t] = distinct_num_utts_.size();
+    distinct_num_utts_.push_back(n);
+    Vector<double> scale(dim, kUndefined), inv_variance(dim, kUndefined);
+    double logdet_term = 0.0;
+    for (int32 i = 0; i < dim; i++) {
+      double variance = 1.0 + psi(i) / (n * psi(i) + 1.0);
+      scale(i) = n * psi(i) / (n * psi(i) + 1.0);
+      inv_variance(i) = 1.0 / variance;
+      logdet_term += -0.5 * Log(variance) + 0.5 * Log(1.0 + psi(i));
+    }
+    scales.push_back(scale);
+    inv_variances.push_back(inv_variance);
+    logdet_terms.push_back(logdet_term);
+  }
+
+  int32 num_distinct = distinct_num_utts_.size();
+  test_sq_weights_.Resize(num_distinct, dim);
+  for (int32 j = 0; j < num_distinct; j++) {
+    // w(n) = -0.5 (1 / s - 1 / (1 + psi)).
+    Vector<double> w(psi);
+    w.Add(1.0);
+    w.InvertElements();
+    w.AddVec(-1.0, inv_variances[j]);
+    w.Scale(0.5);
+    test_sq_weights_.Row(j).CopyFromVec(w);
+  }
+
+  // The terms that involve the train iVector u are
+  //   v^T (a .* u ./ s)  -  0.5 (a .* u)^T ((a .* u) ./ s).
+  Vector<double> mean(dim), scaled_mean(dim);
+  for (int32 t = 0; t < num_train; t++) {
+    int32 j = train_num_utts_index_[t];
+    mean.CopyFromVec(transformed_train_ivectors.Row(t));
+    mean.MulElements(scales[j]);
+    scaled_mean.CopyFromVec(mean);
+    scaled_mean.MulElements(inv_variances[j]);
+    train_ivectors_.Row(t).CopyFromVec(scaled_mean);
+    train_offsets_(t) = logdet_terms[j] - 0.5 * VecVec(mean, scaled_mean);
+  }
+}
+
+template<class Real>
+void PldaBatchScorer<Real>::ComputeTestTerms(
+    const MatrixBase<Real> &transformed_test_ivectors,
+    MatrixBase<Real> *test_terms) const {
+  Matrix<Real> test_sq(transformed_test_ivectors);
+  test_sq.ApplyPow(2.0);
+  test_terms->AddMatMat(1.0, test_sq, kNoTrans, test_sq_weights_, kTrans, 0.0);
+}
+
+template<class Real>
+void PldaBatchScorer<Real>::ScoreBlock(
+    const MatrixBase<Real> &transformed_test_ivectors,
+    const MatrixBase<Real> &test_terms,
+    int32 train_offset,
+    MatrixBase<Real> *scores) const {
+  int32 num_test = scores->NumRows(), block_size = scores->NumCols();
+  KALDI_ASSERT(transformed_test_ivectors.NumRows() == num_test &&
+               test_terms.NumRows() == num_test &&
+               transformed_test_ivectors.NumCols() == Dim());
+  SubMatrix<Real> train_part(train_ivectors_, train_offset, block_size,
+                             0, Dim());
+  scores->AddMatMat(1.0, transformed_test_ivectors, kNoTrans,
+                    train_part, kTrans, 0.0);
+  scores->AddVecToRows(1.0, train_offsets_.Range(train_offset, block_size));
+  if (distinct_num_utts_.size() == 1) {
+    Vector<Real> test_terms_col(num_test, kUndefined);
+    test_terms_col.CopyColFromMat(test_terms, 0);
+    scores->AddVecToCols(1.0, test_terms_col);
+  } else {
+    const int32 *num_utts_index = &(train_num_utts_index_[train_offset]);
+    for (int32 i = 0; i < num_test; i++) {
+      const Real *test_terms_data = test_terms.RowData(i);
+      Real *scores_data = scores->RowData(i);
+      for (int32 j = 0; j < block_size; j++)
+        scores_data[j] += test_terms_data[num_utts_index[j]];
+    }
+  }
+}
+
+template<class Real>
+void PldaBatchScorer<Real>::Score(
+    const MatrixBase<Real> &transformed_test_ivectors,
+    MatrixBase<Real> *scores) const {
+  KALDI_ASSERT(scores->NumRows() == transformed_test_ivectors.NumRows() &&
+               scores->NumCols() == NumTrain());
+  if (scores->NumRows() == 0 || scores->NumCols() == 0)
+    return;
+  Matrix<Real> test_terms(transformed_test_ivectors.NumRows(),
+                          test_sq_weights_.NumRows(), kUndefined);
+  ComputeTestTerms(transformed_test_ivectors, &test_terms);
+  ScoreBlock(transformed_test_ivectors, test_terms, 0, scores);
+}
+
+template<class Real>
+void PldaBatchScorer<Real>::ScoreTopK(
+    const MatrixBase<Real> &transformed_test_ivectors,
+    int32 k, int32 block_size,
+    std::vector<std::vector<std::pair<Real, int32> > > *top_scores) const {
+  KALDI_ASSERT(k > 0 && block_size > 0);
+  typedef std::pair<Real, int32> ScorePair;
+  // We keep the best k scores for each test iVector in a heap whose top is
+  // the worst of them, so it's cheap to check whether a new score gets in.
+  std::greater<ScorePair> comp;
+  int32 num_test = transformed_test_ivectors.NumRows(),
+      num_train = NumTrain();
+  top_scores->clear();
+  top_scores->resize(num_test);
+  Matrix<Real> test_terms, scores;
+  for (int32 test_offset = 0; test_offset < num_test;
+       test_offset += block_size) {
+    int32 this_num_test = std::min(block_size, num_test - test_offset);
+    SubMatrix<Real> test_part(transformed_test_ivectors, test_offset,
+                              this_num_test, 0, Dim());
+    test_terms.Resize(this_num_test, test_sq_weights_.NumRows(), kUndefined);
+    ComputeTestTerms(test_part, &test_terms);
+    for (int32 train_offset = 0; train_offset < num_train;
+         train_offset += block_size) {
+      int32 this_num_train = std::min(block_size, num_train - train_offset);
+      scores.Resize(this_num_test, this_num_train, kUndefined);
+      ScoreBlock(test_part, test_terms, train_offset, &scores);
+      for (int32 i = 0; i < this_num_test; i++) {
+        std::vector<ScorePair> &heap = (*top_scores)[test_offset + i];
+        const Real *scores_data = scores.RowData(i);
+        for (int32 j = 0; j < this_num_train; j++) {
+          ScorePair p(scores_data[j], train_offset + j);
+          if (heap.size() < static_cast<size_t>(k)) {
+            heap.push_back(p);
+            std::push_heap(heap.begin(), heap.end(), comp);
+          } else if (comp(p, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), comp);
+            heap.back() = p;
+            std::push_heap(heap.begin(), heap.end(), comp);
+          }
+        }
+      }
+    }
+  }
+  for (int32 i = 0; i < num_test; i++) {
+    std::vector<ScorePair> &heap = (*top_scores)[i];
+    // Sorting with std::greater puts the highest scores first.
+    std::sort_heap(heap.begin(), heap.end(), comp);
+  }
+}
+
+// Instantiate the template for float and double.
+template class PldaBatchScorer<float>;
+template class PldaBatchScorer<double>;
+
+
 void Plda::SmoothWithinClassCovariance(double smoothing_factor) {
   KALDI_ASSERT(smoothing_factor >= 0.0 && smoothing_factor <= 1.0);
   // smoothing_factor > 1.0 is possible but wouldn't really make sense.
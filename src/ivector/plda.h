@@ -144,6 +144,7 @@ class Plda {
   void ComputeDerivedVars(); // computes offset_.
   friend class PldaEstimator;
   friend class PldaUnsupervisedAdaptor;
+  template<class Real> friend class PldaBatchScorer;
 
   Vector<double> mean_;  // mean of samples in original space.
   Matrix<double> transform_; // of dimension Dim() by Dim();
@@ -169,6 +170,85 @@ class Plda {
 };
 
 
+/**
+   This class computes the same log-likelihood ratios as
+   Plda::LogLikelihoodRatio(), but between a fixed set of "train" (enrollment)
+   iVectors and many test iVectors at once, using matrix multiplication.  For a
+   given number of training utterances n, the log-likelihood ratio is of the
+   form
+     u'^T v  +  (v .* v)^T w(n)  +  c(u, n),
+   where v is the transformed test iVector, u' is the transformed train iVector
+   u scaled elementwise by a function of n and \Psi, w(n) depends only on n and
+   \Psi, and c(u, n) is a constant; all these are precomputed in the
+   constructor.  So the scores for a block of test iVectors are a matrix product
+   plus some cheap corrections.  It's templated so that scoring can be done in
+   float (faster) or double.
+*/
+template<class Real>
+class PldaBatchScorer {
+ public:
+  /// Constructor.  "transformed_train_ivectors" contains the train iVectors,
+  /// one per row, which must already have been transformed with
+  /// Plda::TransformIvector(); "num_train_utts" gives, for each row, the number
+  /// of utterances the iVector was averaged over (as the "num_train_utts"
+  /// argument of Plda::LogLikelihoodRatio()).
+  PldaBatchScorer(const Plda &plda,
+                  const MatrixBase<Real> &transformed_train_ivectors,
+                  const std::vector<int32> &num_train_utts);
+
+  int32 NumTrain() const { return train_ivectors_.NumRows(); }
+
+  int32 Dim() const { return train_ivectors_.NumCols(); }
+
+  /// Computes the log-likelihood ratios between all test iVectors (the rows of
+  /// "transformed_test_ivectors", which must have been transformed with
+  /// Plda::TransformIvector()) and all train iVectors.  "scores" must have
+  /// dimension (number of test iVectors) by NumTrain(); scores(i, j) is the
+  /// score of test iVector i against train iVector j.
+  void Score(const MatrixBase<Real> &transformed_test_ivectors,
+             MatrixBase<Real> *scores) const;
+
+  /// For each test iVector, this function outputs the k train iVectors with
+  /// the highest log-likelihood ratios, as (score, train-index) pairs sorted
+  /// from best to worst (fewer than k if NumTrain() < k).  The scores are
+  /// computed in blocks of at most block_size by block_size, so the whole
+  /// score matrix is never stored; this also keeps the working set in cache.
+  void ScoreTopK(const MatrixBase<Real> &transformed_test_ivectors,
+                 int32 k, int32 block_size,
+                 std::vector<std::vector<std::pair<Real, int32> > > *top_scores)
+      const;
+
+ private:
+  // Computes into "test_terms" (which must have dimension number of test
+  // iVectors by test_sq_weights_.NumRows()) the term (v .* v)^T w(n) for each
+  // test iVector v and each distinct number of train utterances n.
+  void ComputeTestTerms(const MatrixBase<Real> &transformed_test_ivectors,
+                        MatrixBase<Real> *test_terms) const;
+
+  // Computes the scores of the test iVectors against train iVectors
+  // train_offset ... train_offset + scores->NumCols() - 1; "test_terms" is as
+  // computed by ComputeTestTerms().
+  void ScoreBlock(const MatrixBase<Real> &transformed_test_ivectors,
+                  const MatrixBase<Real> &test_terms,
+                  int32 train_offset,
+                  MatrixBase<Real> *scores) const;
+
+  // The train iVectors, each scaled elementwise by
+  // (n \Psi / (n \Psi + I)) / (I + \Psi / (n \Psi + I)), where n is its
+  // number of utterances.
+  Matrix<Real> train_ivectors_;
+  // The constant term c(u, n) for each train iVector.
+  Vector<Real> train_offsets_;
+  // The distinct numbers of train utterances, and for each one, a row of
+  // test_sq_weights_ containing the vector w(n) that multiplies the squared
+  // test iVector.
+  std::vector<int32> distinct_num_utts_;
+  Matrix<Real> test_sq_weights_;
+  // For each train iVector, the index into distinct_num_utts_.
+  std::vector<int32> train_num_utts_index_;
+};
+
+
 class PldaStats {
  public:
   PldaStats(): dim_(0) { } /// The dimension is set up the first time you add samples.
@@ -49,6 +49,7 @@ int main(int argc, char *argv[]) {
     std::string reco2num_spk_rspecifier;
     BaseFloat threshold = 0.0;
     bool read_costs = false;
+    int32 num_threads = 1;
 
     po.Register("reco2num-spk-rspecifier", &reco2num_spk_rspecifier,
       "If supplied, clustering creates exactly this many clusters for each"
@@ -58,6 +59,9 @@ int main(int argc, char *argv[]) {
     po.Register("read-costs", &read_costs, "If true, the first"
       " argument is interpreted as a matrix of costs rather than a"
       " similarity matrix.");
+    po.Register("num-threads", &num_threads, "Number of threads used for"
+      " the nearest-neighbor searches; only helps for recordings with"
+      " many thousands of segments.");
 
     po.Read(argc, argv);
 
@@ -91,9 +95,10 @@ int main(int argc, char *argv[]) {
       if (reco2num_spk_rspecifier.size()) {
         int32 num_speakers = reco2num_spk_reader.Value(reco);
         AgglomerativeCluster(costs,
-          std::numeric_limits<BaseFloat>::max(), num_speakers, &spk_ids);
+          std::numeric_limits<BaseFloat>::max(), num_speakers, &spk_ids,
+          num_threads);
       } else {
-        AgglomerativeCluster(costs, threshold, 1, &spk_ids);
+        AgglomerativeCluster(costs, threshold, 1, &spk_ids, num_threads);
       }
       for (int32 i = 0; i < spk_ids.size(); i++)
         label_writer.Write(uttlist[i], spk_ids[i]);
@@ -49,7 +49,7 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     int32 num_cg_iters = 15;
     int32 ivector_period = 10;
-    BaseFloat max_count = 0.0;
+    BaseFloat max_count = 0.0, cg_tolerance = 0.0;
     g_num_threads = 8;
 
     po.Register("num-cg-iters", &num_cg_iters,
@@ -67,6 +67,12 @@ int main(int argc, char *argv[]) {
                 "longer than normal utterances look more 'typical'.  Interpret "
                 "this value as a number of frames multiplied by your "
                 "posterior scale (so typically 0.1 times a number of frames).");
+    po.Register("cg-tolerance", &cg_tolerance,
+                "If >0, stop the conjugate gradient descent early once the "
+                "norm of the residual is smaller than this value times its "
+                "norm at the default iVector.  Since each iVector estimate "
+                "starts from the previous one this can save a lot of time, "
+                "e.g. try 0.01.");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -114,7 +120,8 @@ int main(int argc, char *argv[]) {
       double objf_impr_per_frame;
       objf_impr_per_frame = EstimateIvectorsOnline(feats, posterior, extractor,
                                                    ivector_period, num_cg_iters,
-                                                   max_count, &ivectors);
+                                                   max_count, &ivectors,
+                                                   cg_tolerance);
 
       BaseFloat offset = extractor.PriorOffset();
       for (int32 i = 0 ; i < ivectors.NumRows(); i++)
@@ -27,66 +27,84 @@
 namespace kaldi {
 
 // This class will be used to parallelize over multiple threads the job
-// that this program does.  The work happens in the operator (), the
+// that this program does.  Each task handles a batch of utterances, whose
+// iVectors are estimated together by GetIvectorMeans(); this is much faster
+// than doing them one at a time.  The work happens in the operator (), the
 // output happens in the destructor.
 class IvectorExtractTask {
  public:
   IvectorExtractTask(const IvectorExtractor &extractor,
-                     std::string utt,
-                     const Matrix<BaseFloat> &feats,
-                     const Posterior &posterior,
                      BaseFloatVectorWriter *writer,
                      double *tot_auxf_change):
-      extractor_(extractor), utt_(utt), feats_(feats), posterior_(posterior),
-      writer_(writer), tot_auxf_change_(tot_auxf_change) { }
+      extractor_(extractor), writer_(writer),
+      tot_auxf_change_(tot_auxf_change) { }
+
+  void AddUtterance(const std::string &utt,
+                    const Matrix<BaseFloat> &feats,
+                    const Posterior &posterior) {
+    utts_.push_back(utt);
+    feats_.push_back(new Matrix<BaseFloat>(feats));
+    posteriors_.push_back(posterior);
+  }
+
+  int32 NumUtterances() const { return utts_.size(); }
 
   void operator () () {
     bool need_2nd_order_stats = false;
-
-    IvectorExtractorUtteranceStats utt_stats(extractor_.NumGauss(),
-                                             extractor_.FeatDim(),
-                                             need_2nd_order_stats);
-
-    utt_stats.AccStats(feats_, posterior_);
-
-    ivector_.Resize(extractor_.IvectorDim());
-    ivector_(0) = extractor_.PriorOffset();
-
-    if (tot_auxf_change_ != NULL) {
-      double old_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
-      double new_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      auxf_change_ = new_auxf - old_auxf;
-    } else {
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+    int32 num_utts = utts_.size();
+    std::vector<IvectorExtractorUtteranceStats*> utt_stats(num_utts);
+    std::vector<const IvectorExtractorUtteranceStats*> const_utt_stats(
+        num_utts);
+    num_frames_.resize(num_utts);
+    for (int32 n = 0; n < num_utts; n++) {
+      utt_stats[n] = new IvectorExtractorUtteranceStats(
+          extractor_.NumGauss(), extractor_.FeatDim(), need_2nd_order_stats);
+      utt_stats[n]->AccStats(*(feats_[n]), posteriors_[n]);
+      const_utt_stats[n] = utt_stats[n];
+      num_frames_[n] = TotalPosterior(posteriors_[n]);
+      // We no longer need the features and posteriors.
+      delete feats_[n];
+      feats_[n] = NULL;
+      Posterior().swap(posteriors_[n]);
     }
+
+    ivectors_.Resize(num_utts, extractor_.IvectorDim());
+    extractor_.GetIvectorMeans(const_utt_stats, &ivectors_,
+                               (tot_auxf_change_ != NULL ?
+                                &auxf_changes_ : NULL));
+    DeletePointers(&utt_stats);
   }
   ~IvectorExtractTask() {
-    if (tot_auxf_change_ != NULL) {
-      double T = TotalPosterior(posterior_);
-      *tot_auxf_change_ += auxf_change_;
-      KALDI_VLOG(2) << "Auxf change for utterance " << utt_ << " was "
-                    << (auxf_change_ / T) << " per frame over " << T
-                    << " frames (weighted)";
+    DeletePointers(&feats_);
+    for (int32 n = 0; n < ivectors_.NumRows(); n++) {
+      if (tot_auxf_change_ != NULL) {
+        double T = num_frames_[n];
+        *tot_auxf_change_ += auxf_changes_(n);
+        KALDI_VLOG(2) << "Auxf change for utterance " << utts_[n] << " was "
+                      << (auxf_changes_(n) / T) << " per frame over " << T
+                      << " frames (weighted)";
+      }
+      // We actually write out the offset of the iVectors from the mean of the
+      // prior distribution; this is the form we'll need it in for scoring.
+      // (most formulations of iVectors have zero-mean priors so this is not
+      // normally an issue).
+      SubVector<double> ivector(ivectors_, n);
+      ivector(0) -= extractor_.PriorOffset();
+      KALDI_VLOG(2) << "Ivector norm for utterance " << utts_[n]
+                    << " was " << ivector.Norm(2.0);
+      writer_->Write(utts_[n], Vector<BaseFloat>(ivector));
     }
-    // We actually write out the offset of the iVectors from the mean of the
-    // prior distribution; this is the form we'll need it in for scoring.  (most
-    // formulations of iVectors have zero-mean priors so this is not normally an
-    // issue).
-    ivector_(0) -= extractor_.PriorOffset();
-    KALDI_VLOG(2) << "Ivector norm for utterance " << utt_
-                  << " was " << ivector_.Norm(2.0);
-    writer_->Write(utt_, Vector<BaseFloat>(ivector_));
   }
  private:
   const IvectorExtractor &extractor_;
-  std::string utt_;
-  Matrix<BaseFloat> feats_;
-  Posterior posterior_;
   BaseFloatVectorWriter *writer_;
   double *tot_auxf_change_; // if non-NULL we need the auxf change.
-  Vector<double> ivector_;
-  double auxf_change_;
+  std::vector<std::string> utts_;
+  std::vector<Matrix<BaseFloat>*> feats_;
+  std::vector<Posterior> posteriors_;
+  std::vector<double> num_frames_;
+  Matrix<double> ivectors_;
+  Vector<double> auxf_changes_;
 };
 
 int32 RunPerSpeaker(const std::string &ivector_extractor_rxfilename,
@@ -225,6 +243,7 @@ int main(int argc, char *argv[]) {
     bool compute_objf_change = true;
     IvectorEstimationOptions opts;
     std::string spk2utt_rspecifier;
+    int32 batch_size = 32;
     TaskSequencerConfig sequencer_config;
     po.Register("compute-objf-change", &compute_objf_change,
                 "If true, compute the change in objective function from using "
@@ -236,6 +255,9 @@ int main(int argc, char *argv[]) {
                 "is not the normal way iVectors are obtained for speaker-id. "
                 "This option will cause the program to ignore the --num-threads "
                 "option.");
+    po.Register("batch-size", &batch_size, "Number of utterances whose "
+                "iVectors are estimated together; larger values are faster "
+                "but use more memory.  Ignored with --spk2utt.");
 
     opts.Register(&po);
     sequencer_config.Register(&po);
@@ -246,6 +268,7 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    KALDI_ASSERT(batch_size > 0);
 
     std::string ivector_extractor_rxfilename = po.GetArg(1),
         feature_rspecifier = po.GetArg(2),
@@ -269,6 +292,7 @@ int main(int argc, char *argv[]) {
 
       {
         TaskSequencer<IvectorExtractTask> sequencer(sequencer_config);
+        IvectorExtractTask *task = NULL;
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
           if (!posterior_reader.HasKey(utt)) {
@@ -302,12 +326,20 @@ int main(int argc, char *argv[]) {
                          &posterior);
           // note: now, this_t == sum of posteriors.
 
-          sequencer.Run(new IvectorExtractTask(extractor, utt, mat, posterior,
-                                               &ivector_writer, auxf_ptr));
+          if (task == NULL)
+            task = new IvectorExtractTask(extractor, &ivector_writer,
+                                          auxf_ptr);
+          task->AddUtterance(utt, mat, posterior);
+          if (task->NumUtterances() >= batch_size) {
+            sequencer.Run(task);
+            task = NULL;
+          }
 
           tot_t += this_t;
           num_done++;
         }
+        if (task != NULL)
+          sequencer.Run(task);
         // Destructor of "sequencer" will wait for any remaining tasks.
       }
 
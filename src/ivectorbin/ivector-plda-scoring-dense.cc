@@ -197,12 +197,14 @@ int main(int argc, char *argv[]) {
           ivector_mat_pca.Resize(ivector_mat.NumRows(), ivector_mat.NumCols());
           ivector_mat_pca.CopyFromMat(ivector_mat);
         }
-        for (int32 i = 0; i < ivector_mat_plda.NumRows(); i++) {
-          for (int32 j = 0; j < ivector_mat_plda.NumRows(); j++) {
-            scores(i, j) = this_plda.LogLikelihoodRatio(Vector<double>(
-              ivector_mat_plda.Row(i)), 1.0,
-              Vector<double>(ivector_mat_plda.Row(j)));
-          }
+        if (ivector_mat_plda.NumRows() != 0) {
+          // Score all pairs at once.  With one utterance per "train" iVector,
+          // the log-likelihood ratio is symmetric in its two arguments, so it
+          // doesn't matter which side we treat as the train iVectors.
+          PldaBatchScorer<BaseFloat> scorer(
+              this_plda, ivector_mat_plda,
+              std::vector<int32>(ivector_mat_plda.NumRows(), 1));
+          scorer.Score(ivector_mat_plda, &scores);
         }
         scores_writer.Write(reco, scores);
         num_reco_done++;
@@ -0,0 +1,196 @@
+// ivectorbin/ivector-plda-scoring-top-k.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "ivector/plda.h"
+
+namespace kaldi {
+
+// Reads the iVectors from "ivector_rspecifier", transforms them with the PLDA
+// model and puts them in the rows of "transformed_ivectors".  If
+// "num_utts_rspecifier" is nonempty, it reads the number of utterances for
+// each iVector from there (iVectors with no such entry are skipped with a
+// warning); otherwise the number of utterances is 1.  Returns the number of
+// iVectors read.
+int32 ReadAndTransformIvectors(const Plda &plda,
+                               const PldaConfig &plda_config,
+                               const std::string &ivector_rspecifier,
+                               const std::string &num_utts_rspecifier,
+                               std::vector<std::string> *keys,
+                               std::vector<int32> *num_utts,
+                               Matrix<double> *transformed_ivectors) {
+  SequentialBaseFloatVectorReader ivector_reader(ivector_rspecifier);
+  RandomAccessInt32Reader num_utts_reader(num_utts_rspecifier);
+  int32 dim = plda.Dim(), num_err = 0;
+  double tot_renorm_scale = 0.0;
+  std::vector<Vector<double>*> ivectors;
+  for (; !ivector_reader.Done(); ivector_reader.Next()) {
+    std::string key = ivector_reader.Key();
+    int32 this_num_utts = 1;
+    if (!num_utts_rspecifier.empty()) {
+      if (!num_utts_reader.HasKey(key)) {
+        KALDI_WARN << "Number of utterances not given for speaker " << key;
+        num_err++;
+        continue;
+      }
+      this_num_utts = num_utts_reader.Value(key);
+    }
+    Vector<double> ivector(ivector_reader.Value());
+    Vector<double> *transformed_ivector = new Vector<double>(dim);
+    tot_renorm_scale += plda.TransformIvector(plda_config, ivector,
+                                              this_num_utts,
+                                              transformed_ivector);
+    keys->push_back(key);
+    num_utts->push_back(this_num_utts);
+    ivectors.push_back(transformed_ivector);
+  }
+  int32 num_ivectors = ivectors.size();
+  transformed_ivectors->Resize(num_ivectors, dim);
+  for (int32 i = 0; i < num_ivectors; i++)
+    transformed_ivectors->Row(i).CopyFromVec(*(ivectors[i]));
+  DeletePointers(&ivectors);
+  KALDI_LOG << "Read " << num_ivectors << " iVectors from "
+            << ivector_rspecifier << ", errors on " << num_err
+            << "; average renormalization scale was "
+            << (tot_renorm_scale / std::max(num_ivectors, 1));
+  return num_ivectors;
+}
+
+template<class Real>
+void ScoreTopK(const Plda &plda,
+               const Matrix<double> &transformed_train_ivectors,
+               const std::vector<int32> &num_train_utts,
+               const Matrix<double> &transformed_test_ivectors,
+               int32 top_k, int32 block_size,
+               std::vector<std::vector<std::pair<BaseFloat, int32> > > *ans) {
+  Matrix<Real> train_ivectors(transformed_train_ivectors),
+      test_ivectors(transformed_test_ivectors);
+  PldaBatchScorer<Real> scorer(plda, train_ivectors, num_train_utts);
+  std::vector<std::vector<std::pair<Real, int32> > > top_scores;
+  scorer.ScoreTopK(test_ivectors, top_k, block_size, &top_scores);
+  ans->resize(top_scores.size());
+  for (size_t i = 0; i < top_scores.size(); i++)
+    (*ans)[i].assign(top_scores[i].begin(), top_scores[i].end());
+}
+
+}  // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  typedef kaldi::int32 int32;
+  try {
+    const char *usage =
+        "For each test iVector, finds the train (e.g. enrollment) iVectors\n"
+        "with the highest PLDA log-likelihood ratios, as computed by\n"
+        "ivector-plda-scoring.  The scores are computed in blocks using matrix\n"
+        "multiplication, without storing the whole score matrix, so this is\n"
+        "suitable for searching large numbers of speakers.\n"
+        "The output has lines of the form\n"
+        "<train-key> <test-key> <score>\n"
+        "with --top-k lines per test iVector, from best to worst.\n"
+        "\n"
+        "Usage: ivector-plda-scoring-top-k [options] <plda> "
+        "<train-ivector-rspecifier>\n"
+        " <test-ivector-rspecifier> <scores-wxfilename>\n"
+        "\n"
+        "e.g.: ivector-plda-scoring-top-k --top-k=5 "
+        "--num-utts=ark:exp/train/num_utts.ark plda\n"
+        " ark:exp/train/spk_ivectors.ark ark:exp/test/ivectors.ark scores\n"
+        "See also: ivector-plda-scoring, ivector-plda-scoring-dense\n";
+
+    ParseOptions po(usage);
+
+    std::string num_utts_rspecifier;
+    int32 top_k = 10, block_size = 1024;
+    bool double_precision = false;
+
+    PldaConfig plda_config;
+    plda_config.Register(&po);
+    po.Register("num-utts", &num_utts_rspecifier, "Table to read the number of "
+                "utterances per speaker, e.g. ark:num_utts.ark\n");
+    po.Register("top-k", &top_k, "Number of best-scoring train iVectors to "
+                "output for each test iVector.");
+    po.Register("block-size", &block_size, "Number of train and test "
+                "iVectors to score at a time; affects speed and memory use "
+                "but not the output.");
+    po.Register("double-precision", &double_precision, "If true, compute "
+                "the scores in double precision (slower).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string plda_rxfilename = po.GetArg(1),
+        train_ivector_rspecifier = po.GetArg(2),
+        test_ivector_rspecifier = po.GetArg(3),
+        scores_wxfilename = po.GetArg(4);
+
+    KALDI_ASSERT(top_k > 0 && block_size > 0);
+
+    Plda plda;
+    ReadKaldiObject(plda_rxfilename, &plda);
+
+    std::vector<std::string> train_keys, test_keys;
+    std::vector<int32> num_train_utts, num_test_utts;
+    Matrix<double> train_ivectors, test_ivectors;
+    if (ReadAndTransformIvectors(plda, plda_config, train_ivector_rspecifier,
+                                 num_utts_rspecifier, &train_keys,
+                                 &num_train_utts, &train_ivectors) == 0)
+      KALDI_ERR << "No training iVectors present.";
+    // For test iVectors, the number of utterances is always 1 (this affects
+    // the length normalization in TransformIvector()).
+    if (ReadAndTransformIvectors(plda, plda_config, test_ivector_rspecifier,
+                                 "", &test_keys, &num_test_utts,
+                                 &test_ivectors) == 0)
+      KALDI_ERR << "No test iVectors present.";
+
+    std::vector<std::vector<std::pair<BaseFloat, int32> > > top_scores;
+    if (double_precision)
+      ScoreTopK<double>(plda, train_ivectors, num_train_utts, test_ivectors,
+                        top_k, block_size, &top_scores);
+    else
+      ScoreTopK<float>(plda, train_ivectors, num_train_utts, test_ivectors,
+                       top_k, block_size, &top_scores);
+
+    bool binary = false;
+    Output ko(scores_wxfilename, binary);
+    int64 num_scores = 0;
+    for (size_t i = 0; i < top_scores.size(); i++) {
+      for (size_t j = 0; j < top_scores[i].size(); j++) {
+        ko.Stream() << train_keys[top_scores[i][j].second] << ' '
+                    << test_keys[i] << ' ' << top_scores[i][j].first
+                    << std::endl;
+        num_scores++;
+      }
+    }
+    KALDI_LOG << "Wrote " << num_scores << " scores for " << test_keys.size()
+              << " test iVectors against " << train_keys.size()
+              << " train iVectors.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -27,6 +27,7 @@
 #include "lat/minimize-lattice.h"   // for minimization
 #include "lat/push-lattice.h"       // for minimization
 #include "lat/determinize-lattice-pruned.h"
+#include "base/kaldi-profile.h"
 
 namespace fst {
 
@@ -1195,6 +1196,7 @@ bool DeterminizeLatticePruned(
     double beam,
     MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > >*ofst,
     DeterminizeLatticePrunedOptions opts) {
+  KALDI_PROFILE_SCOPE("DeterminizeLatticePruned");
   ofst->SetInputSymbols(ifst.InputSymbols());
   ofst->SetOutputSymbols(ifst.OutputSymbols());
   if (ifst.NumStates() == 0) {
@@ -1246,6 +1248,7 @@ bool DeterminizeLatticePruned(const ExpandedFst<ArcTpl<Weight> > &ifst,
                               double beam,
                               MutableFst<ArcTpl<Weight> > *ofst,
                               DeterminizeLatticePrunedOptions opts) {
+  KALDI_PROFILE_SCOPE("DeterminizeLatticePruned");
   typedef int32 IntType;
   ofst->SetInputSymbols(ifst.InputSymbols());
   ofst->SetOutputSymbols(ifst.OutputSymbols());
@@ -1416,6 +1419,7 @@ bool DeterminizeLatticePhonePruned(
     double beam,
     MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > > *ofst,
     DeterminizeLatticePhonePrunedOptions opts) {
+  KALDI_PROFILE_SCOPE("DeterminizeLatticePhonePruned");
   // Returning status.
   bool ans = true;
 
@@ -1488,6 +1492,7 @@ bool DeterminizeLatticePhonePrunedWrapper(
     double beam,
     MutableFst<kaldi::CompactLatticeArc> *ofst,
     DeterminizeLatticePhonePrunedOptions opts) {
+  KALDI_PROFILE_SCOPE("DeterminizeLatticePhonePrunedWrapper");
   bool ans = true;
   Invert(ifst);
   if (ifst->Properties(fst::kTopSorted, true) == 0) {
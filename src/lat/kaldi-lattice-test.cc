@@ -65,6 +65,88 @@ void TestCompactLatticeTable(bool binary) {
   }
 }
 
+// Writes in the packed format, and reads as CompactLattice and as Lattice.
+void TestCompactLatticeTablePacked(bool quantize) {
+  g_lattice_write_options.packed = true;
+  g_lattice_write_options.quantize = (quantize ? 0.0001 : 0.0);
+  CompactLatticeWriter writer("ark:tmpf");
+  int N = 10;
+  std::vector<CompactLattice*> lat_vec(N);
+  for (int i = 0; i < N; i++) {
+    std::string key = "key" + std::to_string(i);
+    lat_vec[i] = RandCompactLattice();
+    writer.Write(key, *(lat_vec[i]));
+  }
+  writer.Close();
+  g_lattice_write_options = LatticeWriteOptions();
+
+  float delta = (quantize ? 0.001 : 0.0);
+  SequentialCompactLatticeReader reader("ark:tmpf");
+  SequentialLatticeReader reader2("ark:tmpf");
+  for (int i = 0; i < N; i++, reader.Next(), reader2.Next()) {
+    KALDI_ASSERT(!reader.Done() && !reader2.Done());
+    KALDI_ASSERT(fst::Equal(reader.Value(), *(lat_vec[i]), delta));
+    CompactLattice clat2;
+    ConvertLattice(reader2.Value(), &clat2);
+    KALDI_ASSERT(fst::Equal(clat2, *(lat_vec[i]), delta));
+    delete lat_vec[i];
+  }
+  KALDI_ASSERT(reader.Done() && reader2.Done());
+}
+
+// Creates a CompactLattice that looks like the output of a decoder: word
+// labels from a large vocabulary, and transition-id strings that are runs of
+// repeated transition-ids (self-loops) of a few frames each.
+CompactLattice *DecoderLikeCompactLattice() {
+  CompactLattice *clat = new CompactLattice;
+  int32 num_states = RandInt(100, 300);
+  for (int32 s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(0);
+  for (int32 s = 0; s + 1 < num_states; s++) {
+    int32 num_arcs = RandInt(1, 3);
+    for (int32 i = 0; i < num_arcs; i++) {
+      int32 next_state = std::min(num_states - 1, s + RandInt(1, 3)),
+          word = RandInt(0, 4) == 0 ? 0 : RandInt(1, 50000);
+      std::vector<int32> tids;
+      int32 num_phones = RandInt(1, 5);
+      for (int32 p = 0; p < num_phones; p++)
+        tids.insert(tids.end(), RandInt(1, 8), RandInt(1, 10000));
+      LatticeWeight weight(10.0 * RandUniform(), 100.0 * RandUniform());
+      clat->AddArc(s, CompactLatticeArc(word, word,
+                                        CompactLatticeWeight(weight, tids),
+                                        next_state));
+    }
+  }
+  clat->SetFinal(num_states - 1, CompactLatticeWeight::One());
+  return clat;
+}
+
+// Checks that the packed format is smaller than the OpenFst format and reads
+// back correctly, and logs both sizes.
+void TestPackedLatticeSize(bool quantize) {
+  CompactLattice *clat = DecoderLikeCompactLattice();
+  std::ostringstream openfst_os, packed_os;
+  KALDI_ASSERT(WriteCompactLattice(openfst_os, true, *clat));
+  g_lattice_write_options.packed = true;
+  g_lattice_write_options.quantize = (quantize ? 0.001 : 0.0);
+  KALDI_ASSERT(WriteCompactLattice(packed_os, true, *clat));
+  g_lattice_write_options = LatticeWriteOptions();
+  std::string openfst_str = openfst_os.str(), packed_str = packed_os.str();
+  KALDI_ASSERT(packed_str.size() < openfst_str.size());
+
+  std::istringstream packed_is(packed_str);
+  CompactLattice *clat2 = NULL;
+  KALDI_ASSERT(ReadCompactLattice(packed_is, true, &clat2));
+  KALDI_ASSERT(fst::Equal(*clat2, *clat, (quantize ? 0.01 : 0.0)));
+  delete clat2;
+  KALDI_LOG << "CompactLattice with " << clat->NumStates() << " states: "
+            << "OpenFst format " << openfst_str.size() << " bytes, packed "
+            << (quantize ? "(quantized) " : "") << packed_str.size()
+            << " bytes.";
+  delete clat;
+}
+
 // Write as CompactLattice, read as Lattice.
 void TestCompactLatticeTableCross(bool binary) {
   CompactLatticeWriter writer(binary ? "ark:tmpf" : "ark,t:tmpf");
@@ -167,6 +249,11 @@ int main() {
     TestLatticeTable(binary);
     TestLatticeTableCross(binary);
   }
+  for (int i = 0; i < 2; i++) {
+    bool quantize = (i%2 == 0);
+    TestCompactLatticeTablePacked(quantize);
+    TestPackedLatticeSize(quantize);
+  }
   std::cout << "Test OK\n";
   
   unlink("tmpf");
@@ -19,6 +19,8 @@
 // limitations under the License.
 
 
+#include <cmath>
+#include <cstring>
 #include "lat/kaldi-lattice.h"
 #include "fst/script/print-impl.h"
 
@@ -58,10 +60,265 @@ Lattice* ConvertToLattice(Lattice *ifst) {
   return ifst;
 }
 
+LatticeWriteOptions g_lattice_write_options;
+
+// The token that begins a CompactLattice in the packed format.  The binary
+// OpenFst format starts with a magic number whose first byte is 214, and the
+// text format starts with whitespace, so the readers can tell them apart from
+// the first character.
+static const char *kPackedLatticeToken = "<PackedCLat>";
+
+namespace {
+
+// The following are for the packed lattice format.
+inline void WriteVarint(uint64 x, std::string *buf) {
+  while (x >= 128) {
+    buf->push_back(static_cast<char>((x & 127) | 128));
+    x >>= 7;
+  }
+  buf->push_back(static_cast<char>(x));
+}
+
+// Uses zigzag coding, so small negative numbers take few bytes.
+inline void WriteSignedVarint(int64 x, std::string *buf) {
+  WriteVarint((static_cast<uint64>(x) << 1) ^ static_cast<uint64>(x >> 63),
+              buf);
+}
+
+// Reads the packed format from memory, checking that we don't go past the end.
+class PackedLatticeReader {
+ public:
+  PackedLatticeReader(const char *begin, const char *end):
+      cur_(begin), end_(end), ok_(true) { }
+
+  uint64 Varint() {
+    uint64 ans = 0;
+    for (int32 shift = 0; shift < 64 && cur_ != end_; shift += 7) {
+      unsigned char c = *(cur_++);
+      ans |= static_cast<uint64>(c & 127) << shift;
+      if (!(c & 128))
+        return ans;
+    }
+    ok_ = false;
+    return 0;
+  }
+  int64 SignedVarint() {
+    uint64 x = Varint();
+    return static_cast<int64>(x >> 1) ^ -static_cast<int64>(x & 1);
+  }
+  float Float() {
+    float f = 0.0;
+    if (end_ - cur_ < static_cast<ptrdiff_t>(sizeof(f))) {
+      ok_ = false;
+    } else {
+      memcpy(&f, cur_, sizeof(f));
+      cur_ += sizeof(f);
+    }
+    return f;
+  }
+  // Returns true if at least "n" bytes are left (used to check sizes before
+  // allocating memory).
+  bool HasBytes(uint64 n) const {
+    return static_cast<uint64>(end_ - cur_) >= n;
+  }
+  bool Ok() const { return ok_; }
+  bool AtEnd() const { return cur_ == end_; }
+ private:
+  const char *cur_;
+  const char *end_;
+  bool ok_;
+};
+
+// Returns true if all the costs in the lattice, divided by "quantize", can be
+// stored as integers.
+bool CanQuantize(const CompactLattice &clat, BaseFloat quantize) {
+  typedef CompactLattice::StateId StateId;
+  double limit = 1.0e+15 * quantize;
+  for (StateId s = 0; s < clat.NumStates(); s++) {
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const LatticeWeight &w = aiter.Value().weight.Weight();
+      if (!(std::abs(w.Value1()) < limit && std::abs(w.Value2()) < limit))
+        return false;  // note: this is also false for infinities and NaN.
+    }
+    const LatticeWeight &w = clat.Final(s).Weight();
+    if (clat.Final(s) != CompactLatticeWeight::Zero() &&
+        !(std::abs(w.Value1()) < limit && std::abs(w.Value2()) < limit))
+      return false;
+  }
+  return true;
+}
+
+void WritePackedWeight(const CompactLatticeWeight &weight,
+                       BaseFloat quantize, std::string *buf) {
+  const LatticeWeight &w = weight.Weight();
+  if (quantize > 0.0) {
+    WriteSignedVarint(static_cast<int64>(std::floor(w.Value1() / quantize
+                                                    + 0.5)), buf);
+    WriteSignedVarint(static_cast<int64>(std::floor(w.Value2() / quantize
+                                                    + 0.5)), buf);
+  } else {
+    float values[2] = { w.Value1(), w.Value2() };
+    buf->append(reinterpret_cast<const char*>(values), sizeof(values));
+  }
+  const std::vector<int32> &str = weight.String();
+  WriteVarint(str.size(), buf);
+  int32 prev = 0;  // Successive transition-ids are often the same (self-loops).
+  for (size_t i = 0; i < str.size(); i++) {
+    WriteSignedVarint(static_cast<int64>(str[i]) - prev, buf);
+    prev = str[i];
+  }
+}
+
+bool ReadPackedWeight(BaseFloat quantize, PackedLatticeReader *reader,
+                      CompactLatticeWeight *weight) {
+  LatticeWeight w;
+  if (quantize > 0.0) {
+    int64 v1 = reader->SignedVarint(), v2 = reader->SignedVarint();
+    w.SetValue1(v1 * quantize);
+    w.SetValue2(v2 * quantize);
+  } else {
+    float v1 = reader->Float(), v2 = reader->Float();
+    w.SetValue1(v1);
+    w.SetValue2(v2);
+  }
+  uint64 len = reader->Varint();
+  if (!reader->Ok() || !reader->HasBytes(len))
+    return false;
+  std::vector<int32> str(len);
+  int64 prev = 0;
+  for (uint64 i = 0; i < len; i++) {
+    prev += reader->SignedVarint();
+    str[i] = static_cast<int32>(prev);
+  }
+  *weight = CompactLatticeWeight(w, str);
+  return reader->Ok();
+}
+
+}  // namespace
+
+static bool WritePackedCompactLattice(std::ostream &os,
+                                      const CompactLattice &clat,
+                                      BaseFloat quantize) {
+  typedef CompactLattice::StateId StateId;
+  if (quantize > 0.0 && !CanQuantize(clat, quantize))
+    quantize = 0.0;  // can't quantize, e.g. because of infinite costs.
+  // We first write the whole thing to memory, which is faster than writing to
+  // the stream, and lets us write the size so the reader can read it in one go.
+  std::string buf;
+  StateId num_states = clat.NumStates();
+  WriteVarint(num_states, &buf);
+  WriteVarint(clat.Start() + 1, &buf);  // Start() may be kNoStateId = -1.
+  for (StateId s = 0; s < num_states; s++) {
+    WriteVarint(clat.NumArcs(s), &buf);
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      WriteSignedVarint(static_cast<int64>(arc.nextstate) - s, &buf);
+      WriteVarint(static_cast<uint32>(arc.ilabel), &buf);
+      WriteSignedVarint(static_cast<int64>(arc.olabel) - arc.ilabel, &buf);
+      WritePackedWeight(arc.weight, quantize, &buf);
+    }
+    CompactLatticeWeight final_weight = clat.Final(s);
+    if (final_weight == CompactLatticeWeight::Zero()) {
+      buf.push_back(0);
+    } else {
+      buf.push_back(1);
+      WritePackedWeight(final_weight, quantize, &buf);
+    }
+  }
+  WriteToken(os, true, kPackedLatticeToken);
+  WriteBasicType(os, true, quantize);
+  WriteBasicType(os, true, static_cast<int64>(buf.size()));
+  os.write(buf.data(), buf.size());
+  return os.good();
+}
+
+static CompactLattice *ReadPackedCompactLattice(std::istream &is) {
+  typedef CompactLattice::StateId StateId;
+  BaseFloat quantize;
+  int64 size;
+  std::vector<char> buf;
+  try {
+    ExpectToken(is, true, kPackedLatticeToken);
+    ReadBasicType(is, true, &quantize);
+    ReadBasicType(is, true, &size);
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error reading packed compact lattice header.";
+    return NULL;
+  }
+  if (size < 0) {
+    KALDI_WARN << "Error reading packed compact lattice: invalid size " << size;
+    return NULL;
+  }
+  buf.resize(size);
+  if (size > 0 && !is.read(&(buf[0]), size)) {
+    KALDI_WARN << "Error reading packed compact lattice: unexpected end of "
+               << "stream.";
+    return NULL;
+  }
+  PackedLatticeReader reader(buf.data(), buf.data() + buf.size());
+  CompactLattice *clat = new CompactLattice();
+  uint64 num_states = reader.Varint();
+  // Each state takes at least 2 bytes; check before allocating.
+  bool ok = reader.HasBytes(2 * num_states);
+  if (ok) {
+    clat->ReserveStates(num_states);
+    for (uint64 s = 0; s < num_states; s++)
+      clat->AddState();
+    int64 start = static_cast<int64>(reader.Varint()) - 1;
+    if (start >= static_cast<int64>(num_states))
+      ok = false;
+    else if (start >= 0)
+      clat->SetStart(start);
+  }
+  for (StateId s = 0; ok && s < static_cast<StateId>(num_states); s++) {
+    uint64 num_arcs = reader.Varint();
+    if (!reader.HasBytes(num_arcs)) {
+      ok = false;
+      break;
+    }
+    clat->ReserveArcs(s, num_arcs);
+    CompactLatticeArc arc;
+    for (uint64 a = 0; a < num_arcs; a++) {
+      int64 nextstate = s + reader.SignedVarint();
+      arc.ilabel = static_cast<int32>(static_cast<uint32>(reader.Varint()));
+      arc.olabel = static_cast<int32>(arc.ilabel + reader.SignedVarint());
+      if (nextstate < 0 || nextstate >= static_cast<int64>(num_states) ||
+          !ReadPackedWeight(quantize, &reader, &arc.weight)) {
+        ok = false;
+        break;
+      }
+      arc.nextstate = nextstate;
+      clat->AddArc(s, arc);
+    }
+    if (!ok || !reader.HasBytes(1)) {
+      ok = false;
+      break;
+    }
+    if (reader.Varint() != 0) {
+      CompactLatticeWeight final_weight;
+      if (!ReadPackedWeight(quantize, &reader, &final_weight))
+        ok = false;
+      else
+        clat->SetFinal(s, final_weight);
+    }
+  }
+  if (!ok || !reader.Ok() || !reader.AtEnd()) {
+    KALDI_WARN << "Error reading packed compact lattice: corrupted data.";
+    delete clat;
+    return NULL;
+  }
+  return clat;
+}
+
+
 
 bool WriteCompactLattice(std::ostream &os, bool binary,
                          const CompactLattice &t) {
-  if (binary) {
+  if (binary && g_lattice_write_options.packed) {
+    return WritePackedCompactLattice(os, t, g_lattice_write_options.quantize);
+  } else if (binary) {
     fst::FstWriteOptions opts;
     // Leave all the options default.  Normally these lattices wouldn't have any
     // osymbols/isymbols so no point directing it not to write them (who knows what
@@ -304,7 +561,10 @@ Lattice *ReadLatticeText(std::istream &is) {
 bool ReadCompactLattice(std::istream &is, bool binary,
                         CompactLattice **clat) {
   KALDI_ASSERT(*clat == NULL);
-  if (binary) {
+  if (binary && is.peek() == kPackedLatticeToken[0]) {
+    *clat = ReadPackedCompactLattice(is);  // will warn on error.
+    return (*clat != NULL);
+  } else if (binary) {
     fst::FstHeader hdr;
     if (!hdr.Read(is, "<unknown>")) {
       KALDI_WARN << "Reading compact lattice: error reading FST header.";
@@ -374,6 +634,8 @@ bool CompactLatticeHolder::Read(std::istream &is) {
     // cannot begin with space because it starts with the FST Type() which is not
     // space).
     return ReadCompactLattice(is, false, &t_);
+  } else if (c == kPackedLatticeToken[0]) {  // packed format.
+    return ReadCompactLattice(is, true, &t_);
   } else if (c != 214) { // 214 is first char of FST magic number,
     // on little-endian machines which is all we support (\326 octal)
     KALDI_WARN << "Reading compact lattice: does not appear to be an FST "
@@ -417,7 +679,11 @@ bool WriteLattice(std::ostream &os, bool binary, const Lattice &t) {
 bool ReadLattice(std::istream &is, bool binary,
                  Lattice **lat) {
   KALDI_ASSERT(*lat == NULL);
-  if (binary) {
+  if (binary && is.peek() == kPackedLatticeToken[0]) {
+    // note: ConvertToLattice frees its input.
+    *lat = ConvertToLattice(ReadPackedCompactLattice(is));
+    return (*lat != NULL);
+  } else if (binary) {
     fst::FstHeader hdr;
     if (!hdr.Read(is, "<unknown>")) {
       KALDI_WARN << "Reading lattice: error reading FST header.";
@@ -490,6 +756,8 @@ bool LatticeHolder::Read(std::istream &is) {
     // cannot begin with space because it starts with the FST Type() which is not
     // space).
     return ReadLattice(is, false, &t_);
+  } else if (c == kPackedLatticeToken[0]) {  // packed format.
+    return ReadLattice(is, true, &t_);
   } else if (c != 214) { // 214 is first char of FST magic number,
     // on little-endian machines which is all we support (\326 octal)
     KALDI_WARN << "Reading compact lattice: does not appear to be an FST "
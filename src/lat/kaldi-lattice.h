@@ -51,13 +51,44 @@ typedef fst::VectorFst<CompactLatticeArc> CompactLattice;
 // functions return false on stream failure rather than throwing an exception as
 // most similar Kaldi functions would do.
 
+/// Options that control how WriteCompactLattice() writes in binary mode.  By
+/// default it uses OpenFst's binary format, so that lattices written to single
+/// files can be read by OpenFst tools.  The "packed" format is Kaldi-specific:
+/// it codes the state ids as differences from the source state, and the labels,
+/// transition-id strings (as differences between successive transition-ids)
+/// and optionally the costs as variable-length integers.  This is typically
+/// several times smaller and faster to read.  The readers detect the format
+/// automatically, so archives may contain both.
+struct LatticeWriteOptions {
+  bool packed;  // If true, write CompactLattices in the packed format.
+  BaseFloat quantize;  // If >0 (packed format only), costs are rounded to
+                       // multiples of this; 0 means they are written exactly.
+
+  LatticeWriteOptions(): packed(false), quantize(0.0) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("packed-lattices", &packed, "If true, write compact "
+                   "lattices in binary mode in Kaldi's packed format, which "
+                   "is smaller and faster to read than the OpenFst format but "
+                   "can't be read by OpenFst tools or older versions of Kaldi.");
+    opts->Register("lattice-quantize", &quantize, "With --packed-lattices, "
+                   "if >0, round the graph and acoustic costs to multiples of "
+                   "this value (e.g. 0.001) to save space.");
+  }
+};
+
+/// The options used by WriteCompactLattice(); programs that write lattices
+/// may register them with g_lattice_write_options.Register(&po).
+extern LatticeWriteOptions g_lattice_write_options;
+
 bool WriteCompactLattice(std::ostream &os, bool binary,
                          const CompactLattice &clat);
 bool WriteLattice(std::ostream &os, bool binary,
                   const Lattice &lat);
 
 // the following function requires that *clat be
-// NULL when called.
+// NULL when called.  In binary mode it reads both the OpenFst format and the
+// packed format (see LatticeWriteOptions).
 bool ReadCompactLattice(std::istream &is, bool binary,
                         CompactLattice **clat);
 // the following function requires that *lat be
@@ -166,6 +166,7 @@ int main(int argc, char *argv[]) {
                 "whose lattices will be excluded");
     po.Register("ignore-missing", &ignore_missing,
                 "Exit with status 0 even if no lattices are copied");
+    g_lattice_write_options.Register(&po);
 
     po.Read(argc, argv);
 
@@ -61,6 +61,7 @@ int main(int argc, char *argv[]) {
     po.Register("minimize", &minimize,
                 "If true, push and minimize after determinization");
     opts.Register(&po);
+    g_lattice_write_options.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
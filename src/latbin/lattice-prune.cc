@@ -48,7 +48,8 @@ int main(int argc, char *argv[]) {
     po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way of setting the "
                 "acoustic scale: you can set its inverse.");
     po.Register("beam", &beam, "Pruning beam [applied after acoustic scaling]");
-    
+    g_lattice_write_options.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
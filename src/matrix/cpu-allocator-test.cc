@@ -0,0 +1,153 @@
+// matrix/cpu-allocator-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "matrix/cpu-allocator.h"
+#include "matrix/kaldi-matrix.h"
+#include "matrix/sp-matrix.h"
+
+namespace kaldi {
+
+static void UnitTestCpuMallocAlignment() {
+  for (int32 i = 0; i < 2; i++) {
+    g_cpu_allocator_options.cache_memory = (i == 1);
+    std::vector<void*> ptrs;
+    for (int32 j = 0; j < 100; j++) {
+      size_t size = 1 + Rand() % (j < 50 ? 300 : 100000);
+      void *ptr = CpuMalloc(size);
+      KALDI_ASSERT(ptr != NULL &&
+                   reinterpret_cast<size_t>(ptr) % kCpuMemoryAlignment == 0);
+      std::memset(ptr, 0, size);
+      ptrs.push_back(ptr);
+    }
+    // Free half of them, with caching switched the other way; blocks
+    // allocated with either setting may be freed with either setting.
+    g_cpu_allocator_options.cache_memory = (i == 0);
+    for (size_t j = 0; j < ptrs.size(); j += 2)
+      CpuFree(ptrs[j]);
+    g_cpu_allocator_options.cache_memory = (i == 1);
+    for (size_t j = 1; j < ptrs.size(); j += 2)
+      CpuFree(ptrs[j]);
+  }
+  CpuFree(NULL);
+  g_cpu_allocator_options.cache_memory = false;
+}
+
+static void UnitTestCpuMallocCaching() {
+  g_cpu_allocator_options.cache_memory = true;
+  // Between 1024 and 2048 bytes the size classes are 256 bytes apart, so
+  // "size" and "size - 1" are in the same class (the one whose blocks have
+  // 1024 + 256 * (c + 1) bytes).
+  int32 c = RandInt(0, 3);
+  size_t size = 1024 + 256 * c + RandInt(2, 256);
+  void *ptr = CpuMalloc(size);
+  CpuFree(ptr);
+  CpuAllocatorStats stats1 = GetCpuAllocatorStats();
+  KALDI_ASSERT(stats1.bytes_cached >= static_cast<int64>(size));
+  // A request of the same size, or a slightly smaller one in the same size
+  // class, should reuse the block.
+  void *ptr2 = CpuMalloc(size);
+  KALDI_ASSERT(ptr2 == ptr);
+  CpuFree(ptr2);
+  stats1 = GetCpuAllocatorStats();
+  ptr2 = CpuMalloc(size - 1);
+  KALDI_ASSERT(ptr2 == ptr);
+  CpuAllocatorStats stats2 = GetCpuAllocatorStats();
+  KALDI_ASSERT(stats2.num_system_allocations == stats1.num_system_allocations &&
+               stats2.num_user_allocations == stats1.num_user_allocations + 1 &&
+               stats2.bytes_cached < stats1.bytes_cached);
+  CpuFree(ptr2);
+
+  {  // The cache should not grow beyond max_cached_mb.
+    g_cpu_allocator_options.max_cached_mb = 1;
+    int64 max_cached = std::max<int64>(GetCpuAllocatorStats().bytes_cached,
+                                       1 << 20);
+    std::vector<void*> ptrs;
+    for (int32 i = 0; i < 20; i++)
+      ptrs.push_back(CpuMalloc(100000));
+    for (size_t i = 0; i < ptrs.size(); i++)
+      CpuFree(ptrs[i]);
+    KALDI_ASSERT(GetCpuAllocatorStats().bytes_cached <= max_cached);
+    g_cpu_allocator_options.max_cached_mb = CpuAllocatorOptions().max_cached_mb;
+  }
+  g_cpu_allocator_options.cache_memory = false;
+}
+
+// Checks that the caches of other threads are freed when they exit.
+static void UnitTestCpuMallocThreads() {
+  g_cpu_allocator_options.cache_memory = true;
+  int64 bytes_cached = GetCpuAllocatorStats().bytes_cached;
+  std::vector<std::thread> threads;
+  for (int32 i = 0; i < 4; i++) {
+    threads.push_back(std::thread([]() {
+          for (int32 j = 0; j < 100; j++) {
+            Matrix<BaseFloat> m(10 + Rand() % 20, 10 + Rand() % 20);
+            m.SetRandn();
+            Vector<BaseFloat> v(m.NumCols());
+            v.AddRowSumMat(1.0, m);
+          }
+        }));
+  }
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  KALDI_ASSERT(GetCpuAllocatorStats().bytes_cached == bytes_cached);
+  g_cpu_allocator_options.cache_memory = false;
+}
+
+// Checks that the matrix code gives the same results with caching.
+template<typename Real>
+static void UnitTestMatrixWithCaching() {
+  int32 dim = 5 + Rand() % 20;
+  Matrix<Real> m(dim, dim);
+  m.SetRandn();
+  SpMatrix<Real> s1(dim), s2(dim);
+  s1.AddMat2(1.0, m, kNoTrans, 0.0);
+  s1.AddToDiag(1.0);
+  Matrix<Real> inv1(s1);
+  inv1.Invert();
+  g_cpu_allocator_options.cache_memory = true;
+  for (int32 i = 0; i < 3; i++) {
+    s2.AddMat2(1.0, m, kNoTrans, 0.0);
+    s2.AddToDiag(1.0);
+    Matrix<Real> inv2(s2);
+    inv2.Invert();
+    AssertEqual(inv1, inv2);
+    s2.Resize(dim + i);
+    s2.Resize(dim);
+  }
+  PrintCpuMemoryUsage();
+  g_cpu_allocator_options.cache_memory = false;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestCpuMallocAlignment();
+    UnitTestCpuMallocCaching();
+    UnitTestCpuMallocThreads();
+    UnitTestMatrixWithCaching<float>();
+    UnitTestMatrixWithCaching<double>();
+  }
+  KALDI_LOG << "Tests succeeded.";
+}
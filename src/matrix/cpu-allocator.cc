@@ -0,0 +1,233 @@
+// matrix/cpu-allocator.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <vector>
+#include "matrix/cpu-allocator.h"
+
+namespace kaldi {
+
+CpuAllocatorOptions g_cpu_allocator_options;
+
+namespace {
+
+// Blocks that may be cached (those allocated while caching is on, of a size
+// we cache) start with a header of kCpuMemoryAlignment bytes, which records
+// their size class.  Other blocks have no header.  We tell them apart by the
+// address: all blocks come from the system aligned to kBlockAlignment (twice
+// kCpuMemoryAlignment), so the memory we return is at an odd multiple of
+// kCpuMemoryAlignment if and only if there is a header before it.  This makes
+// it safe to switch caching on or off at any time, while not adding any
+// overhead when caching is off.
+struct BlockHeader {
+  int32 size_class;
+};
+const size_t kHeaderBytes = kCpuMemoryAlignment;
+const size_t kBlockAlignment = 2 * kCpuMemoryAlignment;
+
+inline bool HasHeader(void *ptr) {
+  return reinterpret_cast<size_t>(ptr) % kBlockAlignment != 0;
+}
+
+// Sizes up to 256 bytes are rounded up to a multiple of 64 (classes 0 to 3);
+// above that, there are 4 classes per power of 2, up to 2^40 bytes.
+const int32 kNumSizeClasses = 4 + 4 * 32;
+
+// Returns the size class for a request of "size" bytes and sets "rounded_size"
+// to the size of the blocks of that class; returns kNumSizeClasses or more if
+// the request is too large to cache.
+inline int32 GetSizeClass(size_t size, size_t *rounded_size) {
+  if (size <= 256) {
+    int32 c = (size == 0 ? 0 : (size - 1) / 64);
+    *rounded_size = 64 * (c + 1);
+    return c;
+  }
+  size_t s = size - 1;
+  int32 k = 0;  // will be the index of the highest set bit of s; k >= 8.
+  while ((s >> k) > 1) k++;
+  size_t step = static_cast<size_t>(1) << (k - 2),
+      sub = s >> (k - 2);  // 4 <= sub <= 7.
+  *rounded_size = (sub + 1) * step;
+  return 4 + 4 * (k - 8) + static_cast<int32>(sub - 4);
+}
+
+// Returns the size of the blocks of a size class; the inverse of
+// GetSizeClass().
+inline size_t SizeClassBytes(int32 size_class) {
+  if (size_class < 4)
+    return 64 * (size_class + 1);
+  int32 k = 8 + (size_class - 4) / 4, sub = 4 + (size_class - 4) % 4;
+  return static_cast<size_t>(sub + 1) << (k - 2);
+}
+
+// Allocates a block with no header.
+inline void* SystemMalloc(size_t size) {
+  void *temp;
+  return KALDI_MEMALIGN(kBlockAlignment, size, &temp);
+}
+
+// Allocates a block with a header recording its size class.
+inline void* SystemMallocWithHeader(size_t size, int32 size_class) {
+  void *base;
+  if ((base = SystemMalloc(size + kHeaderBytes)) == NULL)
+    return NULL;
+  static_cast<BlockHeader*>(base)->size_class = size_class;
+  return static_cast<char*>(base) + kHeaderBytes;
+}
+
+std::atomic<int64> g_num_user_allocations(0);
+std::atomic<int64> g_num_system_allocations(0);
+std::atomic<int64> g_bytes_cached(0);
+
+// The cached blocks of one thread.  The statistics are kept per thread and
+// added to the global ones now and then, to avoid contention.
+class ThreadCache {
+ public:
+  ThreadCache(): bytes_cached_(0), num_user_allocations_(0),
+                 num_system_allocations_(0), bytes_cached_change_(0) { }
+
+  void* Malloc(int32 size_class, size_t rounded_size) {
+    num_user_allocations_++;
+    std::vector<void*> &blocks = blocks_[size_class];
+    void *ans;
+    if (!blocks.empty()) {
+      ans = blocks.back();
+      blocks.pop_back();
+      bytes_cached_ -= rounded_size;
+      bytes_cached_change_ -= rounded_size;
+    } else {
+      num_system_allocations_++;
+      ans = SystemMallocWithHeader(rounded_size, size_class);
+    }
+    if (num_user_allocations_ % 1024 == 0)
+      FlushStats();
+    return ans;
+  }
+
+  // Returns false if the cache is full, in which case the caller should
+  // free the block.
+  bool Free(int32 size_class, void *ptr) {
+    size_t rounded_size = SizeClassBytes(size_class);
+    if (bytes_cached_ + rounded_size >
+        static_cast<size_t>(g_cpu_allocator_options.max_cached_mb) << 20)
+      return false;
+    blocks_[size_class].push_back(ptr);
+    bytes_cached_ += rounded_size;
+    bytes_cached_change_ += rounded_size;
+    return true;
+  }
+
+  void FlushStats() {
+    g_num_user_allocations += num_user_allocations_;
+    g_num_system_allocations += num_system_allocations_;
+    g_bytes_cached += bytes_cached_change_;
+    num_user_allocations_ = 0;
+    num_system_allocations_ = 0;
+    bytes_cached_change_ = 0;
+  }
+
+  ~ThreadCache() {
+    for (int32 c = 0; c < kNumSizeClasses; c++)
+      for (size_t i = 0; i < blocks_[c].size(); i++)
+        KALDI_MEMALIGN_FREE(static_cast<char*>(blocks_[c][i]) - kHeaderBytes);
+    bytes_cached_change_ -= bytes_cached_;
+    FlushStats();
+  }
+
+ private:
+  std::vector<void*> blocks_[kNumSizeClasses];
+  size_t bytes_cached_;
+  int64 num_user_allocations_;
+  int64 num_system_allocations_;
+  int64 bytes_cached_change_;
+};
+
+// The cache is created on first use in each thread.  thread_cache_destroyed is
+// set when it is destroyed at thread exit; memory freed after that (e.g. by
+// the destructors of static objects) goes straight back to the system.
+thread_local ThreadCache *thread_cache = NULL;
+thread_local bool thread_cache_destroyed = false;
+
+struct ThreadCacheDeleter {
+  ~ThreadCacheDeleter() {
+    delete thread_cache;
+    thread_cache = NULL;
+    thread_cache_destroyed = true;
+  }
+};
+thread_local ThreadCacheDeleter thread_cache_deleter;
+
+inline ThreadCache *GetThreadCache() {
+  if (thread_cache == NULL) {
+    if (thread_cache_destroyed)
+      return NULL;
+    (void)&thread_cache_deleter;  // make sure it is constructed.
+    thread_cache = new ThreadCache();
+  }
+  return thread_cache;
+}
+
+}  // namespace
+
+
+void* CpuMalloc(size_t size) {
+  if (g_cpu_allocator_options.cache_memory) {
+    size_t rounded_size;
+    int32 size_class = GetSizeClass(size, &rounded_size);
+    ThreadCache *cache;
+    if (size_class < kNumSizeClasses && (cache = GetThreadCache()) != NULL)
+      return cache->Malloc(size_class, rounded_size);
+  }
+  return SystemMalloc(size);
+}
+
+void CpuFree(void *ptr) {
+  if (ptr == NULL) return;
+  if (!HasHeader(ptr)) {
+    KALDI_MEMALIGN_FREE(ptr);
+    return;
+  }
+  char *base = static_cast<char*>(ptr) - kHeaderBytes;
+  int32 size_class = reinterpret_cast<BlockHeader*>(base)->size_class;
+  if (g_cpu_allocator_options.cache_memory) {
+    ThreadCache *cache = GetThreadCache();
+    if (cache != NULL && cache->Free(size_class, ptr))
+      return;
+  }
+  KALDI_MEMALIGN_FREE(base);
+}
+
+CpuAllocatorStats GetCpuAllocatorStats() {
+  if (thread_cache != NULL)
+    thread_cache->FlushStats();
+  CpuAllocatorStats ans;
+  ans.num_user_allocations = g_num_user_allocations;
+  ans.num_system_allocations = g_num_system_allocations;
+  ans.bytes_cached = g_bytes_cached;
+  return ans;
+}
+
+void PrintCpuMemoryUsage() {
+  CpuAllocatorStats stats = GetCpuAllocatorStats();
+  KALDI_LOG << "CPU memory cache: " << stats.num_system_allocations << '/'
+            << stats.num_user_allocations << " allocations went to the "
+            << "system; " << stats.bytes_cached << " bytes currently cached.";
+}
+
+}  // namespace kaldi
@@ -0,0 +1,87 @@
+// matrix/cpu-allocator.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_CPU_ALLOCATOR_H_
+#define KALDI_MATRIX_CPU_ALLOCATOR_H_
+
+#include <cstddef>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+// This file declares the functions that allocate and free the memory of the
+// CPU matrix and vector classes (Matrix, Vector and PackedMatrix).  It is the
+// CPU counterpart of CuMemoryAllocator (see ../cudamatrix/cu-allocator.h):
+// programs that create and destroy a lot of temporary matrices can ask for
+// freed memory to be cached, so that most allocations don't have to go to
+// malloc().
+//
+// The cache is per thread, so no locking is needed; memory freed in one thread
+// goes into that thread's cache regardless of which thread allocated it.
+// Memory is kept in size classes (4 per power of two), so a freed block can be
+// reused for any request that rounds up to the same size.  The cache is freed
+// when its thread exits.
+
+struct CpuAllocatorOptions {
+  // If true, cache freed memory.  You can change this at any time, e.g. it is
+  // set by the standard option --cpu-memory-cache, which all programs that use
+  // ParseOptions accept.
+  bool cache_memory;
+  // The maximum amount of memory that each thread will cache, in megabytes.
+  // When a thread's cache is full, freed memory is returned to the system.
+  int32 max_cached_mb;
+
+  CpuAllocatorOptions(): cache_memory(false), max_cached_mb(256) { }
+};
+
+// The options used by CpuMalloc() and CpuFree().
+extern CpuAllocatorOptions g_cpu_allocator_options;
+
+// The required alignment of the memory returned by CpuMalloc() (enough for
+// AVX-512 loads, and the size of a cache line).
+const size_t kCpuMemoryAlignment = 64;
+
+/// Returns a pointer to "size" bytes of memory aligned to
+/// kCpuMemoryAlignment, or NULL if the allocation failed.  The memory must be
+/// freed with CpuFree(), not free().  "size" must be nonzero.
+void* CpuMalloc(size_t size);
+
+/// Frees memory allocated with CpuMalloc().  Does nothing if ptr == NULL.
+void CpuFree(void *ptr);
+
+struct CpuAllocatorStats {
+  int64 num_user_allocations;    // number of calls to CpuMalloc() while caching
+  int64 num_system_allocations;  // ... of which were not satisfied from the
+                                 // cache.
+  int64 bytes_cached;            // memory currently in the caches of all
+                                 // threads, in bytes.
+};
+
+/// Returns the statistics of the memory cache.  These are only kept while
+/// g_cpu_allocator_options.cache_memory is true.  The statistics of other
+/// threads are only added to the totals periodically, so they may be a little
+/// out of date while those threads are still running.
+CpuAllocatorStats GetCpuAllocatorStats();
+
+/// Prints the statistics from GetCpuAllocatorStats() to the log.
+void PrintCpuMemoryUsage();
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_CPU_ALLOCATOR_H_
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <string>
 #include "matrix/cblas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/sp-matrix.h"
@@ -173,11 +174,10 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
   }
   MatrixIndexT size;
   void *data;
-  void *free_data;
 
   size = dim * sizeof(Real);
 
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
+  if ((data = CpuMalloc(size)) != NULL) {
     this->data_ = static_cast<Real*> (data);
     this->dim_ = dim;
   } else {
@@ -279,7 +279,7 @@ template<typename Real>
 void Vector<Real>::Destroy() {
   /// we need to free the data block if it was defined
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    CpuFree(this->data_);
   this->data_ = NULL;
   this->dim_ = 0;
 }
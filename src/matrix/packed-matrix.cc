@@ -24,6 +24,7 @@
  * Implementation of specialized PackedMatrix template methods
  */
 #include "matrix/cblas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/packed-matrix.h"
 #include "matrix/kaldi-vector.h"
 
@@ -67,9 +68,8 @@ inline void PackedMatrix<Real>::Init(MatrixIndexT r) {
   }
 
   void *data;  // aligned memory block
-  void *temp;
 
-  if ((data = KALDI_MEMALIGN(16, size * sizeof(Real), &temp)) != NULL) {
+  if ((data = CpuMalloc(size * sizeof(Real))) != NULL) {
     this->data_ = static_cast<Real *> (data);
     this->num_rows_ = r;
   } else {
@@ -226,7 +226,7 @@ Real PackedMatrix<Real>::Trace() const {
 template<typename Real>
 void PackedMatrix<Real>::Destroy() {
   // we need to free the data block if it was defined
-  if (data_ != NULL) KALDI_MEMALIGN_FREE(data_);
+  if (data_ != NULL) CpuFree(data_);
   data_ = NULL;
   num_rows_ = 0;
 }
@@ -357,6 +357,18 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
 }
 
 
+template<typename Real>
+void SplitRadixRealFft<Real>::ComputeTwiddles() {
+  MatrixIndexT N = N_, N4 = N / 4;
+  twiddle_re_.resize(N4 + 1);
+  twiddle_im_.resize(N4 + 1);
+  for (MatrixIndexT k = 0; k <= N4; k++) {
+    double angle = M_2PI * k / N;
+    twiddle_re_[k] = std::cos(angle);
+    twiddle_im_[k] = std::sin(angle);
+  }
+}
+
 // This code is mostly the same as the RealFft function.  It would be
 // possible to replace it with more efficient code from Rico's book.
 template<typename Real>
@@ -367,13 +379,15 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward,
   if (forward) // call to base class
     SplitRadixComplexFft<Real>::Compute(data, true, temp_buffer);
 
-  Real rootN_re, rootN_im;  // exp(-2pi/N), forward; exp(2pi/N), backward
-  int forward_sign = forward ? -1 : 1;
-  ComplexImExp(static_cast<Real>(M_2PI/N *forward_sign), &rootN_re, &rootN_im);
-  Real kN_re = -forward_sign, kN_im = 0.0;  // exp(-2pik/N), forward; exp(-2pik/N), backward
-  // kN starts out as 1.0 for forward algorithm but -1.0 for backward.
+  // In the forward direction, kN = exp(-2pik/N); in the backward direction,
+  // kN = -exp(2pik/N).  [In RealFft() these are computed by repeated
+  // multiplication by exp(-2pi/N) or exp(2pi/N), starting from 1.0 or -1.0
+  // respectively.]  Writing exp(2pik/N) = c + i s, we have
+  // kN = c - i s (forward) or -c - i s (backward).
+  const Real *twiddle_re = &(twiddle_re_[0]), *twiddle_im = &(twiddle_im_[0]);
+  Real re_sign = forward ? 1.0 : -1.0;
   for (MatrixIndexT k = 1; 2*k <= N2; k++) {
-    ComplexMul(rootN_re, rootN_im, &kN_re, &kN_im);
+    Real kN_re = re_sign * twiddle_re[k], kN_im = -twiddle_im[k];
 
     Real Ck_re, Ck_im, Dk_re, Dk_im;
     // C_k = 1/2 (B_k + B_{N/2 - k}^*) :
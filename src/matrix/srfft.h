@@ -105,11 +105,12 @@ template<typename Real>
 class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
  public:
   SplitRadixRealFft(MatrixIndexT N):  // will fail unless N>=4 and N is a power of 2.
-      SplitRadixComplexFft<Real> (N/2), N_(N) { }
+      SplitRadixComplexFft<Real> (N/2), N_(N) { ComputeTwiddles(); }
 
   // Copy constructor
   SplitRadixRealFft(const SplitRadixRealFft<Real> &other):
-      SplitRadixComplexFft<Real>(other), N_(other.N_) { }
+      SplitRadixComplexFft<Real>(other), N_(other.N_),
+      twiddle_re_(other.twiddle_re_), twiddle_im_(other.twiddle_im_) { }
 
   /// If forward == true, this function transforms from a sequence of N real points to its complex fourier
   /// transform; otherwise it goes in the reverse direction.  If you call it
@@ -126,9 +127,20 @@ class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
   void Compute(Real *x, bool forward, std::vector<Real> *temp_buffer) const;
 
  private:
+  // Computes twiddle_re_ and twiddle_im_.
+  void ComputeTwiddles();
+
   // Disallow assignment.
   SplitRadixRealFft &operator =(const SplitRadixRealFft<Real> &other);
   int N_;
+  // twiddle_re_[k] = cos(2 pi k / N) and twiddle_im_[k] = sin(2 pi k / N) for
+  // 0 <= k <= N/4.  These are used in the conversion between the complex FFT
+  // of size N/2 and the real FFT of size N; precomputing them (rather than
+  // getting them by repeated complex multiplication) makes the iterations of
+  // that loop independent of each other, so the compiler can vectorize it,
+  // and it is also more accurate.
+  std::vector<Real> twiddle_re_;
+  std::vector<Real> twiddle_im_;
 };
 
 
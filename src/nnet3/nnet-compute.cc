@@ -19,11 +19,25 @@
 
 #include <iterator>
 #include <sstream>
+#include "base/kaldi-profile.h"
 #include "nnet3/nnet-compute.h"
 
 namespace kaldi {
 namespace nnet3 {
 
+// The names of the command types, in the same order as enum CommandType; these
+// are the names of the profiling scopes in ExecuteCommand().
+static const char *kCommandTypeNames[] = {
+  "kAllocMatrix", "kDeallocMatrix", "kSwapMatrix", "kSetConst",
+  "kPropagate", "kBackprop", "kBackpropNoModelUpdate",
+  "kMatrixCopy", "kMatrixAdd", "kCopyRows", "kAddRows",
+  "kCopyRowsMulti", "kCopyToRowsMulti", "kAddRowsMulti", "kAddToRowsMulti",
+  "kAddRowRanges", "kCompressMatrix", "kDecompressMatrix",
+  "kAcceptInput", "kProvideOutput",
+  "kNoOperation", "kNoOperationPermanent", "kNoOperationMarker",
+  "kNoOperationLabel", "kGotoLabel" };
+static_assert(sizeof(kCommandTypeNames) / sizeof(kCommandTypeNames[0]) ==
+              kGotoLabel + 1, "kCommandTypeNames does not match CommandType");
 
 NnetComputer::NnetComputer(const NnetComputeOptions &options,
                            const NnetComputation &computation,
@@ -209,6 +223,7 @@ NnetComputer::NnetComputer(const NnetComputer &other):
 
 void NnetComputer::ExecuteCommand() {
   const NnetComputation::Command &c = computation_.commands[program_counter_];
+  KALDI_PROFILE_SCOPE(kCommandTypeNames[c.command_type]);
   int32 m1, m2;
   try {
     switch (c.command_type) {
@@ -506,6 +521,7 @@ void NnetComputer::GetPointers(int32 indexes_multi_index,
 }
 
 void NnetComputer::Run() {
+  KALDI_PROFILE_SCOPE("NnetComputer::Run");
   const std::vector<NnetComputation::Command> &c = computation_.commands;
   int32 num_commands = c.size();
 
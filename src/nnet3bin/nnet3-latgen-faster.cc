@@ -74,6 +74,7 @@ int main(int argc, char *argv[]) {
     po.Register("online-ivector-period", &online_ivector_period, "Number of frames "
                 "between iVectors in matrices supplied to the --online-ivectors "
                 "option");
+    g_lattice_write_options.Register(&po);
 
     po.Read(argc, argv);
 
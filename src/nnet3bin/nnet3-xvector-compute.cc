@@ -25,38 +25,294 @@
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "base/timer.h"
 #include "nnet3/nnet-utils.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 namespace nnet3 {
 
-// Computes an xvector from a chunk of speech features.
-static void RunNnetComputation(const MatrixBase<BaseFloat> &features,
-    const Nnet &nnet, CachingOptimizingCompiler *compiler,
-    Vector<BaseFloat> *xvector) {
+struct BatchedXvectorComputerOptions {
+  int32 chunk_size;
+  int32 min_chunk_size;
+  bool pad_input;
+  int32 batch_size;
+
+  BatchedXvectorComputerOptions():
+      chunk_size(-1), min_chunk_size(100), pad_input(true), batch_size(1) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("chunk-size", &chunk_size,
+      "If set, extracts xectors from specified chunk-size, and averages.  "
+      "If not set, extracts an xvector from all available features.");
+    opts->Register("min-chunk-size", &min_chunk_size,
+      "Minimum chunk-size allowed when extracting xvectors.");
+    opts->Register("pad-input", &pad_input, "If true, duplicate the first and "
+      "last frames of the input features as required to equal min-chunk-size.");
+    opts->Register("batch-size", &batch_size, "Number of chunks of the same "
+      "size (possibly from different utterances) to propagate through the "
+      "network together.  Values such as 32 or 64 make much better use of a "
+      "GPU; on CPU the gain is small.");
+  }
+};
+
+// Works out how an utterance with "num_rows" frames is split into chunks.
+// Outputs a list of (first frame, number of frames) pairs; the xvector for the
+// utterance is the average of the xvectors of these chunks weighted by the
+// number of frames.  Chunks shorter than opts.min_chunk_size are either padded
+// (if opts.pad_input) or skipped.
+static void GetXvectorChunks(const BatchedXvectorComputerOptions &opts,
+                             int32 num_rows,
+                             std::vector<std::pair<int32, int32> > *chunks) {
+  int32 this_chunk_size = opts.chunk_size;
+  if (opts.chunk_size == -1 || num_rows < opts.chunk_size)
+    this_chunk_size = num_rows;
+  int32 num_chunks = ceil(num_rows / static_cast<BaseFloat>(this_chunk_size));
+  chunks->clear();
+  for (int32 chunk_indx = 0; chunk_indx < num_chunks; chunk_indx++) {
+    // If we're nearing the end of the input, we may need to shift the
+    // offset back so that we can get this_chunk_size frames of input to
+    // the nnet.
+    int32 offset = std::min(
+        this_chunk_size, num_rows - chunk_indx * this_chunk_size);
+    if (!opts.pad_input && offset < opts.min_chunk_size)
+      continue;
+    chunks->push_back(std::make_pair(chunk_indx * this_chunk_size, offset));
+  }
+}
+
+// This class computes xvectors for a sequence of utterances.  Chunks of the
+// same length, possibly from different utterances, are grouped into batches of
+// --batch-size chunks that are propagated through the network together as
+// different 'n' indexes, so that the computation uses larger matrix
+// multiplications.  The xvectors are output in the same order as the
+// utterances were given.
+class BatchedXvectorComputer {
+ public:
+  // Note: "opts", "nnet" and "compiler" are retained by reference.
+  BatchedXvectorComputer(const BatchedXvectorComputerOptions &opts,
+                         const Nnet &nnet,
+                         CachingOptimizingCompiler *compiler):
+      opts_(opts), nnet_(nnet), compiler_(compiler),
+      xvector_dim_(nnet.OutputDim("output")) {
+    KALDI_ASSERT(opts.batch_size > 0);
+  }
+
+  // Adds an utterance; it must have at least one chunk (see
+  // GetXvectorChunks()).  Computes any batches that become full.
+  void AcceptUtterance(const std::string &utt,
+                       const MatrixBase<BaseFloat> &features);
+
+  // Computes any remaining, incomplete batches; after calling this, the
+  // xvectors for all utterances will be ready.
+  void Flush();
+
+  // Returns true if the xvector for the oldest utterance not yet output is
+  // ready.
+  bool XvectorReady() const {
+    return !utterances_.empty() &&
+        utterances_.front()->num_chunks_pending == 0;
+  }
+
+  // Outputs the xvector for the oldest utterance not yet output;
+  // requires XvectorReady().
+  void OutputXvector(std::string *utt, Vector<BaseFloat> *xvector);
+
+  ~BatchedXvectorComputer() {
+    for (size_t i = 0; i < utterances_.size(); i++)
+      delete utterances_[i];
+  }
+
+ private:
+  struct UtteranceInfo {
+    std::string utt;
+    Matrix<BaseFloat> features;
+    Vector<BaseFloat> xvector_sum;  // weighted sum of the chunks' xvectors.
+    BaseFloat tot_weight;
+    int32 num_chunks_pending;
+  };
+  struct ChunkInfo {
+    UtteranceInfo *utterance;
+    int32 first_frame;
+    int32 num_frames;  // Number of frames before padding.
+  };
+
+  // Propagates the chunks in "chunks", which all have "input_length" frames
+  // after padding, through the network, adds their xvectors to their
+  // utterances and clears "chunks".
+  void ComputeBatch(int32 input_length, std::vector<ChunkInfo> *chunks);
+
+  const BatchedXvectorComputerOptions &opts_;
+  const Nnet &nnet_;
+  CachingOptimizingCompiler *compiler_;
+  int32 xvector_dim_;
+
+  // Chunks not yet computed, indexed by their length after padding.
+  std::map<int32, std::vector<ChunkInfo> > pending_chunks_;
+  // Utterances not yet output, oldest first.
+  std::deque<UtteranceInfo*> utterances_;
+};
+
+void BatchedXvectorComputer::AcceptUtterance(
+    const std::string &utt, const MatrixBase<BaseFloat> &features) {
+  std::vector<std::pair<int32, int32> > chunks;
+  GetXvectorChunks(opts_, features.NumRows(), &chunks);
+  KALDI_ASSERT(!chunks.empty());
+  if (opts_.chunk_size != -1 && features.NumRows() < opts_.chunk_size)
+    KALDI_LOG << "Chunk size of " << opts_.chunk_size << " is greater than "
+              << "the number of rows in utterance: " << utt
+              << ", using chunk size  of " << features.NumRows();
+
+  UtteranceInfo *info = new UtteranceInfo();
+  info->utt = utt;
+  info->features = features;
+  info->xvector_sum.Resize(xvector_dim_);
+  info->tot_weight = 0.0;
+  info->num_chunks_pending = chunks.size();
+  utterances_.push_back(info);
+
+  for (size_t i = 0; i < chunks.size(); i++) {
+    ChunkInfo chunk;
+    chunk.utterance = info;
+    chunk.first_frame = chunks[i].first;
+    chunk.num_frames = chunks[i].second;
+    info->tot_weight += chunk.num_frames;
+    int32 input_length = chunk.num_frames;
+    if (opts_.pad_input && input_length < opts_.min_chunk_size)
+      input_length = opts_.min_chunk_size;
+    std::vector<ChunkInfo> &batch = pending_chunks_[input_length];
+    batch.push_back(chunk);
+    if (static_cast<int32>(batch.size()) == opts_.batch_size)
+      ComputeBatch(input_length, &batch);
+  }
+}
+
+void BatchedXvectorComputer::Flush() {
+  std::map<int32, std::vector<ChunkInfo> >::iterator iter =
+      pending_chunks_.begin(), end = pending_chunks_.end();
+  for (; iter != end; ++iter)
+    if (!iter->second.empty())
+      ComputeBatch(iter->first, &(iter->second));
+  pending_chunks_.clear();
+}
+
+void BatchedXvectorComputer::OutputXvector(std::string *utt,
+                                           Vector<BaseFloat> *xvector) {
+  KALDI_ASSERT(XvectorReady());
+  UtteranceInfo *info = utterances_.front();
+  utterances_.pop_front();
+  utt->swap(info->utt);
+  xvector->Swap(&(info->xvector_sum));
+  xvector->Scale(1.0 / info->tot_weight);
+  delete info;
+}
+
+void BatchedXvectorComputer::ComputeBatch(int32 input_length,
+                                          std::vector<ChunkInfo> *chunks) {
+  int32 num_real_chunks = chunks->size(),
+      feat_dim = chunks->front().utterance->features.NumCols();
+  // Incomplete batches are padded to a power of two by repeating the last
+  // chunk, to limit the number of distinct computations we need to compile.
+  int32 num_chunks = 1;
+  while (num_chunks < num_real_chunks)
+    num_chunks *= 2;
+  num_chunks = std::min(num_chunks, opts_.batch_size);
+
+  // The input indexes are ordered with 'n' varying fastest, which lets the
+  // compiler express time offsets as contiguous ranges of rows.
   ComputationRequest request;
   request.need_model_derivative = false;
   request.store_component_stats = false;
-  request.inputs.push_back(
-    IoSpecification("input", 0, features.NumRows()));
-  IoSpecification output_spec;
-  output_spec.name = "output";
-  output_spec.has_deriv = false;
-  output_spec.indexes.resize(1);
+  request.inputs.resize(1);
+  request.inputs[0].name = "input";
+  request.inputs[0].indexes.resize(input_length * num_chunks);
+  for (int32 t = 0; t < input_length; t++)
+    for (int32 n = 0; n < num_chunks; n++)
+      request.inputs[0].indexes[t * num_chunks + n] = Index(n, t);
   request.outputs.resize(1);
-  request.outputs[0].Swap(&output_spec);
-  std::shared_ptr<const NnetComputation> computation(std::move(compiler->Compile(request)));
+  request.outputs[0].name = "output";
+  request.outputs[0].indexes.resize(num_chunks);
+  for (int32 n = 0; n < num_chunks; n++)
+    request.outputs[0].indexes[n] = Index(n, 0);
+  std::shared_ptr<const NnetComputation> computation(
+      compiler_->Compile(request));
+
+  // Copy the features, duplicating the first and last frames of chunks that
+  // need padding.
+  Matrix<BaseFloat> input(input_length * num_chunks, feat_dim, kUndefined);
+  for (int32 n = 0; n < num_chunks; n++) {
+    const ChunkInfo &chunk = (*chunks)[std::min(n, num_real_chunks - 1)];
+    const Matrix<BaseFloat> &features = chunk.utterance->features;
+    int32 left_context = (input_length - chunk.num_frames) / 2;
+    for (int32 t = 0; t < input_length; t++) {
+      int32 frame = std::max(0, std::min(chunk.num_frames - 1,
+                                         t - left_context));
+      input.Row(t * num_chunks + n).CopyFromVec(
+          features.Row(chunk.first_frame + frame));
+    }
+  }
+
   Nnet *nnet_to_update = NULL;  // we're not doing any update.
   NnetComputer computer(NnetComputeOptions(), *computation,
-                  nnet, nnet_to_update);
-  CuMatrix<BaseFloat> input_feats_cu(features);
-  computer.AcceptInput("input", &input_feats_cu);
+                        nnet_, nnet_to_update);
+  CuMatrix<BaseFloat> input_cu;
+  input_cu.Swap(&input);
+  computer.AcceptInput("input", &input_cu);
   computer.Run();
-  CuMatrix<BaseFloat> cu_output;
-  computer.GetOutputDestructive("output", &cu_output);
-  xvector->Resize(cu_output.NumCols());
-  xvector->CopyFromVec(cu_output.Row(0));
+  CuMatrix<BaseFloat> output_cu;
+  computer.GetOutputDestructive("output", &output_cu);
+  Matrix<BaseFloat> output(output_cu);
+
+  for (int32 n = 0; n < num_real_chunks; n++) {
+    const ChunkInfo &chunk = (*chunks)[n];
+    UtteranceInfo *info = chunk.utterance;
+    info->xvector_sum.AddVec(chunk.num_frames, output.Row(n));
+    if (--(info->num_chunks_pending) == 0)
+      info->features.Resize(0, 0);  // free memory.
+  }
+  chunks->clear();
 }
 
+// This class is used with TaskSequencer to compute the xvectors for a group of
+// utterances in a separate thread; the work happens in operator (), and the
+// output is written in the destructor.
+class XvectorComputeTask {
+ public:
+  XvectorComputeTask(const BatchedXvectorComputerOptions &opts,
+                     const Nnet &nnet,
+                     CachingOptimizingCompiler *compiler,
+                     BaseFloatVectorWriter *writer):
+      computer_(opts, nnet, compiler), writer_(writer) { }
+
+  void AddUtterance(const std::string &utt,
+                    const Matrix<BaseFloat> &features) {
+    utts_.push_back(utt);
+    features_.push_back(new Matrix<BaseFloat>(features));
+  }
+
+  void operator () () {
+    for (size_t i = 0; i < utts_.size(); i++) {
+      computer_.AcceptUtterance(utts_[i], *(features_[i]));
+      delete features_[i];
+      features_[i] = NULL;
+    }
+    computer_.Flush();
+  }
+
+  ~XvectorComputeTask() {
+    DeletePointers(&features_);
+    std::string utt;
+    Vector<BaseFloat> xvector;
+    while (computer_.XvectorReady()) {
+      computer_.OutputXvector(&utt, &xvector);
+      writer_->Write(utt, xvector);
+    }
+  }
+ private:
+  BatchedXvectorComputer computer_;
+  BaseFloatVectorWriter *writer_;
+  std::vector<std::string> utts_;
+  std::vector<Matrix<BaseFloat>*> features_;
+};
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -79,7 +335,10 @@ int main(int argc, char *argv[]) {
         "output layer after the statistics pooling layer.  By default, one\n"
         "xvector is extracted directly from the set of features for each\n"
         "utterance.  Optionally, xvectors are extracted from chunks of input\n"
-        "features and averaged, to produce a single vector.\n"
+        "features and averaged, to produce a single vector.  Chunks of the\n"
+        "same size from different utterances may be computed together (see\n"
+        "--batch-size), and --num-threads may be used to compute on several\n"
+        "CPU cores.\n"
         "\n"
         "Usage: nnet3-xvector-compute [options] <raw-nnet-in> "
         "<features-rspecifier> <vector-wspecifier>\n"
@@ -92,26 +351,20 @@ int main(int argc, char *argv[]) {
 
     NnetSimpleComputationOptions opts;
     CachingOptimizingCompilerOptions compiler_config;
+    BatchedXvectorComputerOptions xvector_opts;
+    TaskSequencerConfig sequencer_config;
 
     opts.acoustic_scale = 1.0; // by default do no scaling in this recipe.
 
     std::string use_gpu = "no";
-    int32 chunk_size = -1,
-      min_chunk_size = 100;
-    bool pad_input = true;
 
     opts.Register(&po);
     compiler_config.Register(&po);
+    xvector_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Register("use-gpu", &use_gpu,
       "yes|no|optional|wait, only has effect if compiled with CUDA");
-    po.Register("chunk-size", &chunk_size,
-      "If set, extracts xectors from specified chunk-size, and averages.  "
-      "If not set, extracts an xvector from all available features.");
-    po.Register("min-chunk-size", &min_chunk_size,
-      "Minimum chunk-size allowed when extracting xvectors.");
-    po.Register("pad-input", &pad_input, "If true, duplicate the first and "
-      "last frames of the input features as required to equal min-chunk-size.");
 
     po.Read(argc, argv);
 
@@ -122,6 +375,8 @@ int main(int argc, char *argv[]) {
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
+    // With --num-threads > 1, the worker threads share the GPU.
+    CuDevice::Instantiate().AllowMultithreading();
 #endif
 
     std::string nnet_rxfilename = po.GetArg(1),
@@ -140,78 +395,56 @@ int main(int argc, char *argv[]) {
 
     int32 num_success = 0, num_fail = 0;
     int64 frame_count = 0;
-    int32 xvector_dim = nnet.OutputDim("output");
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string utt = feature_reader.Key();
-      const Matrix<BaseFloat> &features (feature_reader.Value());
-      if (features.NumRows() == 0) {
-        KALDI_WARN << "Zero-length utterance: " << utt;
-        num_fail++;
-        continue;
-      }
-      int32 num_rows = features.NumRows(),
-            feat_dim = features.NumCols(),
-            this_chunk_size = chunk_size;
-      if (!pad_input && num_rows < min_chunk_size) {
-        KALDI_WARN << "Minimum chunk size of " << min_chunk_size
-                   << " is greater than the number of rows "
-                   << "in utterance: " << utt;
-        num_fail++;
-        continue;
-      } else if (num_rows < chunk_size) {
-        KALDI_LOG << "Chunk size of " << chunk_size << " is greater than "
-                  << "the number of rows in utterance: " << utt
-                  << ", using chunk size  of " << num_rows;
-        this_chunk_size = num_rows;
-      } else if (chunk_size == -1) {
-        this_chunk_size = num_rows;
-      }
+    {
+      TaskSequencer<XvectorComputeTask> sequencer(sequencer_config);
+      // Each task gets enough utterances for a few batches, so that chunks
+      // from different utterances can be batched together.
+      int32 min_chunks_per_task = 4 * xvector_opts.batch_size,
+          task_chunks = 0;
+      XvectorComputeTask *task = NULL;
+      std::vector<std::pair<int32, int32> > chunks;
 
-      int32 num_chunks = ceil(
-        num_rows / static_cast<BaseFloat>(this_chunk_size));
-      Vector<BaseFloat> xvector_avg(xvector_dim, kSetZero);
-      BaseFloat tot_weight = 0.0;
-
-      // Iterate over the feature chunks.
-      for (int32 chunk_indx = 0; chunk_indx < num_chunks; chunk_indx++) {
-        // If we're nearing the end of the input, we may need to shift the
-        // offset back so that we can get this_chunk_size frames of input to
-        // the nnet.
-        int32 offset = std::min(
-          this_chunk_size, num_rows - chunk_indx * this_chunk_size);
-        if (!pad_input && offset < min_chunk_size)
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string utt = feature_reader.Key();
+        const Matrix<BaseFloat> &features (feature_reader.Value());
+        if (features.NumRows() == 0) {
+          KALDI_WARN << "Zero-length utterance: " << utt;
+          num_fail++;
           continue;
-        SubMatrix<BaseFloat> sub_features(
-          features, chunk_indx * this_chunk_size, offset, 0, feat_dim);
-        Vector<BaseFloat> xvector;
-        tot_weight += offset;
-
-        // Pad input if the offset is less than the minimum chunk size
-        if (pad_input && offset < min_chunk_size) {
-          Matrix<BaseFloat> padded_features(min_chunk_size, feat_dim);
-          int32 left_context = (min_chunk_size - offset) / 2;
-          int32 right_context = min_chunk_size - offset - left_context;
-          for (int32 i = 0; i < left_context; i++) {
-            padded_features.Row(i).CopyFromVec(sub_features.Row(0));
-          }
-          for (int32 i = 0; i < right_context; i++) {
-            padded_features.Row(min_chunk_size - i - 1).CopyFromVec(sub_features.Row(offset - 1));
-          }
-          padded_features.Range(left_context, offset, 0, feat_dim).CopyFromMat(sub_features);
-          RunNnetComputation(padded_features, nnet, &compiler, &xvector);
-        } else {
-          RunNnetComputation(sub_features, nnet, &compiler, &xvector);
         }
-        xvector_avg.AddVec(offset, xvector);
-      }
-      xvector_avg.Scale(1.0 / tot_weight);
-      vector_writer.Write(utt, xvector_avg);
+        // Without --pad-input, chunks shorter than --min-chunk-size are
+        // skipped; this includes all chunks of utterances shorter than it,
+        // and of all utterances if --chunk-size is smaller than it.
+        GetXvectorChunks(xvector_opts, features.NumRows(), &chunks);
+        if (chunks.empty()) {
+          KALDI_WARN << "No chunks of at least --min-chunk-size="
+                     << xvector_opts.min_chunk_size << " frames in utterance "
+                     << utt << ", which has " << features.NumRows()
+                     << " frames (--chunk-size=" << xvector_opts.chunk_size
+                     << ")";
+          num_fail++;
+          continue;
+        }
+        if (task == NULL)
+          task = new XvectorComputeTask(xvector_opts, nnet, &compiler,
+                                        &vector_writer);
+        task->AddUtterance(utt, features);
+        task_chunks += chunks.size();
+        if (task_chunks >= min_chunks_per_task) {
+          sequencer.Run(task);
+          task = NULL;
+          task_chunks = 0;
+        }
 
-      frame_count += features.NumRows();
-      num_success++;
+        frame_count += features.NumRows();
+        num_success++;
+      }
+      if (task != NULL)
+        sequencer.Run(task);
+      sequencer.Wait();
     }
 
 #if HAVE_CUDA==1
@@ -34,6 +34,8 @@ void OnlineIvectorExtractionInfo::Init(
   posterior_scale = config.posterior_scale;
   max_count = config.max_count;
   num_cg_iters = config.num_cg_iters;
+  cg_tolerance = config.cg_tolerance;
+  min_relative_count_change = config.min_relative_count_change;
   use_most_recent_ivector = config.use_most_recent_ivector;
   greedy_ivector_extractor = config.greedy_ivector_extractor;
   if (greedy_ivector_extractor && !use_most_recent_ivector) {
@@ -88,6 +90,7 @@ void OnlineIvectorExtractionInfo::Check() const {
 // The class constructed in this way should never be used.
 OnlineIvectorExtractionInfo::OnlineIvectorExtractionInfo():
     ivector_period(0), num_gselect(0), min_post(0.0), posterior_scale(0.0),
+    cg_tolerance(0.0), min_relative_count_change(0.0),
     use_most_recent_ivector(true), greedy_ivector_extractor(false),
     max_remembered_frames(0) { }
 
@@ -174,22 +177,46 @@ void OnlineIvectorFeature::UpdateFrameWeights(
   delta_weights_provided_ = true;
 }
 
-void OnlineIvectorFeature::UpdateStatsForFrame(int32 t,
-                                               BaseFloat weight) {
-  int32 feat_dim = lda_normalized_->Dim();
-  Vector<BaseFloat> feat(feat_dim),  // features given to iVector extractor
-      log_likes(info_.diag_ubm.NumGauss());
-  lda_normalized_->GetFrame(t, &feat);
-  info_.diag_ubm.LogLikelihoods(feat, &log_likes);
-  // "posterior" stores the pruned posteriors for Gaussians in the UBM.
-  std::vector<std::pair<int32, BaseFloat> > posterior;
-  tot_ubm_loglike_ += weight *
-      VectorToPosteriorEntry(log_likes, info_.num_gselect,
-                             info_.min_post, &posterior);
-  for (size_t i = 0; i < posterior.size(); i++)
-    posterior[i].second *= info_.posterior_scale * weight;
-  lda_->GetFrame(t, &feat); // get feature without CMN.
-  ivector_stats_.AccStats(info_.extractor, feat, posterior);
+void OnlineIvectorFeature::UpdateStatsForFrames(
+    const std::vector<std::pair<int32, BaseFloat> > &frame_weights) {
+  int32 num_frames = frame_weights.size(),
+      feat_dim = lda_normalized_->Dim();
+  if (num_frames == 0)
+    return;
+  // features given to iVector extractor.
+  Matrix<BaseFloat> feats(num_frames, feat_dim, kUndefined), log_likes;
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> feat(feats, i);
+    lda_normalized_->GetFrame(frame_weights[i].first, &feat);
+  }
+  info_.diag_ubm.LogLikelihoods(feats, &log_likes);
+  // "posteriors" stores the pruned posteriors for Gaussians in the UBM.
+  Posterior posteriors(num_frames);
+  for (int32 i = 0; i < num_frames; i++) {
+    BaseFloat weight = frame_weights[i].second;
+    std::vector<std::pair<int32, BaseFloat> > &posterior = posteriors[i];
+    tot_ubm_loglike_ += weight *
+        VectorToPosteriorEntry(log_likes.Row(i), info_.num_gselect,
+                               info_.min_post, &posterior);
+    for (size_t j = 0; j < posterior.size(); j++) {
+      posterior[j].second *= info_.posterior_scale * weight;
+      count_change_since_update_ += std::abs(posterior[j].second);
+    }
+    SubVector<BaseFloat> feat(feats, i);
+    lda_->GetFrame(frame_weights[i].first, &feat); // get feature without CMN.
+  }
+  ivector_stats_.AccStats(info_.extractor, feats, posteriors);
+}
+
+void OnlineIvectorFeature::UpdateIvector() {
+  if (ivector_estimated_ && info_.min_relative_count_change > 0.0 &&
+      count_change_since_update_ <
+      info_.min_relative_count_change * ivector_stats_.Count())
+    return;  // The stats have changed too little to be worth re-estimating.
+  ivector_stats_.GetIvector(info_.num_cg_iters, &current_ivector_,
+                            info_.cg_tolerance);
+  count_change_since_update_ = 0.0;
+  ivector_estimated_ = true;
 }
 
 void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
@@ -198,14 +225,18 @@ void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
   updated_with_no_delta_weights_ = true;
 
   int32 ivector_period = info_.ivector_period;
-  int32 num_cg_iters = info_.num_cg_iters;
+  // The frames since the last iVector estimation, which we'll accumulate
+  // as one block.
+  std::vector<std::pair<int32, BaseFloat> > frame_weights;
 
   for (; num_frames_stats_ <= frame; num_frames_stats_++) {
     int32 t = num_frames_stats_;
-    UpdateStatsForFrame(t, 1.0);
+    frame_weights.push_back(std::pair<int32, BaseFloat>(t, 1.0));
     if ((!info_.use_most_recent_ivector && t % ivector_period == 0) ||
         (info_.use_most_recent_ivector && t == frame)) {
-      ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
+      UpdateStatsForFrames(frame_weights);
+      frame_weights.clear();
+      UpdateIvector();
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
         KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
@@ -213,6 +244,7 @@ void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
       }
     }
   }
+  UpdateStatsForFrames(frame_weights);
 }
 
 void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
@@ -223,7 +255,9 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
   bool debug_weights = false;
 
   int32 ivector_period = info_.ivector_period;
-  int32 num_cg_iters = info_.num_cg_iters;
+  // The (frame, weight) pairs since the last iVector estimation, which we'll
+  // accumulate as one block.
+  std::vector<std::pair<int32, BaseFloat> > frame_weights;
 
   for (; num_frames_stats_ <= frame; num_frames_stats_++) {
     int32 t = num_frames_stats_;
@@ -235,7 +269,7 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
       delta_weights_.pop();
       int32 frame = p.first;
       BaseFloat weight = p.second;
-      UpdateStatsForFrame(frame, weight);
+      frame_weights.push_back(p);
       if (debug_weights) {
         if (current_frame_weight_debug_.size() <= frame)
           current_frame_weight_debug_.resize(frame + 1, 0.0);
@@ -244,7 +278,9 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
     }
     if ((!info_.use_most_recent_ivector && t % ivector_period == 0) ||
         (info_.use_most_recent_ivector && t == frame)) {
-      ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
+      UpdateStatsForFrames(frame_weights);
+      frame_weights.clear();
+      UpdateIvector();
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
         KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
@@ -252,6 +288,7 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
       }
     }
   }
+  UpdateStatsForFrames(frame_weights);
 }
 
 
@@ -340,7 +377,8 @@ OnlineIvectorFeature::OnlineIvectorFeature(
                    info_.max_count),
     num_frames_stats_(0), delta_weights_provided_(false),
     updated_with_no_delta_weights_(false),
-    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0) {
+    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0),
+    count_change_since_update_(0.0), ivector_estimated_(false) {
   info.Check();
   KALDI_ASSERT(base_feature != NULL);
   splice_ = new OnlineSpliceFrames(info_.splice_opts, base_);
@@ -411,10 +449,13 @@ void OnlineSilenceWeighting::ComputeCurrentTraceback(
   if (num_frames_decoded == 0)
     return;
   int32 frame = num_frames_decoded - 1;
+  // Frames before num_frames_committed have been freed by the decoder's
+  // CommitStablePrefix(), so the traceback stops there.
+  int32 num_frames_committed = decoder.NumFramesCommitted();
   bool use_final_probs = false;
   LatticeFasterOnlineDecoder::BestPathIterator iter =
       decoder.BestPathEnd(use_final_probs, NULL);
-  while (frame >= 0) {
+  while (frame >= num_frames_committed) {
     LatticeArc arc;
     arc.ilabel = 0;
     while (arc.ilabel == 0)  // the while loop skips over input-epsilons
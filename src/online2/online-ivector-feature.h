@@ -79,7 +79,20 @@ struct OnlineIvectorExtractionConfig {
 
   int32 num_cg_iters;  // set to 15.  I don't believe this is very important, so it's
                        // not configurable from the command line for now.
-  
+
+  // If nonzero, the conjugate gradient in each iVector re-estimation (which
+  // is warm-started from the previous iVector) stops early once the residual
+  // is this small relative to its value at the default iVector; see
+  // OnlineIvectorEstimationStats::GetIvector().
+  BaseFloat cg_tolerance;
+
+  // If nonzero, at an --ivector-period boundary we only re-estimate the
+  // iVector if the data-count added since the last estimate is at least this
+  // proportion of the total data-count; otherwise we keep the previous
+  // iVector.  Since the stats change more and more slowly as the utterance
+  // goes on, this saves most of the estimation work for long utterances.
+  BaseFloat min_relative_count_change;
+
 
   // If use_most_recent_ivector is true, we always return the most recent
   // available iVector rather than the one for the current frame.  This means
@@ -102,6 +115,8 @@ struct OnlineIvectorExtractionConfig {
   OnlineIvectorExtractionConfig(): ivector_period(10), num_gselect(5),
                                    min_post(0.025), posterior_scale(0.1),
                                    max_count(0.0), num_cg_iters(15),
+                                   cg_tolerance(0.0),
+                                   min_relative_count_change(0.0),
                                    use_most_recent_ivector(true),
                                    greedy_ivector_extractor(false),
                                    max_remembered_frames(1000) { }
@@ -139,6 +154,15 @@ struct OnlineIvectorExtractionConfig {
                    "iVectors from long utterances look more typical.  Interpret "
                    "as a frame-count times --posterior-scale, typically 1/10 of "
                    "a number of frames.  Suggest 100.");
+    opts->Register("cg-tolerance", &cg_tolerance, "If nonzero, stop the "
+                   "conjugate gradient descent in iVector estimation early once "
+                   "the residual is this small relative to its value for the "
+                   "default iVector.  Saves time; try 0.01.");
+    opts->Register("min-relative-count-change", &min_relative_count_change,
+                   "If nonzero, only re-estimate the iVector if the data count "
+                   "since the last estimate is at least this proportion of the "
+                   "total count; otherwise reuse the previous iVector.  Saves "
+                   "time on long utterances; try 0.05.");
     opts->Register("use-most-recent-ivector", &use_most_recent_ivector, "If true, "
                    "always use most recent available iVector, rather than the "
                    "one for the designated frame.");
@@ -176,6 +200,8 @@ struct OnlineIvectorExtractionInfo {
   BaseFloat posterior_scale;
   BaseFloat max_count;
   int32 num_cg_iters;
+  BaseFloat cg_tolerance;
+  BaseFloat min_relative_count_change;
   bool use_most_recent_ivector;
   bool greedy_ivector_extractor;
   BaseFloat max_remembered_frames;
@@ -311,9 +337,16 @@ class OnlineIvectorFeature: public OnlineFeatureInterface {
       const std::vector<std::pair<int32, BaseFloat> > &delta_weights);
   
  private:
-  // this function adds "weight" to the stats for frame "frame".
-  void UpdateStatsForFrame(int32 frame,
-                           BaseFloat weight);
+  // this function adds the frames in "frame_weights", which is a list of pairs
+  // (frame, weight), to the stats with the given weights.  The frames are
+  // processed as one block, which is more efficient than doing it frame by
+  // frame.
+  void UpdateStatsForFrames(
+      const std::vector<std::pair<int32, BaseFloat> > &frame_weights);
+
+  // Re-estimates current_ivector_ from the stats (but see the
+  // --min-relative-count-change option).
+  void UpdateIvector();
 
   // This is the original UpdateStatsUntilFrame that is called when there is
   // no data-weighting involved.
@@ -373,10 +406,18 @@ class OnlineIvectorFeature: public OnlineFeatureInterface {
   
   /// The following is only needed for diagnostics.
   double tot_ubm_loglike_;
-  
+
+  /// The data-count (sum of absolute values of the scaled posteriors) added to
+  /// ivector_stats_ since current_ivector_ was last estimated.
+  double count_change_since_update_;
+
+  /// True once current_ivector_ has been estimated from the stats.
+  bool ivector_estimated_;
+
   /// Most recently estimated iVector, will have been
   /// estimated at the greatest time t where t <= num_frames_stats_ and
-  /// t % info_.ivector_period == 0.
+  /// t % info_.ivector_period == 0 (unless we skipped re-estimating it there
+  /// because of info_.min_relative_count_change).
   Vector<double> current_ivector_;
   
   /// if info_.use_most_recent_ivector == false, we need to store
@@ -455,7 +496,10 @@ class OnlineSilenceWeighting {
 
   // This should be called before GetDeltaWeights, so this class knows about the
   // traceback info from the decoder.  It records the traceback information from
-  // the decoder using its BestPathEnd() and related functions.
+  // the decoder using its BestPathEnd() and related functions.  If you use the
+  // decoder's CommitStablePrefix(), call this before each call to it: the
+  // traceback stops at NumFramesCommitted(), so frames before that keep
+  // whatever traceback they had when they were committed.
   void ComputeCurrentTraceback(const LatticeFasterOnlineDecoder &decoder);
   
   // Calling this function gets the changes in weight that require us to modify
@@ -71,6 +71,14 @@ void SingleUtteranceNnet3Decoder::GetBestPath(bool end_of_utterance,
   decoder_.GetBestPath(best_path, end_of_utterance);
 }
 
+bool SingleUtteranceNnet3Decoder::CommitStablePrefix(Lattice *prefix) {
+  return decoder_.CommitStablePrefix(prefix);
+}
+
+int32 SingleUtteranceNnet3Decoder::NumFramesCommitted() const {
+  return decoder_.NumFramesCommitted();
+}
+
 bool SingleUtteranceNnet3Decoder::EndpointDetected(
     const OnlineEndpointConfig &config) {
   BaseFloat output_frame_shift =
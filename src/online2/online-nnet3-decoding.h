@@ -83,6 +83,20 @@ class SingleUtteranceNnet3Decoder {
                    Lattice *best_path) const;
 
 
+  /// This is for decoding endless streams, where we never endpoint, with
+  /// bounded memory; see LatticeFasterOnlineDecoder::CommitStablePrefix().  If
+  /// it returns true, "prefix" is the best path up to the most recent point
+  /// where the best-path tracebacks of all active tokens coalesce, and the
+  /// decoder forgets the frames before it; after that, GetLattice() and
+  /// GetBestPath() only cover the frames from NumFramesCommitted() onward (and
+  /// the lattice only contains paths through that point).  If you use
+  /// OnlineSilenceWeighting, call its ComputeCurrentTraceback() before this.
+  bool CommitStablePrefix(Lattice *prefix);
+
+  /// Returns the number of frames that have been output by
+  /// CommitStablePrefix().
+  int32 NumFramesCommitted() const;
+
   /// This function calls EndpointDetected from online-endpoint.h,
   /// with the required arguments.
   bool EndpointDetected(const OnlineEndpointConfig &config);
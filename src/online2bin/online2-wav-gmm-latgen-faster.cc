@@ -110,6 +110,7 @@ int main(int argc, char *argv[]) {
     feature_cmdline_config.Register(&po);
     decode_config.Register(&po);
     endpoint_config.Register(&po);
+    g_lattice_write_options.Register(&po);
     
     po.Read(argc, argv);
     
@@ -130,6 +130,7 @@ int main(int argc, char *argv[]) {
     feature_config.Register(&po);
     nnet2_decoding_config.Register(&po);
     endpoint_config.Register(&po);
+    g_lattice_write_options.Register(&po);
 
     po.Read(argc, argv);
 
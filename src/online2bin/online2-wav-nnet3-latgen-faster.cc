@@ -131,6 +131,7 @@ int main(int argc, char *argv[]) {
     decodable_opts.Register(&po);
     decoder_opts.Register(&po);
     endpoint_opts.Register(&po);
+    g_lattice_write_options.Register(&po);
 
 
     po.Read(argc, argv);
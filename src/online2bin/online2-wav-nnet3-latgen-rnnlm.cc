@@ -0,0 +1,395 @@
+// online2bin/online2-wav-nnet3-latgen-rnnlm.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/wave-reader.h"
+#include "online2/online-nnet3-decoding.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/onlinebin-util.h"
+#include "online2/online-timing.h"
+#include "online2/online-endpoint.h"
+#include "fstext/fstext-lib.h"
+#include "lat/lattice-functions.h"
+#include "lm/const-arpa-lm.h"
+#include "rnnlm/rnnlm-lattice-rescoring.h"
+#include "util/kaldi-thread.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+
+void GetDiagnosticsAndPrintOutput(const std::string &utt,
+                                  const fst::SymbolTable *word_syms,
+                                  const CompactLattice &clat,
+                                  int64 *tot_num_frames,
+                                  double *tot_like) {
+  if (clat.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice.";
+    return;
+  }
+  CompactLattice best_path_clat;
+  CompactLatticeShortestPath(clat, &best_path_clat);
+
+  Lattice best_path_lat;
+  ConvertLattice(best_path_clat, &best_path_lat);
+
+  double likelihood;
+  LatticeWeight weight;
+  int32 num_frames;
+  std::vector<int32> alignment;
+  std::vector<int32> words;
+  GetLinearSymbolSequence(best_path_lat, &alignment, &words, &weight);
+  num_frames = alignment.size();
+  likelihood = -(weight.Value1() + weight.Value2());
+  *tot_num_frames += num_frames;
+  *tot_like += likelihood;
+  KALDI_VLOG(2) << "Likelihood per frame for utterance " << utt << " is "
+                << (likelihood / num_frames) << " over " << num_frames
+                << " frames.";
+
+  if (word_syms != NULL) {
+    std::cerr << utt << ' ';
+    for (size_t i = 0; i < words.size(); i++) {
+      std::string s = word_syms->Find(words[i]);
+      if (s == "")
+        KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+      std::cerr << s << ' ';
+    }
+    std::cerr << std::endl;
+  }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Reads in wav file(s) and simulates online decoding with neural nets\n"
+        "(nnet3 setup), like online2-wav-nnet3-latgen-faster, but with RNNLM\n"
+        "lattice rescoring done incrementally as the audio arrives: every\n"
+        "--rescore-period frames, the partial lattice is rescored, so that by\n"
+        "the time the end of the utterance (or an endpoint) is reached most of\n"
+        "the RNNLM computation has already been done and the final rescoring\n"
+        "adds little latency.  The output lattices are the rescored ones.\n"
+        "Note: each partial rescoring determinizes and rescores the lattice for\n"
+        "the whole of the utterance so far, so the total cost of the partial\n"
+        "rescorings grows quadratically with utterance length (only the RNNLM\n"
+        "computation itself is reused); use --do-endpointing or a larger\n"
+        "--rescore-period for long utterances.\n"
+        "RNNLM-related options have the prefix --rnnlm, e.g.\n"
+        "--rnnlm.lm-scale, --rnnlm.bos-symbol, --rnnlm.eos-symbol.\n"
+        "\n"
+        "Usage: online2-wav-nnet3-latgen-rnnlm [options] <nnet3-in> <fst-in> \\\n"
+        "         <old-lm-rxfilename> <embedding-file> <raw-rnnlm-rxfilename> \\\n"
+        "         <spk2utt-rspecifier> <wav-rspecifier> <lattice-wspecifier>\n"
+        "e.g.: online2-wav-nnet3-latgen-rnnlm --config=conf/online.conf \\\n"
+        "         --rnnlm.bos-symbol=1 --rnnlm.eos-symbol=2 \\\n"
+        "         final.mdl HCLG.fst data/lang_test/G.fst word_embedding.mat \\\n"
+        "         final.raw ark:spk2utt scp:wav.scp ark:out.lats\n"
+        "The spk2utt-rspecifier can just be <utterance-id> <utterance-id> if\n"
+        "you want to decode utterance by utterance.\n";
+
+    ParseOptions po(usage);
+
+    std::string word_syms_rxfilename;
+
+    // feature_opts includes configuration for the iVector adaptation,
+    // as well as the basic features.
+    OnlineNnet2FeaturePipelineConfig feature_opts;
+    nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
+    LatticeFasterDecoderConfig decoder_opts;
+    OnlineEndpointConfig endpoint_opts;
+    rnnlm::RnnlmComputeStateComputationOptions rnnlm_compute_opts;
+    rnnlm::OnlineRnnlmRescoringOptions rescoring_opts;
+
+    BaseFloat chunk_length_secs = 0.18;
+    bool do_endpointing = false;
+    bool use_carpa = false;
+    int32 rescore_period = 50;
+
+    po.Register("chunk-length", &chunk_length_secs,
+                "Length of chunk size in seconds, that we process.  Set to <= 0 "
+                "to use all input in one chunk.");
+    po.Register("word-symbol-table", &word_syms_rxfilename,
+                "Symbol table for words [for debug output]");
+    po.Register("do-endpointing", &do_endpointing,
+                "If true, apply endpoint detection");
+    po.Register("use-const-arpa", &use_carpa, "If true, read the old-LM file "
+                "as a const-arpa file as opposed to an FST file");
+    po.Register("rescore-period", &rescore_period, "Number of (possibly "
+                "subsampled) decoded frames between successive rescorings of "
+                "the partial lattice.  Smaller values do the RNNLM computation "
+                "more promptly, at the cost of more lattice determinization: "
+                "each partial rescoring processes the whole utterance so far, "
+                "so for T frames the total work is about "
+                "T^2 / (2 * rescore-period) frames' worth.");
+    po.Register("num-threads-startup", &g_num_threads,
+                "Number of threads used when initializing iVector extractor.");
+
+    feature_opts.Register(&po);
+    decodable_opts.Register(&po);
+    decoder_opts.Register(&po);
+    endpoint_opts.Register(&po);
+    ParseOptions rnnlm_po("rnnlm", &po);
+    rnnlm_compute_opts.Register(&rnnlm_po);
+    rescoring_opts.Register(&rnnlm_po);
+    g_lattice_write_options.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 8) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    if (rnnlm_compute_opts.bos_index == -1 ||
+        rnnlm_compute_opts.eos_index == -1) {
+      KALDI_ERR << "must set --rnnlm.bos-symbol and --rnnlm.eos-symbol options";
+    }
+    if (rescore_period <= 0)
+      KALDI_ERR << "--rescore-period must be positive.";
+
+    std::string nnet3_rxfilename = po.GetArg(1),
+        fst_rxfilename = po.GetArg(2),
+        lm_to_subtract_rxfilename = po.GetArg(3),
+        word_embedding_rxfilename = po.GetArg(4),
+        rnnlm_rxfilename = po.GetArg(5),
+        spk2utt_rspecifier = po.GetArg(6),
+        wav_rspecifier = po.GetArg(7),
+        clat_wspecifier = po.GetArg(8);
+
+    OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
+
+    TransitionModel trans_model;
+    nnet3::AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(nnet3_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
+    }
+
+    // this object contains precomputed stuff that is used by all decodable
+    // objects.  It takes a pointer to am_nnet because if it has iVectors it has
+    // to modify the nnet to accept iVectors at intervals.
+    nnet3::DecodableNnetSimpleLoopedInfo decodable_info(decodable_opts,
+                                                        &am_nnet);
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename);
+
+    // The LM to subtract: either G.fst or G.carpa.
+    VectorFst<StdArc> *lm_to_subtract_fst = NULL;
+    ConstArpaLm *const_arpa = NULL;
+    DeterministicOnDemandFst<StdArc> *lm_to_subtract = NULL;
+    if (use_carpa) {
+      const_arpa = new ConstArpaLm();
+      ReadKaldiObject(lm_to_subtract_rxfilename, const_arpa);
+      lm_to_subtract = new ConstArpaLmDeterministicFst(*const_arpa);
+    } else {
+      lm_to_subtract_fst = ReadAndPrepareLmFst(lm_to_subtract_rxfilename);
+      lm_to_subtract =
+          new BackoffDeterministicOnDemandFst<StdArc>(*lm_to_subtract_fst);
+    }
+
+    nnet3::Nnet rnnlm;
+    ReadKaldiObject(rnnlm_rxfilename, &rnnlm);
+    KALDI_ASSERT(IsSimpleNnet(rnnlm));
+    CuMatrix<BaseFloat> word_embedding_mat;
+    ReadKaldiObject(word_embedding_rxfilename, &word_embedding_mat);
+    const rnnlm::RnnlmComputeStateInfo rnnlm_info(rnnlm_compute_opts, rnnlm,
+                                                  word_embedding_mat);
+
+    rnnlm::OnlineRnnlmLatticeRescorer rescorer(rescoring_opts, rnnlm_info,
+                                               lm_to_subtract);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_rxfilename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_rxfilename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_rxfilename;
+
+    int32 num_done = 0, num_err = 0;
+    double tot_like = 0.0;
+    int64 num_frames = 0;
+    // Time spent in the final rescoring of each utterance, i.e. the latency
+    // that the RNNLM adds after the end of the utterance.
+    double tot_final_rescoring_time = 0.0;
+    int64 num_partial_rescorings = 0;
+
+    SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+    RandomAccessTableReader<WaveHolder> wav_reader(wav_rspecifier);
+    CompactLatticeWriter clat_writer(clat_wspecifier);
+
+    OnlineTimingStats timing_stats;
+
+    for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+      std::string spk = spk2utt_reader.Key();
+      const std::vector<std::string> &uttlist = spk2utt_reader.Value();
+      OnlineIvectorExtractorAdaptationState adaptation_state(
+          feature_info.ivector_extractor_info);
+      for (size_t i = 0; i < uttlist.size(); i++) {
+        std::string utt = uttlist[i];
+        if (!wav_reader.HasKey(utt)) {
+          KALDI_WARN << "Did not find audio for utterance " << utt;
+          num_err++;
+          continue;
+        }
+        const WaveData &wave_data = wav_reader.Value(utt);
+        // get the data for channel zero (if the signal is not mono, we only
+        // take the first channel).
+        SubVector<BaseFloat> data(wave_data.Data(), 0);
+
+        OnlineNnet2FeaturePipeline feature_pipeline(feature_info);
+        feature_pipeline.SetAdaptationState(adaptation_state);
+
+        OnlineSilenceWeighting silence_weighting(
+            trans_model,
+            feature_info.silence_weighting_config,
+            decodable_opts.frame_subsampling_factor);
+
+        SingleUtteranceNnet3Decoder decoder(decoder_opts, trans_model,
+                                            decodable_info,
+                                            *decode_fst, &feature_pipeline);
+        rescorer.InitUtterance();
+        OnlineTimer decoding_timer(utt);
+
+        BaseFloat samp_freq = wave_data.SampFreq();
+        int32 chunk_length;
+        if (chunk_length_secs > 0) {
+          chunk_length = int32(samp_freq * chunk_length_secs);
+          if (chunk_length == 0) chunk_length = 1;
+        } else {
+          chunk_length = std::numeric_limits<int32>::max();
+        }
+
+        int32 samp_offset = 0, last_rescored_frame = 0;
+        std::vector<std::pair<int32, BaseFloat> > delta_weights;
+
+        while (samp_offset < data.Dim()) {
+          int32 samp_remaining = data.Dim() - samp_offset;
+          int32 num_samp = chunk_length < samp_remaining ? chunk_length
+                                                         : samp_remaining;
+
+          SubVector<BaseFloat> wave_part(data, samp_offset, num_samp);
+          feature_pipeline.AcceptWaveform(samp_freq, wave_part);
+
+          samp_offset += num_samp;
+          decoding_timer.WaitUntil(samp_offset / samp_freq);
+          if (samp_offset == data.Dim()) {
+            // no more input. flush out last frames
+            feature_pipeline.InputFinished();
+          }
+
+          if (silence_weighting.Active() &&
+              feature_pipeline.IvectorFeature() != NULL) {
+            silence_weighting.ComputeCurrentTraceback(decoder.Decoder());
+            silence_weighting.GetDeltaWeights(feature_pipeline.NumFramesReady(),
+                                              &delta_weights);
+            feature_pipeline.IvectorFeature()->UpdateFrameWeights(delta_weights);
+          }
+
+          decoder.AdvanceDecoding();
+
+          if (do_endpointing && decoder.EndpointDetected(endpoint_opts)) {
+            break;
+          }
+
+          if (decoder.NumFramesDecoded() >=
+              last_rescored_frame + rescore_period) {
+            // Rescore the partial lattice; we don't need the result here,
+            // but this computes the RNNLM states for the histories seen so
+            // far, which will be reused in the final rescoring.  In a real
+            // application you might display the best path of the result as a
+            // partial transcript.  Note: GetLattice() and Rescore() both
+            // process the whole utterance so far (only the RNNLM states and
+            // LM arcs are cached between calls), so the cost of these partial
+            // rescorings is quadratic in the utterance length.
+            CompactLattice partial_clat, partial_rescored_clat;
+            decoder.GetLattice(false, &partial_clat);
+            rescorer.Rescore(partial_clat, false, &partial_rescored_clat);
+            last_rescored_frame = decoder.NumFramesDecoded();
+            num_partial_rescorings++;
+          }
+        }
+        decoder.FinalizeDecoding();
+
+        CompactLattice clat, rescored_clat;
+        bool end_of_utterance = true;
+        decoder.GetLattice(end_of_utterance, &clat);
+
+        Timer final_rescoring_timer;
+        bool ans = rescorer.Rescore(clat, end_of_utterance, &rescored_clat);
+        tot_final_rescoring_time += final_rescoring_timer.Elapsed();
+        // the final rescoring is counted in the delay at utterance end.
+        decoding_timer.OutputStats(&timing_stats);
+
+        if (!ans) {
+          KALDI_WARN << "RNNLM rescoring failed for utterance " << utt;
+          num_err++;
+          continue;
+        }
+        KALDI_VLOG(2) << "Utterance " << utt << " used "
+                      << rescorer.NumRnnlmStates() << " RNNLM states.";
+
+        GetDiagnosticsAndPrintOutput(utt, word_syms, rescored_clat,
+                                     &num_frames, &tot_like);
+
+        // In an application you might avoid updating the adaptation state if
+        // you felt the utterance had low confidence.  See lat/confidence.h
+        feature_pipeline.GetAdaptationState(&adaptation_state);
+
+        // we want to output the lattice with un-scaled acoustics.
+        BaseFloat inv_acoustic_scale =
+            1.0 / decodable_opts.acoustic_scale;
+        ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &rescored_clat);
+
+        clat_writer.Write(utt, rescored_clat);
+        KALDI_LOG << "Decoded utterance " << utt;
+        num_done++;
+      }
+    }
+    timing_stats.Print(true);
+
+    KALDI_LOG << "Decoded " << num_done << " utterances, "
+              << num_err << " with errors.";
+    KALDI_LOG << "Did " << num_partial_rescorings << " partial rescorings; "
+              << "average time for final rescoring was "
+              << (num_done + num_err == 0 ? 0.0 :
+                  tot_final_rescoring_time / (num_done + num_err))
+              << " seconds per utterance.";
+    KALDI_LOG << "Overall likelihood per frame was " << (tot_like / num_frames)
+              << " per frame over " << num_frames << " frames.";
+    delete decode_fst;
+    delete word_syms; // will delete if non-NULL.
+    delete lm_to_subtract;
+    delete lm_to_subtract_fst;
+    delete const_arpa;
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
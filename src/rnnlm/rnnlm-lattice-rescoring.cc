@@ -22,6 +22,7 @@
 #include <utility>
 
 #include "rnnlm/rnnlm-lattice-rescoring.h"
+#include "lat/lattice-functions.h"
 #include "util/stl-utils.h"
 #include "util/text-utils.h"
 
@@ -116,5 +117,102 @@ bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
   return true;
 }
 
+
+namespace {
+
+// This on-demand FST wraps another one but gives all its states unit
+// final-probs.  We use it when rescoring partial lattices, for which the
+// end-of-sentence probabilities of the LMs should not be included.
+class NoFinalProbDeterministicOnDemandFst:
+      public fst::DeterministicOnDemandFst<fst::StdArc> {
+ public:
+  typedef fst::StdArc::Weight Weight;
+  typedef fst::StdArc::StateId StateId;
+  typedef fst::StdArc::Label Label;
+
+  // Does not take ownership.
+  explicit NoFinalProbDeterministicOnDemandFst(
+      fst::DeterministicOnDemandFst<fst::StdArc> *fst): fst_(fst) { }
+
+  virtual StateId Start() { return fst_->Start(); }
+
+  virtual Weight Final(StateId s) { return Weight::One(); }
+
+  virtual bool GetArc(StateId s, Label ilabel, fst::StdArc *oarc) {
+    return fst_->GetArc(s, ilabel, oarc);
+  }
+ private:
+  fst::DeterministicOnDemandFst<fst::StdArc> *fst_;
+};
+
+}  // namespace
+
+
+OnlineRnnlmLatticeRescorer::OnlineRnnlmLatticeRescorer(
+    const OnlineRnnlmRescoringOptions &opts,
+    const RnnlmComputeStateInfo &info,
+    fst::DeterministicOnDemandFst<fst::StdArc> *lm_to_subtract):
+    opts_(opts),
+    lm_to_subtract_scaled_(new fst::ScaleDeterministicOnDemandFst(
+        -opts.lm_scale, lm_to_subtract)),
+    rnnlm_fst_(new KaldiRnnlmDeterministicFst(opts.max_ngram_order, info)),
+    rnnlm_fst_scaled_(new fst::ScaleDeterministicOnDemandFst(
+        opts.lm_scale, rnnlm_fst_)),
+    combined_lms_(NULL), cached_combined_lms_(NULL) {
+  KALDI_ASSERT(opts.num_cached_arcs > 0);
+  InitUtterance();
+}
+
+void OnlineRnnlmLatticeRescorer::DeleteUtteranceFsts() {
+  delete cached_combined_lms_;
+  cached_combined_lms_ = NULL;
+  delete combined_lms_;
+  combined_lms_ = NULL;
+}
+
+void OnlineRnnlmLatticeRescorer::InitUtterance() {
+  DeleteUtteranceFsts();
+  rnnlm_fst_->Clear();
+  // The composed FST's state-ids refer to rnnlm_fst_'s state-ids, which are
+  // invalidated by Clear(), so it has to be recreated; and so does the arc
+  // cache, which has no Clear() function.
+  combined_lms_ = new fst::ComposeDeterministicOnDemandFst<fst::StdArc>(
+      lm_to_subtract_scaled_, rnnlm_fst_scaled_);
+  cached_combined_lms_ = new fst::CacheDeterministicOnDemandFst<fst::StdArc>(
+      combined_lms_, opts_.num_cached_arcs);
+}
+
+bool OnlineRnnlmLatticeRescorer::Rescore(const CompactLattice &clat,
+                                         bool end_of_utterance,
+                                         CompactLattice *rescored_clat) {
+  rescored_clat->DeleteStates();
+  if (clat.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice given to RNNLM rescoring.";
+    return false;
+  }
+  // ComposeCompactLatticePruned() requires a topologically sorted input.
+  CompactLattice clat_sorted(clat);
+  TopSortCompactLatticeIfNeeded(&clat_sorted);
+
+  if (end_of_utterance) {
+    ComposeCompactLatticePruned(opts_.compose_opts, clat_sorted,
+                                cached_combined_lms_, rescored_clat);
+  } else {
+    NoFinalProbDeterministicOnDemandFst no_final_lms(cached_combined_lms_);
+    ComposeCompactLatticePruned(opts_.compose_opts, clat_sorted,
+                                &no_final_lms, rescored_clat);
+  }
+  // ComposeCompactLatticePruned() will already have printed a warning if
+  // something went wrong.
+  return (rescored_clat->NumStates() != 0);
+}
+
+OnlineRnnlmLatticeRescorer::~OnlineRnnlmLatticeRescorer() {
+  DeleteUtteranceFsts();
+  delete rnnlm_fst_scaled_;
+  delete rnnlm_fst_;
+  delete lm_to_subtract_scaled_;
+}
+
 }  // namespace rnnlm
 }  // namespace kaldi
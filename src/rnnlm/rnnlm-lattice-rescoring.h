@@ -27,6 +27,8 @@
 
 #include "base/kaldi-common.h"
 #include "fstext/deterministic-fst.h"
+#include "lat/compose-lattice-pruned.h"
+#include "lat/kaldi-lattice.h"
 #include "rnnlm/rnnlm-compute-state.h"
 #include "util/common-utils.h"
 
@@ -57,6 +59,10 @@ class KaldiRnnlmDeterministicFst
 
   virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
 
+  // Returns the number of history states created so far (including the start
+  // state).
+  int32 NumStates() const { return state_to_wseq_.size(); }
+
  private:
   typedef unordered_map
       <std::vector<Label>, StateId, VectorHasher<Label> > MapType;
@@ -76,6 +82,108 @@ class KaldiRnnlmDeterministicFst
 
 };
 
+
+struct OnlineRnnlmRescoringOptions {
+  BaseFloat lm_scale;
+  int32 max_ngram_order;
+  int32 num_cached_arcs;
+  ComposeLatticePrunedOptions compose_opts;
+
+  OnlineRnnlmRescoringOptions(): lm_scale(0.5), max_ngram_order(3),
+                                 num_cached_arcs(100000) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("lm-scale", &lm_scale, "Scaling factor for the RNNLM; its "
+                   "negative will be applied to the LM we are subtracting "
+                   "(normally the LM used to build the decoding graph).");
+    opts->Register("max-ngram-order", &max_ngram_order, "If positive, allow "
+                   "RNNLM histories longer than this to be identified with "
+                   "each other for rescoring purposes (an approximation that "
+                   "saves time and reduces output lattice size).");
+    opts->Register("num-cached-arcs", &num_cached_arcs, "Number of arcs of the "
+                   "combined LM score-difference FST that we cache between "
+                   "successive calls to Rescore() within an utterance.");
+    compose_opts.Register(opts);
+  }
+};
+
+/**
+   This class does RNNLM rescoring of the partial lattices that you get during
+   online (streaming) decoding, e.g. from
+   SingleUtteranceNnet3Decoder::GetLattice(false, &clat), which internally uses
+   LatticeFasterOnlineDecoder::GetRawLatticePruned().  The idea is that you call
+   Rescore() periodically as frames arrive, and once more at the end of the
+   utterance (after endpointing), and because successive partial lattices
+   mostly share their word histories, almost all of the RNNLM computation
+   needed for the final call will already have been done.
+
+   The work we reuse between calls is: the RNNLM states for the word
+   histories seen so far (these are kept in a KaldiRnnlmDeterministicFst which
+   we only clear in InitUtterance()), the state-pair mapping of the
+   ComposeDeterministicOnDemandFst that combines it with the LM we are
+   subtracting, and the arcs of that composed FST, which are cached in a
+   CacheDeterministicOnDemandFst so we don't recompute the LM probabilities.
+   The pruned composition itself (ComposeCompactLatticePruned()) is redone on
+   each call; it is cheap compared with the RNNLM computation, but since it
+   (like the determinization in GetLattice()) covers the whole utterance so
+   far, calling Rescore() every N frames on a T-frame utterance costs
+   O(T^2 / N) in total.  Keep N large relative to the typical utterance
+   length, or bound the utterance length with endpointing.
+*/
+class OnlineRnnlmLatticeRescorer {
+ public:
+  /// Constructor.  Does not take ownership of 'info' or 'lm_to_subtract', which
+  /// must outlive this object.  'lm_to_subtract' is the unscaled on-demand
+  /// version of the LM that was used to build the decoding graph (e.g. a
+  /// BackoffDeterministicOnDemandFst or ConstArpaLmDeterministicFst); we apply
+  /// the scale -opts.lm_scale to it.
+  OnlineRnnlmLatticeRescorer(
+      const OnlineRnnlmRescoringOptions &opts,
+      const RnnlmComputeStateInfo &info,
+      fst::DeterministicOnDemandFst<fst::StdArc> *lm_to_subtract);
+
+  /// Call this at the start of each new utterance.  It discards the RNNLM
+  /// states and cached arcs from the previous utterance (it is called from the
+  /// constructor, so you don't need to call it for the first utterance).
+  void InitUtterance();
+
+  /// Rescores the lattice 'clat', which will normally be the lattice for the
+  /// part of the utterance decoded so far.  It is expected to have the
+  /// acoustic scale already applied, as is the case for lattices obtained from
+  /// the online decoders.  If 'end_of_utterance' is false, the end-of-sentence
+  /// probabilities of the LMs are not included in the final-probs (the
+  /// sentence has not ended yet); you should set it to true for the final
+  /// call.  Returns true on success; on failure (which is rare and would
+  /// normally be caused by an empty lattice), prints a warning and returns
+  /// false.
+  bool Rescore(const CompactLattice &clat, bool end_of_utterance,
+               CompactLattice *rescored_clat);
+
+  /// Returns the number of word-history states for which we have computed
+  /// RNNLM states so far in this utterance; for diagnostics.
+  int32 NumRnnlmStates() const { return rnnlm_fst_->NumStates(); }
+
+  ~OnlineRnnlmLatticeRescorer();
+ private:
+  // Deletes the per-utterance FSTs.
+  void DeleteUtteranceFsts();
+
+  const OnlineRnnlmRescoringOptions &opts_;
+
+  // lm_to_subtract scaled by -opts_.lm_scale; owned here.
+  fst::ScaleDeterministicOnDemandFst *lm_to_subtract_scaled_;
+  // The RNNLM; owned here.  We call Clear() on it for each new utterance.
+  KaldiRnnlmDeterministicFst *rnnlm_fst_;
+  // The RNNLM scaled by opts_.lm_scale; owned here.
+  fst::ScaleDeterministicOnDemandFst *rnnlm_fst_scaled_;
+
+  // The following two are recreated for each utterance.
+  fst::ComposeDeterministicOnDemandFst<fst::StdArc> *combined_lms_;
+  fst::CacheDeterministicOnDemandFst<fst::StdArc> *cached_combined_lms_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineRnnlmLatticeRescorer);
+};
+
 }  // namespace rnnlm
 }  // namespace kaldi
 
@@ -19,6 +19,7 @@
 
 #include "util/common-utils.h"
 #include "gmm/diag-gmm.h"
+#include "gmm/am-diag-gmm.h"
 #include "transform/fmllr-diag-gmm.h"
 
 namespace kaldi {
@@ -222,6 +223,62 @@ void UnitTestFmllrDiagGmmOffset() {
   // mean that something is wrong.
 }
 
+// Tests that AccumulateForGmms() gives the same stats as calling
+// AccumulateForGmm() frame by frame.
+void UnitTestFmllrDiagGmmAccumulateForGmms() {
+  using namespace kaldi;
+  DiagGmm gmm;
+  InitRandomGmm(&gmm);
+  int32 dim = gmm.Dim(), num_pdfs = 1 + Rand() % 4;
+  AmDiagGmm am_gmm;
+  am_gmm.Init(gmm, num_pdfs);
+  for (int32 pdf = 1; pdf < num_pdfs; pdf++) {
+    DiagGmm this_gmm;
+    do {
+      InitRandomGmm(&this_gmm);
+    } while (this_gmm.Dim() != dim);
+    am_gmm.GetPdf(pdf).CopyFromDiagGmm(this_gmm);
+  }
+  int32 num_frames = 50 + Rand() % 50;
+  Matrix<BaseFloat> feats(num_frames, dim);
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    SubVector<BaseFloat> row(feats, t);
+    gmm.Generate(&row);
+    int32 num_entries = Rand() % 3;  // zero entries is allowed.
+    for (int32 i = 0; i < num_entries; i++)
+      pdf_post[t].push_back(std::make_pair(Rand() % num_pdfs,
+                                           0.1 + RandUniform()));
+  }
+
+  for (int32 i = 0; i < 2; i++) {
+    FmllrOptions opts;
+    opts.update_type = (i == 0 ? "full" : "diag");
+    FmllrDiagGmmAccs stats1(dim, opts), stats2(dim, opts);
+    BaseFloat like1 = 0.0, like2;
+    for (int32 t = 0; t < num_frames; t++)
+      for (size_t j = 0; j < pdf_post[t].size(); j++)
+        like1 += pdf_post[t][j].second *
+            stats1.AccumulateForGmm(am_gmm.GetPdf(pdf_post[t][j].first),
+                                    feats.Row(t), pdf_post[t][j].second);
+    like2 = stats2.AccumulateForGmms(am_gmm, feats, pdf_post);
+    AssertEqual(like1, like2, 1.0e-03);
+
+    Matrix<BaseFloat> xform1(dim, dim + 1), xform2(dim, dim + 1);
+    xform1.SetUnit();
+    xform2.SetUnit();
+    BaseFloat objf_impr1, objf_impr2, count1, count2;
+    stats1.Update(opts, &xform1, &objf_impr1, &count1);
+    stats2.Update(opts, &xform2, &objf_impr2, &count2);
+    AssertEqual(stats1.beta_, stats2.beta_);
+    AssertEqual(stats1.K_, stats2.K_);
+    for (int32 d = 0; d < dim; d++)
+      AssertEqual(stats1.G_[d], stats2.G_[d]);
+    AssertEqual(count1, count2);
+    AssertEqual(xform1, xform2, 0.01);
+  }
+}
+
 }  // namespace kaldi ends here
 
 int main() {
@@ -229,6 +286,7 @@ int main() {
     kaldi::UnitTestFmllrDiagGmmOffset();
     kaldi::UnitTestFmllrDiagGmmDiagonal();
     kaldi::UnitTestFmllrDiagGmm();
+    kaldi::UnitTestFmllrDiagGmmAccumulateForGmms();
   }
   std::cout << "Test OK.\n";
 }
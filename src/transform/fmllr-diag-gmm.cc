@@ -19,6 +19,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 using std::vector;
@@ -111,6 +112,62 @@ BaseFloat FmllrDiagGmmAccs::AccumulateForGmm(const DiagGmm &pdf,
   return loglike;
 }
 
+BaseFloat FmllrDiagGmmAccs::AccumulateForGmms(
+    const AmDiagGmm &am_gmm,
+    const MatrixBase<BaseFloat> &data,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post) {
+  int32 num_frames = data.NumRows(), dim = Dim();
+  KALDI_ASSERT(data.NumCols() == dim && am_gmm.Dim() == dim &&
+               static_cast<int32>(pdf_post.size()) == num_frames);
+  // Sort the (pdf-id, (frame, weight)) triples by pdf-id, so we can process
+  // all the frames of each pdf together.
+  std::vector<std::pair<int32, std::pair<int32, BaseFloat> > > triples;
+  for (int32 t = 0; t < num_frames; t++)
+    for (size_t j = 0; j < pdf_post[t].size(); j++)
+      triples.push_back(std::make_pair(
+          pdf_post[t][j].first, std::make_pair(t, pdf_post[t][j].second)));
+  std::sort(triples.begin(), triples.end());
+
+  // Row t of "a" and "b", and element t of "counts", are the same as the
+  // members of SingleFrameStats for frame t.
+  Matrix<BaseFloat> a(num_frames, dim), b(num_frames, dim);
+  Vector<double> counts(num_frames);
+  double tot_like = 0.0;
+  int32 num_triples = triples.size();
+  std::vector<MatrixIndexT> frames;
+  for (int32 start = 0; start < num_triples; ) {
+    int32 pdf_id = triples[start].first, end = start + 1;
+    while (end < num_triples && triples[end].first == pdf_id)
+      end++;
+    const DiagGmm &gmm = am_gmm.GetPdf(pdf_id);
+    int32 n = end - start;
+    frames.resize(n);
+    for (int32 i = 0; i < n; i++)
+      frames[i] = triples[start + i].second.first;
+    Matrix<BaseFloat> pdf_data(n, dim, kUndefined), posteriors;
+    pdf_data.CopyRows(data, &(frames[0]));
+    gmm.LogLikelihoods(pdf_data, &posteriors);
+    for (int32 i = 0; i < n; i++) {
+      BaseFloat weight = triples[start + i].second.second;
+      SubVector<BaseFloat> post(posteriors, i);
+      tot_like += weight * post.ApplySoftMax();
+      post.Scale(weight);
+      counts(frames[i]) += weight;
+    }
+    Matrix<BaseFloat> pdf_a(n, dim), pdf_b(n, dim);
+    pdf_a.AddMatMat(1.0, posteriors, kNoTrans, gmm.means_invvars(), kNoTrans,
+                    0.0);
+    pdf_b.AddMatMat(1.0, posteriors, kNoTrans, gmm.inv_vars(), kNoTrans, 0.0);
+    for (int32 i = 0; i < n; i++) {
+      a.Row(frames[i]).AddVec(1.0, pdf_a.Row(i));
+      b.Row(frames[i]).AddVec(1.0, pdf_b.Row(i));
+    }
+    start = end;
+  }
+  CommitFrameStats(data, a, b, counts);
+  return tot_like;
+}
+
 BaseFloat FmllrDiagGmmAccs::AccumulateForGmmPreselect(
     const DiagGmm &pdf,
     const std::vector<int32> &gselect,
@@ -594,6 +651,56 @@ void FmllrDiagGmmAccs::CommitSingleFrameStats() {
   stats.a.SetZero();
   stats.b.SetZero();
 }
+
+void FmllrDiagGmmAccs::CommitFrameStats(const MatrixBase<BaseFloat> &data,
+                                        const MatrixBase<BaseFloat> &a,
+                                        const MatrixBase<BaseFloat> &b,
+                                        const VectorBase<double> &counts) {
+  int32 dim = Dim(), num_frames = data.NumRows();
+  KALDI_ASSERT(data.NumCols() == dim && a.NumCols() == dim &&
+               b.NumCols() == dim && a.NumRows() == num_frames &&
+               b.NumRows() == num_frames && counts.Dim() == num_frames);
+  if (num_frames == 0) return;
+
+  Matrix<double> xplus(num_frames, dim + 1, kUndefined);
+  xplus.Range(0, num_frames, 0, dim).CopyFromMat(data);
+  xplus.Range(0, num_frames, dim, 1).Set(1.0);
+
+  this->beta_ += counts.Sum();
+  Matrix<double> a_dbl(a);
+  this->K_.AddMatMat(1.0, a_dbl, kTrans, xplus, kNoTrans, 1.0);
+
+  KALDI_ASSERT(static_cast<size_t>(dim) == this->G_.size());
+  Matrix<double> b_trans(b, kTrans);  // row i is the per-frame scale for G_[i].
+  if (opts_.update_type == "full") {
+    // G_[i] += xplus^T diag(b(:,i)) xplus.
+    Matrix<double> scaled_xplus(num_frames, dim + 1, kUndefined),
+        scatter(dim + 1, dim + 1, kUndefined);
+    SpMatrix<double> scatter_sp(dim + 1, kUndefined);
+    for (int32 i = 0; i < dim; i++) {
+      scaled_xplus.CopyFromMat(xplus);
+      scaled_xplus.MulRowsVec(b_trans.Row(i));
+      scatter.AddMatMat(1.0, scaled_xplus, kTrans, xplus, kNoTrans, 0.0);
+      scatter_sp.CopyFromMat(scatter, kTakeLower);
+      this->G_[i].AddSp(1.0, scatter_sp);
+    }
+  } else {
+    // We only need some elements of these stats, so just update those elements.
+    for (int32 i = 0; i < dim; i++) {
+      const double *scale = b_trans.RowData(i);
+      double sum = 0.0, sum_x = 0.0, sum_x2 = 0.0;
+      for (int32 t = 0; t < num_frames; t++) {
+        double x_i = xplus(t, i);
+        sum += scale[t];
+        sum_x += scale[t] * x_i;
+        sum_x2 += scale[t] * x_i * x_i;
+      }
+      this->G_[i](i, i) += sum_x2;
+      this->G_[i](dim, i) += sum_x;
+      this->G_[i](dim, dim) += sum;
+    }
+  }
+}
     
 
 
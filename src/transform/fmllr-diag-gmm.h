@@ -97,6 +97,18 @@ class FmllrDiagGmmAccs: public AffineXformStats {
                                       const VectorBase<BaseFloat> &data,
                                       BaseFloat weight);
   
+  /// Accumulate stats for a block of frames, e.g. an utterance: "data" has
+  /// one frame per row, and pdf_post[t] is a list of (pdf-id, weight) pairs
+  /// for frame t, e.g. obtained from ConvertPosteriorToPdfs().  Gives the same
+  /// result (up to roundoff) as calling AccumulateForGmm() for each frame and
+  /// pdf-id, but the Gaussian posteriors are computed for all the frames of
+  /// each pdf at once, and the stats are accumulated with matrix-matrix
+  /// products.  Returns the total log-likelihood, weighted by pdf_post.
+  BaseFloat AccumulateForGmms(
+      const AmDiagGmm &am_gmm,
+      const MatrixBase<BaseFloat> &data,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post);
+
   /// Accumulate stats for a GMM, given supplied posteriors.
   void AccumulateFromPosteriors(const DiagGmm &gmm,
                                 const VectorBase<BaseFloat> &data,
@@ -143,6 +155,14 @@ class FmllrDiagGmmAccs: public AffineXformStats {
 
   void CommitSingleFrameStats();
 
+  // This is a block version of CommitSingleFrameStats(): row t of "data", "a"
+  // and "b", and element t of "counts", correspond to the members x, a, b and
+  // count of SingleFrameStats for frame t.
+  void CommitFrameStats(const MatrixBase<BaseFloat> &data,
+                        const MatrixBase<BaseFloat> &a,
+                        const MatrixBase<BaseFloat> &b,
+                        const VectorBase<double> &counts);
+
   void InitSingleFrameStats(const VectorBase<BaseFloat> &data);
   
   bool DataHasChanged(const VectorBase<BaseFloat> &data) const; // compares it to the
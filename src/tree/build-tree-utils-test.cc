@@ -810,6 +810,24 @@ void TestSplitDecisionTree() {
                                                &num_leaves, &impr, &smallest_split);
       KALDI_ASSERT(num_leaves <= max_leaves && smallest_split >= thresh);
 
+      {  // Check that the multi-threaded version gives the same tree.
+        int32 num_leaves2 = 0, num_threads = 2 + Rand() % 3;
+        EventMap *trivial_tree2 = TrivialTree(&num_leaves2);
+        BaseFloat impr2, smallest_split2;
+        EventMap *split_tree2 = SplitDecisionTree(*trivial_tree2, stats, qo,
+                                                  thresh, max_leaves,
+                                                  &num_leaves2, &impr2,
+                                                  &smallest_split2,
+                                                  num_threads);
+        std::ostringstream os, os2;
+        split_tree->Write(os, false);
+        split_tree2->Write(os2, false);
+        KALDI_ASSERT(num_leaves2 == num_leaves && impr2 == impr &&
+                     smallest_split2 == smallest_split && os.str() == os2.str());
+        delete trivial_tree2;
+        delete split_tree2;
+      }
+
       {
         BaseFloat impr_check = ObjfGivenMap(stats, *split_tree) - ObjfGivenMap(stats, *trivial_tree);
         std::cout << "Objf impr is " << impr << ", computed differently: " <<impr_check<<'\n';
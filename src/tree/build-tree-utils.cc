@@ -17,9 +17,11 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
+#include "util/kaldi-thread.h"
 #include "tree/build-tree-utils.h"
 
 
@@ -350,15 +352,27 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
                               EventKeyType key,
                               std::vector<EventValueType> *yes_set_out) {
   if (stats.size()<=1) return 0.0;  // cannot split if only zero or one instance of stats.
-  if (!PossibleValues(key, stats, NULL)) {
-    yes_set_out->clear();
-    return 0.0;  // Can't split as key not always defined.
-  }
   std::vector<Clusterable*> summed_stats;  // indexed by value corresponding to key. owned here.
-  {  // compute summed_stats
-    std::vector<BuildTreeStatsType> split_stats;
-    SplitStatsByKey(stats, key, &split_stats);
-    SumStatsVec(split_stats, &summed_stats);
+  {  // compute summed_stats.  This is equivalent to SplitStatsByKey() followed
+     // by SumStatsVec(), but it sums the stats in a single pass without
+     // copying the event vectors.
+    BuildTreeStatsType::const_iterator iter = stats.begin(), end = stats.end();
+    for (; iter != end; ++iter) {
+      EventValueType val;
+      if (!EventMap::Lookup(iter->first, key, &val)) {
+        DeletePointers(&summed_stats);
+        yes_set_out->clear();
+        return 0.0;  // Can't split as key not always defined.
+      }
+      KALDI_ASSERT(val >= 0);
+      if (static_cast<size_t>(val) >= summed_stats.size())
+        summed_stats.resize(val + 1, NULL);
+      const Clusterable *cl = iter->second;
+      if (cl != NULL) {
+        if (summed_stats[val] == NULL) summed_stats[val] = cl->Copy();
+        else summed_stats[val]->Add(*cl);
+      }
+    }
   }
 
   std::vector<EventValueType> yes_set;
@@ -423,7 +437,7 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
 
 
 /*
-  DecisionTreeBuilder is a class used in SplitDecisionTree
+  DecisionTreeSplitter is a class used in SplitDecisionTree
 */
 
 class DecisionTreeSplitter {
@@ -444,16 +458,55 @@ class DecisionTreeSplitter {
       best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());  // may have changed.
     }
   }
+  // Note: the constructor does not work out the best split; you have to call
+  // FindBestSplits() on the newly constructed objects, which lets us evaluate
+  // the splits of several objects in parallel.
   DecisionTreeSplitter(EventAnswerType leaf, const BuildTreeStatsType &stats,
-                      const Questions &q_opts): q_opts_(q_opts), yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) {
-    // not, this must work when stats is empty too. [just gives zero improvement, non-splittable].
-    FindBestSplit();
-  }
+                       const Questions &q_opts, int32 num_threads):
+      q_opts_(q_opts), num_threads_(num_threads), best_split_impr_(0.0),
+      yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats), key_(0) { }
   ~DecisionTreeSplitter() {
     delete yes_;
     delete no_;
   }
+
+  // This sets best_split_impr_, key_ and yes_set_ for each of "splitters",
+  // which must be leaves that were just constructed.  It evaluates the
+  // candidate splits for each (splitter, key) pair, using up to "num_threads"
+  // threads.  The result does not depend on the number of threads.  Must work
+  // when the stats are empty too [just gives zero improvement,
+  // non-splittable].
+  static void FindBestSplits(const std::vector<DecisionTreeSplitter*> &splitters,
+                             int32 num_threads);
  private:
+  // Evaluates the best split for each task (splitter, key) in "tasks", taking
+  // the tasks in turn from a shared counter.
+  class FindBestSplitClass: public MultiThreadable {
+   public:
+    typedef std::pair<DecisionTreeSplitter*, EventKeyType> Task;
+    FindBestSplitClass(const std::vector<Task> &tasks,
+                       std::atomic<size_t> *next_task,
+                       std::vector<BaseFloat> *improvements,
+                       std::vector<std::vector<EventValueType> > *yes_sets):
+        tasks_(tasks), next_task_(next_task), improvements_(improvements),
+        yes_sets_(yes_sets) { }
+    void operator () () {
+      size_t t;
+      while ((t = (*next_task_)++) < tasks_.size()) {
+        const DecisionTreeSplitter *splitter = tasks_[t].first;
+        (*improvements_)[t] = FindBestSplitForKey(splitter->stats_,
+                                                  splitter->q_opts_,
+                                                  tasks_[t].second,
+                                                  &((*yes_sets_)[t]));
+      }
+    }
+   private:
+    const std::vector<Task> &tasks_;
+    std::atomic<size_t> *next_task_;
+    std::vector<BaseFloat> *improvements_;
+    std::vector<std::vector<EventValueType> > *yes_sets_;
+  };
+
   void DoSplitInternal(int32 *next_leaf) {
     // Does the split; applicable only to leaf nodes.
     KALDI_ASSERT(!yes_);  // make sure children not already set up.
@@ -481,38 +534,19 @@ class DecisionTreeSplitter {
       delete yes_clust; delete no_clust;
     }
 #endif
-    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_);
-    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_);
+    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_, num_threads_);
+    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_, num_threads_);
+    std::vector<DecisionTreeSplitter*> children(2);
+    children[0] = yes_;
+    children[1] = no_;
+    FindBestSplits(children, num_threads_);
     best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());
     stats_.clear();  // note: pointers in stats_ were not owned here.
   }
-  void FindBestSplit() {
-    // This sets best_split_impr_, key_ and yes_set_.
-    // May just pick best question, or may iterate a bit (depends on
-    // q_opts; see FindBestSplitForKey for details)
-    std::vector<EventKeyType> all_keys;
-    q_opts_.GetKeysWithQuestions(&all_keys);
-    if (all_keys.size() == 0) {
-      KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
-    }
-    best_split_impr_ = 0;
-    for (size_t i = 0; i < all_keys.size(); i++) {
-      if (q_opts_.HasQuestionsForKey(all_keys[i])) {
-        std::vector<EventValueType> temp_yes_set;
-        BaseFloat split_improvement = FindBestSplitForKey(stats_, q_opts_, all_keys[i], &temp_yes_set);
-        if (split_improvement > best_split_impr_) {
-          best_split_impr_ = split_improvement;
-          yes_set_ = temp_yes_set;
-          key_ = all_keys[i];
-        }
-      }
-    }
-  }
-
-
 
   // Data members... Always used:
   const Questions &q_opts_;
+  int32 num_threads_;
   BaseFloat best_split_impr_;
 
   // If already split:
@@ -529,6 +563,50 @@ class DecisionTreeSplitter {
 
 };
 
+void DecisionTreeSplitter::FindBestSplits(
+    const std::vector<DecisionTreeSplitter*> &splitters,
+    int32 num_threads) {
+  if (splitters.empty()) return;
+  // May just pick best question, or may iterate a bit (depends on
+  // q_opts; see FindBestSplitForKey for details).  All the splitters
+  // share the same q_opts_.
+  const Questions &q_opts = splitters[0]->q_opts_;
+  std::vector<EventKeyType> all_keys;
+  q_opts.GetKeysWithQuestions(&all_keys);
+  if (all_keys.size() == 0) {
+    KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
+  }
+  std::vector<FindBestSplitClass::Task> tasks;
+  for (size_t i = 0; i < splitters.size(); i++)
+    for (size_t j = 0; j < all_keys.size(); j++)
+      if (q_opts.HasQuestionsForKey(all_keys[j]))
+        tasks.push_back(FindBestSplitClass::Task(splitters[i], all_keys[j]));
+
+  std::vector<BaseFloat> improvements(tasks.size());
+  std::vector<std::vector<EventValueType> > yes_sets(tasks.size());
+  std::atomic<size_t> next_task(0);
+  {
+    FindBestSplitClass c(tasks, &next_task, &improvements, &yes_sets);
+    // num_threads == 0 means: run in this thread.  The destructor of
+    // MultiThreader waits for the threads to finish.
+    MultiThreader<FindBestSplitClass> m(
+        num_threads > 1 && tasks.size() > 1 ?
+        std::min<int32>(num_threads, tasks.size()) : 0, c);
+  }
+
+  // Pick the best key for each splitter; we go through the keys in the same
+  // order as before, so ties are broken the same way regardless of the
+  // number of threads.
+  for (size_t t = 0; t < tasks.size(); t++) {
+    DecisionTreeSplitter *splitter = tasks[t].first;
+    if (improvements[t] > splitter->best_split_impr_) {
+      splitter->best_split_impr_ = improvements[t];
+      splitter->yes_set_.swap(yes_sets[t]);
+      splitter->key_ = tasks[t].second;
+    }
+  }
+}
+
 EventMap *SplitDecisionTree(const EventMap &input_map,
                             const BuildTreeStatsType &stats,
                             Questions &q_opts,
@@ -536,7 +614,8 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *obj_impr_out,
-                            BaseFloat *smallest_split_change_out) {
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads) {
   KALDI_ASSERT(num_leaves != NULL && *num_leaves > 0);  // can't be 0 or input_map would be empty.
   int32 num_empty_leaves = 0;
   BaseFloat like_impr = 0.0;
@@ -551,8 +630,10 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
     for (size_t i = 0;i < split_stats.size();i++) {
       EventAnswerType leaf = static_cast<EventAnswerType>(i);
       if (split_stats[i].size() == 0) num_empty_leaves++;
-      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts);
+      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts,
+                                             num_threads);
     }
+    DecisionTreeSplitter::FindBestSplits(builders, num_threads);
   }
 
   {  // Do the splitting.
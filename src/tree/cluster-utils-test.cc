@@ -53,6 +53,32 @@ static void TestClusterUtils() {  // just some very basic tests of the GaussClus
     delete v[i];
 }
 
+// Checks that the GaussClusterable versions of ObjfPlus(), ObjfMinus() and
+// Distance() agree with computing them from a copy of the stats.
+static void TestGaussClusterableObjf() {
+  for (int32 n = 0; n < 10; n++) {
+    int32 dim = 1 + Rand() % 20;
+    BaseFloat var_floor = (Rand() % 2 == 0 ? 0.0 : 0.5);
+    GaussClusterable a(dim, var_floor), b(dim, var_floor);
+    for (int32 i = 0; i < 1 + Rand() % 10; i++) {
+      Vector<BaseFloat> vec(dim);
+      vec.SetRandn();
+      a.AddStats(vec, RandUniform());
+      if (i % 2 == 0) b.AddStats(vec, RandUniform());
+    }
+    a.Add(b);  // make sure a - b has positive count.
+    Clusterable *plus = a.Copy(), *minus = a.Copy();
+    plus->Add(b);
+    minus->Sub(b);
+    AssertEqual(a.ObjfPlus(b), plus->Objf());
+    AssertEqual(a.ObjfMinus(b), minus->Objf());
+    AssertEqual(a.Distance(b),
+                std::max<BaseFloat>(0.0, a.Objf() + b.Objf() - plus->Objf()));
+    delete plus;
+    delete minus;
+  }
+}
+
 static void TestClusterUtilsVector() {  // just some very basic tests of the VectorClusterable class.
   size_t dim = 2 + Rand() % 10;
   size_t num_vectors = 1 + Rand() % 10;
@@ -282,6 +308,37 @@ static void TestClusterBottomUp() {
 }
 
 
+// Checks that ClusterBottomUp() gives the same result with multiple threads.
+// The threshold for using threads is lowered on some iterations so that the
+// distances after each merge are also computed by multiple threads.
+static void TestClusterBottomUpThreaded() {
+  for (int32 n = 0; n < 6; n++) {
+    g_bottom_up_min_threaded_distances = (n % 2 == 0 ? 1000 :
+                                          1 + Rand() % 20);
+    int32 dim = 1 + Rand() % 5, num_points = 50 + Rand() % 100;
+    std::vector<Clusterable*> points(num_points);
+    for (int32 i = 0; i < num_points; i++) {
+      GaussClusterable *gc = new GaussClusterable(dim, 0.01);
+      for (int32 j = 0; j < 1 + Rand() % 5; j++) {
+        Vector<BaseFloat> vec(dim);
+        vec.SetRandn();
+        gc->AddStats(vec);
+      }
+      points[i] = gc;
+    }
+    int32 min_clust = 1 + Rand() % 10;
+    std::vector<int32> assignments, assignments2;
+    BaseFloat ans = ClusterBottomUp(points, 1.0e+10, min_clust, NULL,
+                                    &assignments),
+        ans2 = ClusterBottomUp(points, 1.0e+10, min_clust, NULL,
+                               &assignments2, 2 + Rand() % 3);
+    KALDI_ASSERT(ans == ans2 && assignments == assignments2);
+    DeletePointers(&points);
+  }
+  g_bottom_up_min_threaded_distances = 1000;
+}
+
+
 static void TestRefineClusters() {
   for (size_t n = 0;n < 4;n++) {
     // Test it by creating a random clustering and verifying that it does not make it worse, and
@@ -561,6 +618,7 @@ int main() {
   TestAddToClustersOptimized();
   TestObjfPlus();
   TestObjfMinus();
+  TestGaussClusterableObjf();
   TestDistance();
   TestSumObjfAndSumNormalizer();
   TestSum();
@@ -571,6 +629,7 @@ int main() {
   TestClusterKMeans();
   TestClusterKMeansVector();
   TestClusterBottomUp();
+  TestClusterBottomUpThreaded();
   TestRefineClusters();
 }
 
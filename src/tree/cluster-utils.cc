@@ -25,7 +25,9 @@ using std::vector;
 
 #include "base/kaldi-math.h"
 #include "util/stl-utils.h"
+#include "util/kaldi-thread.h"
 #include "tree/cluster-utils.h"
+#include "tree/clusterable-classes.h"
 
 namespace kaldi {
 
@@ -196,11 +198,13 @@ class BottomUpClusterer {
                     BaseFloat max_merge_thresh,
                     int32 min_clust,
                     std::vector<Clusterable*> *clusters_out,
-                    std::vector<int32> *assignments_out)
+                    std::vector<int32> *assignments_out,
+                    int32 num_threads)
       : ans_(0.0), points_(points), max_merge_thresh_(max_merge_thresh),
         min_clust_(min_clust), clusters_(clusters_out != NULL? clusters_out
             : &tmp_clusters_), assignments_(assignments_out != NULL ?
-                assignments_out : &tmp_assignments_) {
+                assignments_out : &tmp_assignments_),
+        num_threads_(num_threads) {
     nclusters_ = npoints_ = points.size();
     dist_vec_.resize((npoints_ * (npoints_ - 1)) / 2);
   }
@@ -220,6 +224,25 @@ class BottomUpClusterer {
   /// Reconstructs the priority queue from the distances.
   void ReconstructQueue();
 
+  /// This class computes distances in parallel, writing them to dist_vec_.  If
+  /// cluster == -1 it computes all the pairwise distances between the initial
+  /// clusters; otherwise it computes the distances between cluster "cluster"
+  /// and all the other existing clusters.
+  class DistanceComputer: public MultiThreadable {
+   public:
+    DistanceComputer(BottomUpClusterer *clusterer, int32 cluster):
+        clusterer_(clusterer), cluster_(cluster) { }
+    void operator () ();
+   private:
+    BottomUpClusterer *clusterer_;
+    int32 cluster_;
+  };
+  /// Calls DistanceComputer with the appropriate number of threads.
+  void ComputeDistances(int32 cluster);
+  /// Returns the same as (*clusters_)[i]->Distance(*((*clusters_)[j])), but
+  /// uses the cached objective functions of the clusters.
+  BaseFloat ComputeDistance(int32 i, int32 j) const;
+
   void SetDistance(int32 i, int32 j);
   BaseFloat& Distance(int32 i, int32 j) {
     KALDI_ASSERT(i < npoints_ && j < i);
@@ -237,8 +260,10 @@ class BottomUpClusterer {
   std::vector<int32> tmp_assignments_;
 
   std::vector<BaseFloat> dist_vec_;
+  std::vector<BaseFloat> objf_;  // objf_[i] is (*clusters_)[i]->Objf().
   int32 nclusters_;
   int32 npoints_;
+  int32 num_threads_;
   typedef std::pair<BaseFloat, std::pair<uint_smaller, uint_smaller> > QueueElement;
   // Priority queue using greater (lowest distances are highest priority).
   typedef std::priority_queue<QueueElement, std::vector<QueueElement>,
@@ -316,17 +341,59 @@ void BottomUpClusterer::Renumber() {
 void BottomUpClusterer::InitializeAssignments() {
   clusters_->resize(npoints_);
   assignments_->resize(npoints_);
+  objf_.resize(npoints_);
   for (int32 i = 0; i < npoints_; i++) {  // initialize as 1-1 mapping.
     (*clusters_)[i] = points_[i]->Copy();
     (*assignments_)[i] = i;
+    objf_[i] = (*clusters_)[i]->Objf();
+  }
+}
+
+void BottomUpClusterer::DistanceComputer::operator () () {
+  const std::vector<Clusterable*> &clusters = *(clusterer_->clusters_);
+  int32 npoints = clusterer_->npoints_;
+  if (cluster_ == -1) {
+    // Interleave the rows between threads; row i has i elements.
+    for (int32 i = thread_id_; i < npoints; i += num_threads_)
+      for (int32 j = 0; j < i; j++)
+        clusterer_->Distance(i, j) = clusterer_->ComputeDistance(i, j);
+  } else {
+    int32 i = cluster_;
+    for (int32 k = thread_id_; k < npoints; k += num_threads_) {
+      if (k != i && clusters[k] != NULL) {
+        if (k < i)
+          clusterer_->Distance(i, k) = clusterer_->ComputeDistance(i, k);
+        else
+          clusterer_->Distance(k, i) = clusterer_->ComputeDistance(k, i);
+      }
+    }
   }
 }
 
+BaseFloat BottomUpClusterer::ComputeDistance(int32 i, int32 j) const {
+  return DistanceFromObjfs(objf_[i], objf_[j],
+                           (*clusters_)[i]->ObjfPlus(*((*clusters_)[j])));
+}
+
+void BottomUpClusterer::ComputeDistances(int32 cluster) {
+  // Only use threads if there is enough work to be worth starting them.  After
+  // a merge, only the distances to the remaining clusters are computed.
+  int64 num_distances = (cluster == -1 ?
+                         (static_cast<int64>(npoints_) * (npoints_ - 1)) / 2 :
+                         nclusters_ - 1);
+  int32 num_threads = (num_threads_ > 1 &&
+                       num_distances >= g_bottom_up_min_threaded_distances ?
+                       num_threads_ : 0);  // 0 means: use this thread.
+  DistanceComputer c(this, cluster);
+  // The destructor of MultiThreader waits for the threads to finish.
+  MultiThreader<DistanceComputer> m(num_threads, c);
+}
+
 void BottomUpClusterer::SetInitialDistances() {
+  ComputeDistances(-1);
   for (int32 i = 0; i < npoints_; i++) {
     for (int32 j = 0; j < i; j++) {
-      BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-      dist_vec_[(i * (i - 1)) / 2 + j] = dist;
+      BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
       if (dist <= max_merge_thresh_)
         queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
             static_cast<uint_smaller>(j))));
@@ -345,6 +412,7 @@ bool BottomUpClusterer::CanMerge(int32 i, int32 j, BaseFloat dist) {
 void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
   KALDI_ASSERT(i != j && i < npoints_ && j < npoints_);
   (*clusters_)[i]->Add(*((*clusters_)[j]));
+  objf_[i] = (*clusters_)[i]->Objf();
   delete (*clusters_)[j];
   (*clusters_)[j] = NULL;
   // note that we may have to follow the chain within "assignment_" to get
@@ -355,6 +423,7 @@ void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
   ans_ -= dist_vec_[(i * (i - 1)) / 2 + j];
   nclusters_--;
   // Now update "distances".
+  ComputeDistances(i);
   for (int32 k = 0; k < npoints_; k++) {
     if (k != i && (*clusters_)[k] != NULL) {
       if (k < i)
@@ -389,8 +458,8 @@ void BottomUpClusterer::ReconstructQueue() {
 void BottomUpClusterer::SetDistance(int32 i, int32 j) {
   KALDI_ASSERT(i < npoints_ && j < i && (*clusters_)[i] != NULL
          && (*clusters_)[j] != NULL);
-  BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-  dist_vec_[(i * (i - 1)) / 2 + j] = dist;  // set the distance in the array.
+  // The distance has already been set in the array by ComputeDistances().
+  BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
   if (dist < max_merge_thresh_) {
     queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
         static_cast<uint_smaller>(j))));
@@ -404,11 +473,14 @@ void BottomUpClusterer::SetDistance(int32 i, int32 j) {
 
 
 
+int32 g_bottom_up_min_threaded_distances = 1000;
+
 BaseFloat ClusterBottomUp(const std::vector<Clusterable*> &points,
                           BaseFloat max_merge_thresh,
                           int32 min_clust,
                           std::vector<Clusterable*> *clusters_out,
-                          std::vector<int32> *assignments_out) {
+                          std::vector<int32> *assignments_out,
+                          int32 num_threads) {
   KALDI_ASSERT(max_merge_thresh >= 0.0 && min_clust >= 0);
   KALDI_ASSERT(!ContainsNullPointers(points));
   int32 npoints = points.size();
@@ -417,7 +489,8 @@ BaseFloat ClusterBottomUp(const std::vector<Clusterable*> &points,
                npoints < static_cast<int32>(static_cast<uint_smaller>(-1)));
 
   KALDI_VLOG(2) << "Initializing clustering object.";
-  BottomUpClusterer bc(points, max_merge_thresh, min_clust, clusters_out, assignments_out);
+  BottomUpClusterer bc(points, max_merge_thresh, min_clust, clusters_out,
+                       assignments_out, num_threads);
   BaseFloat ans = bc.Cluster();
   if (clusters_out) KALDI_ASSERT(!ContainsNullPointers(*clusters_out));
   return ans;
@@ -732,18 +805,14 @@ class RefineClusterer {
     std::vector<std::pair<BaseFloat, LocalInt> > distances;
     distances.reserve(num_clust_-1);
     int32 my_clust = (*assignments_)[point];
-    Clusterable *point_cl = points_[point];
 
     for (int32 clust = 0;clust < num_clust_;clust++) {
       if (clust != my_clust) {
-        Clusterable *tmp = (*clusters_)[clust]->Copy();
-        tmp->Add(*point_cl);
         BaseFloat other_clust_objf = clust_objf_[clust];
         BaseFloat other_clust_plus_me_objf = (*clusters_)[clust]->ObjfPlus(* (points_[point]));
 
         BaseFloat distance = other_clust_objf-other_clust_plus_me_objf;  // negated delta-objf, with only "varying" terms.
         distances.push_back(std::make_pair(distance, (LocalInt)clust));
-        delete tmp;
       }
     }
     if ((cfg_.top_n-1-1) >= 0) {
@@ -847,15 +916,15 @@ class RefineClusterer {
   void UpdateInfo(int32 point, int32 idx) {
     point_info &pinfo = GetInfo(point, idx);
     if (pinfo.time < clust_time_[pinfo.clust]) {  // it's not up-to-date...
-      Clusterable *tmp_cl = (*clusters_)[pinfo.clust]->Copy();
+      const Clusterable *cl = (*clusters_)[pinfo.clust];
+      pinfo.time = t_;
+      // ObjfMinus() and ObjfPlus() may be overridden to avoid copying the
+      // cluster's stats.
       if (idx == my_clust_index_[point]) {
-        tmp_cl->Sub( *(points_[point]) );
-      } else{
-        tmp_cl->Add( *(points_[point]) );
+        pinfo.objf = cl->ObjfMinus( *(points_[point]) );
+      } else {
+        pinfo.objf = cl->ObjfPlus( *(points_[point]) );
       }
-      pinfo.time = t_;
-      pinfo.objf = tmp_cl->Objf();
-      delete tmp_cl;
     }
   }
 
@@ -103,6 +103,8 @@ void AddToClustersOptimized(const std::vector<Clusterable*> &stats,
  *  @param assignments_out [out] If non-NULL, will be resized to the number of
  *                 points, and each element is the index of the cluster that point
  *                 was assigned to.
+ *  @param num_threads [in] Number of threads used to compute the distances
+ *                 between clusters; does not affect the result.
  *  @return Returns the total objf change relative to all clusters being separate, which is
  *    a negative.  Note that this is not the same as what the other clustering algorithms return.
  */
@@ -110,7 +112,14 @@ BaseFloat ClusterBottomUp(const std::vector<Clusterable*> &points,
                           BaseFloat thresh,
                           int32 min_clust,
                           std::vector<Clusterable*> *clusters_out,
-                          std::vector<int32> *assignments_out);
+                          std::vector<int32> *assignments_out,
+                          int32 num_threads = 1);
+
+/// ClusterBottomUp() only uses multiple threads for a batch of distance
+/// computations (all initial distances, or the distances to a newly merged
+/// cluster) if the batch has at least this many distances.  Default 1000; it
+/// is a variable so that the tests can exercise the threaded code.
+extern int32 g_bottom_up_min_threaded_distances;
 
 /** This is a bottom-up clustering where the points are pre-clustered in a set
  *  of compartments, such that only points in the same compartment are clustered
@@ -49,16 +49,22 @@ BaseFloat Clusterable::ObjfMinus(const Clusterable &other) const {
 BaseFloat Clusterable::Distance(const Clusterable &other) const {
   Clusterable *copy = this->Copy();
   copy->Add(other);
-  BaseFloat ans = this->Objf() + other.Objf() - copy->Objf();
+  BaseFloat ans = DistanceFromObjfs(this->Objf(), other.Objf(), copy->Objf());
+  delete copy;
+  return ans;
+}
+
+BaseFloat DistanceFromObjfs(BaseFloat objf1, BaseFloat objf2,
+                            BaseFloat objf_plus) {
+  BaseFloat ans = objf1 + objf2 - objf_plus;
   if (ans < 0) {
     // This should not happen. Check if it is more than just rounding error.
-    if (std::fabs(ans) > 0.01 * (1.0 + std::fabs(copy->Objf()))) {
+    if (std::fabs(ans) > 0.01 * (1.0 + std::fabs(objf_plus))) {
       KALDI_WARN << "Negative number returned (badly defined Clusterable "
                  << "class?): ans= " << ans;
     }
     ans = 0;
   }
-  delete copy;
   return ans;
 }
 
@@ -191,32 +197,77 @@ void GaussClusterable::Read(std::istream &is, bool binary) {
 }
 
 BaseFloat GaussClusterable::Objf() const {
-  if (count_ <= 0.0) {
-    if (count_ < -0.1) {
-      KALDI_WARN << "GaussClusterable::Objf(), count is negative " << count_;
+  return ObjfPlusScaled(NULL, 0.0);
+}
+
+BaseFloat GaussClusterable::ObjfPlusScaled(const GaussClusterable *other,
+                                           double scale) const {
+  double count = count_;
+  if (other != NULL) {
+    KALDI_ASSERT(other->stats_.NumCols() == stats_.NumCols());
+    count += scale * other->count_;
+  }
+  if (count <= 0.0) {
+    if (count < -0.1) {
+      KALDI_WARN << "GaussClusterable::Objf(), count is negative " << count;
     }
     return 0.0;
   } else {
     size_t dim = stats_.NumCols();
-    Vector<double> vars(dim);
+    const double *x = stats_.RowData(0), *x2 = stats_.RowData(1),
+        *other_x = (other != NULL ? other->stats_.RowData(0) : NULL),
+        *other_x2 = (other != NULL ? other->stats_.RowData(1) : NULL);
     double objf_per_frame = 0.0;
+    // We compute the sum of the log-variances in the same way as
+    // VectorBase::SumLog(), without storing the variances.
+    double sum_log = 0.0, prod = 1.0;
     for (size_t d = 0; d < dim; d++) {
-      double mean(stats_(0, d) / count_), var = stats_(1, d) / count_ - mean
+      double this_x = x[d], this_x2 = x2[d];
+      if (other != NULL) {
+        this_x += scale * other_x[d];
+        this_x2 += scale * other_x2[d];
+      }
+      double mean(this_x / count), var = this_x2 / count - mean
           * mean, floored_var = std::max(var, var_floor_);
-      vars(d) = floored_var;
       objf_per_frame += -0.5 * var / floored_var;
+      prod *= floored_var;
+      if (prod < 1.0e-10 || prod > 1.0e+10) {
+        sum_log += Log(prod);
+        prod = 1.0;
+      }
     }
-    objf_per_frame += -0.5 * (vars.SumLog() + M_LOG_2PI * dim);
+    if (prod != 1.0) sum_log += Log(prod);
+    objf_per_frame += -0.5 * (sum_log + M_LOG_2PI * dim);
     if (KALDI_ISNAN(objf_per_frame)) {
       KALDI_WARN << "GaussClusterable::Objf(), objf is NaN";
       return 0.0;
     }
-    // KALDI_VLOG(2) << "count = " << count_ << ", objf_per_frame = "<< objf_per_frame
-    //   << ", returning " << (objf_per_frame*count_) << ", floor = " << var_floor_;
-    return objf_per_frame * count_;
+    return objf_per_frame * count;
   }
 }
 
+BaseFloat GaussClusterable::ObjfPlus(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  const GaussClusterable *other =
+      static_cast<const GaussClusterable*>(&other_in);
+  return ObjfPlusScaled(other, 1.0);
+}
+
+BaseFloat GaussClusterable::ObjfMinus(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  const GaussClusterable *other =
+      static_cast<const GaussClusterable*>(&other_in);
+  return ObjfPlusScaled(other, -1.0);
+}
+
+BaseFloat GaussClusterable::Distance(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  const GaussClusterable *other =
+      static_cast<const GaussClusterable*>(&other_in);
+  return DistanceFromObjfs(this->Objf(), other->Objf(),
+                           ObjfPlusScaled(other, 1.0));
+}
+
 
 // ============================================================================
 // Implementation of VectorClusterable class.
@@ -83,6 +83,12 @@ class GaussClusterable: public Clusterable {
   virtual void Scale(BaseFloat f);
   virtual void Write(std::ostream &os, bool binary) const;
   virtual Clusterable *ReadNew(std::istream &is, bool binary) const;
+  // ObjfPlus(), ObjfMinus() and Distance() are overridden for speed: they
+  // give the same answer as the default implementations, but without
+  // allocating a temporary copy of the stats.
+  virtual BaseFloat ObjfPlus(const Clusterable &other) const;
+  virtual BaseFloat ObjfMinus(const Clusterable &other) const;
+  virtual BaseFloat Distance(const Clusterable &other) const;
   virtual ~GaussClusterable() {}
 
   BaseFloat count() const { return count_; }
@@ -94,9 +100,20 @@ class GaussClusterable: public Clusterable {
   Matrix<double> stats_; // two rows: sum, then sum-squared.
   double var_floor_;  // should be common for all objects created.
 
+  // Returns the objective function of the stats of *this plus "scale" times
+  // the stats of "other" (if other != NULL), where scale is 1 or -1.
+  BaseFloat ObjfPlusScaled(const GaussClusterable *other, double scale) const;
+
   void Read(std::istream &is, bool binary);
 };
 
+/// Returns objf1 + objf2 - objf_plus, which is the distance (negated objective
+/// function change) from merging two clusters with objective functions objf1
+/// and objf2 into one with objective function objf_plus.  It is floored at
+/// zero, with a warning if it was more negative than rounding error allows.
+BaseFloat DistanceFromObjfs(BaseFloat objf1, BaseFloat objf2,
+                            BaseFloat objf_plus);
+
 /// @} end of "addtogroup clustering_group"
 
 inline void GaussClusterable::SetZero() {
@@ -0,0 +1,363 @@
+// util/kaldi-compressed-filebuf.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-compressed-filebuf.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace kaldi {
+
+CompressionOptions g_compression_options;
+
+// The size of the buffer of uncompressed data.
+static const size_t kCompressedFilebufSize = 1 << 17;
+
+static bool EndsWith(const std::string &s, const char *suffix) {
+  size_t len = std::strlen(suffix);
+  return s.size() > len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+CompressionFormat GetCompressionFormat(const std::string &filename) {
+#ifdef HAVE_ZLIB
+  if (EndsWith(filename, ".gz"))
+    return kGzipCompression;
+#endif
+#ifdef HAVE_ZSTD
+  if (EndsWith(filename, ".zst"))
+    return kZstdCompression;
+#endif
+  return kNoCompression;
+}
+
+CompressedFilebuf::CompressedFilebuf():
+    format_(kNoCompression), writing_(false), error_(false),
+    buffer_start_(0), gz_file_(NULL), file_(NULL), zstd_in_pos_(0),
+    zstd_in_size_(0), zstd_ret_(0), zstd_dctx_(NULL), zstd_cctx_(NULL) { }
+
+bool CompressedFilebuf::OpenRead(const std::string &filename,
+                                 CompressionFormat format) {
+  KALDI_ASSERT(!IsOpen());
+  filename_ = filename;
+  writing_ = false;
+  error_ = false;
+  buffer_start_ = 0;
+  if (format == kGzipCompression) {
+#ifdef HAVE_ZLIB
+    if ((gz_file_ = gzopen(filename.c_str(), "rb")) == NULL)
+      return false;
+    gzbuffer(gz_file_, kCompressedFilebufSize);
+#endif
+  } else if (format == kZstdCompression) {
+#ifdef HAVE_ZSTD
+    if ((file_ = std::fopen(filename.c_str(), "rb")) == NULL)
+      return false;
+    zstd_dctx_ = ZSTD_createDStream();
+    ZSTD_initDStream(zstd_dctx_);
+    zstd_buffer_.resize(ZSTD_DStreamInSize());
+    zstd_in_pos_ = zstd_in_size_ = 0;
+    zstd_ret_ = 0;
+#endif
+  }
+  if (gz_file_ == NULL && file_ == NULL)
+    KALDI_ERR << "Compression format " << format << " not supported (file "
+              << filename << "); recompile with zlib or zstd.";
+  buffer_.resize(kCompressedFilebufSize);
+  setg(&(buffer_[0]), &(buffer_[0]), &(buffer_[0]));  // empty get area.
+  format_ = format;
+  return true;
+}
+
+bool CompressedFilebuf::OpenWrite(const std::string &filename,
+                                  CompressionFormat format) {
+  KALDI_ASSERT(!IsOpen());
+  filename_ = filename;
+  writing_ = true;
+  error_ = false;
+  buffer_start_ = 0;
+  int32 level = g_compression_options.level;
+  if (format == kGzipCompression) {
+#ifdef HAVE_ZLIB
+    std::ostringstream mode;
+    mode << "wb";
+    if (level >= 0)
+      mode << std::min(level, 9);
+    if ((gz_file_ = gzopen(filename.c_str(), mode.str().c_str())) == NULL)
+      return false;
+    gzbuffer(gz_file_, kCompressedFilebufSize);
+#endif
+  } else if (format == kZstdCompression) {
+#ifdef HAVE_ZSTD
+    if ((file_ = std::fopen(filename.c_str(), "wb")) == NULL)
+      return false;
+    zstd_cctx_ = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(zstd_cctx_, ZSTD_c_compressionLevel,
+                           level >= 0 ? level : ZSTD_CLEVEL_DEFAULT);
+    if (g_compression_options.num_threads > 1) {
+      size_t ret = ZSTD_CCtx_setParameter(zstd_cctx_, ZSTD_c_nbWorkers,
+                                          g_compression_options.num_threads);
+      if (ZSTD_isError(ret))
+        KALDI_WARN << "Could not compress with "
+                   << g_compression_options.num_threads << " threads (zstd "
+                   << "not compiled with multithreading?): "
+                   << ZSTD_getErrorName(ret);
+    }
+    zstd_buffer_.resize(ZSTD_CStreamOutSize());
+#endif
+  }
+  if (gz_file_ == NULL && file_ == NULL)
+    KALDI_ERR << "Compression format " << format << " not supported (file "
+              << filename << "); recompile with zlib or zstd.";
+  buffer_.resize(kCompressedFilebufSize);
+  setp(&(buffer_[0]), &(buffer_[0]) + buffer_.size());
+  format_ = format;
+  return true;
+}
+
+bool CompressedFilebuf::FillBuffer() {
+  buffer_start_ += egptr() - eback();
+  size_t num_read = 0;
+  if (!error_ && format_ == kGzipCompression) {
+#ifdef HAVE_ZLIB
+    int ret = gzread(gz_file_, &(buffer_[0]), buffer_.size()), errnum = Z_OK;
+    // At the end of a truncated file, gzread() returns 0 and sets the error
+    // to Z_BUF_ERROR.
+    const char *msg = (ret <= 0 ? gzerror(gz_file_, &errnum) : NULL);
+    if (errnum != Z_OK) {
+      KALDI_WARN << "Error reading compressed file: " << msg;
+      error_ = true;
+    } else if (ret > 0) {
+      num_read = ret;
+    }
+#endif
+  } else if (!error_ && format_ == kZstdCompression) {
+#ifdef HAVE_ZSTD
+    ZSTD_outBuffer out = { &(buffer_[0]), buffer_.size(), 0 };
+    while (out.pos == 0) {
+      if (zstd_in_pos_ == zstd_in_size_) {
+        zstd_in_size_ = std::fread(&(zstd_buffer_[0]), 1, zstd_buffer_.size(),
+                                   file_);
+        zstd_in_pos_ = 0;
+        if (zstd_in_size_ == 0) {
+          if (std::ferror(file_)) {
+            KALDI_WARN << "Error reading compressed file " << filename_;
+            error_ = true;
+          } else if (zstd_ret_ != 0) {
+            KALDI_WARN << "Compressed file " << filename_
+                       << " is truncated.";
+            error_ = true;
+          }
+          break;
+        }
+      }
+      ZSTD_inBuffer in = { &(zstd_buffer_[0]), zstd_in_size_, zstd_in_pos_ };
+      zstd_ret_ = ZSTD_decompressStream(zstd_dctx_, &out, &in);
+      zstd_in_pos_ = in.pos;
+      if (ZSTD_isError(zstd_ret_)) {
+        KALDI_WARN << "Error decompressing file " << filename_ << ": "
+                   << ZSTD_getErrorName(zstd_ret_);
+        error_ = true;
+        out.pos = 0;
+        break;
+      }
+    }
+    num_read = out.pos;
+#endif
+  }
+  setg(&(buffer_[0]), &(buffer_[0]), &(buffer_[0]) + num_read);
+  return num_read > 0;
+}
+
+bool CompressedFilebuf::FlushBuffer(bool finish) {
+  size_t num_bytes = pptr() - pbase();
+  if (!error_ && format_ == kGzipCompression) {
+#ifdef HAVE_ZLIB
+    // gzclose() finishes the stream, so "finish" needs no action here.
+    if (num_bytes > 0 &&
+        gzwrite(gz_file_, pbase(), num_bytes) != static_cast<int>(num_bytes)) {
+      int errnum;
+      KALDI_WARN << "Error writing compressed file " << filename_ << ": "
+                 << gzerror(gz_file_, &errnum);
+      error_ = true;
+    }
+#endif
+  } else if (!error_ && format_ == kZstdCompression) {
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer in = { pbase(), num_bytes, 0 };
+    while (true) {
+      ZSTD_outBuffer out = { &(zstd_buffer_[0]), zstd_buffer_.size(), 0 };
+      size_t remaining = ZSTD_compressStream2(
+          zstd_cctx_, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining)) {
+        KALDI_WARN << "Error compressing file " << filename_ << ": "
+                   << ZSTD_getErrorName(remaining);
+        error_ = true;
+        break;
+      }
+      if (out.pos > 0 &&
+          std::fwrite(out.dst, 1, out.pos, file_) != out.pos) {
+        KALDI_WARN << "Error writing compressed file " << filename_;
+        error_ = true;
+        break;
+      }
+      if (finish ? remaining == 0 : in.pos == in.size)
+        break;
+    }
+#endif
+  }
+  buffer_start_ += num_bytes;
+  setp(&(buffer_[0]), &(buffer_[0]) + buffer_.size());
+  return !error_;
+}
+
+CompressedFilebuf::int_type CompressedFilebuf::underflow() {
+  if (!IsOpen() || writing_)
+    return traits_type::eof();
+  if (gptr() < egptr() || FillBuffer())
+    return traits_type::to_int_type(*gptr());
+  return traits_type::eof();
+}
+
+CompressedFilebuf::int_type CompressedFilebuf::overflow(int_type c) {
+  if (!IsOpen() || !writing_ || !FlushBuffer(false))
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int CompressedFilebuf::sync() {
+  if (IsOpen() && writing_)
+    return FlushBuffer(false) ? 0 : -1;
+  return 0;
+}
+
+bool CompressedFilebuf::Rewind() {
+  if (format_ == kGzipCompression) {
+#ifdef HAVE_ZLIB
+    if (gzrewind(gz_file_) != 0)
+      return false;
+#endif
+  } else {
+#ifdef HAVE_ZSTD
+    if (std::fseek(file_, 0, SEEK_SET) != 0)
+      return false;
+    ZSTD_initDStream(zstd_dctx_);
+    zstd_in_pos_ = zstd_in_size_ = 0;
+    zstd_ret_ = 0;
+#endif
+  }
+  buffer_start_ = 0;
+  setg(&(buffer_[0]), &(buffer_[0]), &(buffer_[0]));
+  return true;
+}
+
+bool CompressedFilebuf::SeekRead(int64 pos) {
+  if (pos < 0 || error_)
+    return false;
+  if (pos < buffer_start_ && !Rewind())
+    return false;
+  // Decompress until "pos" is in the buffer.
+  while (pos > buffer_start_ + (egptr() - eback())) {
+    if (!FillBuffer())
+      return false;
+  }
+  setg(eback(), eback() + (pos - buffer_start_), egptr());
+  return true;
+}
+
+CompressedFilebuf::pos_type CompressedFilebuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!IsOpen())
+    return pos_type(off_type(-1));
+  if (writing_) {  // we can only tell the position.
+    if (off == 0 && dir == std::ios_base::cur)
+      return pos_type(buffer_start_ + (pptr() - pbase()));
+    return pos_type(off_type(-1));
+  }
+  int64 cur_pos = buffer_start_ + (gptr() - eback()), pos;
+  if (dir == std::ios_base::beg)
+    pos = off;
+  else if (dir == std::ios_base::cur)
+    pos = cur_pos + off;
+  else
+    return pos_type(off_type(-1));  // we don't know the size.
+  if (pos != cur_pos && !SeekRead(pos))
+    return pos_type(off_type(-1));
+  return pos_type(pos);
+}
+
+CompressedFilebuf::pos_type CompressedFilebuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+bool CompressedFilebuf::Close() {
+  if (!IsOpen())
+    return false;
+  bool ans = true;
+  if (writing_)
+    ans = FlushBuffer(true);
+  ans = ans && !error_;
+  if (gz_file_ != NULL) {
+#ifdef HAVE_ZLIB
+    // When reading, gzclose() may complain if we didn't read to the end,
+    // which is not an error for us.
+    if (gzclose(gz_file_) != Z_OK && writing_) {
+      KALDI_WARN << "Error closing compressed file " << filename_;
+      ans = false;
+    }
+#endif
+    gz_file_ = NULL;
+  }
+  if (file_ != NULL) {
+    if (std::fclose(file_) != 0 && writing_) {
+      KALDI_WARN << "Error closing compressed file " << filename_;
+      ans = false;
+    }
+    file_ = NULL;
+  }
+#ifdef HAVE_ZSTD
+  ZSTD_freeDStream(zstd_dctx_);
+  ZSTD_freeCCtx(zstd_cctx_);
+#endif
+  zstd_dctx_ = NULL;
+  zstd_cctx_ = NULL;
+  format_ = kNoCompression;
+  setg(NULL, NULL, NULL);
+  setp(NULL, NULL);
+  return ans;
+}
+
+CompressedFilebuf::~CompressedFilebuf() {
+  if (IsOpen() && !Close() && writing_)
+    KALDI_WARN << "Error closing compressed file " << filename_;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,138 @@
+// util/kaldi-compressed-filebuf.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_COMPRESSED_FILEBUF_H_
+#define KALDI_UTIL_KALDI_COMPRESSED_FILEBUF_H_
+
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+
+// Declared in zlib.h and zstd.h; we don't include those here so that code that
+// includes this header doesn't depend on them.
+struct gzFile_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CCtx_s;
+
+namespace kaldi {
+
+/// This file provides reading and writing of compressed files inside the
+/// program, as an alternative to pipes like "gunzip -c foo.ark.gz |", which
+/// fork a process for each file.  Kaldi's Input and Output classes (see
+/// kaldi-io.h) use it for filenames ending in ".gz" (if Kaldi was compiled
+/// with zlib, i.e. with -DHAVE_ZLIB) and ".zst" (if compiled with zstd,
+/// i.e. with -DHAVE_ZSTD).
+
+enum CompressionFormat {
+  kNoCompression,
+  kGzipCompression,
+  kZstdCompression
+};
+
+/// Returns the compression format implied by the extension of "filename"
+/// (".gz" or ".zst"), or kNoCompression if there is no such extension or if
+/// Kaldi was not compiled with support for that format.
+CompressionFormat GetCompressionFormat(const std::string &filename);
+
+struct CompressionOptions {
+  // The number of threads zstd uses to compress; 1 means compress in the
+  // calling thread.  Ignored for gzip.  Set by the standard option
+  // --compression-threads, which all programs that use ParseOptions accept.
+  int32 num_threads;
+  // The compression level; -1 means the default of the format (6 for gzip, 3
+  // for zstd).
+  int32 level;
+  CompressionOptions(): num_threads(1), level(-1) { }
+};
+
+/// The options used when writing compressed files.
+extern CompressionOptions g_compression_options;
+
+/// A stream buffer that reads or writes a compressed file.  While reading, it
+/// supports seeking to positions in the uncompressed data (which it does by
+/// decompressing, and by going back to the start of the file for backward
+/// seeks); while writing, it supports getting the current position in the
+/// uncompressed data.  This is enough for Kaldi archives and their scp files
+/// (e.g. foo.ark.gz:1234), although random access will be slow.
+class CompressedFilebuf: public std::streambuf {
+ public:
+  CompressedFilebuf();
+
+  /// Opens "filename" for reading; returns false on failure.
+  bool OpenRead(const std::string &filename, CompressionFormat format);
+
+  /// Opens "filename" for writing; returns false on failure.  Uses
+  /// g_compression_options.
+  bool OpenWrite(const std::string &filename, CompressionFormat format);
+
+  bool IsOpen() const { return format_ != kNoCompression; }
+
+  /// Closes the file.  While writing, this finishes the compressed stream.
+  /// Returns false if there was any error (e.g. a write error, or corrupted or
+  /// truncated input).
+  bool Close();
+
+  ~CompressedFilebuf();
+
+ protected:
+  virtual int_type underflow();
+  virtual int_type overflow(int_type c);
+  virtual int sync();
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+ private:
+  // Reads and decompresses more data into buffer_, and sets the get area to
+  // it.  Returns false at end of file or on error.
+  bool FillBuffer();
+  // Compresses and writes out the contents of the put area; if "finish" is
+  // true, ends the compressed stream.  Returns false on error.
+  bool FlushBuffer(bool finish);
+  // Moves to "pos" in the uncompressed data, while reading.
+  bool SeekRead(int64 pos);
+  // Goes back to the start of the file, while reading.
+  bool Rewind();
+
+  CompressionFormat format_;  // kNoCompression if not open.
+  bool writing_;
+  bool error_;
+  std::string filename_;
+  std::vector<char> buffer_;  // the get or put area (uncompressed data).
+  // position in the uncompressed data of the start of buffer_.
+  int64 buffer_start_;
+  gzFile_s *gz_file_;  // for gzip.
+  FILE *file_;  // for zstd.
+  std::vector<char> zstd_buffer_;  // compressed data, for zstd.
+  // While reading zstd, zstd_buffer_[zstd_in_pos_ .. zstd_in_size_ - 1] is
+  // the data that has been read but not yet decompressed.
+  size_t zstd_in_pos_;
+  size_t zstd_in_size_;
+  size_t zstd_ret_;  // the last return value of ZSTD_decompressStream(); zero
+                     // at the end of a frame.
+  ZSTD_DCtx_s *zstd_dctx_;
+  ZSTD_CCtx_s *zstd_cctx_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CompressedFilebuf);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_COMPRESSED_FILEBUF_H_
@@ -112,12 +112,53 @@ template<class KaldiType> class KaldiObjectHolder {
     return ExtractObjectRange(*(other.t_), range, t_);
   }
 
+  // Reads only the part of the object given by "range" (see
+  // ReadObjectRange() in kaldi-holder.h) if ObjectRangeIsCheap(), else the
+  // whole object; this is used via ReadHolderRange().
+  bool ReadRange(std::istream &is, const std::string &range, bool *is_range) {
+    delete t_;
+    t_ = new T;
+    bool is_binary;
+    if (!InitKaldiInputStream(is, &is_binary)) {
+      KALDI_WARN << "Reading Table object, failed reading binary header\n";
+      return false;
+    }
+    try {
+      *is_range = ObjectRangeIsCheap(is, is_binary, *t_);
+      if (*is_range)
+        return ReadObjectRange(is, is_binary, range, t_);
+      t_->Read(is, is_binary);
+      return true;
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Exception caught reading Table object. " << e.what();
+      delete t_;
+      t_ = NULL;
+      return false;
+    }
+  }
+
   ~KaldiObjectHolder() { delete t_; }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiObjectHolder);
   T *t_;
 };
 
+// Matrices can be read in part; see HolderCanReadRange() in kaldi-holder.h.
+template<class Real>
+bool HolderCanReadRange(const KaldiObjectHolder<Matrix<Real> > &holder) {
+  return true;
+}
+
+inline bool HolderCanReadRange(const KaldiObjectHolder<GeneralMatrix> &holder) {
+  return true;
+}
+
+template<class T>
+bool ReadHolderRange(std::istream &is, const std::string &range,
+                     KaldiObjectHolder<T> *holder, bool *is_range) {
+  return holder->ReadRange(is, range, is_range);
+}
+
 
 // BasicHolder is valid for float, double, bool, and integer
 // types.  There will be a compile time error otherwise, because
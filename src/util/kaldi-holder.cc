@@ -160,6 +160,120 @@ template bool ExtractObjectRange(const Matrix<double> &, const std::string &,
 template bool ExtractObjectRange(const Matrix<float> &, const std::string &,
                                  Matrix<float> *);
 
+// Skips "num_bytes" bytes of the stream "is", by seeking if the stream
+// supports it and otherwise by reading.
+static void SkipBytes(std::istream &is, int64 num_bytes) {
+  if (num_bytes == 0) return;
+  if (!is.seekg(num_bytes, std::ios_base::cur)) {
+    // e.g. it's a pipe.
+    is.clear();
+    is.ignore(num_bytes);
+  }
+}
+
+// Reads the rows of the matrix we need, given that the stream is at the
+// start of the data of a rows by cols matrix of type OtherReal, and
+// that we need "output" starting from row "row_offset" and column
+// "col_offset".
+template<class Real, class OtherReal>
+static void ReadMatrixRows(std::istream &is, int32 rows, int32 cols,
+                           int32 row_offset, int32 col_offset,
+                           Matrix<Real> *output) {
+  int32 num_rows = output->NumRows(), num_cols = output->NumCols();
+  SkipBytes(is, static_cast<int64>(row_offset) * cols * sizeof(OtherReal));
+  if (sizeof(Real) == sizeof(OtherReal) && num_cols == cols) {
+    // We can read straight into the output.
+    for (int32 r = 0; r < num_rows; r++)
+      is.read(reinterpret_cast<char*>(output->RowData(r)),
+              sizeof(Real) * cols);
+  } else {
+    Vector<OtherReal> row(cols, kUndefined);
+    for (int32 r = 0; r < num_rows; r++) {
+      is.read(reinterpret_cast<char*>(row.Data()), sizeof(OtherReal) * cols);
+      output->Row(r).CopyFromVec(row.Range(col_offset, num_cols));
+    }
+  }
+  if (is.fail())
+    KALDI_ERR << "Failed to read matrix from stream";
+}
+
+template<class Real>
+bool ReadObjectRange(std::istream &is, bool binary, const std::string &range,
+                     Matrix<Real> *output) {
+  if (!binary) {
+    // There is no way to find the rows without parsing the whole matrix.
+    Matrix<Real> whole;
+    whole.Read(is, binary);
+    return ExtractObjectRange(whole, range, output);
+  }
+  if (Peek(is, binary) == 'C') {
+    // The compressed data is small; what we avoid is decompressing the whole
+    // matrix.
+    CompressedMatrix compressed;
+    compressed.Read(is, binary);
+    return ExtractObjectRange(compressed, range, output);
+  }
+  std::string token;
+  ReadToken(is, binary, &token);
+  if (token != "FM" && token != "DM")
+    KALDI_ERR << "Expected token FM or DM, got " << token;
+  int32 rows, cols;
+  ReadBasicType(is, binary, &rows);
+  ReadBasicType(is, binary, &cols);
+  std::vector<int32> row_range, col_range;
+  if (!ParseMatrixRangeSpecifier(range, rows, cols, &row_range, &col_range))
+    KALDI_ERR << "Could not parse range specifier \"" << range << "\".";
+  int32 num_rows = std::min(row_range[1], rows - 1) - row_range[0] + 1,
+      num_cols = col_range[1] - col_range[0] + 1;
+  output->Resize(num_rows, num_cols, kUndefined);
+  if (token == "FM")
+    ReadMatrixRows<Real, float>(is, rows, cols, row_range[0], col_range[0],
+                                output);
+  else
+    ReadMatrixRows<Real, double>(is, rows, cols, row_range[0], col_range[0],
+                                 output);
+  return true;
+}
+
+template bool ReadObjectRange(std::istream &, bool, const std::string &,
+                              Matrix<float> *);
+template bool ReadObjectRange(std::istream &, bool, const std::string &,
+                              Matrix<double> *);
+
+template<class Real>
+bool ObjectRangeIsCheap(std::istream &is, bool binary,
+                        const Matrix<Real> &obj) {
+  if (!binary)
+    return false;
+  int c = Peek(is, binary);
+  return c == 'F' || c == 'D';  // "FM" or "DM", not compressed ("CM").
+}
+
+template bool ObjectRangeIsCheap(std::istream &, bool, const Matrix<float> &);
+template bool ObjectRangeIsCheap(std::istream &, bool, const Matrix<double> &);
+
+bool ObjectRangeIsCheap(std::istream &is, bool binary,
+                        const GeneralMatrix &obj) {
+  // A full matrix is written just as for class Matrix.
+  return ObjectRangeIsCheap(is, binary, Matrix<BaseFloat>());
+}
+
+bool ReadObjectRange(std::istream &is, bool binary, const std::string &range,
+                     GeneralMatrix *output) {
+  if (!binary || is.peek() == 'S') {
+    // A sparse or text-mode matrix; we don't handle these efficiently.
+    GeneralMatrix whole;
+    whole.Read(is, binary);
+    return ExtractObjectRange(whole, range, output);
+  }
+  Matrix<BaseFloat> mat;
+  if (!ReadObjectRange(is, binary, range, &mat))
+    return false;
+  output->Clear();
+  output->SwapFullMatrix(&mat);
+  return true;
+}
+
 template<class Real>
 bool ExtractObjectRange(const Vector<Real> &input, const std::string &range,
                         Vector<Real> *output) {
@@ -259,6 +259,77 @@ template <class Real>
 bool ExtractObjectRange(const CompressedMatrix &input, const std::string &range,
                         Matrix<Real> *output);
 
+/// ReadObjectRange() reads, from a stream positioned just after the
+/// binary-mode header of an object (i.e. where T::Read() would start), only the
+/// part of the object given by "range", as for ExtractObjectRange().  It throws
+/// on error, and leaves the stream at an unspecified position inside the
+/// object.  The generic version reads the whole object and calls
+/// ExtractObjectRange().
+template <class T>
+bool ReadObjectRange(std::istream &is, bool binary, const std::string &range,
+                     T *output) {
+  T whole;
+  whole.Read(is, binary);
+  return ExtractObjectRange(whole, range, output);
+}
+
+/// For matrices in binary mode, this reads only the requested rows, skipping
+/// over the others (by seeking if the stream supports it, e.g. for archives);
+/// for compressed matrices, it decompresses only the requested part.  In text
+/// mode it has to read the whole matrix.
+template <class Real>
+bool ReadObjectRange(std::istream &is, bool binary, const std::string &range,
+                     Matrix<Real> *output);
+
+/// The output is always a full matrix, as for ExtractObjectRange().
+bool ReadObjectRange(std::istream &is, bool binary, const std::string &range,
+                     GeneralMatrix *output);
+
+/// Returns true if ReadObjectRange() would avoid reading most of the object
+/// that starts at the current position of "is" (just after the binary-mode
+/// header), i.e. if it is a binary, uncompressed matrix.  For other objects,
+/// such as compressed matrices, it is better to read the whole object once
+/// and extract all the ranges needed from it.  The "obj" argument only selects
+/// the overload.  The generic version returns false.
+template <class T>
+bool ObjectRangeIsCheap(std::istream &is, bool binary, const T &obj) {
+  return false;
+}
+
+template <class Real>
+bool ObjectRangeIsCheap(std::istream &is, bool binary,
+                        const Matrix<Real> &obj);
+
+bool ObjectRangeIsCheap(std::istream &is, bool binary,
+                        const GeneralMatrix &obj);
+
+/// The table readers use HolderCanReadRange() and ReadHolderRange() for scp
+/// lines with range specifiers, like foo.ark:1234[0:99], if the data is in a
+/// seekable file (see RxfilenameIsSeekable()): if HolderCanReadRange()
+/// returns true for the type of holder, they call ReadHolderRange() instead of
+/// Read().  ReadHolderRange() reads only the range if ObjectRangeIsCheap(),
+/// setting *is_range to true; otherwise it reads the whole object, setting
+/// *is_range to false, and the table reader calls ExtractRange() on it and
+/// keeps it for any following lines with ranges of the same object.  The
+/// overloads for the holders that support this are in kaldi-holder-inl.h.
+template<class Holder>
+bool HolderCanReadRange(const Holder &holder) { return false; }
+
+template<class Holder>
+bool ReadHolderRange(std::istream &is, const std::string &range,
+                     Holder *holder, bool *is_range) {
+  KALDI_ERR << "ReadHolderRange() is not supported for this type of holder.";
+  return false;
+}
+
+/// Parses a matrix range specifier of the form r1:r2,c1:c2 (e.g. the "0:39,:"
+/// in foo.ark:1234[0:39,:]), where any of the numbers may be missing, and
+/// outputs the first and last row and column.  See kaldi-holder.cc for details.
+bool ParseMatrixRangeSpecifier(const std::string &range,
+                               const int rows, const int cols,
+                               std::vector<int32> *row_range,
+                               std::vector<int32> *col_range);
+
 // In SequentialTableReaderScriptImpl and RandomAccessTableReaderScriptImpl, for
 // cases where the scp contained 'range specifiers' (things in square brackets
 // identifying parts of objects like matrices), use this function to separate
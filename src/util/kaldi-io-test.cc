@@ -19,8 +19,10 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#include <fstream>
 #include "base/io-funcs.h"
 #include "util/kaldi-io.h"
+#include "util/kaldi-compressed-filebuf.h"
 #include "base/kaldi-math.h"
 #include "base/kaldi-utils.h"
 
@@ -45,7 +47,13 @@ void UnitTestClassifyRxfilename() {
   KALDI_ASSERT(ClassifyRxfilename("a b c/3") == kFileInput);
   KALDI_ASSERT(ClassifyRxfilename("ark,s,cs:a b c") == kNoInput);
   KALDI_ASSERT(ClassifyRxfilename("scp:a b c") == kNoInput);
-
+  if (GetCompressionFormat("a.gz") != kNoCompression) {
+    KALDI_ASSERT(ClassifyRxfilename("a.gz") == kCompressedFileInput);
+    KALDI_ASSERT(ClassifyRxfilename("a.gz:12") == kOffsetFileInput);
+    KALDI_ASSERT(ClassifyRxfilename("gunzip -c a.gz|") == kPipeInput);
+  } else {
+    KALDI_ASSERT(ClassifyRxfilename("a.gz") == kFileInput);
+  }
 }
 
 
@@ -66,6 +74,81 @@ void UnitTestClassifyWxfilename() {
   KALDI_ASSERT(ClassifyWxfilename("a b c:3") == kNoOutput);
   KALDI_ASSERT(ClassifyWxfilename("a b c:") == kFileOutput);
   KALDI_ASSERT(ClassifyWxfilename("a b c/3") == kFileOutput);
+  if (GetCompressionFormat("a.gz") != kNoCompression)
+    KALDI_ASSERT(ClassifyWxfilename("a.gz") == kCompressedFileOutput);
+  else
+    KALDI_ASSERT(ClassifyWxfilename("a.gz") == kFileOutput);
+}
+
+// Tests reading and writing compressed files, including reading at offsets
+// into them as for archives written with "ark,scp:foo.ark.gz,foo.scp".
+void UnitTestIoCompressed(bool binary) {
+  const char *filenames[] = { "tmpf.gz", "tmpf.zst" };
+  for (int32 f = 0; f < 2; f++) {
+    const char *filename = filenames[f];
+    if (GetCompressionFormat(filename) == kNoCompression)
+      continue;  // not compiled with support for this format.
+    // Write enough data that it spans several buffers.
+    int32 num_vecs = 50 + Rand() % 50;
+    std::vector<std::vector<int32> > vecs(num_vecs);
+    std::vector<size_t> offsets(num_vecs);
+    {
+      Output ko(filename, binary);
+      for (int32 i = 0; i < num_vecs; i++) {
+        for (int32 j = Rand() % 5000; j > 0; j--)
+          vecs[i].push_back(Rand());
+        offsets[i] = ko.Stream().tellp();
+        WriteIntegerVector(ko.Stream(), binary, vecs[i]);
+      }
+      KALDI_ASSERT(ko.Close());
+    }
+    {
+      bool binary_in;
+      Input ki(filename, &binary_in);
+      KALDI_ASSERT(binary_in == binary);
+      for (int32 i = 0; i < num_vecs; i++) {
+        std::vector<int32> vec;
+        ReadIntegerVector(ki.Stream(), binary_in, &vec);
+        KALDI_ASSERT(vec == vecs[i]);
+      }
+      KALDI_ASSERT(Peek(ki.Stream(), binary_in) == -1);
+      KALDI_ASSERT(ki.Close() == 0);
+    }
+    {
+      // Read at offsets in random order with the same Input object, which
+      // seeks forward and backward in the same file.
+      Input ki;
+      for (int32 n = 0; n < 20; n++) {
+        int32 i = Rand() % num_vecs;
+        std::ostringstream rxfilename;
+        rxfilename << filename << ':' << offsets[i];
+        KALDI_ASSERT(ki.Open(rxfilename.str()));
+        std::vector<int32> vec;
+        ReadIntegerVector(ki.Stream(), binary, &vec);
+        KALDI_ASSERT(vec == vecs[i]);
+      }
+    }
+    {
+      // Truncated files should be detected when we reach the end.
+      std::string contents;
+      {
+        std::ifstream is(filename, std::ios::binary);
+        std::ostringstream os;
+        os << is.rdbuf();
+        contents = os.str();
+      }
+      {
+        std::ofstream os(filename, std::ios::binary);
+        os.write(contents.data(), contents.size() / 2);
+      }
+      bool binary_in;
+      Input ki(filename, &binary_in);
+      std::string line;
+      while (std::getline(ki.Stream(), line)) { }
+      KALDI_ASSERT(ki.Close() != 0);
+    }
+    unlink(filename);
+  }
 }
 
 void UnitTestIoNew(bool binary) {
@@ -361,6 +444,8 @@ int main(int argc, const char** argv) {
   UnitTestIoPipe(true);
   UnitTestIoPipe(false);
   UnitTestIoStandard();
+  UnitTestIoCompressed(true);
+  UnitTestIoCompressed(false);
   UnitTestClassifyRxfilename();
   UnitTestClassifyWxfilename();
 
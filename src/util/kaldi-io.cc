@@ -25,6 +25,8 @@
 #include "util/parse-options.h"
 #include "util/kaldi-holder.h"
 #include "util/kaldi-pipebuf.h"
+#include "util/kaldi-compressed-filebuf.h"
+#include "util/kaldi-mmap.h"
 #include "util/kaldi-table.h"  // for Classify{W,R}specifier
 #include <stdio.h>
 #include <stdlib.h>
@@ -131,6 +133,8 @@ OutputType ClassifyWxfilename(const std::string &filename) {
         filename;
     return kNoOutput;
   }
+  if (GetCompressionFormat(filename) != kNoCompression)
+    return kCompressedFileOutput;  // e.g. foo.ark.gz
   return kFileOutput;  // It matched no other pattern: assume it's a filename.
 }
 
@@ -182,9 +186,23 @@ InputType ClassifyRxfilename(const std::string &filename) {
         " wrong place (pipe without | at the end?): " << filename;
     return kNoInput;
   }
+  if (GetCompressionFormat(filename) != kNoCompression)
+    return kCompressedFileInput;  // e.g. foo.ark.gz
   return kFileInput;  // It matched no other pattern: assume it's a filename.
 }
 
+bool RxfilenameIsSeekable(const std::string &rxfilename) {
+  switch (ClassifyRxfilename(rxfilename)) {
+    case kFileInput:
+      return true;
+    case kOffsetFileInput:
+      return GetCompressionFormat(rxfilename.substr(
+          0, rxfilename.find_last_of(':'))) == kNoCompression;
+    default:
+      return false;
+  }
+}
+
 class OutputImplBase {
  public:
   // Open will open it as a file (no header), and return true
@@ -234,6 +252,41 @@ class FileOutputImpl: public OutputImplBase {
   std::ofstream os_;
 };
 
+class CompressedFileOutputImpl: public OutputImplBase {
+ public:
+  CompressedFileOutputImpl(): os_(&buf_) { }
+
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (buf_.IsOpen()) KALDI_ERR << "CompressedFileOutputImpl::Open(), "
+                                 << "open called on already open file.";
+    filename_ = filename;
+    return buf_.OpenWrite(MapOsPath(filename_),
+                          GetCompressionFormat(filename_));
+  }
+
+  virtual std::ostream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "CompressedFileOutputImpl::Stream(), file is not open.";
+    return os_;
+  }
+
+  virtual bool Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "CompressedFileOutputImpl::Close(), file is not open.";
+    os_.flush();
+    bool ok = !os_.fail();
+    return buf_.Close() && ok;
+  }
+  virtual ~CompressedFileOutputImpl() {
+    if (buf_.IsOpen() && !Close())
+      KALDI_ERR << "Error closing output file " << filename_;
+  }
+ private:
+  std::string filename_;
+  CompressedFilebuf buf_;
+  std::ostream os_;
+};
+
 class StandardOutputImpl: public OutputImplBase {
  public:
   StandardOutputImpl(): is_open_(false) { }
@@ -416,6 +469,38 @@ class FileInputImpl: public InputImplBase {
 };
 
 
+class CompressedFileInputImpl: public InputImplBase {
+ public:
+  CompressedFileInputImpl(): is_(&buf_) { }
+
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (buf_.IsOpen()) KALDI_ERR << "CompressedFileInputImpl::Open(), "
+                                 << "open called on already open file.";
+    return buf_.OpenRead(MapOsPath(filename), GetCompressionFormat(filename));
+  }
+
+  virtual std::istream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "CompressedFileInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual int32 Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "CompressedFileInputImpl::Close(), file is not open.";
+    // Like a pipe with nonzero exit status, so the table code can tell that
+    // the file was corrupted or truncated.
+    return buf_.Close() ? 0 : 1;
+  }
+
+  virtual InputType MyType() { return kCompressedFileInput; }
+
+ private:
+  CompressedFilebuf buf_;
+  std::istream is_;
+};
+
+
 class StandardInputImpl: public InputImplBase {
  public:
   StandardInputImpl(): is_open_(false) { }
@@ -575,23 +660,42 @@ class OffsetFileInputImpl: public InputImplBase {
                 << " byte offset into a file; you'll have to compile 64-bit.";
   }
 
+  OffsetFileInputImpl(): binary_(false), compressed_is_(&compressed_buf_),
+                         mapped_is_(&mapped_buf_) { }
+
   bool Seek(size_t offset) {
-    size_t cur_pos = is_.tellg();
+    if (mapped_file_ != NULL) {
+      // No need to read up to the offset; but the file may have grown since
+      // we mapped it.
+      if (offset > mapped_file_->Size()) {
+        mapped_file_ = GetMappedFile(MapOsPath(filename_));
+        if (mapped_file_ == NULL || offset > mapped_file_->Size()) {
+          CloseFile();
+          return false;
+        }
+        mapped_buf_.SetData(mapped_file_->Data(), mapped_file_->Size());
+      }
+      mapped_is_.clear();
+      mapped_is_.seekg(offset, std::ios_base::beg);
+      return !mapped_is_.fail();
+    }
+    std::istream &is = FileStream();
+    size_t cur_pos = is.tellg();
     if (cur_pos == offset) return true;
     else if (cur_pos<offset && cur_pos+100 > offset) {
       // We're close enough that it may be faster to just
       // read that data, rather than seek.
       for (size_t i = cur_pos; i < offset; i++)
-        is_.get();
-      return (is_.tellg() == std::streampos(offset));
+        is.get();
+      return (is.tellg() == std::streampos(offset));
     }
     // Try to actually seek.
-    is_.seekg(offset, std::ios_base::beg);
-    if (is_.fail()) {  // failbit or badbit is set [error happened]
-      is_.close();
+    is.seekg(offset, std::ios_base::beg);
+    if (is.fail()) {  // failbit or badbit is set [error happened]
+      CloseFile();
       return false;  // failure.
     } else {
-      is_.clear();  // Clear any failure bits (e.g. eof).
+      is.clear();  // Clear any failure bits (e.g. eof).
       return true;  // success.
     }
   }
@@ -600,7 +704,7 @@ class OffsetFileInputImpl: public InputImplBase {
   // if it was already open.  This for efficiency when seeking multiple
   // times.
   virtual bool Open(const std::string &rxfilename, bool binary) {
-    if (is_.is_open()) {
+    if (FileIsOpen()) {
       // We are opening when we have an already-open file.
       // We may have to seek within this file, or else close it and
       // open a different one.
@@ -608,15 +712,12 @@ class OffsetFileInputImpl: public InputImplBase {
       size_t offset;
       SplitFilename(rxfilename, &tmp_filename, &offset);
       if (tmp_filename == filename_ && binary == binary_) {  // Just seek
-        is_.clear();  // clear fail bit, etc.
+        FileStream().clear();  // clear fail bit, etc.
         return Seek(offset);
       } else {
-        is_.close();  // don't bother checking error status of is_.
+        CloseFile();  // don't bother checking error status.
         filename_ = tmp_filename;
-        is_.open(MapOsPath(filename_).c_str(),
-                 binary ? std::ios_base::in | std::ios_base::binary
-                        : std::ios_base::in);
-        if (!is_.is_open()) return false;
+        if (!OpenFile(binary)) return false;
         else
           return Seek(offset);
       }
@@ -624,27 +725,24 @@ class OffsetFileInputImpl: public InputImplBase {
       size_t offset;
       SplitFilename(rxfilename, &filename_, &offset);
       binary_ = binary;
-      is_.open(MapOsPath(filename_).c_str(),
-                binary ? std::ios_base::in | std::ios_base::binary
-                      : std::ios_base::in);
-      if (!is_.is_open()) return false;
+      if (!OpenFile(binary)) return false;
       else
         return Seek(offset);
     }
   }
 
   virtual std::istream &Stream() {
-    if (!is_.is_open())
+    if (!FileIsOpen())
       KALDI_ERR << "FileInputImpl::Stream(), file is not open.";
     // I believe this error can only arise from coding error.
-    return is_;
+    return FileStream();
   }
 
   virtual int32 Close() {
-    if (!is_.is_open())
+    if (!FileIsOpen())
       KALDI_ERR << "FileInputImpl::Close(), file is not open.";
     // I believe this error can only arise from coding error.
-    is_.close();
+    CloseFile();
     // Don't check status.
     return 0;
   }
@@ -656,9 +754,55 @@ class OffsetFileInputImpl: public InputImplBase {
     // whether it fails.
   }
  private:
+  // Opens filename_, which may be a compressed file like foo.ark.gz (in
+  // which case the offsets are into the uncompressed data).  Other files are
+  // memory-mapped if g_mmap_options.enabled, and if that fails (e.g. it's not
+  // a regular file) we fall back to std::ifstream.
+  bool OpenFile(bool binary) {
+    CompressionFormat format = GetCompressionFormat(filename_);
+    if (format != kNoCompression)
+      return compressed_buf_.OpenRead(MapOsPath(filename_), format);
+    if (g_mmap_options.enabled) {
+      mapped_file_ = GetMappedFile(MapOsPath(filename_));
+      if (mapped_file_ != NULL) {
+        mapped_buf_.SetData(mapped_file_->Data(), mapped_file_->Size());
+        return true;
+      }
+    }
+    is_.open(MapOsPath(filename_).c_str(),
+             binary ? std::ios_base::in | std::ios_base::binary
+                    : std::ios_base::in);
+    return is_.is_open();
+  }
+  bool FileIsOpen() const {
+    return is_.is_open() || compressed_buf_.IsOpen() || mapped_file_ != NULL;
+  }
+  std::istream &FileStream() {
+    if (compressed_buf_.IsOpen()) return compressed_is_;
+    else if (mapped_file_ != NULL) return mapped_is_;
+    else return is_;
+  }
+  void CloseFile() {
+    if (is_.is_open()) is_.close();
+    if (compressed_buf_.IsOpen()) compressed_buf_.Close();
+    compressed_is_.clear();
+    mapped_file_.reset();
+    mapped_buf_.SetData(NULL, 0);
+    mapped_is_.clear();
+  }
+
   std::string filename_;  // the actual filename
   bool binary_;  // true if was opened in binary mode.
   std::ifstream is_;
+  CompressedFilebuf compressed_buf_;  // used instead of is_ for compressed
+                                      // files.
+  std::istream compressed_is_;
+  // If the file is memory-mapped, mapped_file_ is its mapping (which usually
+  // comes from the cache, so that it stays mapped for the next Input object
+  // that reads it) and mapped_is_ reads from it.
+  std::shared_ptr<const MappedFile> mapped_file_;
+  MemoryInputBuf mapped_buf_;
+  std::istream mapped_is_;
 };
 
 
@@ -693,7 +837,8 @@ Output::~Output() {
     if (!ok)
       KALDI_ERR << "Error closing output file "
                 << PrintableWxfilename(filename_)
-                << (ClassifyWxfilename(filename_) == kFileOutput ?
+                << (ClassifyWxfilename(filename_) == kFileOutput ||
+                    ClassifyWxfilename(filename_) == kCompressedFileOutput ?
                     " (disk full?)" : "");
   }
 }
@@ -721,6 +866,8 @@ bool Output::Open(const std::string &wxfn, bool binary, bool header) {
 
   if (type ==  kFileOutput) {
     impl_ = new FileOutputImpl();
+  } else if (type == kCompressedFileOutput) {
+    impl_ = new CompressedFileOutputImpl();
   } else if (type == kStandardOutput) {
     impl_ = new StandardOutputImpl();
   } else if (type == kPipeOutput) {
@@ -796,6 +943,8 @@ bool Input::OpenInternal(const std::string &rxfilename,
   }
   if (type ==  kFileInput) {
     impl_ = new FileInputImpl();
+  } else if (type == kCompressedFileInput) {
+    impl_ = new CompressedFileInputImpl();
   } else if (type == kStandardInput) {
     impl_ = new StandardInputImpl();
   } else if (type == kPipeInput) {
@@ -90,7 +90,8 @@ enum OutputType {
   kNoOutput,
   kFileOutput,
   kStandardOutput,
-  kPipeOutput
+  kPipeOutput,
+  kCompressedFileOutput
 };
 
 /// ClassifyWxfilename interprets filenames as follows:
@@ -100,6 +101,9 @@ enum OutputType {
 ///  - kFileOutput: Normal filenames
 ///  - kStandardOutput: The empty string or "-", interpreted as standard output
 ///  - kPipeOutput: pipes, e.g. "gunzip -c some_file.gz |"
+///  - kCompressedFileOutput: filenames ending in ".gz" or ".zst", which are
+///       compressed inside the program (only if Kaldi was compiled with zlib
+///       or zstd respectively; see kaldi-compressed-filebuf.h).
 OutputType ClassifyWxfilename(const std::string &wxfilename);
 
 enum InputType {
@@ -107,7 +111,8 @@ enum InputType {
   kFileInput,
   kStandardInput,
   kOffsetFileInput,
-  kPipeInput
+  kPipeInput,
+  kCompressedFileInput
 };
 
 /// ClassifyRxfilenames interprets filenames for reading as follows:
@@ -117,9 +122,21 @@ enum InputType {
 ///  - kFileInput: normal filenames
 ///  - kStandardInput: the empty string or "-"
 ///  - kPipeInput: e.g. "| gzip -c > blah.gz"
-///  - kOffsetFileInput: offsets into files, e.g.  /some/filename:12970
+///  - kOffsetFileInput: offsets into files, e.g.  /some/filename:12970;
+///       this includes offsets into compressed files, e.g. foo.ark.gz:12970,
+///       where the offset is into the uncompressed data.
+///  - kCompressedFileInput: filenames ending in ".gz" or ".zst", which are
+///       decompressed inside the program (only if Kaldi was compiled with zlib
+///       or zstd respectively).
 InputType ClassifyRxfilename(const std::string &rxfilename);
 
+/// Returns true if "rxfilename" is a file or an offset into a file
+/// (kFileInput or kOffsetFileInput) that we can seek in cheaply, i.e. not a
+/// compressed file like foo.ark.gz:12970.  The table readers use this to
+/// decide whether to read only part of a matrix for script-file ranges like
+/// foo.ark:12970[0:99].
+bool RxfilenameIsSeekable(const std::string &rxfilename);
+
 
 class Output {
  public:
@@ -179,12 +196,13 @@ class Output {
 // Input communicates errors by throwing exceptions.
 
 
-// Input interprets four kinds of filenames:
+// Input interprets five kinds of filenames:
 //  (1) Normal filenames
 //  (2) The empty string or "-", interpreted as standard output
 //  (3) Pipes, e.g. "| gzip -c > some_file.gz"
 //  (4) Offsets into [real] files, e.g. "/my/filename:12049"
-// The last one has no correspondence in Output.
+//  (5) Compressed files, e.g. "some_file.gz" (see ClassifyRxfilename()).
+// The fourth one has no correspondence in Output.
 
 
 class Input {
@@ -220,7 +238,9 @@ class Input {
   // It is never necessary or helpful to call Close, except if
   // you are concerned about to many filehandles being open.
   // Close does not throw. It returns the exit code as int32
-  // in the case of a pipe [kPipeInput], and always zero otherwise.
+  // in the case of a pipe [kPipeInput], 1 for a compressed file
+  // [kCompressedFileInput] that was corrupted or truncated, and zero
+  // otherwise.
   int32 Close();
 
   // Returns the underlying stream. Throws if !IsOpen()
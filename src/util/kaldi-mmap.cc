@@ -0,0 +1,176 @@
+// util/kaldi-mmap.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-mmap.h"
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+MmapOptions g_mmap_options;
+
+#ifndef _MSC_VER
+static int64 ModificationTime(const struct stat &st) {
+#ifdef __APPLE__
+  return static_cast<int64>(st.st_mtimespec.tv_sec) * 1000000000 +
+      st.st_mtimespec.tv_nsec;
+#else
+  return static_cast<int64>(st.st_mtim.tv_sec) * 1000000000 +
+      st.st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+MappedFile *MappedFile::Open(const std::string &filename) {
+#ifdef _MSC_VER
+  return NULL;
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return NULL;
+  }
+  size_t size = st.st_size;
+  void *data = NULL;
+  if (size != 0) {  // mmap() fails for zero size.
+    data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return NULL;
+    }
+  }
+  close(fd);  // The mapping remains valid after the file is closed.
+  MappedFile *ans = new MappedFile(static_cast<const char*>(data), size);
+  ans->device_ = st.st_dev;
+  ans->inode_ = st.st_ino;
+  ans->mtime_ = ModificationTime(st);
+  return ans;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _MSC_VER
+  if (size_ != 0)
+    munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+
+namespace {
+
+// The cache used by GetMappedFile().  "files" maps each filename to its
+// mapping and its position in "lru", which lists the filenames with the most
+// recently used first.
+struct MappedFileCache {
+  std::mutex mutex;
+  std::list<std::string> lru;
+  typedef std::pair<std::shared_ptr<const MappedFile>,
+                    std::list<std::string>::iterator> Entry;
+  std::unordered_map<std::string, Entry> files;
+};
+
+MappedFileCache &GetMappedFileCache() {
+  // Allocated on first use and never freed, so that it is safe to use while
+  // static objects are being destroyed.
+  static MappedFileCache *cache = new MappedFileCache();
+  return *cache;
+}
+
+}  // namespace
+
+std::shared_ptr<const MappedFile> GetMappedFile(const std::string &filename) {
+  MappedFileCache &cache = GetMappedFileCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  std::unordered_map<std::string, MappedFileCache::Entry>::iterator iter =
+      cache.files.find(filename);
+  if (iter != cache.files.end()) {
+    cache.lru.splice(cache.lru.begin(), cache.lru, iter->second.second);
+#ifndef _MSC_VER
+    const MappedFile &file = *(iter->second.first);
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0 &&
+        static_cast<int64>(st.st_dev) == file.device_ &&
+        static_cast<int64>(st.st_ino) == file.inode_ &&
+        static_cast<size_t>(st.st_size) == file.size_ &&
+        ModificationTime(st) == file.mtime_)
+      return iter->second.first;
+#endif
+  }
+  MappedFile *file = MappedFile::Open(filename);
+  if (file == NULL) {
+    if (iter != cache.files.end()) {
+      cache.lru.erase(iter->second.second);
+      cache.files.erase(iter);
+    }
+    return std::shared_ptr<const MappedFile>();
+  }
+  std::shared_ptr<const MappedFile> ans(file);
+  if (iter != cache.files.end()) {
+    iter->second.first = ans;  // Users of the old mapping still hold it.
+  } else {
+    cache.lru.push_front(filename);
+    cache.files[filename] = MappedFileCache::Entry(ans, cache.lru.begin());
+    while (cache.lru.size() > static_cast<size_t>(std::max<int32>(
+               g_mmap_options.max_mapped_files, 1))) {
+      cache.files.erase(cache.lru.back());
+      cache.lru.pop_back();
+    }
+  }
+  return ans;
+}
+
+
+void MemoryInputBuf::SetData(const char *data, size_t size) {
+  char *begin = const_cast<char*>(data);  // we never write to it.
+  setg(begin, begin, begin + size);
+}
+
+MemoryInputBuf::pos_type MemoryInputBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in))
+    return pos_type(off_type(-1));
+  off_type pos;
+  if (dir == std::ios_base::beg) pos = off;
+  else if (dir == std::ios_base::cur) pos = (gptr() - eback()) + off;
+  else pos = (egptr() - eback()) + off;
+  if (pos < 0 || pos > egptr() - eback())
+    return pos_type(off_type(-1));
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+MemoryInputBuf::pos_type MemoryInputBuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,107 @@
+// util/kaldi-mmap.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <memory>
+#include <streambuf>
+#include <string>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// This file provides memory-mapped reading of archives.  When we read objects
+/// from an archive through its scp file (rxfilenames like foo.ark:1234), the
+/// normal code opens the archive and seeks for each object, and the table
+/// readers reopen it whenever successive objects come from different archives.
+/// With memory-mapping, each archive is mapped once into a process-wide cache
+/// and reading an object is just a matter of pointing a stream at the right
+/// place.  See also RandomAccessMatrixViewReader in matrix-view-reader.h, which
+/// goes further and avoids copying matrices at all.
+
+struct MmapOptions {
+  // If true, archives read at an offset (e.g. foo.ark:1234 in an scp file) are
+  // memory-mapped rather than opened with std::ifstream.  Set by the standard
+  // option --mmap-archives, which all programs that use ParseOptions accept.
+  // Compressed archives (foo.ark.gz) are never mapped.
+  bool enabled;
+  // The maximum number of files kept mapped in the cache; beyond this, the
+  // least recently used ones are unmapped once nothing uses them.
+  int32 max_mapped_files;
+  MmapOptions(): enabled(false), max_mapped_files(64) { }
+};
+
+/// The options used by Kaldi's Input class.
+extern MmapOptions g_mmap_options;
+
+/// A read-only memory mapping of an entire file.
+class MappedFile {
+ public:
+  /// Maps "filename", and returns NULL if it could not be mapped (e.g. it
+  /// does not exist or is not a regular file, or memory-mapping is not
+  /// supported on this platform).
+  static MappedFile *Open(const std::string &filename);
+
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+  ~MappedFile();
+ private:
+  friend std::shared_ptr<const MappedFile> GetMappedFile(
+      const std::string &filename);
+  MappedFile(const char *data, size_t size): data_(data), size_(size),
+                                             device_(0), inode_(0), mtime_(0) { }
+  const char *data_;
+  size_t size_;
+  // These identify the version of the file that we mapped.
+  int64 device_;
+  int64 inode_;
+  int64 mtime_;  // in nanoseconds.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+/// Returns the mapping of "filename" from a process-wide cache, mapping it if
+/// it is not already in the cache or if the file has changed since it was
+/// mapped (e.g. it was appended to or rewritten; we check this with stat()).
+/// Returns NULL if the file could not be mapped.  This function is
+/// thread-safe, and the mapping stays valid for as long as the returned
+/// pointer (or a copy of it) exists.
+std::shared_ptr<const MappedFile> GetMappedFile(const std::string &filename);
+
+/// A stream buffer that reads from a block of memory, such as the data of a
+/// MappedFile, without copying it.  It supports seeking.
+class MemoryInputBuf: public std::streambuf {
+ public:
+  MemoryInputBuf() { }
+  /// Sets the stream buffer to read data[0] ... data[size-1], starting at
+  /// data[0].
+  void SetData(const char *data, size_t size);
+
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryInputBuf);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
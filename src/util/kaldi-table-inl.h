@@ -24,11 +24,15 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 #include <errno.h>
+#include "base/kaldi-profile.h"
 #include "util/kaldi-io.h"
 #include "util/kaldi-holder.h"
 #include "util/text-utils.h"
@@ -167,7 +171,8 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
                 << "(p, ) option to the rspecifier.";
     // Because EnsureObjectLoaded() returned with success, we know
     // that if range_ is nonempty (i.e. a range was requested), the
-    // state will be kHaveRange.
+    // state will be kHaveRange, or kHaveObject if we read just the range
+    // into holder_.
     if (state_ == kHaveRange) {
       return range_holder_.Value();
     } else {
@@ -310,8 +315,26 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
         KALDI_WARN << "Failed to open file "
                    << PrintableRxfilename(data_rxfilename_);
         return false;
+      } else if (!range_.empty() && HolderCanReadRange(holder_) &&
+                 RxfilenameIsSeekable(data_rxfilename_)) {
+        // This reads just the range if that is cheap (e.g. a binary,
+        // uncompressed matrix), which saves reading the whole object, and
+        // otherwise reads the whole object, which we keep for any following
+        // ranges of it.
+        bool is_range;
+        if (ReadHolderRange(data_input_.Stream(), range_, &holder_,
+                            &is_range)) {
+          object_range_ = (is_range ? range_ : "");
+          state_ = kHaveObject;
+        } else {
+          KALDI_WARN << "Failed to load object from "
+                     << PrintableRxfilename(data_rxfilename_)
+                     << "[" << range_ << "]";
+          return false;
+        }
       } else {
         if (holder_.Read(data_input_.Stream())) {
+          object_range_ = "";
           state_ = kHaveObject;
         } else {  // holder_ will not contain data.
           KALDI_WARN << "Failed to load object from "
@@ -325,7 +348,11 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     if (range_.empty()) {
       // if range_ is the empty string, we should not be in the state
       // kHaveRange.
-      KALDI_ASSERT(state_ == kHaveObject);
+      KALDI_ASSERT(state_ == kHaveObject && object_range_.empty());
+      return true;
+    }
+    if (state_ == kHaveObject && object_range_ == range_) {
+      // We read just the range into holder_.
       return true;
     }
     // range_ is nonempty.
@@ -396,12 +423,12 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
         if (!filenames_equal)
           data_rxfilename_ = data_rxfilename;
         if (state_ == kHaveObject) {
-          if (!filenames_equal) {
+          if (!filenames_equal || !object_range_.empty()) {
             holder_.Clear();
             state_ = kHaveScpLine;
           }
-          // else leave state_ at kHaveObject and leave the object in the
-          // holder.
+          // else leave state_ at kHaveObject and leave the (whole) object in
+          // the holder.
         } else {
           state_ = kHaveScpLine;
         }
@@ -445,12 +472,14 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
   std::string data_rxfilename_;  // the rxfilename corresponding to the current key
   std::string range_;  // the range of object corresponding to the current key, if an
                        // object range was specified in the script file, else "".
+  std::string object_range_;  // If holder_ contains just a range of the object
+                              // (see HolderCanReadRange()), the range; else "".
 
   enum StateType {
     //  Summary of the states this object can be in (state_).
     //
     //                (*) Does holder_ contain the object corresponding to
-    //                    data_rxfilename_ ?
+    //                    data_rxfilename_ (or its object_range_)?
     //                    (*) Does range_holder_ contain a range object?
     //                         (*) is script_input_ open?
     //                             (*) are key_, data_rxfilename_ and range_ [if applicable] set?
@@ -853,6 +882,358 @@ class SequentialTableReaderBackgroundImpl:
 
 };
 
+// This is for when someone gives the 'bg' modifier with a number of threads,
+// e.g. "scp,bg4:feats.scp".  The script file is read in the calling thread
+// (this is cheap), and the objects it points to are read and deserialized by
+// that many worker threads, each with its own Input object.  The objects are
+// returned in the order of the script file.  At most 2 * num_threads objects
+// are read ahead.
+template<class Holder>
+class SequentialTableReaderParallelImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  explicit SequentialTableReaderParallelImpl(int32 num_threads):
+      num_threads_(num_threads), state_(kUninitialized), script_done_(false),
+      script_error_(false), script_status_(0), current_(NULL), stop_(false) {
+    KALDI_ASSERT(num_threads > 0);
+  }
+
+  virtual bool Open(const std::string &rspecifier) {
+    KALDI_ASSERT(state_ == kUninitialized);  // Open() is only called once.
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &script_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kScriptRspecifier);
+    bool binary;
+    if (!script_input_.Open(script_rxfilename_, &binary)) {
+      KALDI_WARN << "Failed to open script file "
+                 << PrintableRxfilename(script_rxfilename_);
+      return false;
+    }
+    if (binary) {
+      KALDI_WARN << "Script file should not be binary file.";
+      script_input_.Close();
+      return false;
+    }
+    for (int32 i = 0; i < num_threads_; i++)
+      threads_.push_back(std::thread(
+          SequentialTableReaderParallelImpl<Holder>::run, this));
+    state_ = kFileStart;
+    Next();
+    // kEof and kError are OK from the point of view of Open(), as for
+    // SequentialTableReaderScriptImpl.
+    return true;
+  }
+
+  virtual bool IsOpen() const { return state_ != kUninitialized; }
+
+  virtual bool Done() const {
+    switch (state_) {
+      case kHaveObject: return false;
+      case kEof: case kError: return true;
+      default: KALDI_ERR << "Done() called on TableReader object at the wrong"
+          " time.";
+        return false;
+    }
+  }
+
+  virtual std::string Key() {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return current_->key;
+  }
+
+  virtual T &Value() {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    if (!current_->ok)
+      KALDI_ERR << "Failed to load object from "
+                << PrintableRxfilename(current_->data_rxfilename)
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
+    return current_->holder.Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (state_ == kHaveObject)
+      current_->holder.Clear();
+    else
+      KALDI_WARN << "FreeCurrent called at the wrong time.";
+  }
+
+  void SwapHolder(Holder *other_holder) {
+    KALDI_ERR << "SwapHolder() should not be called on this class.";
+  }
+
+  virtual void Next() {
+    if (state_ != kHaveObject && state_ != kFileStart)
+      KALDI_ERR << "Next() called wrongly.";
+    delete current_;
+    current_ = NULL;
+    QueueTasks();
+    while (!tasks_.empty()) {
+      Task *task = tasks_.front();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!task->done)
+          done_cond_.wait(lock);
+      }
+      tasks_.pop_front();
+      QueueTasks();
+      if (task->ok || !opts_.permissive) {
+        // In non-permissive mode we return the key even if the object could
+        // not be read; Value() will then fail, as for
+        // SequentialTableReaderScriptImpl.
+        current_ = task;
+        state_ = kHaveObject;
+        return;
+      }
+      delete task;  // In permissive mode we skip objects that can't be read.
+    }
+    state_ = (script_error_ ? kError : kEof);
+  }
+
+  // This may be called in any state, and leaves the object in state
+  // kUninitialized.  It returns false in the same circumstances as
+  // SequentialTableReaderScriptImpl::Close().
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "Close() called on input that was not open.";
+    StopThreads();
+    delete current_;
+    current_ = NULL;
+    for (size_t i = 0; i < tasks_.size(); i++)
+      delete tasks_[i];
+    tasks_.clear();
+    pending_.clear();
+    if (script_input_.IsOpen())
+      script_status_ = script_input_.Close();
+    StateType old_state = state_;
+    state_ = kUninitialized;
+    if (old_state == kError || (old_state == kEof && script_status_ != 0)) {
+      if (opts_.permissive) {
+        KALDI_WARN << "Close() called on scp file with read error, ignoring the"
+            " error because permissive mode specified.";
+        return true;
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  virtual ~SequentialTableReaderParallelImpl() {
+    if (IsOpen() && !Close())
+      KALDI_ERR << "TableReader: reading script file failed: from scp "
+                << PrintableRxfilename(script_rxfilename_);
+  }
+
+ private:
+  // An object to be read, i.e. a line of the script file.
+  struct Task {
+    std::string key;
+    std::string data_rxfilename;  // e.g. foo.ark:1234
+    std::string range;  // e.g. 0:9, or "" if no range was specified.
+    Holder holder;
+    bool done;  // true once a worker thread has tried to read the object.
+    bool ok;    // true if the object was read successfully.
+    Task(): done(false), ok(false) { }
+  };
+
+  static void run(SequentialTableReaderParallelImpl<Holder> *object) {
+    object->RunWorker();
+  }
+
+  // This is run by the worker threads.
+  void RunWorker() {
+    Input input;
+    // The last object read by this thread, kept in case the following lines of
+    // the script file have ranges of the same object.
+    Holder whole_object;
+    std::string whole_object_rxfilename;
+    while (true) {
+      Task *task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (pending_.empty() && !stop_)
+          work_cond_.wait(lock);
+        if (stop_)
+          return;
+        task = pending_.front();
+        pending_.pop_front();
+      }
+      KALDI_PROFILE_SCOPE("TableReaderWorker::Read");
+      bool ok = false;
+      try {
+        if (task->range.empty()) {
+          ok = ReadObject(task->data_rxfilename, &input, &(task->holder));
+        } else {
+          bool is_range = false;
+          if (whole_object_rxfilename != task->data_rxfilename) {
+            whole_object_rxfilename = "";
+            if (HolderCanReadRange(whole_object) &&
+                RxfilenameIsSeekable(task->data_rxfilename)) {
+              // This reads just the range if that is cheap, else the whole
+              // object.
+              ok = ReadRangeOfObject(task->data_rxfilename, task->range,
+                                     &input, &whole_object, &is_range);
+            } else {
+              ok = ReadObject(task->data_rxfilename, &input, &whole_object);
+            }
+            if (ok && is_range)
+              task->holder.Swap(&whole_object);
+            else if (ok)
+              whole_object_rxfilename = task->data_rxfilename;
+          }
+          if (!is_range && !whole_object_rxfilename.empty()) {
+            ok = task->holder.ExtractRange(whole_object, task->range);
+            if (!ok)
+              KALDI_WARN << "Failed to load object from "
+                         << PrintableRxfilename(task->data_rxfilename)
+                         << "[" << task->range << "]";
+          }
+        }
+      } catch (const std::exception &e) {
+        // e.g. the holder type does not support ranges.  The error will be
+        // reported in the main thread when Value() is called.
+        KALDI_WARN << "Error reading object from "
+                   << PrintableRxfilename(task->data_rxfilename) << ": "
+                   << e.what();
+        ok = false;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->ok = ok;
+        task->done = true;
+      }
+      done_cond_.notify_all();
+    }
+  }
+
+  static bool ReadObject(const std::string &rxfilename, Input *input,
+                         Holder *holder) {
+    bool ans;
+    // NULL means it doesn't read the binary-mode header.
+    if (Holder::IsReadInBinary())
+      ans = input->Open(rxfilename, NULL);
+    else
+      ans = input->OpenTextMode(rxfilename);
+    if (!ans) {
+      KALDI_WARN << "Failed to open file " << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    if (!holder->Read(input->Stream())) {
+      KALDI_WARN << "Failed to load object from "
+                 << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    return true;
+  }
+
+  // As ReadObject(), but calls ReadHolderRange(), which reads only the range
+  // "range" of the object if that is cheap (then it sets *is_range to true);
+  // only called if HolderCanReadRange() returns true.
+  static bool ReadRangeOfObject(const std::string &rxfilename,
+                                const std::string &range, Input *input,
+                                Holder *holder, bool *is_range) {
+    bool ans;
+    if (Holder::IsReadInBinary())
+      ans = input->Open(rxfilename, NULL);
+    else
+      ans = input->OpenTextMode(rxfilename);
+    if (!ans) {
+      KALDI_WARN << "Failed to open file " << PrintableRxfilename(rxfilename);
+      return false;
+    }
+    if (!ReadHolderRange(input->Stream(), range, holder, is_range)) {
+      KALDI_WARN << "Failed to load object from "
+                 << PrintableRxfilename(rxfilename) << "[" << range << "]";
+      return false;
+    }
+    return true;
+  }
+
+  // Reads lines of the script file and gives them to the worker threads,
+  // until 2 * num_threads_ objects are queued or we reach the end of the
+  // script file.
+  void QueueTasks() {
+    size_t max_tasks = 2 * static_cast<size_t>(num_threads_);
+    while (!script_done_ && tasks_.size() < max_tasks) {
+      std::string line;
+      if (!std::getline(script_input_.Stream(), line)) {
+        script_done_ = true;
+        script_status_ = script_input_.Close();
+        break;
+      }
+      Task *task = new Task();
+      std::string rest;
+      SplitStringOnFirstSpace(line, &(task->key), &rest);
+      bool ok = !task->key.empty() && !rest.empty();
+      if (ok && rest[rest.size() - 1] == ']')
+        ok = ExtractRangeSpecifier(rest, &(task->data_rxfilename),
+                                   &(task->range));
+      else
+        task->data_rxfilename = rest;
+      if (!ok) {
+        KALDI_WARN << "We got an invalid line in the scp file. "
+                   << "It should look like: some_key 1.ark:10, got: "
+                   << line;
+        delete task;
+        script_done_ = true;
+        script_error_ = true;
+        break;
+      }
+      tasks_.push_back(task);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(task);
+      }
+      work_cond_.notify_one();
+    }
+  }
+
+  void StopThreads() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_cond_.notify_all();
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i].join();
+    threads_.clear();
+  }
+
+  int32 num_threads_;
+  std::string rspecifier_;
+  RspecifierOptions opts_;
+  std::string script_rxfilename_;
+  Input script_input_;
+
+  enum StateType {
+    kUninitialized,  // Uninitialized or closed.
+    kFileStart,      // Just opened (internal state).
+    kEof,            // No more objects.
+    kError,          // Error reading the script file.
+    kHaveObject      // current_ is set.
+  } state_;
+  bool script_done_;   // true if we have read all of the script file.
+  bool script_error_;  // true if there was an error in the script file.
+  int32 script_status_;  // the return status of script_input_.Close().
+
+  Task *current_;  // The task of the current key (owned here).
+  std::deque<Task*> tasks_;  // Tasks queued but not yet returned by Next(),
+                             // in order; only accessed in the main thread.
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;  // guards pending_, stop_ and Task::done and Task::ok.
+  std::condition_variable work_cond_;  // the worker threads wait on this.
+  std::condition_variable done_cond_;  // the main thread waits on this.
+  std::deque<Task*> pending_;  // Tasks not yet taken by a worker thread.
+  bool stop_;  // set in Close() to make the worker threads exit.
+};
+
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string
                                                      &rspecifier): impl_(NULL) {
@@ -871,9 +1252,21 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
   RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, &opts);
   switch (wt) {
     case kArchiveRspecifier:
+      // Note: for archives, "bgN" is the same as "bg", since we can't find
+      // where the objects are without parsing them.
       impl_ = new SequentialTableReaderArchiveImpl<Holder>();
       break;
     case kScriptRspecifier:
+      if (opts.num_threads > 1) {
+        impl_ = new SequentialTableReaderParallelImpl<Holder>(
+            opts.num_threads);
+        if (!impl_->Open(rspecifier)) {
+          delete impl_;
+          impl_ = NULL;
+          return false;
+        }
+        return true;
+      }
       impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
     case kNoRspecifier: default:
@@ -932,6 +1325,7 @@ void SequentialTableReader<Holder>::FreeCurrent() {
 template<class Holder>
 typename SequentialTableReader<Holder>::T &
 SequentialTableReader<Holder>::Value() {
+  KALDI_PROFILE_SCOPE("SequentialTableReader::Value");
   CheckImpl();
   return impl_->Value();  // This may throw (if EnsureObjectLoaded() returned false you
                           // are safe.).
@@ -940,6 +1334,7 @@ SequentialTableReader<Holder>::Value() {
 
 template<class Holder>
 void SequentialTableReader<Holder>::Next() {
+  KALDI_PROFILE_SCOPE("SequentialTableReader::Next");
   CheckImpl();
   impl_->Next();
 }
@@ -1307,7 +1702,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
                                            &script_wxfilename_,
                                            &opts_);
     KALDI_ASSERT(ws == kBothWspecifier);  // or wrongly called.
-    if (ClassifyWxfilename(archive_wxfilename_) != kFileOutput)
+    OutputType archive_type = ClassifyWxfilename(archive_wxfilename_);
+    if (archive_type != kFileOutput && archive_type != kCompressedFileOutput)
       KALDI_WARN << "When writing to both archive and script, the script file "
           "will generally not be interpreted correctly unless the archive is "
           "an actual file: wspecifier = " << wspecifier;
@@ -1510,6 +1906,7 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
 template<class Holder>
 void TableWriter<Holder>::Write(const std::string &key,
                                 const T &value) const {
+  KALDI_PROFILE_SCOPE("TableWriter::Write");
   CheckImpl();
   if (!impl_->Write(key, value))
     KALDI_ERR << "Error in TableWriter::Write";
@@ -1660,6 +2057,7 @@ class RandomAccessTableReaderScriptImpl:
     script_.clear();
     key_ = "";
     range_ = "";
+    object_range_ = "";
     data_rxfilename_ = "";
     // This cannot fail because any errors of a "global" nature would have been
     // detected when we did Open().  With archives it's different.
@@ -1706,7 +2104,7 @@ class RandomAccessTableReaderScriptImpl:
         KALDI_ERR << "HasKey called on RandomAccessTableReader object that is"
                      " not open.";
       case kHaveObject:
-        if (key == key_ && range_.empty())
+        if (key == key_ && range_ == object_range_)
           return true;
         break;
       case kHaveRange:
@@ -1751,7 +2149,8 @@ class RandomAccessTableReaderScriptImpl:
         }
         // OK, at this point the state will be kHaveObject or kNotHaveObject.
         if (state_ == kHaveObject) {
-          if (data_rxfilename_ != data_rxfilename) {
+          if (data_rxfilename_ != data_rxfilename ||
+              (!object_range_.empty() && object_range_ != range)) {
             // clear out the object.
             state_ = kNotHaveObject;
             holder_.Clear();
@@ -1769,8 +2168,25 @@ class RandomAccessTableReaderScriptImpl:
             KALDI_WARN << "Error opening stream "
                        << PrintableRxfilename(data_rxfilename);
             return false;
+          } else if (!range.empty() && HolderCanReadRange(holder_) &&
+                     RxfilenameIsSeekable(data_rxfilename)) {
+            // This reads just the range if that is cheap (e.g. a binary,
+            // uncompressed matrix), and otherwise the whole object, which we
+            // keep for any following ranges of it.
+            bool is_range;
+            if (ReadHolderRange(input_.Stream(), range, &holder_,
+                                &is_range)) {
+              object_range_ = (is_range ? range : "");
+              state_ = kHaveObject;
+            } else {
+              KALDI_WARN << "Failed to load object from "
+                         << PrintableRxfilename(data_rxfilename)
+                         << "[" << range << "]";
+              return false;
+            }
           } else {
             if (holder_.Read(input_.Stream())) {
+              object_range_ = "";
               state_ = kHaveObject;
             } else {
               KALDI_WARN << "Error reading object from "
@@ -1780,8 +2196,9 @@ class RandomAccessTableReaderScriptImpl:
           }
         }
         // At this point the state is kHaveObject.
-        if (range.empty())
-          return true;  // we're done: no range was requested.
+        if (range == object_range_)
+          return true;  // we're done: no range was requested, or we read just
+                        // the range.
         if (range_holder_.ExtractRange(holder_, range)) {
           state_ = kHaveRange;
           return true;
@@ -1846,6 +2263,8 @@ class RandomAccessTableReaderScriptImpl:
                         // 'range_' is specified.
   std::string range_; // range within which we read the object from holder_.
                       // If key_ is set, always correspond to the key.
+  std::string object_range_;  // If holder_ contains just a range of the object
+                              // (see HolderCanReadRange()), the range; else "".
   std::string data_rxfilename_;  // the rxfilename corresponding to key_,
                                  // always set when key_ is set.
 
@@ -1873,7 +2292,8 @@ class RandomAccessTableReaderScriptImpl:
     kHaveRange,      //    yes   yes   yes
 
     // If we are in a state where holder_ contains an object, it always contains
-    // the object from 'key_', and the corresponding rxfilename is always
+    // the object from 'key_' (or its range 'object_range_', if that is
+    // nonempty), and the corresponding rxfilename is always
     // 'data_rxfilename_'.  If range_holder_ contains an object, it always
     // corresponds to the range 'range_' of the object in 'holder_', and always
     // corresponds to the current key.
@@ -2549,6 +2969,7 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
 
 template<class Holder>
 bool RandomAccessTableReader<Holder>::HasKey(const std::string &key) {
+  KALDI_PROFILE_SCOPE("RandomAccessTableReader::HasKey");
   CheckImpl();
   if (!IsToken(key))
     KALDI_ERR << "Invalid key \"" << key << '"';
@@ -2559,6 +2980,7 @@ bool RandomAccessTableReader<Holder>::HasKey(const std::string &key) {
 template<class Holder>
 const typename RandomAccessTableReader<Holder>::T&
 RandomAccessTableReader<Holder>::Value(const std::string &key) {
+  KALDI_PROFILE_SCOPE("RandomAccessTableReader::Value");
   CheckImpl();
   return impl_->Value(key);
 }
@@ -215,6 +215,19 @@ void UnitTestClassifyRspecifier() {
     KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo|");
   }
 
+  {
+    std::string a = "scp,bg4:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo" &&
+                 opts.background && opts.num_threads == 4);
+    KALDI_ASSERT(ClassifyRspecifier("scp,bg0:foo", NULL, NULL) ==
+                 kNoRspecifier);
+    KALDI_ASSERT(ClassifyRspecifier("scp,bgx:foo", NULL, NULL) ==
+                 kNoRspecifier);
+  }
+
   {
     std::string a = "scp,scp,b:foo|";  // invalid as repeated.
     std::string fname = "x";
@@ -456,9 +469,10 @@ void UnitTestTableSequentialDoubleBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialDoubleReader sbr(RandInt(0, 1) == 0 ?
-                             (read_scp ? "scp:tmpf.scp" : "ark:tmpf") :
-                             (read_scp ? "scp,bg:tmpf.scp" : "ark,bg:tmpf"));
+  const char *rspecifiers[] = { "ark:tmpf", "ark,bg:tmpf", "ark,bg3:tmpf",
+                                "scp:tmpf.scp", "scp,bg:tmpf.scp",
+                                "scp,bg3:tmpf.scp" };
+  SequentialDoubleReader sbr(rspecifiers[RandInt(0, 2) + (read_scp ? 3 : 0)]);
   std::vector<std::string> k2;
   std::vector<double> v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -636,8 +650,9 @@ void UnitTestTableSequentialInt32Script(bool binary) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32Reader sbr(RandInt(0, 1) == 0 ?
-                            "scp:tmp.scp" : "scp,bg:tmp.scp");
+  const char *rspecifiers[] = { "scp:tmp.scp", "scp,bg:tmp.scp",
+                                "scp,bg2:tmp.scp" };
+  SequentialInt32Reader sbr(rspecifiers[RandInt(0, 2)]);
   std::vector<std::string> k2;
   std::vector<int32> v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -955,9 +970,11 @@ void UnitTestRangesMatrix(bool binary) {
 
   {  // test sequential reading.
     bool permissive = (RandInt(0, 1) == 0);
-    SequentialBaseFloatMatrixReader reader(permissive ?
-                                           "scp,p:tmpf_ranges.scp" :
-                                           "scp:tmpf_ranges.scp");
+    std::string rspecifier = (permissive ? "scp,p" : "scp");
+    if (RandInt(0, 1) == 0)
+      rspecifier += ",bg3";  // read in 3 threads.
+    rspecifier += ":tmpf_ranges.scp";
+    SequentialBaseFloatMatrixReader reader(rspecifier);
 
     int32 i = 0;
     for (; !reader.Done(); reader.Next(), i++) {
@@ -973,6 +990,196 @@ void UnitTestRangesMatrix(bool binary) {
   unlink("tmpf_ranges.scp");
 }
 
+// Tests ranges of compressed matrices, and of a matrix read through a pipe
+// (which we can't seek in), as full and general matrices.
+void UnitTestRangesCompressedMatrix() {
+  Matrix<BaseFloat> mat(RandInt(2, 20), RandInt(2, 10));
+  mat.SetRandn();
+  {
+    CompressedMatrixWriter writer("ark,scp:tmpf,tmpf.scp");
+    writer.Write("a", CompressedMatrix(mat));
+    Output output("tmpf.mat", true);
+    mat.Write(output.Stream(), true);
+  }
+  Matrix<BaseFloat> decompressed;
+  {
+    RandomAccessBaseFloatMatrixReader reader("scp:tmpf.scp");
+    decompressed = reader.Value("a");
+  }
+  std::vector<std::pair<std::string, std::string> > script;
+  KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script) &&
+               script.size() == 1);
+  int32 row_offset = RandInt(0, mat.NumRows() - 1),
+      num_rows = RandInt(1, mat.NumRows() - row_offset),
+      col_offset = RandInt(0, mat.NumCols() - 1),
+      num_cols = RandInt(1, mat.NumCols() - col_offset);
+  std::ostringstream range;
+  range << "[" << row_offset << ":" << (row_offset + num_rows - 1) << ","
+        << col_offset << ":" << (col_offset + num_cols - 1) << "]";
+  script[0].first = "a";
+  script[0].second += range.str();
+  script.push_back(std::make_pair("b", "cat tmpf.mat |" + range.str()));
+  KALDI_ASSERT(WriteScriptFile("tmpf_ranges.scp", script));
+  Matrix<BaseFloat> mat_range(mat.Range(row_offset, num_rows,
+                                        col_offset, num_cols)),
+      decompressed_range(decompressed.Range(row_offset, num_rows,
+                                            col_offset, num_cols));
+
+  RandomAccessBaseFloatMatrixReader reader("scp:tmpf_ranges.scp");
+  KALDI_ASSERT(reader.Value("a").ApproxEqual(decompressed_range, 1.0e-05) &&
+               reader.Value("b").ApproxEqual(mat_range, 1.0e-05));
+  SequentialGeneralMatrixReader general_reader(
+      RandInt(0, 1) == 0 ? "scp:tmpf_ranges.scp" : "scp,bg2:tmpf_ranges.scp");
+  Matrix<BaseFloat> value;
+  KALDI_ASSERT(general_reader.Key() == "a");
+  general_reader.Value().GetMatrix(&value);
+  KALDI_ASSERT(value.ApproxEqual(decompressed_range, 1.0e-05));
+  general_reader.Next();
+  KALDI_ASSERT(general_reader.Key() == "b");
+  general_reader.Value().GetMatrix(&value);
+  KALDI_ASSERT(value.ApproxEqual(mat_range, 1.0e-05));
+  general_reader.Next();
+  KALDI_ASSERT(general_reader.Done() && general_reader.Close());
+
+  unlink("tmpf");
+  unlink("tmpf.scp");
+  unlink("tmpf.mat");
+  unlink("tmpf_ranges.scp");
+}
+
+// Tests several ranges of one compressed matrix, which the readers read once
+// and keep for all of its ranges, mixed with ranges of an uncompressed matrix,
+// which they read in part.
+void UnitTestSeveralRangesCompressedMatrix() {
+  Matrix<BaseFloat> mat(RandInt(2, 20), RandInt(2, 10)), mat2(mat);
+  mat.SetRandn();
+  mat2.SetRandn();
+  {
+    CompressedMatrixWriter writer("ark,scp:tmpf,tmpf.scp");
+    writer.Write("a", CompressedMatrix(mat));
+  }
+  {
+    BaseFloatMatrixWriter writer("ark,scp:tmpf2,tmpf2.scp");
+    writer.Write("b", mat2);
+  }
+  Matrix<BaseFloat> decompressed;
+  {
+    RandomAccessBaseFloatMatrixReader reader("scp:tmpf.scp");
+    decompressed = reader.Value("a");
+  }
+  std::vector<std::pair<std::string, std::string> > script, script2;
+  KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script) &&
+               script.size() == 1 &&
+               ReadScriptFile("tmpf2.scp", true, &script2) &&
+               script2.size() == 1);
+  std::vector<std::pair<std::string, std::string> > ranges_script;
+  std::vector<Matrix<BaseFloat> > expected;
+  int32 num_ranges = RandInt(2, 8);
+  for (int32 i = 0; i < num_ranges; i++) {
+    // Mostly ranges of the compressed matrix, with the occasional range of
+    // the uncompressed one in between.
+    bool compressed = (RandInt(0, 3) != 0);
+    const Matrix<BaseFloat> &m = (compressed ? decompressed : mat2);
+    int32 row_offset = RandInt(0, m.NumRows() - 1),
+        num_rows = RandInt(1, m.NumRows() - row_offset),
+        col_offset = RandInt(0, m.NumCols() - 1),
+        num_cols = RandInt(1, m.NumCols() - col_offset);
+    std::ostringstream key, range;
+    key << "k" << i;
+    range << "[" << row_offset << ":" << (row_offset + num_rows - 1) << ","
+          << col_offset << ":" << (col_offset + num_cols - 1) << "]";
+    ranges_script.push_back(std::make_pair(
+        key.str(), (compressed ? script : script2)[0].second + range.str()));
+    expected.push_back(Matrix<BaseFloat>(m.Range(row_offset, num_rows,
+                                                 col_offset, num_cols)));
+  }
+  KALDI_ASSERT(WriteScriptFile("tmpf_ranges.scp", ranges_script));
+
+  const char *rspecifiers[] = { "scp:tmpf_ranges.scp",
+                                "scp,bg:tmpf_ranges.scp",
+                                "scp,bg3:tmpf_ranges.scp" };
+  for (size_t j = 0; j < sizeof(rspecifiers) / sizeof(rspecifiers[0]); j++) {
+    SequentialBaseFloatMatrixReader reader(rspecifiers[j]);
+    for (int32 i = 0; i < num_ranges; i++, reader.Next()) {
+      KALDI_ASSERT(!reader.Done() && reader.Key() == ranges_script[i].first);
+      KALDI_ASSERT(reader.Value().ApproxEqual(expected[i], 1.0e-05));
+    }
+    KALDI_ASSERT(reader.Done() && reader.Close());
+  }
+  RandomAccessGeneralMatrixReader reader("scp:tmpf_ranges.scp");
+  for (int32 n = 0; n < 2 * num_ranges; n++) {
+    int32 i = RandInt(0, num_ranges - 1);
+    Matrix<BaseFloat> value;
+    reader.Value(ranges_script[i].first).GetMatrix(&value);
+    KALDI_ASSERT(value.ApproxEqual(expected[i], 1.0e-05));
+  }
+
+  unlink("tmpf");
+  unlink("tmpf.scp");
+  unlink("tmpf2");
+  unlink("tmpf2.scp");
+  unlink("tmpf_ranges.scp");
+}
+
+// Tests reading, with several threads, an scp file in which some of the
+// objects can't be read.
+void UnitTestTableSequentialParallelPermissive() {
+  int32 sz = RandInt(1, 20);
+  std::vector<std::string> keys;
+  {
+    Int32Writer writer("ark,scp:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++) {
+      keys.push_back(std::string("key") + std::to_string(i));
+      writer.Write(keys.back(), i);
+    }
+  }
+  std::vector<std::string> scp_lines;
+  {
+    Input input("tmpf.scp");
+    std::string line;
+    while (std::getline(input.Stream(), line))
+      scp_lines.push_back(line);
+  }
+  int32 bad_index = RandInt(0, sz - 1);
+  scp_lines[bad_index] = keys[bad_index] + " nonexistent_file";
+  {
+    Output output("tmpf_bad.scp", false);
+    for (int32 i = 0; i < sz; i++)
+      output.Stream() << scp_lines[i] << "\n";
+  }
+  {
+    SequentialInt32Reader reader("scp,p,bg3:tmpf_bad.scp");
+    int32 num_read = 0;
+    for (; !reader.Done(); reader.Next(), num_read++) {
+      KALDI_ASSERT(reader.Key() != keys[bad_index]);
+      KALDI_ASSERT(keys[reader.Value()] == reader.Key());
+    }
+    KALDI_ASSERT(num_read == sz - 1 && reader.Close());
+  }
+  {
+    SequentialInt32Reader reader("scp,bg3:tmpf_bad.scp");
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == keys[i]);
+      if (i != bad_index) {
+        KALDI_ASSERT(reader.Value() == i);
+      } else {
+        bool threw = false;
+        try {
+          reader.Value();
+        } catch (const std::exception &e) {
+          threw = true;
+        }
+        KALDI_ASSERT(threw);
+      }
+    }
+    KALDI_ASSERT(i == sz);
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+  unlink("tmpf_bad.scp");
+}
+
 void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
                                          bool sorted, bool called_sorted,
                                          bool once) {
@@ -1064,6 +1271,9 @@ int main() {
     UnitTestTableSequentialInt32Script(b);
     UnitTestTableSequentialDouble(b);
     UnitTestRangesMatrix(b);
+    UnitTestRangesCompressedMatrix();
+    UnitTestSeveralRangesCompressedMatrix();
+    UnitTestTableSequentialParallelPermissive();
     for (int j = 0; j < 2; j++) {
       bool c = (j == 0);
       UnitTestTableSequentialDoubleBoth(b, c);
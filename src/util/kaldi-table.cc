@@ -232,7 +232,8 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // We also allow the meaningless prefixes b, and t,
   // plus the options o (once), no (not-once),
   // s (sorted) and ns (not-sorted), p (permissive)
-  // and np (not-permissive).
+  // and np (not-permissive), and bg or e.g. bg4 (background reading,
+  // with 4 threads).
   // so the following would be valid:
   //
   // f, o, b, np, ark:rxfilename  ->  kArchiveRspecifier
@@ -293,6 +294,14 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = false;
     } else if (!strcmp(c, "bg")) {
       if (opts) opts->background = true;
+    } else if (!strncmp(c, "bg", 2) && isdigit(c[2])) {  // e.g. "bg4".
+      int32 num_threads;
+      if (!ConvertStringToInteger(c + 2, &num_threads) || num_threads < 1)
+        return kNoRspecifier;
+      if (opts) {
+        opts->background = true;
+        opts->num_threads = num_threads;
+      }
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else
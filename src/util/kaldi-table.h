@@ -211,9 +211,12 @@ struct  RspecifierOptions {
   bool background;  // For sequential readers, if the background option ("bg")
                     // is provided, it will read ahead to the next object in a
                     // background thread.
+  int32 num_threads;  // For sequential readers of scp files, if the option
+                      // "bgN" is provided (e.g. "bg4"), N threads will read
+                      // and deserialize the objects; implies "background".
   RspecifierOptions(): once(false), sorted(false),
                        called_sorted(false), permissive(false),
-                       background(false) { }
+                       background(false), num_threads(1) { }
 };
 
 enum RspecifierType  {
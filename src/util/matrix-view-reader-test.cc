@@ -0,0 +1,178 @@
+// util/matrix-view-reader-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "util/matrix-view-reader.h"
+#include "util/kaldi-io.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+// Writes an archive of float matrices and one of compressed matrices, and an
+// scp file that covers both and has some range specifiers; returns the keys
+// and the matrices.
+static void WriteTestData(std::vector<std::string> *keys,
+                          std::vector<Matrix<BaseFloat> > *mats) {
+  std::vector<std::pair<std::string, std::string> > script, script2;
+  {
+    BaseFloatMatrixWriter writer("ark,scp:tmpf.ark,tmpf.scp");
+    CompressedMatrixWriter compressed_writer("ark,scp:tmpf2.ark,tmpf2.scp");
+    int32 num_mats = 10 + Rand() % 10;
+    for (int32 i = 0; i < num_mats; i++) {
+      // Most of the keys (including the first) have 4 characters so that the
+      // data of most of the float matrices is aligned and they can be viewed
+      // directly.
+      std::ostringstream os;
+      os << (i > 0 && Rand() % 5 == 0 ? "utt-" : "u") << (100 + i);
+      int32 num_rows = Rand() % 20, num_cols = (num_rows == 0 ? 0 :
+                                                1 + Rand() % 10);
+      Matrix<BaseFloat> mat(num_rows, num_cols);
+      mat.SetRandn();
+      if (i % 3 == 2) {
+        CompressedMatrix cmat(mat);
+        compressed_writer.Write(os.str(), cmat);
+        cmat.CopyToMat(&mat);
+      } else {
+        writer.Write(os.str(), mat);
+      }
+      keys->push_back(os.str());
+      mats->push_back(mat);
+    }
+  }
+  KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script) &&
+               ReadScriptFile("tmpf2.scp", true, &script2));
+  script.insert(script.end(), script2.begin(), script2.end());
+  // Add a range of each non-empty matrix.
+  size_t num_keys = keys->size();
+  for (size_t i = 0; i < num_keys; i++) {
+    const Matrix<BaseFloat> &mat = (*mats)[i];
+    if (mat.NumRows() == 0) continue;
+    int32 r = Rand() % mat.NumRows(), c = Rand() % mat.NumCols();
+    std::ostringstream range;
+    range << "[" << r << ":" << (mat.NumRows() - 1) << "," << c << ":"
+          << (mat.NumCols() - 1) << "]";
+    for (size_t j = 0; j < script.size(); j++) {
+      if (script[j].first == (*keys)[i]) {
+        script.push_back(std::make_pair(script[j].first + "-range",
+                                        script[j].second + range.str()));
+        break;
+      }
+    }
+    keys->push_back((*keys)[i] + "-range");
+    mats->push_back(Matrix<BaseFloat>(mat.Range(r, mat.NumRows() - r,
+                                                c, mat.NumCols() - c)));
+  }
+  std::random_shuffle(script.begin(), script.end());
+  KALDI_ASSERT(WriteScriptFile("tmpf3.scp", script));
+}
+
+static void UnitTestMatrixViewReader() {
+  std::vector<std::string> keys;
+  std::vector<Matrix<BaseFloat> > mats;
+  WriteTestData(&keys, &mats);
+
+  RandomAccessMatrixViewReader reader(Rand() % 2 == 0 ? "scp:tmpf3.scp" :
+                                      "scp,p:tmpf3.scp");
+  for (int32 n = 0; n < 3; n++) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      size_t j = (n == 0 ? i : Rand() % keys.size());
+      KALDI_ASSERT(reader.HasKey(keys[j]));
+      const MatrixBase<BaseFloat> &mat = reader.Value(keys[j]);
+      KALDI_ASSERT(mat.ApproxEqual(mats[j], 1.0e-05));
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  KALDI_ASSERT(reader.NumViews() > 0);
+  KALDI_ASSERT(reader.Close());
+
+  // Non-scp rspecifiers go to the normal reader.
+  RandomAccessMatrixViewReader ark_reader("ark:tmpf.ark");
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (ark_reader.HasKey(keys[i]))
+      KALDI_ASSERT(ark_reader.Value(keys[i]).ApproxEqual(mats[i], 1.0e-05));
+  }
+  KALDI_ASSERT(ark_reader.NumViews() == 0);
+
+  // Also test the normal reader with memory-mapping.
+  g_mmap_options.enabled = true;
+  RandomAccessBaseFloatMatrixReader table_reader("scp:tmpf3.scp");
+  for (size_t i = 0; i < keys.size(); i++) {
+    size_t j = Rand() % keys.size();
+    KALDI_ASSERT(table_reader.Value(keys[j]).ApproxEqual(mats[j], 1.0e-05));
+  }
+  g_mmap_options.enabled = false;
+
+  unlink("tmpf.ark");
+  unlink("tmpf.scp");
+  unlink("tmpf2.ark");
+  unlink("tmpf2.scp");
+  unlink("tmpf3.scp");
+}
+
+static void UnitTestMemoryInputBuf() {
+  std::string data = "0123456789";
+  MemoryInputBuf buf;
+  buf.SetData(data.data(), data.size());
+  std::istream is(&buf);
+  KALDI_ASSERT(is.get() == '0');
+  is.seekg(5);
+  KALDI_ASSERT(is.tellg() == std::streampos(5) && is.get() == '5');
+  is.seekg(-2, std::ios_base::end);
+  KALDI_ASSERT(is.get() == '8' && is.get() == '9' && is.get() == EOF);
+  is.clear();
+  is.seekg(11);
+  KALDI_ASSERT(is.fail());
+}
+
+// Checks that the cache maps a file again when it changes.
+static void UnitTestGetMappedFile() {
+  {
+    Output output("tmpf", false);
+    output.Stream() << "abc";
+  }
+  std::shared_ptr<const MappedFile> file = GetMappedFile("tmpf");
+  KALDI_ASSERT(file != NULL && file->Size() == 3 &&
+               std::string(file->Data(), 3) == "abc");
+  KALDI_ASSERT(GetMappedFile("tmpf") == file);
+  {
+    std::ofstream os("tmpf", std::ios_base::app);
+    os << "def";
+  }
+  std::shared_ptr<const MappedFile> file2 = GetMappedFile("tmpf");
+  KALDI_ASSERT(file2 != NULL && file2->Size() == 6 &&
+               std::string(file2->Data(), 6) == "abcdef");
+  KALDI_ASSERT(std::string(file->Data(), 3) == "abc");
+  KALDI_ASSERT(GetMappedFile("nonexistent-file") == NULL);
+  unlink("tmpf");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestMemoryInputBuf();
+  UnitTestGetMappedFile();
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMatrixViewReader();
+  std::cout << "Test OK.\n";
+  return 0;
+}
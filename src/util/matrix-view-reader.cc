@@ -0,0 +1,287 @@
+// util/matrix-view-reader.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include "util/matrix-view-reader.h"
+#include "util/kaldi-compressed-filebuf.h"
+#include "util/kaldi-holder.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+namespace {
+
+// If "rxfilename" is an offset into an uncompressed file, like foo.ark:1234,
+// outputs the filename and offset and returns true.
+bool SplitOffsetRxfilename(const std::string &rxfilename,
+                           std::string *filename, size_t *offset) {
+  if (ClassifyRxfilename(rxfilename) != kOffsetFileInput)
+    return false;
+  size_t pos = rxfilename.find_last_of(':');
+  *filename = std::string(rxfilename, 0, pos);
+  return ConvertStringToInteger(std::string(rxfilename, pos + 1), offset) &&
+      GetCompressionFormat(*filename) == kNoCompression;
+}
+
+// If data[0] ... data[size-1] starts with a matrix of type BaseFloat written
+// in binary mode with its binary-mode header, as in an archive, whose data
+// is suitably aligned for us to point to it, returns a view of it; otherwise
+// returns NULL.
+SubMatrix<BaseFloat> *ViewMatrix(const char *data, size_t size) {
+  // The layout is: "\0B", then "FM " or "DM ", then the number of rows and
+  // columns, each preceded by its size (4).
+  const size_t header_size = 15;
+  const char *token = (sizeof(BaseFloat) == 4 ? "FM " : "DM ");
+  if (size < header_size || data[0] != '\0' || data[1] != 'B' ||
+      std::memcmp(data + 2, token, 3) != 0 || data[5] != 4 || data[10] != 4)
+    return NULL;
+  int32 rows, cols;
+  std::memcpy(&rows, data + 6, sizeof(rows));
+  std::memcpy(&cols, data + 11, sizeof(cols));
+  const char *matrix_data = data + header_size;
+  if (rows <= 0 || cols <= 0 ||
+      static_cast<double>(rows) * cols * sizeof(BaseFloat) >
+      static_cast<double>(size - header_size) ||
+      reinterpret_cast<size_t>(matrix_data) % sizeof(BaseFloat) != 0)
+    return NULL;
+  // The memory is mapped read-only, so any attempt to modify the matrix will
+  // crash rather than change the archive.
+  BaseFloat *matrix_ptr = reinterpret_cast<BaseFloat*>(
+      const_cast<char*>(matrix_data));
+  return new SubMatrix<BaseFloat>(matrix_ptr, rows, cols, cols);
+}
+
+}  // namespace
+
+
+RandomAccessMatrixViewReader::RandomAccessMatrixViewReader(
+    const std::string &rspecifier): is_open_(false), last_found_(0),
+                                    value_(NULL), num_views_(0) {
+  if (!Open(rspecifier))
+    KALDI_ERR << "Error opening RandomAccessMatrixViewReader object "
+              << " (rspecifier is: " << rspecifier << ")";
+}
+
+bool RandomAccessMatrixViewReader::Open(const std::string &rspecifier) {
+  if (IsOpen())
+    Close();
+  rspecifier_ = rspecifier;
+  RspecifierType rs = ClassifyRspecifier(rspecifier, &script_rxfilename_,
+                                         &opts_);
+  if (rs != kScriptRspecifier) {
+    is_open_ = table_reader_.Open(rspecifier);
+    return is_open_;
+  }
+  if (!ReadScriptFile(script_rxfilename_, true, &script_))
+    return false;  // ReadScriptFile() will have printed a warning.
+  std::sort(script_.begin(), script_.end());
+  for (size_t i = 0; i + 1 < script_.size(); i++) {
+    if (script_[i].first.compare(script_[i+1].first) >= 0) {
+      KALDI_WARN << "Script file " << PrintableRxfilename(script_rxfilename_)
+                 << " contains duplicate key: " << script_[i].first;
+      script_.clear();
+      return false;
+    }
+  }
+  is_open_ = true;
+  return true;
+}
+
+bool RandomAccessMatrixViewReader::Close() {
+  if (!IsOpen())
+    KALDI_ERR << "Close() called on RandomAccessMatrixViewReader that was "
+              << "not open.";
+  is_open_ = false;
+  script_.clear();
+  last_found_ = 0;
+  cur_key_.clear();
+  value_ = NULL;
+  view_.reset();
+  mapped_file_.reset();
+  archive_filename_.clear();
+  archive_.reset();
+  matrix_.Resize(0, 0);
+  if (table_reader_.IsOpen())
+    return table_reader_.Close();
+  return true;
+}
+
+bool RandomAccessMatrixViewReader::HasKey(const std::string &key) {
+  if (!IsOpen())
+    KALDI_ERR << "HasKey() called on RandomAccessMatrixViewReader that is "
+              << "not open.";
+  if (table_reader_.IsOpen())
+    return table_reader_.HasKey(key);
+  if (opts_.permissive) {
+    // We have to check that the matrix can be read.
+    return Load(key);
+  } else {
+    std::string rxfilename;
+    return LookupFilename(key, &rxfilename);
+  }
+}
+
+const MatrixBase<BaseFloat> &RandomAccessMatrixViewReader::Value(
+    const std::string &key) {
+  if (!IsOpen())
+    KALDI_ERR << "Value() called on RandomAccessMatrixViewReader that is "
+              << "not open.";
+  if (table_reader_.IsOpen())
+    return table_reader_.Value(key);
+  if (!Load(key))
+    KALDI_ERR << "Could not find key " << key << " in script file "
+              << PrintableRxfilename(script_rxfilename_)
+              << ", or could not read its matrix (rspecifier is "
+              << rspecifier_ << ")";
+  return *value_;
+}
+
+bool RandomAccessMatrixViewReader::LookupFilename(const std::string &key,
+                                                  std::string *rxfilename) {
+  // This is the same as in RandomAccessTableReaderScriptImpl: if we're going
+  // consecutively through the scp, this will make the lookup very fast.
+  last_found_++;
+  if (last_found_ < script_.size() && script_[last_found_].first == key) {
+    *rxfilename = script_[last_found_].second;
+    return true;
+  }
+  std::pair<std::string, std::string> pr(key, "");
+  std::vector<std::pair<std::string, std::string> >::const_iterator iter =
+      std::lower_bound(script_.begin(), script_.end(), pr);
+  if (iter != script_.end() && iter->first == key) {
+    last_found_ = iter - script_.begin();
+    *rxfilename = iter->second;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+bool RandomAccessMatrixViewReader::Load(const std::string &key) {
+  if (key == cur_key_)
+    return (value_ != NULL);
+  cur_key_ = key;
+  value_ = NULL;
+  view_.reset();
+  mapped_file_.reset();
+  std::string rxfilename;
+  if (!LookupFilename(key, &rxfilename))
+    return false;
+  std::string data_rxfilename, range;
+  if (!rxfilename.empty() && rxfilename[rxfilename.size() - 1] == ']') {
+    if (!ExtractRangeSpecifier(rxfilename, &data_rxfilename, &range)) {
+      KALDI_WARN << "Could not make sense of possible range specifier in "
+                 << "filename " << rxfilename;
+      return false;
+    }
+  } else {
+    data_rxfilename = rxfilename;
+  }
+  if (!ReadEntry(data_rxfilename)) {
+    value_ = NULL;
+    return false;
+  }
+  if (!range.empty()) {
+    std::vector<int32> row_range, col_range;
+    bool ok;
+    try {  // ParseMatrixRangeSpecifier() throws on error.
+      ok = ParseMatrixRangeSpecifier(range, value_->NumRows(),
+                                     value_->NumCols(), &row_range, &col_range);
+    } catch (const std::exception &e) {
+      ok = false;
+    }
+    if (!ok) {
+      value_ = NULL;
+      return false;
+    }
+    int32 num_rows = std::min(row_range[1], value_->NumRows() - 1) -
+        row_range[0] + 1,
+        num_cols = col_range[1] - col_range[0] + 1;
+    SubMatrix<BaseFloat> *range_view =
+        new SubMatrix<BaseFloat>(*value_, row_range[0], num_rows,
+                                 col_range[0], num_cols);
+    // The data that range_view points to is owned by mapped_file_ or matrix_,
+    // not by view_, so it's OK to replace view_.
+    view_.reset(range_view);
+    value_ = range_view;
+  }
+  return true;
+}
+
+bool RandomAccessMatrixViewReader::ReadEntry(
+    const std::string &data_rxfilename) {
+  std::string filename;
+  size_t offset;
+  std::shared_ptr<const MappedFile> file;
+  if (SplitOffsetRxfilename(data_rxfilename, &filename, &offset)) {
+    // We keep the last archive we used so that we don't have to look it up
+    // in the cache (which checks whether the file has changed) for every
+    // matrix.
+    if (filename != archive_filename_ || archive_ == NULL ||
+        offset > archive_->Size()) {
+      archive_filename_ = filename;
+      archive_ = GetMappedFile(filename);
+    }
+    file = archive_;
+    if (file != NULL && offset > file->Size())
+      file.reset();  // Let Input report the error.
+  }
+  try {
+    if (file != NULL) {
+      const char *data = file->Data() + offset;
+      size_t size = file->Size() - offset;
+      SubMatrix<BaseFloat> *view = ViewMatrix(data, size);
+      if (view != NULL) {
+        view_.reset(view);
+        value_ = view;
+        mapped_file_ = file;
+        num_views_++;
+        return true;
+      }
+      // Read it from the mapped data.
+      MemoryInputBuf buf;
+      buf.SetData(data, size);
+      std::istream is(&buf);
+      bool binary;
+      if (!InitKaldiInputStream(is, &binary)) {
+        KALDI_WARN << "Failed to read header from " << data_rxfilename;
+        return false;
+      }
+      matrix_.Read(is, binary);
+    } else {
+      Input input;
+      bool binary;
+      if (!input.Open(data_rxfilename, &binary)) {
+        KALDI_WARN << "Failed to open stream "
+                   << PrintableRxfilename(data_rxfilename);
+        return false;
+      }
+      matrix_.Read(input.Stream(), binary);
+    }
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Failed to read matrix from "
+               << PrintableRxfilename(data_rxfilename) << ": " << e.what();
+    return false;
+  }
+  value_ = &matrix_;
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,110 @@
+// util/matrix-view-reader.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_MATRIX_VIEW_READER_H_
+#define KALDI_UTIL_MATRIX_VIEW_READER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+#include "util/kaldi-mmap.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+/// RandomAccessMatrixViewReader is a read-only alternative to
+/// RandomAccessBaseFloatMatrixReader for scp files that point into archives,
+/// e.g. feats.scp.  It memory-maps the archives (see kaldi-mmap.h), and for
+/// matrices that were written uncompressed in binary mode, Value() returns a
+/// SubMatrix that points directly to the mapped data, so nothing is read or
+/// copied until the matrix is used.  Range specifiers like
+/// foo.ark:1234[0:99,0:12] also give views.
+///
+/// Other entries (compressed or text-mode matrices, matrices whose data is not
+/// suitably aligned in the archive, or rxfilenames that are not offsets into
+/// uncompressed archives) are read into a Matrix as usual, which for archives
+/// is done from the mapped data.  Rspecifiers other than scp are passed to a
+/// RandomAccessBaseFloatMatrixReader.  The rspecifier options, e.g. "p", work
+/// as for the table readers.
+class RandomAccessMatrixViewReader {
+ public:
+  RandomAccessMatrixViewReader(): is_open_(false), last_found_(0),
+                                  value_(NULL), num_views_(0) { }
+
+  // Equivalent to the default constructor plus Open(), but throws on error.
+  explicit RandomAccessMatrixViewReader(const std::string &rspecifier);
+
+  bool Open(const std::string &rspecifier);
+
+  bool IsOpen() const { return is_open_; }
+
+  bool Close();
+
+  // As RandomAccessTableReader::HasKey().
+  bool HasKey(const std::string &key);
+
+  /// Returns the matrix for "key".  The reference is only valid until the next
+  /// call to HasKey(), Value() or Close(), and the matrix must not be
+  /// modified (for views, the memory is mapped read-only).
+  const MatrixBase<BaseFloat> &Value(const std::string &key);
+
+  /// Returns the number of calls to Value() that returned a view of the
+  /// mapped data, rather than a copy.  For diagnostics.
+  int64 NumViews() const { return num_views_; }
+
+ private:
+  // Finds the rxfilename for "key" in script_; returns false if not found.
+  bool LookupFilename(const std::string &key, std::string *rxfilename);
+  // Sets value_ to the matrix for "key", if it is not already; returns false
+  // if it could not be read.
+  bool Load(const std::string &key);
+  // Sets value_ to the matrix at "data_rxfilename" (without any range
+  // specifier); returns false if it could not be read.
+  bool ReadEntry(const std::string &data_rxfilename);
+
+  bool is_open_;
+  std::string rspecifier_;
+  std::string script_rxfilename_;
+  RspecifierOptions opts_;
+  // Used if the rspecifier is not an scp.
+  RandomAccessBaseFloatMatrixReader table_reader_;
+  // The contents of the scp file, sorted on the key.
+  std::vector<std::pair<std::string, std::string> > script_;
+  size_t last_found_;  // For an optimization in LookupFilename().
+
+  std::string cur_key_;  // The key we last tried to load.
+  // The matrix for cur_key_, or NULL if we failed to read it.  It points to
+  // view_ or matrix_.
+  const MatrixBase<BaseFloat> *value_;
+  std::unique_ptr<SubMatrix<BaseFloat> > view_;
+  std::shared_ptr<const MappedFile> mapped_file_;  // The archive view_ is in.
+  // The archive we read the last matrix from, and its filename.
+  std::string archive_filename_;
+  std::shared_ptr<const MappedFile> archive_;
+  Matrix<BaseFloat> matrix_;  // Used for entries that we can't view directly.
+  int64 num_views_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(RandomAccessMatrixViewReader);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_MATRIX_VIEW_READER_H_
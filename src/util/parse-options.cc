@@ -32,6 +32,7 @@
 #include "util/parse-options.h"
 #include "util/text-utils.h"
 #include "base/kaldi-common.h"
+#include "base/kaldi-profile.h"
 
 namespace kaldi {
 
@@ -385,6 +386,9 @@ int ParseOptions::Read(int argc, const char *const argv[]) {
     }
   }
 
+  if (!profile_.empty())
+    EnableProfiling(profile_);
+
   // if the user did not suppress this with --print-args = false....
   if (print_args_) {
     std::ostringstream strm;
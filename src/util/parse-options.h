@@ -28,6 +28,9 @@
 
 #include "base/kaldi-common.h"
 #include "itf/options-itf.h"
+#include "matrix/cpu-allocator.h"
+#include "util/kaldi-compressed-filebuf.h"
+#include "util/kaldi-mmap.h"
 
 namespace kaldi {
 
@@ -48,6 +51,22 @@ class ParseOptions : public OptionsItf {
     RegisterStandard("help", &help_, "Print out usage message");
     RegisterStandard("verbose", &g_kaldi_verbose_level,
                      "Verbose level (higher->more logging)");
+    RegisterStandard("cpu-memory-cache",
+                     &g_cpu_allocator_options.cache_memory,
+                     "If true, cache the memory of freed CPU matrices and "
+                     "vectors, to reduce calls to malloc()");
+    RegisterStandard("compression-threads",
+                     &g_compression_options.num_threads,
+                     "Number of threads used to compress output files ending "
+                     "in .zst (if compiled with zstd)");
+    RegisterStandard("mmap-archives", &g_mmap_options.enabled,
+                     "If true, memory-map archives that are read through scp "
+                     "files, instead of opening and seeking in them for each "
+                     "object");
+    RegisterStandard("profile", &profile_,
+                     "If set, collect timing statistics and write them to "
+                     "this file at exit: as JSON if it ends in .json, else "
+                     "as folded stacks for flame graphs");
   }
 
   /**
@@ -209,6 +228,7 @@ class ParseOptions : public OptionsItf {
   bool print_args_;     ///< variable for the implicit --print-args parameter
   bool help_;           ///< variable for the implicit --help parameter
   std::string config_;  ///< variable for the implicit --config parameter
+  std::string profile_;  ///< variable for the implicit --profile parameter
   std::vector<std::string> positional_args_;
   const char *usage_;
   int argc_;